@@ -0,0 +1,73 @@
+#include "arena.h"
+#include <stdlib.h>
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define BLOCK_HEADER ALIGN_UP(sizeof(ArenaBlock))
+
+static ArenaBlock* block_create(size_t size) {
+    ArenaBlock* block = (ArenaBlock*)malloc(BLOCK_HEADER + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+int arena_init(Arena* arena, size_t block_size) {
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->peak = 0;
+    arena->allocated = 0;
+    arena->head = block_create(arena->block_size);
+    arena->current = arena->head;
+    return arena->head ? 0 : -1;
+}
+
+void arena_destroy(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = ALIGN_UP(size ? size : 1);
+    ArenaBlock* block = arena->current;
+    if (block == NULL) {
+        return NULL;
+    }
+    // 当前块放不下时依次使用后面保留的块，都不够再追加
+    while (block->used + size > block->size) {
+        if (block->next == NULL) {
+            size_t block_size = size > arena->block_size ? size : arena->block_size;
+            block->next = block_create(block_size);
+            if (block->next == NULL) {
+                return NULL;
+            }
+        }
+        block = block->next;
+        block->used = 0;
+    }
+    arena->current = block;
+    void* p = (char*)block + BLOCK_HEADER + block->used;
+    block->used += size;
+    arena->allocated += size;
+    if (arena->allocated > arena->peak) {
+        arena->peak = arena->allocated;
+    }
+    return p;
+}
+
+void arena_reset(Arena* arena) {
+    if (arena->head == NULL) {
+        return;
+    }
+    arena->head->used = 0;
+    arena->current = arena->head;
+    arena->allocated = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+线性分配器（每个工作线程一个）
+    处理一批请求期间的临时对象（如缓存查询结果链表）都从这里按顺序切出，
+    不单独释放；回复发出后 arena_reset 一次性回收。
+    块用完时追加新块，重置后所有块保留复用，内存占用稳定在一批请求的峰值。
+*/
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;            // 可用字节数，不含块头
+    size_t used;
+} ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock* head;       // 第一个块
+    ArenaBlock* current;    // 正在分配的块
+    size_t block_size;
+    size_t peak;            // 单次重置周期内分配的最大字节数
+    size_t allocated;       // 本周期已分配的字节数
+} Arena;
+
+// 建立分配器，预先分配第一个块；失败返回 -1
+int arena_init(Arena* arena, size_t block_size);
+
+void arena_destroy(Arena* arena);
+
+// 分配 size 字节，按 ARENA_ALIGN 对齐；内存不足返回 NULL
+void* arena_alloc(Arena* arena, size_t size);
+
+// 回收本周期分配的全部内存，块保留复用
+void arena_reset(Arena* arena);
@@ -0,0 +1,194 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // recvmmsg / sendmmsg
+#endif
+
+#include "batch.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <errno.h>
+#endif
+
+int batch_size = BATCH_DEFAULT_SIZE;
+
+DNSBatch* batch_create(event_fd_t sock, int size) {
+    if (size < 1) size = 1;
+    if (size > BATCH_MAX_SIZE) size = BATCH_MAX_SIZE;
+
+    DNSBatch* batch = (DNSBatch*)calloc(1, sizeof(DNSBatch));
+    if (batch == NULL) {
+        return NULL;
+    }
+    batch->sock = sock;
+    batch->size = size;
+    batch->slots = (DNSPacket*)calloc(size, sizeof(DNSPacket));
+#ifdef __linux__
+    batch->msgs = (struct mmsghdr*)calloc(size, sizeof(struct mmsghdr));
+    batch->iovs = (struct iovec*)calloc(size, sizeof(struct iovec));
+    if (batch->msgs == NULL || batch->iovs == NULL) {
+        batch_destroy(batch);
+        return NULL;
+    }
+#endif
+    if (batch->slots == NULL) {
+        batch_destroy(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+void batch_destroy(DNSBatch* batch) {
+    if (batch == NULL) return;
+#ifdef __linux__
+    free(batch->msgs);
+    free(batch->iovs);
+#endif
+    free(batch->slots);
+    free(batch);
+}
+
+void batch_stats_add(BatchStats* stats, int n) {
+    stats->calls++;
+    stats->packets += n;
+    if ((uint64_t)n > stats->max_batch) {
+        stats->max_batch = n;
+    }
+}
+
+#ifdef __linux__
+
+// 让第 i 个 mmsghdr 指向槽位 i，len 为本次收/发的长度
+static void prepare_msg(DNSBatch* batch, int i, int len) {
+    DNSPacket* pkt = &batch->slots[i];
+    batch->iovs[i].iov_base = pkt->data;
+    batch->iovs[i].iov_len = len;
+    memset(&batch->msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+    batch->msgs[i].msg_hdr.msg_iov = &batch->iovs[i];
+    batch->msgs[i].msg_hdr.msg_iovlen = 1;
+    batch->msgs[i].msg_hdr.msg_name = &pkt->addr;
+    batch->msgs[i].msg_hdr.msg_namelen = sizeof(pkt->addr);
+    batch->msgs[i].msg_len = 0;
+}
+
+int batch_recv(DNSBatch* batch) {
+    for (int i = 0; i < batch->size; i++) {
+        prepare_msg(batch, i, BUFFER_SIZE);
+    }
+    int n = recvmmsg(batch->sock, batch->msgs, batch->size, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+        batch->count = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        perror("recvmmsg failed");
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        batch->slots[i].len = batch->msgs[i].msg_len;
+    }
+    batch->count = n;
+    if (n > 0) {
+        batch_stats_add(&batch->stats, n);
+    }
+    return n;
+}
+
+static int batch_send_all(DNSBatch* batch) {
+    int total = batch->count;
+    int sent = 0;
+    int failed = 0;
+    for (int i = 0; i < total; i++) {
+        prepare_msg(batch, i, batch->slots[i].len);
+    }
+    while (sent < total) {
+        int n = sendmmsg(batch->sock, batch->msgs + sent, total - sent, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // 发送缓冲区满：剩下的数据报一次全部丢弃，不再逐个重试，客户端会重传
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                LOG_WARNING("Send buffer full, dropping %d datagrams\n", total - sent);
+                batch->stats.dropped += total - sent;
+                failed += total - sent;
+                break;
+            }
+            // 其他错误只与当前数据报有关（如目的地址不可达）：跳过它，其余继续发送
+            LOG_ERROR("sendmmsg failed: %d\n", errno);
+            batch->stats.dropped++;
+            failed++;
+            sent++;
+            continue;
+        }
+        sent += n;
+    }
+    return total - failed;
+}
+
+#else
+
+int batch_recv(DNSBatch* batch) {
+    int n = 0;
+    while (n < batch->size) {
+        DNSPacket* pkt = &batch->slots[n];
+        socklen_t addr_len = sizeof(pkt->addr);
+        int len = recvfrom(batch->sock, pkt->data, BUFFER_SIZE, 0, (struct sockaddr*)&pkt->addr, &addr_len);
+        if (len < 0) {
+            break;
+        }
+        pkt->len = len;
+        n++;
+    }
+    batch->count = n;
+    if (n > 0) {
+        batch_stats_add(&batch->stats, n);
+    }
+    return n;
+}
+
+static int batch_send_all(DNSBatch* batch) {
+    int sent = 0;
+    for (int i = 0; i < batch->count; i++) {
+        DNSPacket* pkt = &batch->slots[i];
+        if (sendto(batch->sock, pkt->data, pkt->len, 0, (struct sockaddr*)&pkt->addr, sizeof(pkt->addr)) < 0) {
+            batch->stats.dropped++;
+        } else {
+            sent++;
+        }
+    }
+    return sent;
+}
+
+#endif
+
+int batch_flush(DNSBatch* batch) {
+    if (batch->count == 0) {
+        return 0;
+    }
+    int sent = batch->flush_hook ? batch->flush_hook(batch, batch->flush_ctx) : batch_send_all(batch);
+    batch_stats_add(&batch->stats, batch->count);
+    batch->count = 0;
+    return sent;
+}
+
+void batch_queue(DNSBatch* batch, const char* data, int len, const struct sockaddr_in* addr) {
+    if (len <= 0 || len > BUFFER_SIZE) {
+        return;
+    }
+    if (batch->count == batch->size) {
+        batch_flush(batch);
+    }
+    DNSPacket* pkt = &batch->slots[batch->count++];
+    memcpy(pkt->data, data, len);
+    pkt->len = len;
+    pkt->addr = *addr;
+}
+
+void batch_print_stats(const char* name, const DNSBatch* batch) {
+    const BatchStats* s = &batch->stats;
+    double avg = s->calls ? (double)s->packets / s->calls : 0.0;
+    LOG_DEBUG("%s: %llu packets in %llu calls, avg batch %.2f, max batch %llu, dropped %llu\n",
+              name, (unsigned long long)s->packets, (unsigned long long)s->calls, avg,
+              (unsigned long long)s->max_batch, (unsigned long long)s->dropped);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+批量收发数据报
+    Linux 下一次 recvmmsg 最多取 size 个数据报放进各自的槽位，
+    处理完后把回复与转发分别攒在发送批次里，一次 sendmmsg 发出；
+    其他平台退化为循环 recvfrom/sendto，接口不变。
+*/
+
+#ifdef _WIN32
+    #include <WinSock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+#endif
+
+#include <stdint.h>
+#include "event.h"  // event_fd_t 即各平台的 socket 类型
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 512
+#endif
+
+#define BATCH_DEFAULT_SIZE 32   // 默认批大小
+#define BATCH_MAX_SIZE 1024     // 批大小上限
+
+// 一个数据报槽位
+typedef struct DNSPacket {
+    char data[BUFFER_SIZE];
+    int len;
+    struct sockaddr_in addr;    // 接收时为来源地址，发送时为目的地址
+} DNSPacket;
+
+// 批量收发统计，packets / calls 即实际达到的平均批大小
+typedef struct BatchStats {
+    uint64_t calls;     // 有数据的系统调用次数
+    uint64_t packets;   // 收发的数据报总数
+    uint64_t max_batch; // 单次最多收发的数据报数
+    uint64_t dropped;   // 发送失败丢弃的数据报数
+} BatchStats;
+
+struct DNSBatch;
+
+// 替换默认的发送方式（如 io_uring 提交 sendmsg），返回发送成功的个数
+typedef int (*BatchFlushHook)(struct DNSBatch* batch, void* ctx);
+
+typedef struct DNSBatch {
+    event_fd_t sock;    // 绑定的 socket
+    DNSPacket* slots;
+    int size;           // 槽位数（批大小）
+    int count;          // 当前已占用的槽位数
+#ifdef __linux__
+    struct mmsghdr* msgs;
+    struct iovec* iovs;
+#endif
+    BatchStats stats;
+    BatchFlushHook flush_hook; // 为空时使用 sendmmsg/sendto
+    void* flush_ctx;
+} DNSBatch;
+
+extern int batch_size; // 由命令行 -b 配置
+
+DNSBatch* batch_create(event_fd_t sock, int size);
+
+void batch_destroy(DNSBatch* batch);
+
+// 非阻塞地收取最多 size 个数据报，返回收到的个数，无数据返回 0，出错返回 -1
+int batch_recv(DNSBatch* batch);
+
+// 把一个数据报加入发送批次，批次已满时先自动发送
+void batch_queue(DNSBatch* batch, const char* data, int len, const struct sockaddr_in* addr);
+
+// 发送批次中的全部数据报并清空，返回发送成功的个数
+int batch_flush(DNSBatch* batch);
+
+// 记录一次收发了 n 个数据报
+void batch_stats_add(BatchStats* stats, int n);
+
+void batch_print_stats(const char* name, const DNSBatch* batch);
@@ -12,6 +12,7 @@ DomainBlacklist* blacklist_create() {
         return NULL;
     }
 
+    blacklist->names = name_table_shared();
     blacklist->count = 0;
     memset(blacklist->entries, 0, sizeof(blacklist->entries));
 
@@ -32,8 +33,12 @@ void blacklist_update(DomainBlacklist* blacklist, const char* domain) {
         return ;  // 已存在，返回成功
     }
     // 添加新域名
-    memcpy(blacklist->entries[blacklist->count].domain, domain, strlen(domain));
-    blacklist->entries[blacklist->count].domain[strlen(domain)] = '\0';
+    NameId name = name_intern(blacklist->names, domain);
+    if (name == NAME_NIL) {
+        printf("Fail to update blacklist: invalid domain %s\n", domain);
+        return ;
+    }
+    blacklist->entries[blacklist->count] = name;
     blacklist->count++;
     printf("Added domain to blacklist: %s\n", domain);
 }
@@ -42,12 +47,24 @@ void blacklist_update(DomainBlacklist* blacklist, const char* domain) {
 检查域名是否在黑名单中，1表示在
 */
 int blacklist_query(DomainBlacklist* blacklist, const char* domain) {
-    if (blacklist == NULL || domain == NULL) {
+    if (blacklist == NULL || domain == NULL || blacklist->count == 0) {
+        return 0;
+    }
+    // 黑名单里的名字都在名字表中，查不到的名字肯定不在黑名单里；之后只比较整数
+    epoch_enter();
+    NameId name = name_find(blacklist->names, domain);
+    int found = name != NAME_NIL && blacklist_contains(blacklist, name);
+    epoch_exit();
+    return found;
+}
+
+int blacklist_contains(const DomainBlacklist* blacklist, NameId name) {
+    if (blacklist == NULL) {
         return 0;
     }
     for (int i = 0; i < blacklist->count; i++) {
-        if (strcmp(blacklist->entries[i].domain, domain) == 0) {
-            return 1; 
+        if (blacklist->entries[i] == name) {
+            return 1;
         }
     }
     return 0;
@@ -55,6 +72,9 @@ int blacklist_query(DomainBlacklist* blacklist, const char* domain) {
 
 void blacklist_destory(DomainBlacklist* blacklist) {
     if (blacklist) {
+        for (int i = 0; i < blacklist->count; i++) {
+            name_release(blacklist->names, blacklist->entries[i]);
+        }
         free(blacklist);
         printf("Blacklist cleaned up\n");
     }
@@ -1,13 +1,12 @@
 #pragma once
 
 #include "dnsStruct.h"
+#include "names.h"
 
-typedef struct DomainBlacklistEntry {
-    char domain[DOMAIN_MAX_LEN];
-} DomainBlacklistEntry;
-
+// 条目是全局名字表中的名字（见 names.h），黑名单持有它们的引用；比较不区分大小写
 typedef struct DomainBlacklist {
-    DomainBlacklistEntry entries[MAX_BLACKLIST_SIZE];
+    NameTable* names;
+    NameId entries[MAX_BLACKLIST_SIZE];
     int count;
 } DomainBlacklist;
 
@@ -22,5 +21,8 @@ void blacklist_update(DomainBlacklist* blacklist, const char* domain);
 // 查询域名是否在黑名单中，1表示在
 int blacklist_query(DomainBlacklist* blacklist, const char* domain);
 
+// 同 blacklist_query，名字已在名字表中（如缓存记录的所有者名），只比较整数，不进入纪元临界区
+int blacklist_contains(const DomainBlacklist* blacklist, NameId name);
+
 // 清除黑名单
 void blacklist_destory(DomainBlacklist* blacklist);
\ No newline at end of file
@@ -1,216 +1,960 @@
 #include "cache.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-DNSCache* cache_create(int capacity) {
+#ifdef _WIN32
+    #include <malloc.h>
+    #define shards_alloc(size) _aligned_malloc(size, 64)
+    #define shards_free(p) _aligned_free(p)
+#else
+    #define shards_alloc(size) aligned_alloc(64, size)
+    #define shards_free(p) free(p)
+#endif
+
+static inline CacheRecord* shard_record(const CacheShard* shard, RecordRef ref) {
+    return record_at(shard->records, ref);
+}
+
+// 分片内的名字索引：按 (名字, 类型) 找记录，编译时选择 Trie 或哈希表（见 Makefile 的 CACHE_INDEX）
+// index_find 返回第一条匹配的记录，调用方沿 next 继续时需跳过其他类型（Trie 的链表包含同名的所有类型）
+#ifdef CACHE_INDEX_TRIE
+
+// Trie 以名字的字符串为键
+static inline const char* record_domain(const CacheShard* shard, RecordRef ref) {
+    return name_string(shard->names, shard_record(shard, ref)->name);
+}
+
+static RecordRef index_find(CacheShard* shard, NameId name, uint8_t type) {
+    TrieNode* node = trie_search(shard->root, name_string(shard->names, name));
+    if (node == NULL) {
+        return RECORD_NIL;
+    }
+    for (RecordRef p = node->head; p != RECORD_NIL; p = shard_record(shard, p)->next) {
+        if (shard_record(shard, p)->type == type) {
+            return p;
+        }
+    }
+    return RECORD_NIL;
+}
+
+static int index_insert(CacheShard* shard, RecordRef record) {
+    return trie_insert(shard->root, record_domain(shard, record), shard->records, record);
+}
+
+static void index_delete(CacheShard* shard, RecordRef record) {
+    trie_delete(shard->root, record_domain(shard, record), shard->records, record);
+}
+
+static void index_replace(CacheShard* shard, RecordRef old, RecordRef record) {
+    trie_replace(shard->root, record_domain(shard, old), shard->records, old, record);
+}
+
+// ART 增删子节点时原地改写、替换节点，读者仍需持有分片锁
+static inline void read_lock(CacheShard* shard) {
+    mutex_lock(&shard->lock);
+}
+
+static inline void read_unlock(CacheShard* shard) {
+    mutex_unlock(&shard->lock);
+}
+
+#else
+
+static RecordRef index_find(CacheShard* shard, NameId name, uint8_t type) {
+    return hash_index_find(&shard->index, name, type);
+}
+
+static int index_insert(CacheShard* shard, RecordRef record) {
+    return hash_index_insert(&shard->index, record);
+}
+
+static void index_delete(CacheShard* shard, RecordRef record) {
+    hash_index_delete(&shard->index, record);
+}
+
+static void index_replace(CacheShard* shard, RecordRef old, RecordRef record) {
+    hash_index_replace(&shard->index, old, record);
+}
+
+// 哈希索引可与写者并发读，读者只需处于纪元临界区
+static inline void read_lock(CacheShard* shard) {
+    (void)shard;
+}
+
+static inline void read_unlock(CacheShard* shard) {
+    (void)shard;
+}
+
+// 扩容替换下来的旧表可能还有读者在用
+static void index_table_retire(void* table, void* arg) {
+    epoch_retire(&((CacheShard*)arg)->retired, table);
+}
+
+#endif
+
+// 读者沿链表前进：与写者发布链接的 release 配对
+static inline RecordRef record_next(const CacheShard* shard, RecordRef ref) {
+    return __atomic_load_n(&shard_record(shard, ref)->next, __ATOMIC_ACQUIRE);
+}
+
+// 记录持有的所有者名与 CNAME 目标的引用
+static void record_release_names(NameTable* names, const CacheRecord* record) {
+    name_release(names, record->name);
+    if (record->type == RR_CNAME) {
+        name_release(names, record_cname(record));
+    }
+}
+
+// 宽限期过后，记录放开所引用的名字，回到所属分片的 slab（回收在持有分片锁的写操作中进行）
+static void record_release(void* ptr, void* arg) {
+    CacheShard* shard = (CacheShard*)arg;
+    CacheRecord* record = (CacheRecord*)ptr;
+    record_release_names(shard->names, record);
+    record_free(shard->records, &shard->slab, record_ref(shard->records, record));
+}
+
+DNSCache* cache_create(int capacity, int shards) {
+    return cache_create_policy(capacity, shards, CACHE_POLICY_CLOCK);
+}
+
+DNSCache* cache_create_policy(int capacity, int shards, CachePolicy policy) {
     DNSCache* cache = (DNSCache*)malloc(sizeof(DNSCache));
-    cache->root = trie_create();
-    cache->head = NULL;
-    cache->tail = NULL;
-    cache->size = 0;
+    int count = 1;
+    int shift = 64;
+    while (count < shards && count < CACHE_MAX_SHARDS && count * 2 <= capacity) {
+        count *= 2;
+        shift--;
+    }
+    cache->shards = (CacheShard*)shards_alloc(count * sizeof(CacheShard));
+    if (cache->shards == NULL) {
+        fprintf(stderr, "Memory allocation failed for cache shards\n");
+        exit(1);
+    }
+    memset(cache->shards, 0, count * sizeof(CacheShard));
+    // 只保留地址空间，实际占用随记录增长
+    size_t reserve = (size_t)capacity * CACHE_ARENA_PER_RECORD + (size_t)count * (256 << 10);
+    if (record_arena_init(&cache->records, reserve) != 0) {
+        fprintf(stderr, "Failed to reserve %zu bytes for cache records\n", reserve);
+        exit(1);
+    }
+    cache->names = name_table_shared();
+    cache->shard_count = count;
+    cache->shard_shift = shift;
     cache->capacity = capacity;
+    cache->policy = policy;
+    cache->counter_stride = (count + 3) & ~3;  // 每项 16 字节，4 项一个缓存行
+    size_t counters_size = (size_t)EPOCH_MAX_THREADS * cache->counter_stride * sizeof(CacheCounters);
+    cache->counters = (CacheCounters*)shards_alloc(counters_size);
+    if (cache->counters == NULL) {
+        fprintf(stderr, "Memory allocation failed for cache counters\n");
+        exit(1);
+    }
+    memset(cache->counters, 0, counters_size);
+    cache->prefetch_issued = 0;
+    cache->stale_served = 0;
+    cache->keep_expired = 0;
+    for (int i = 0; i < count; i++) {
+        CacheShard* shard = &cache->shards[i];
+        // 容量除不尽的部分分给前几个分片
+        shard->capacity = capacity / count + (i < capacity % count);
+        shard->policy = policy;
+        if (policy == CACHE_POLICY_TINYLFU) {
+            shard->window_capacity = shard->capacity * TINYLFU_WINDOW_PERCENT / 100;
+            if (shard->window_capacity < 1) {
+                shard->window_capacity = 1;
+            }
+            shard->protected_capacity = (shard->capacity - shard->window_capacity) * TINYLFU_PROTECTED_PERCENT / 100;
+            if (sketch_init(&shard->sketch, (size_t)shard->capacity) != 0) {
+                fprintf(stderr, "Memory allocation failed for cache frequency sketch\n");
+                exit(1);
+            }
+        }
+        shard->records = &cache->records;
+        shard->names = cache->names;
+        shard->retired_records.release = record_release;
+        shard->retired_records.release_arg = shard;
+#ifdef CACHE_INDEX_TRIE
+        shard->root = trie_create();
+#else
+        if (hash_index_init(&shard->index, (size_t)shard->capacity, &cache->records) != 0) {
+            fprintf(stderr, "Memory allocation failed for cache index\n");
+            exit(1);
+        }
+        shard->index.retire = index_table_retire;
+        shard->index.retire_arg = shard;
+#endif
+        mutex_init(&shard->lock);
+    }
     return cache;
 }
 
-void lru_insert(DNSCache* cache, DNSRecord* record) {
-    if (cache->head == NULL) {
-        cache->head = record;
-        cache->tail = record;
+// 用名字哈希的高位选分片，与驻留表选段所用的低位错开
+static inline CacheShard* hash_shard(DNSCache* cache, uint64_t hash) {
+    if (cache->shard_count == 1) {
+        return &cache->shards[0];
+    }
+    return &cache->shards[hash >> cache->shard_shift];
+}
+
+CacheShard* cache_shard(DNSCache* cache, const char* domain) {
+    if (cache->shard_count == 1) {
+        return &cache->shards[0];
+    }
+    return hash_shard(cache, name_hash(domain, strlen(domain)));
+}
+
+// 同 cache_shard，哈希取自驻留表，不必重新计算
+static CacheShard* name_shard(DNSCache* cache, NameId name) {
+    return hash_shard(cache, name_entry(cache->names, name)->hash);
+}
+
+int cache_size(const DNSCache* cache) {
+    int size = 0;
+    for (int i = 0; i < cache->shard_count; i++) {
+        size += cache->shards[i].size;
+    }
+    return size;
+}
+
+size_t cache_record_bytes(const DNSCache* cache) {
+    size_t bytes = 0;
+    for (int i = 0; i < cache->shard_count; i++) {
+        bytes += cache->shards[i].slab.bytes;
+    }
+    return bytes;
+}
+
+void cache_shard_lookups(const DNSCache* cache, int shard, uint64_t* hits, uint64_t* misses) {
+    *hits = 0;
+    *misses = 0;
+    int threads = epoch_threads();
+    for (int i = 0; i < threads; i++) {
+        const CacheCounters* counters = &cache->counters[(size_t)i * cache->counter_stride + shard];
+        *hits += __atomic_load_n(&counters->hits, __ATOMIC_RELAXED);
+        *misses += __atomic_load_n(&counters->misses, __ATOMIC_RELAXED);
+    }
+}
+
+// 以下分片内的操作由调用方持有 shard->lock
+static void lru_insert(CacheShard* shard, int segment, RecordRef ref) {
+    RecordList* list = &shard->lru[segment];
+    CacheRecord* record = shard_record(shard, ref);
+    record->segment = (uint8_t)segment;
+    record->lru_prev = list->tail;
+    record->lru_next = RECORD_NIL;
+    if (list->head == RECORD_NIL) {
+        list->head = ref;
     } else {
-        record->lru_prev = cache->tail;
-        cache->tail->lru_next = record;
-        cache->tail = record;
+        shard_record(shard, list->tail)->lru_next = ref;
     }
-    cache->size++;
+    list->tail = ref;
+    list->size++;
+    shard->size++;
 }
 
-void lru_delete(DNSCache* cache, DNSRecord* record) {
-    if (record == cache->head && record == cache->tail) {
-        cache->head = NULL;
-        cache->tail = NULL;
-    } else if (record == cache->head) {
-        cache->head = record->lru_next;
-    } else if (record == cache->tail) {
-        cache->tail = record->lru_prev;
+static void lru_delete(CacheShard* shard, RecordRef ref) {
+    CacheRecord* record = shard_record(shard, ref);
+    RecordList* list = &shard->lru[record->segment];
+    if (record->lru_prev != RECORD_NIL) {
+        shard_record(shard, record->lru_prev)->lru_next = record->lru_next;
+    } else {
+        list->head = record->lru_next;
+    }
+    if (record->lru_next != RECORD_NIL) {
+        shard_record(shard, record->lru_next)->lru_prev = record->lru_prev;
     } else {
-        record->lru_prev->lru_next = record->lru_next;
-        record->lru_next->lru_prev = record->lru_prev;
+        list->tail = record->lru_prev;
     }
-    cache->size--;
+    record->lru_prev = RECORD_NIL;
+    record->lru_next = RECORD_NIL;
+    list->size--;
+    shard->size--;
 }
 
-void cache_eliminate(DNSCache* cache) {
-    DNSRecord* record = cache->head;
-    trie_delete(cache->root, record->domain, record);
-    lru_delete(cache, record);
-    free(record);
+// 移到 segment 链表的尾部
+static void lru_move(CacheShard* shard, RecordRef ref, int segment) {
+    lru_delete(shard, ref);
+    lru_insert(shard, segment, ref);
 }
 
-void cache_update(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl) {
-    DNSRecord* record = DNSRecord_create(domain, time(NULL) + ttl, type, value);
-    if (record == NULL) {
-        fprintf(stderr, "Failed to create DNS record\n");
-        return;
+// 清掉命中标记，返回上次扫描以来是否被命中过
+static int record_take_reference(CacheRecord* record) {
+    if (!(__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_REFERENCED)) {
+        return 0;
     }
+    __atomic_fetch_and(&record->flags, (uint8_t)~RECORD_REFERENCED, __ATOMIC_RELAXED);
+    return 1;
+}
 
-    printf("%s\n",domain);
-    
-    DNSRecord* isExist = NULL;
-    TrieNode* node = trie_search(cache->root, domain);
-    if (node != NULL) {
-        DNSRecord* p = node->head;
-        while (p != NULL) {
-            if (DNSRecord_compare(p, record) == 1) {
-                isExist = p;
-                break;
-            }
-            p = p->trie_next;
+// 过期堆：写堆元素的同时更新记录中的位置
+static void expiry_set(CacheShard* shard, uint32_t i, ExpiryEntry entry) {
+    shard->expiry[i] = entry;
+    shard_record(shard, entry.ref)->expiry = i;
+}
+
+static void expiry_sift_up(CacheShard* shard, uint32_t i) {
+    ExpiryEntry entry = shard->expiry[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (shard->expiry[parent].expire_time <= entry.expire_time) {
+            break;
         }
+        expiry_set(shard, i, shard->expiry[parent]);
+        i = parent;
     }
-    
-    if (isExist == NULL) {     // 无相同记录
-        int flag = trie_insert(cache->root, domain, record);
-        if (flag == -1) return; // 插入失败
-        if (cache->size == cache->capacity) { // 缓存已满
-            cache_eliminate(cache);
+    expiry_set(shard, i, entry);
+}
+
+static void expiry_sift_down(CacheShard* shard, uint32_t i) {
+    ExpiryEntry entry = shard->expiry[i];
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= shard->expiry_count) {
+            break;
+        }
+        if (child + 1 < shard->expiry_count &&
+            shard->expiry[child + 1].expire_time < shard->expiry[child].expire_time) {
+            child++;
         }
-        lru_insert(cache, record);
-    } else {    // 有相同记录
-        lru_delete(cache, isExist);
-        trie_delete(cache->root, domain, isExist);
-        free(isExist);
-        lru_insert(cache, record);
-        trie_insert(cache->root, domain, record);
+        if (entry.expire_time <= shard->expiry[child].expire_time) {
+            break;
+        }
+        expiry_set(shard, i, shard->expiry[child]);
+        i = child;
     }
+    expiry_set(shard, i, entry);
 }
 
-CacheQueryResult* cache_query(DNSCache* cache, const char* domain, const uint8_t type) {
-    // 构建结果链表
-    CacheQueryResult* result = NULL;
-    CacheQueryResult* current = NULL;
-    
-    const int MAX_CNAME_DEPTH = 5;
-    int cname_depth = 0;
-    
-    TrieNode* node = trie_search(cache->root, domain);
-    // 更新LRU
-    if(node!=NULL && node->head!=NULL) {
-        if (node->head->type == RR_A) {
-            cache_update(cache, domain, RR_A, &node->head->value.ipv4, 300);
-        } else if (node->head->type == RR_AAAA) {
-            cache_update(cache, domain, RR_AAAA, &node->head->value.ipv6, 300);
-        } else if (node->head->type == RR_CNAME) {
-            cache_update(cache, domain, RR_CNAME, node->head->value.cname, 300);
+// 静态记录不会过期，不进堆；堆扩容失败时记录也不进堆，查询照样判其过期，最终由 CLOCK 淘汰
+static void expiry_insert(CacheShard* shard, RecordRef ref) {
+    CacheRecord* record = shard_record(shard, ref);
+    if (__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_STATIC) {
+        return;
+    }
+    if (shard->expiry_count == shard->expiry_capacity) {
+        uint32_t capacity = shard->expiry_capacity ? shard->expiry_capacity * 2 : 64;
+        ExpiryEntry* entries = (ExpiryEntry*)realloc(shard->expiry, capacity * sizeof(ExpiryEntry));
+        if (entries == NULL) {
+            return;
+        }
+        shard->expiry = entries;
+        shard->expiry_capacity = capacity;
+    }
+    uint32_t i = shard->expiry_count++;
+    shard->expiry[i].expire_time = record->expire_time;
+    shard->expiry[i].ref = ref;
+    expiry_sift_up(shard, i);
+}
+
+// 用最后一个元素填上空位，再按它与父节点的大小上浮或下沉
+static void expiry_delete(CacheShard* shard, RecordRef ref) {
+    CacheRecord* record = shard_record(shard, ref);
+    uint32_t i = record->expiry;
+    if (i == RECORD_NO_EXPIRY) {
+        return;
+    }
+    record->expiry = RECORD_NO_EXPIRY;
+    uint32_t last = --shard->expiry_count;
+    if (i == last) {
+        return;
+    }
+    expiry_set(shard, i, shard->expiry[last]);
+    if (i > 0 && shard->expiry[i].expire_time < shard->expiry[(i - 1) / 2].expire_time) {
+        expiry_sift_up(shard, i);
+    } else {
+        expiry_sift_down(shard, i);
+    }
+}
+
+// 已从索引摘下的记录，等读者离开后放回 slab
+static void record_retire(CacheShard* shard, RecordRef ref) {
+    epoch_retire(&shard->retired_records, shard_record(shard, ref));
+}
+
+// 从索引、LRU 链表和过期堆中摘下记录
+static void shard_remove(CacheShard* shard, RecordRef ref) {
+    index_delete(shard, ref);
+    lru_delete(shard, ref);
+    expiry_delete(shard, ref);
+    record_retire(shard, ref);
+}
+
+// 从堆顶摘下过期时间不晚于 cutoff 的记录，最多 budget 条
+static int shard_expire(CacheShard* shard, time_t cutoff, int budget) {
+    int removed = 0;
+    while (removed < budget && shard->expiry_count > 0 && shard->expiry[0].expire_time <= cutoff) {
+        shard_remove(shard, shard->expiry[0].ref);
+        removed++;
+    }
+    shard->expirations += removed;
+    return removed;
+}
+
+// 写操作结束前回收已过宽限期的记录和旧表
+static void shard_reclaim(CacheShard* shard) {
+    epoch_reclaim(&shard->retired_records);
+    epoch_reclaim(&shard->retired);
+}
+
+// CLOCK：从最老的开始，命中过的清掉标记移到尾部，淘汰第一条没被命中过的；最多转一圈
+static void cache_eliminate(CacheShard* shard) {
+    RecordList* list = &shard->lru[0];
+    RecordRef ref = list->head;
+    for (int i = list->size; i > 0 && record_take_reference(shard_record(shard, ref)); i--) {
+        lru_move(shard, ref, 0);
+        ref = list->head;
+    }
+    shard_remove(shard, ref);
+    shard->evictions++;
+}
+
+static inline uint64_t record_hash(const CacheShard* shard, RecordRef ref) {
+    return name_entry(shard->names, shard_record(shard, ref)->name)->hash;
+}
+
+// W-TinyLFU：保护段超出上限时，最老的降回试用段（命中过的先在保护段再留一轮）
+static void tinylfu_demote(CacheShard* shard) {
+    RecordList* protect = &shard->lru[CACHE_SEGMENT_PROTECTED];
+    for (int chances = protect->size; protect->size > shard->protected_capacity;) {
+        RecordRef ref = protect->head;
+        if (chances > 0 && record_take_reference(shard_record(shard, ref))) {
+            chances--;
+            lru_move(shard, ref, CACHE_SEGMENT_PROTECTED);
         } else {
-            return NULL;
+            lru_move(shard, ref, CACHE_SEGMENT_PROBATION);
         }
     }
-    // 注意此时的node已变，需要更新
-    node = trie_search(cache->root, domain);
-    // 处理CNAME链，最后得到的node不是CNAME
-    while (node != NULL && node->head->type == RR_CNAME) {
-        ++cname_depth;
-        if(cname_depth > MAX_CNAME_DEPTH) {
-            fprintf(stderr, "CNAME loop detected\n");
-            cache_query_free(result);
-            return NULL;
+}
+
+// 主区的淘汰对象：试用段中最老、上次扫描以来没被命中过的记录，扫到的命中过的记录升入保护段；
+// 试用段为空时取保护段最老的，主区为空返回 RECORD_NIL
+static RecordRef tinylfu_victim(CacheShard* shard) {
+    RecordList* probation = &shard->lru[CACHE_SEGMENT_PROBATION];
+    RecordList* protect = &shard->lru[CACHE_SEGMENT_PROTECTED];
+    for (int chances = probation->size + protect->size; chances > 0 && probation->head != RECORD_NIL; chances--) {
+        RecordRef ref = probation->head;
+        if (!record_take_reference(shard_record(shard, ref))) {
+            return ref;
         }
-        if (current == NULL) {
-            result = malloc(sizeof(CacheQueryResult));
-            current = result;
+        lru_move(shard, ref, CACHE_SEGMENT_PROTECTED);
+        tinylfu_demote(shard);
+    }
+    return probation->head != RECORD_NIL ? probation->head : protect->head;
+}
+
+// 从窗口挤出的候选：分片还有空位时直接进试用段；
+// 否则与主区的淘汰对象比较名字的访问频率，候选更常被查询才换掉它，相等时留下原有的
+static void tinylfu_admit(CacheShard* shard, RecordRef candidate) {
+    if (shard->size < shard->capacity) {
+        lru_move(shard, candidate, CACHE_SEGMENT_PROBATION);
+        return;
+    }
+    RecordRef victim = tinylfu_victim(shard);
+    if (victim != RECORD_NIL && sketch_estimate(&shard->sketch, record_hash(shard, candidate)) >
+                                    sketch_estimate(&shard->sketch, record_hash(shard, victim))) {
+        shard_remove(shard, victim);
+        lru_move(shard, candidate, CACHE_SEGMENT_PROBATION);
+    } else {
+        shard_remove(shard, candidate);
+        shard->rejections++;
+    }
+    shard->evictions++;
+}
+
+// 新记录进窗口尾部。先为它腾出窗口的位置：窗口最老的记录命中过就移到尾部再留一轮，
+// 否则作为候选移出窗口；窗口有空位而分片已满（窗口里的记录过期了）时直接淘汰主区的记录
+static void tinylfu_insert(CacheShard* shard, RecordRef ref) {
+    sketch_age(&shard->sketch);
+    RecordList* window = &shard->lru[CACHE_SEGMENT_WINDOW];
+    for (int chances = window->size; window->size >= shard->window_capacity;) {
+        RecordRef head = window->head;
+        if (chances > 0 && record_take_reference(shard_record(shard, head))) {
+            chances--;
+            lru_move(shard, head, CACHE_SEGMENT_WINDOW);
         } else {
-            current->next = malloc(sizeof(CacheQueryResult));
-            current = current->next;
+            tinylfu_admit(shard, head);
         }
-        current->record = node->head;
-        current->next = NULL;
-        node = trie_search(cache->root, node->head->domain);
     }
-    
-    // 注意特判无ip情况
-    if (node == NULL) {
-        cache_query_free(result);
-        return NULL;
+    if (shard->size >= shard->capacity) {
+        RecordRef victim = tinylfu_victim(shard);
+        if (victim != RECORD_NIL) {
+            shard_remove(shard, victim);
+            shard->evictions++;
+        }
     }
+    lru_insert(shard, CACHE_SEGMENT_WINDOW, ref);
+}
+
+// 删除 name 上被新记录取代的负缓存条目：qtype 为 0 时删除全部，
+// 否则删除 NXDOMAIN 和该类型的 NODATA
+static void cache_drop_negative(CacheShard* shard, NameId name, uint16_t qtype) {
+    RecordRef p = index_find(shard, name, RR_NEGATIVE);
+    while (p != RECORD_NIL) {
+        CacheRecord* record = shard_record(shard, p);
+        RecordRef next = record->next;
+        if (record->type == RR_NEGATIVE) {
+            uint16_t negative_qtype = record_negative_qtype(record);
+            if (qtype == 0 || negative_qtype == 0 || negative_qtype == qtype) {
+                shard_remove(shard, p);
+            }
+        }
+        p = next;
+    }
+}
 
-    if (type == RR_CNAME) {
-        return result;
+// name 是调用方驻留好的所有者名，它的引用交给新记录，不需要新记录时在这里释放
+static void shard_insert(CacheShard* shard, NameId name, const uint8_t type, const void* value, time_t ttl,
+                         uint8_t flags) {
+    const char* domain = name_string(shard->names, name);
+    if (type != RR_NEGATIVE) {
+        // 名字或该类型已有数据，之前缓存的不存在应答作废
+        cache_drop_negative(shard, name, type == RR_CNAME ? 0 : type);
     }
+    // 先在栈上构造候选记录比对，只有确实是新记录时才分配
+    DNSRecord candidate;
+    NameId target = NAME_NIL;
+    if (DNSRecord_init(&candidate, domain, time(NULL) + ttl, type, value) != 0 ||
+        (type == RR_CNAME && (target = name_intern(shard->names, candidate.value.cname)) == NAME_NIL)) {
+        fprintf(stderr, "Failed to create DNS record\n");
+        name_release(shard->names, name);
+        return;
+    }
+    candidate.ttl = (uint32_t)ttl;
+    candidate.flags = flags;
+
+    LOG_DEBUG("Cache insert: %s\n", domain);
     
-    int isExist = 0;
-    DNSRecord* p = node->head;
+    RecordRef isExist = RECORD_NIL;
+    for (RecordRef p = index_find(shard, name, type); p != RECORD_NIL; p = shard_record(shard, p)->next) {
+        if (record_equal(shard_record(shard, p), &candidate, name, target)) {
+            isExist = p;
+            break;
+        }
+    }
     
-    while (p != NULL) {
-        if (p->type == type) {
-            if (current == NULL) {
-                result = malloc(sizeof(CacheQueryResult));
-                current = result;
+    RecordRef record = RECORD_NIL;
+    if (isExist == RECORD_NIL) {     // 无相同记录
+        record = record_pack(shard->records, &shard->slab, &candidate, name, target);
+        if (record == RECORD_NIL) {
+            fprintf(stderr, "Failed to create DNS record\n");
+        } else if (index_insert(shard, record) == -1) { // 插入失败
+            record_free(shard->records, &shard->slab, record);
+            record = RECORD_NIL;
+        } else {
+            expiry_insert(shard, record);
+            if (shard->policy == CACHE_POLICY_TINYLFU) {
+                tinylfu_insert(shard, record);
             } else {
-                current->next = malloc(sizeof(CacheQueryResult));
-                current = current->next;
+                if (shard->size == shard->capacity) { // 分片已满
+                    cache_eliminate(shard);
+                }
+                lru_insert(shard, 0, record);
             }
-            current->record = p;
-            current->next = NULL;
-            
-            isExist = 1;
+            shard->inserts++;
+        }
+    } else if ((__atomic_load_n(&shard_record(shard, isExist)->flags, __ATOMIC_RELAXED) & RECORD_STATIC) &&
+               !(flags & RECORD_STATIC)) {
+        // 上游的应答不覆盖本地配置
+    } else {    // 有相同记录：读者可能正在复制它，换上刷新了过期时间的新副本，放到所在链表的尾部
+        record = record_pack(shard->records, &shard->slab, &candidate, name, target);
+        if (record == RECORD_NIL) {
+            fprintf(stderr, "Failed to create DNS record\n");
+        } else {
+            int segment = shard_record(shard, isExist)->segment;
+            index_replace(shard, isExist, record);
+            lru_delete(shard, isExist);
+            lru_insert(shard, segment, record);
+            expiry_delete(shard, isExist);
+            expiry_insert(shard, record);
+            record_retire(shard, isExist);
         }
-        p = p->trie_next;
     }
-    
-    if (!isExist) {
-        cache_query_free(result);
+    if (record == RECORD_NIL) {     // 名字的引用没有交给记录
+        name_release(shard->names, name);
+        name_release(shard->names, target);
+    }
+}
+
+// 驻留所有者名并锁住它所在的分片；名字无效或驻留表已满返回 NULL
+static CacheShard* shard_lock_name(DNSCache* cache, const char* domain, NameId* name) {
+    *name = name_intern(cache->names, domain);
+    if (*name == NAME_NIL) {
+        fprintf(stderr, "Failed to create DNS record\n");
         return NULL;
     }
+    CacheShard* shard = name_shard(cache, *name);
+    mutex_lock(&shard->lock);
+    return shard;
+}
+
+void cache_insert(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl, uint8_t flags) {
+    NameId name;
+    CacheShard* shard = shard_lock_name(cache, domain, &name);
+    if (shard == NULL) {
+        return;
+    }
+    // 先清掉堆顶已过期的记录，分片满时腾出的位置不必再淘汰有效的记录
+    shard_expire(shard, time(NULL) - cache->keep_expired, CACHE_EXPIRE_BATCH);
+    shard_insert(shard, name, type, value, ttl, flags);
+    shard_reclaim(shard);
+    mutex_unlock(&shard->lock);
+}
+
+void cache_update(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl) {
+    cache_insert(cache, domain, type, value, ttl, 0);
+}
+
+void cache_insert_negative(DNSCache* cache, const char* domain, uint16_t qtype, uint8_t rcode, const char* zone,
+                           uint32_t soa_ttl, const DNSSoa* soa) {
+    NegativeAnswer negative;
+    memset(&negative, 0, sizeof(negative));
+    negative.qtype = rcode == RCODE_NXDOMAIN ? 0 : qtype;
+    negative.rcode = rcode;
+
+    // SOA 所有者名 + MNAME + RNAME + 5 个 32 位字段
+    int max_length = (int)sizeof(negative.soa);
+    int owner_len = encode_dns_name(zone, negative.soa, max_length);
+    if (owner_len < 0) {
+        return;
+    }
+    int offset = owner_len;
+    int len = encode_dns_name(soa->mname, negative.soa + offset, max_length - offset);
+    if (len < 0) {
+        return;
+    }
+    offset += len;
+    len = encode_dns_name(soa->rname, negative.soa + offset, max_length - offset);
+    if (len < 0 || offset + len + 20 > max_length) {
+        return;
+    }
+    offset += len;
+    uint32_t fields[5] = {soa->serial, soa->refresh, soa->retry, soa->expire, soa->minimum};
+    for (int i = 0; i < 5; i++) {
+        uint32_t field = htonl(fields[i]);
+        memcpy(negative.soa + offset, &field, 4);
+        offset += 4;
+    }
+    negative.owner_len = (uint8_t)owner_len;
+    negative.rdata_len = (uint8_t)(offset - owner_len);
+
+    time_t ttl = soa_ttl < soa->minimum ? soa_ttl : soa->minimum;
+    if (ttl == 0) {
+        return;
+    }
+    NameId name;
+    CacheShard* shard = shard_lock_name(cache, domain, &name);
+    if (shard == NULL) {
+        return;
+    }
+    shard_expire(shard, time(NULL) - cache->keep_expired, CACHE_EXPIRE_BATCH);
+    cache_drop_negative(shard, name, negative.qtype);
+    shard_insert(shard, name, RR_NEGATIVE, &negative, ttl, 0);
+    shard_reclaim(shard);
+    mutex_unlock(&shard->lock);
+}
+
+void cache_update_static(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl) {
+    cache_insert(cache, domain, type, value, ttl, RECORD_STATIC);
+}
+
+int cache_expire(DNSCache* cache, time_t now, int budget) {
+    time_t cutoff = now - cache->keep_expired;
+    int removed = 0;
+    for (int i = 0; i < cache->shard_count; i++) {
+        CacheShard* shard = &cache->shards[i];
+        if (!mutex_trylock(&shard->lock)) {
+            continue;
+        }
+        removed += shard_expire(shard, cutoff, budget);
+        shard_reclaim(shard);
+        mutex_unlock(&shard->lock);
+    }
+    return removed;
+}
+
+int record_expired(const DNSRecord* record, time_t now) {
+    return !(__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_STATIC) && record->expire_time <= now;
+}
+
+static int cached_expired(const CacheRecord* record, time_t now) {
+    return !(__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_STATIC) && record->expire_time <= now;
+}
+
+// 命中：不加锁，只在状态确实变化时写，被反复命中的热点记录不再产生写操作；TTL 照常流逝
+static void record_touch(CacheShard* shard, CacheRecord* record) {
+    if (__atomic_load_n(&record->hits, __ATOMIC_RELAXED) < PREFETCH_MIN_HITS) {
+        __atomic_fetch_add(&record->hits, 1, __ATOMIC_RELAXED);
+    }
+    uint8_t flags = __atomic_load_n(&record->flags, __ATOMIC_RELAXED);
+    if ((flags & RECORD_PREFETCHED) &&
+        (__atomic_fetch_and(&record->flags, (uint8_t)~RECORD_PREFETCHED, __ATOMIC_RELAXED) & RECORD_PREFETCHED)) {
+        __atomic_fetch_add(&shard->prefetch_used, 1, __ATOMIC_RELAXED);
+    }
+    if (!(flags & RECORD_REFERENCED)) {
+        __atomic_fetch_or(&record->flags, RECORD_REFERENCED, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void view_set(const DNSCache* cache, CacheView* view, const CacheRecord* record) {
+    view->record = record;
+    view->domain = name_string(cache->names, record->name);
+    view->target = record->type == RR_CNAME ? name_string(cache->names, record_cname(record)) : NULL;
+}
+
+// 按 now 判断过期；now 往前推即可接受已过期一段时间的记录
+// 调用方处于纪元临界区；CNAME 链上的每个名字各自查所在的分片，沿目标的 NameId 前进，不再比较字符串。
+// 每个名字先找查询的类型，直接命中只查一次索引；没有未过期的记录时再找 CNAME。
+// touch 为真时命中的记录计为命中，W-TinyLFU 下链上每个名字无论命中与否都计一次访问；
+// serve-stale 的查找不算访问（未命中时已计过一次），不改写记录
+static int cache_lookup_chain(DNSCache* cache, NameId name, const uint8_t type, time_t now, CacheView* views,
+                              int max, int touch) {
+    const int MAX_CNAME_DEPTH = 5;
+    int cname_depth = 0;
+    int count = 0;
+
+    // 处理CNAME链，最后得到的name没有CNAME记录
+    for (;;) {
+        CacheShard* shard = name_shard(cache, name);
+        if (touch && shard->policy == CACHE_POLICY_TINYLFU) {
+            sketch_increment(&shard->sketch, name_entry(cache->names, name)->hash);
+        }
+        read_lock(shard);
+        if (type != RR_CNAME) {
+            int isExist = 0;
+            for (RecordRef ref = index_find(shard, name, type); ref != RECORD_NIL; ref = record_next(shard, ref)) {
+                CacheRecord* p = shard_record(shard, ref);
+                if (p->type == type && !cached_expired(p, now)) {
+                    if (count < max) {     // 放不下的记录不进应答
+                        view_set(cache, &views[count++], p);
+                    }
+                    if (touch) {
+                        record_touch(shard, p);
+                    }
+                    isExist = 1;
+                }
+            }
+            if (isExist) {
+                read_unlock(shard);
+                return count;
+            }
+        }
+        RecordRef cname_ref = index_find(shard, name, RR_CNAME);
+        if (cname_ref == RECORD_NIL) {
+            read_unlock(shard);
+            return type == RR_CNAME ? count : 0;
+        }
+
+        ++cname_depth;
+        CacheRecord* cname = shard_record(shard, cname_ref);
+        if (cached_expired(cname, now) || count == max) {  // 链上任何一环过期都视为未命中
+            read_unlock(shard);
+            return 0;
+        }
+        if(cname_depth > MAX_CNAME_DEPTH) {
+            read_unlock(shard);
+            fprintf(stderr, "CNAME loop detected\n");
+            return 0;
+        }
+        view_set(cache, &views[count++], cname);
+        if (touch) {
+            record_touch(shard, cname);
+        }
+        read_unlock(shard);
+        // 记录在宽限期内仍持有目标名字的引用，解锁后也可以继续用
+        name = record_cname(cname);
+    }
+}
+
+// 统计按查询名所在的分片记在本线程的那一行，只有本线程写；名字已驻留时用表中的哈希选分片。
+// W-TinyLFU 下驻留表中还没有的名字也计一次访问，反复被查询的名字写入后更容易被接纳
+static void count_lookup(DNSCache* cache, const char* domain, NameId name, int hit) {
+    CacheShard* shard;
+    if (name != NAME_NIL) {
+        shard = name_shard(cache, name);
+    } else if (cache->policy == CACHE_POLICY_TINYLFU) {
+        uint64_t hash = name_hash(domain, strlen(domain));
+        shard = hash_shard(cache, hash);
+        sketch_increment(&shard->sketch, hash);
+    } else {
+        shard = cache_shard(cache, domain);
+    }
+    CacheCounters* counters =
+        &cache->counters[(size_t)epoch_thread_id() * cache->counter_stride + (size_t)(shard - cache->shards)];
+    uint64_t* counter = hit ? &counters->hits : &counters->misses;
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+int cache_query_views(DNSCache* cache, const char* domain, const uint8_t type, CacheView* views, int max) {
+    // 驻留表中没有的名字不可能有记录
+    NameId name = name_find(cache->names, domain);
+    int count = name != NAME_NIL ? cache_lookup_chain(cache, name, type, time(NULL), views, max, 1) : 0;
+    count_lookup(cache, domain, name, count > 0);
+    return count;
+}
+
+// 把借用的记录解码到 arena，连成结果链表；arena 用尽返回 NULL
+static CacheQueryResult* views_copy(Arena* arena, const NameTable* names, const CacheView* views, int count) {
+    CacheQueryResult* result = NULL;
+    CacheQueryResult** tail = &result;
+    for (int i = 0; i < count; i++) {
+        CacheQueryResult* next = arena_alloc(arena, sizeof(CacheQueryResult));
+        DNSRecord* copy = arena_alloc(arena, sizeof(DNSRecord));
+        if (next == NULL || copy == NULL) {
+            return NULL;
+        }
+        record_unpack(views[i].record, names, copy);
+        next->record = copy;
+        next->next = NULL;
+        *tail = next;
+        tail = &next->next;
+    }
     return result;
 }
 
-void cache_query_free(CacheQueryResult* result) {
-    CacheQueryResult* p = result;
-    while (p != NULL) {
-        CacheQueryResult* next = p->next;
-        free(p);
-        p = next;
+CacheQueryResult* cache_query(DNSCache* cache, Arena* arena, const char* domain, const uint8_t type) {
+    CacheView views[CACHE_MAX_ANSWERS];
+    epoch_enter();
+    int count = cache_query_views(cache, domain, type, views, CACHE_MAX_ANSWERS);
+    CacheQueryResult* result = views_copy(arena, cache->names, views, count);
+    epoch_exit();
+    return result;
+}
+
+CacheQueryResult* cache_query_stale(DNSCache* cache, Arena* arena, const char* domain, const uint8_t type,
+                                    time_t max_stale) {
+    CacheView views[CACHE_MAX_ANSWERS];
+    CacheQueryResult* result = NULL;
+    epoch_enter();
+    NameId name = name_find(cache->names, domain);
+    if (name != NAME_NIL) {
+        int count = cache_lookup_chain(cache, name, type, time(NULL) - max_stale, views, CACHE_MAX_ANSWERS, 0);
+        result = views_copy(arena, cache->names, views, count);
     }
+    epoch_exit();
+    return result;
 }
 
-void cache_destroy(DNSCache* cache) {
-    trie_free(cache->root);
-    while (cache->head != NULL) {
-        DNSRecord* next = cache->head->lru_next;
-        free(cache->head);
-        cache->head = next;
+DNSRecord* cache_query_negative(DNSCache* cache, Arena* arena, const char* domain, uint16_t qtype) {
+    DNSRecord* copy = NULL;
+    time_t now = time(NULL);
+    epoch_enter();
+    NameId name = name_find(cache->names, domain);
+    if (name == NAME_NIL) {
+        epoch_exit();
+        return NULL;
     }
-    free(cache);
+    CacheShard* shard = name_shard(cache, name);
+    read_lock(shard);
+    for (RecordRef ref = index_find(shard, name, RR_NEGATIVE); ref != RECORD_NIL; ref = record_next(shard, ref)) {
+        CacheRecord* p = shard_record(shard, ref);
+        if (p->type == RR_NEGATIVE && !cached_expired(p, now) &&
+            (record_negative_qtype(p) == 0 || record_negative_qtype(p) == qtype)) {
+            record_touch(shard, p);
+            copy = arena_alloc(arena, sizeof(DNSRecord));
+            if (copy != NULL) {
+                record_unpack(p, cache->names, copy);
+            }
+            break;
+        }
+    }
+    read_unlock(shard);
+    epoch_exit();
+    return copy;
+}
+
+int cache_should_prefetch(const CacheView* views, int count, int percent) {
+    if (percent <= 0) {
+        return 0;
+    }
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++) {
+        const CacheRecord* record = views[i].record;
+        if ((__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_STATIC) ||
+            __atomic_load_n(&record->hits, __ATOMIC_RELAXED) < PREFETCH_MIN_HITS) {
+            continue;
+        }
+        time_t remaining = record->expire_time - now;
+        if ((int64_t)remaining * 100 <= (int64_t)record->ttl * percent) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+time_t cache_views_fresh_until(const CacheView* views, int count, int percent) {
+    time_t until = 0;
+    for (int i = 0; i < count; i++) {
+        const CacheRecord* record = views[i].record;
+        if (__atomic_load_n(&record->flags, __ATOMIC_RELAXED) & RECORD_STATIC) {
+            return 0;
+        }
+        time_t point = record->expire_time;
+        if (percent > 0) {
+            point -= (time_t)((int64_t)record->ttl * percent / 100);
+        }
+        if (until == 0 || point < until) {
+            until = point;
+        }
+    }
+    return until;
 }
 
-void cache_print(DNSCache* cache) {
-    DNSRecord* p = cache->head;
-    int cnt=0;
-    while (p != NULL) {
-        ++cnt;
-        printf("No.%d: %s\n",cnt, p->domain);
-        p = p->lru_next;
+void cache_destroy(DNSCache* cache) {
+    for (int i = 0; i < cache->shard_count; i++) {
+        CacheShard* shard = &cache->shards[i];
+#ifdef CACHE_INDEX_TRIE
+        trie_free(shard->root);
+#else
+        hash_index_free(&shard->index);
+#endif
+        epoch_retire_list_free(&shard->retired_records);
+        epoch_retire_list_free(&shard->retired);
+        free(shard->expiry);
+        sketch_free(&shard->sketch);
+        // 名字表与其他使用者共用，还在缓存中的记录逐条放开名字
+        for (int segment = 0; segment < CACHE_SEGMENTS; segment++) {
+            for (RecordRef ref = shard->lru[segment].head; ref != RECORD_NIL; ref = shard_record(shard, ref)->lru_next) {
+                record_release_names(shard->names, shard_record(shard, ref));
+            }
+        }
+        mutex_destroy(&shard->lock);
     }
+    record_arena_destroy(&cache->records);     // 记录本身不必逐条释放，随 arena 一起归还
+    shards_free(cache->counters);
+    shards_free(cache->shards);
+    free(cache);
 }
 
 void cache_print_status(DNSCache* cache) {
-    const int DOMAIN_WIDTH = 40;
-    const int TYPE_WIDTH = 2;
     const int MAX_COUNT = 15;
 
-    // 打印缓存状态
-    printf("Cache Status: %d / %d\n", cache->size, cache->capacity);
-    printf("================================ Cache Status ================================\n");
-    DNSRecord* p = cache->tail;
+    // 打印缓存状态，经日志队列写出
+    LOG_DEBUG("Cache Status: %d / %d in %d shards\n", cache_size(cache), cache->capacity, cache->shard_count);
+    LOG_DEBUG("================================ Cache Status ================================\n");
     int cnt = 0;
-    while (p) {
-        printf("| domain: %-*s type: %*d              -> |\n", DOMAIN_WIDTH, p->domain, TYPE_WIDTH, p->type);
-        p = p->lru_prev;
-        ++cnt;
-        if (cnt >= MAX_COUNT) break;
-    }
-    printf("Remaining %d records\n", cache->size - cnt);
-    printf("=============================================================================\n");
-}
\ No newline at end of file
+    for (int i = 0; i < cache->shard_count; i++) {
+        CacheShard* shard = &cache->shards[i];
+        uint64_t hits, misses;
+        cache_shard_lookups(cache, i, &hits, &misses);
+        mutex_lock(&shard->lock);
+        LOG_DEBUG("| shard %2d: %4d / %-4d hits %-8llu misses %-8llu inserts %-8llu evictions %-8llu rejected %-8llu "
+                  "expired %-8llu |\n",
+                  i, shard->size, shard->capacity, (unsigned long long)hits, (unsigned long long)misses,
+                  (unsigned long long)shard->inserts, (unsigned long long)shard->evictions,
+                  (unsigned long long)shard->rejections, (unsigned long long)shard->expirations);
+        for (int segment = 0; segment < CACHE_SEGMENTS; segment++) {
+            for (RecordRef ref = shard->lru[segment].tail; ref != RECORD_NIL && cnt < MAX_COUNT;
+                 ref = shard_record(shard, ref)->lru_prev) {
+                const CacheRecord* p = shard_record(shard, ref);
+                LOG_DEBUG("| domain: %-40s type: %2d              -> |\n", name_string(cache->names, p->name), p->type);
+                ++cnt;
+            }
+        }
+        mutex_unlock(&shard->lock);
+    }
+    LOG_DEBUG("Remaining %d records\n", cache_size(cache) - cnt);
+    LOG_DEBUG("=============================================================================\n");
+}
@@ -1,42 +1,202 @@
 /*
-用域名建一棵 Trie 树，Trie上每个节点维护一条链表保存资源记录，支持尾部插入和随机删除
-使用一条LRU链表将所有资源记录连起来，支持尾部插入和随机删除
-头部最老，尾部最新
+记录缓存，按域名的哈希分成若干分片，每个分片有自己的索引、LRU 链表、容量和锁
+分片内用域名建索引（默认哈希表，见 hashindex.h；编译时定义 CACHE_INDEX_TRIE 则用 Trie 树），
+索引的每个键维护一条链表保存资源记录，支持尾部插入和随机删除
+记录以紧凑形式保存在所有分片共用的 RecordArena 中，各分片从自己的 slab 分配（见 record.h）；
+记录的名字驻留在全局的名字表中（见 names.h），查询先找到名字的 NameId，之后只比较整数
+使用LRU链表将分片内的资源记录连起来，支持尾部插入和随机删除，头部最老，尾部最新
+分片满时的淘汰策略在建立缓存时选择（CachePolicy）：
+    CLOCK（默认）：一条链表，命中过的记录清掉标记移到尾部，淘汰第一条没被命中过的；
+    W-TinyLFU：新记录先进约占 1% 的准入窗口，从窗口挤出的记录成为候选，与主区试用段最老的记录比较
+        访问频率（FrequencySketch，见 sketch.h），候选更常被查询才能换掉它，否则候选被淘汰；
+        试用段中再被命中的记录升入保护段（约占主区 80%），保护段溢出时最老的降回试用段。
+        一次性的名字（爬虫、随机子域名）进得了窗口，挤不掉被反复查询的记录。
+    两种策略都只在写入时整理链表：命中只置位 RECORD_REFERENCED（见下），W-TinyLFU 另外累加名字的频率，
+    升段、移到尾部都推迟到写者扫描链表时按标记进行
+每个分片另有一个按过期时间排列的最小堆，写入时顺带、工作线程定期从堆顶摘下过期的记录（serve-stale 保留期内的除外）；
+    命中不改写记录，应答中的 TTL 为剩余时间
+多个工作线程共享同一个缓存，调用方不需要加锁：
+    写入只锁所涉及名字所在的分片；已发布的记录不再改写，刷新时换上新副本；
+    查询不加锁（哈希索引），命中只置位记录的标志，不移动 LRU 链表；
+    摘下的记录和索引旧表放进分片的回收队列，按纪元延迟释放（见 epoch.h），记录回到分片的 slab。
+    Trie 索引插入删除时原地改写节点，这种编译方式下查询仍持有分片锁。
+查询有两种形式：cache_query_views 把命中的记录（含 CNAME 链）以借用视图填入调用方的定长数组，
+    不分配、不复制，只在调用方的纪元临界区内有效，应答路径用它直接编码；
+    cache_query 返回记录在调用方 arena 中的副本，之后仍可安全使用
 */
 
 #ifndef CACHE_H
 #define CACHE_H
 
+#include "record.h"
+#include "names.h"
 #include "trie.h"
+#include "hashindex.h"
+#include "thread.h"
+#include "arena.h"
+#include "epoch.h"
+#include "sketch.h"
 
-typedef struct DNSCache {
+#define CACHE_DEFAULT_SHARDS 16
+#define CACHE_MAX_SHARDS 64
+#define CACHE_ARENA_PER_RECORD 3072     // 按容量为每条记录保留的地址空间：每个大小类都各自放满也用不完
+
+// 分片满时的淘汰策略
+typedef enum CachePolicy {
+    CACHE_POLICY_CLOCK,
+    CACHE_POLICY_TINYLFU,
+} CachePolicy;
+
+// 记录所在的淘汰链表（CacheRecord.segment）；CLOCK 只用第一条
+#define CACHE_SEGMENT_WINDOW 0
+#define CACHE_SEGMENT_PROBATION 1
+#define CACHE_SEGMENT_PROTECTED 2
+#define CACHE_SEGMENTS 3
+#define TINYLFU_WINDOW_PERCENT 1        // 准入窗口占分片容量的比例，至少 1 条
+#define TINYLFU_PROTECTED_PERCENT 80    // 保护段占主区（窗口以外）的比例
+
+typedef struct RecordList {
+    RecordRef head; // 最老
+    RecordRef tail; // 最新
+    int size;
+} RecordList;
+
+// 过期堆的元素：堆顶最早过期，记录的 expiry 指回所在的位置，删除任意记录为 O(log n)
+typedef struct ExpiryEntry {
+    time_t expire_time;
+    RecordRef ref;
+} ExpiryEntry;
+
+// 各分片的锁与统计放在不同的缓存行上，不同分片的读写互不干扰
+typedef struct __attribute__((aligned(64))) CacheShard {
+    mutex_t lock;
+#ifdef CACHE_INDEX_TRIE
     TrieNode* root;
-    DNSRecord* head; // LRU链表头指针
-    DNSRecord* tail; // LRU链表尾指针
-    int size;       // 当前大小
+#else
+    HashIndex index;
+#endif
+    RecordArena* records;   // 所有分片共用
+    NameTable* names;       // 同 DNSCache.names
+    RecordSlab slab;        // 本分片的记录从这里分配
+    CachePolicy policy;     // 同 DNSCache.policy
+    RecordList lru[CACHE_SEGMENTS];
+    int window_capacity;        // W-TinyLFU 窗口与保护段的上限
+    int protected_capacity;
+    FrequencySketch sketch;     // W-TinyLFU 的访问频率，读者不加锁累加，老化在分片锁内进行
+    ExpiryEntry* expiry;        // 过期堆，静态记录不进堆
+    uint32_t expiry_count;
+    uint32_t expiry_capacity;
+    int size;       // 当前大小（各链表之和）
     int capacity;   // 最大容量
+    EpochRetireList retired;    // 等读者离开后释放的索引旧表
+    EpochRetireList retired_records;    // 已摘下、等读者离开后放回 slab 的记录
+    uint64_t inserts;       // 新写入的记录，不含刷新
+    uint64_t evictions;     // 因分片已满淘汰的记录，含 W-TinyLFU 拒绝准入的候选
+    uint64_t rejections;    // W-TinyLFU 拒绝准入的候选
+    uint64_t expirations;   // 过期后被清理的记录
+    uint64_t prefetch_used; // 预取写入后又被命中的记录数，读者原子累加
+} CacheShard;
+
+// cache_query 的命中与未命中（按查询名所在分片计），每个线程各记一份，读者之间不争用缓存行
+typedef struct CacheCounters {
+    uint64_t hits;
+    uint64_t misses;
+} CacheCounters;
+
+typedef struct DNSCache {
+    RecordArena records;
+    NameTable* names;       // 全局名字表（name_table_shared），与黑名单共用
+    CacheShard* shards;
+    int shard_count;        // 2 的幂
+    int shard_shift;        // 取哈希高位选分片
+    int capacity;           // 各分片容量之和
+    CachePolicy policy;
+    CacheCounters* counters; // EPOCH_MAX_THREADS 行，每行 counter_stride 项，按线程槽位编号取行
+    int counter_stride;     // 每行凑满整数个缓存行
+    uint64_t prefetch_issued; // 发出的预取数，工作线程原子累加
+    uint64_t stale_served;    // 用过期数据应答的次数，工作线程原子累加
+    time_t keep_expired;      // 过期后仍保留的秒数，供 serve-stale 使用；默认 0，过期即可清理
 }DNSCache;
 
+#define PREFETCH_MIN_HITS 2 // 本次写入以来至少命中这么多次才值得预取
+#define CACHE_STALE_TTL 30  // 用过期数据应答时填写的 TTL（RFC 8767 建议 30 秒）
+#define CACHE_EXPIRE_BATCH 4            // 每次写入顺带清理的过期记录上限
+#define CACHE_EXPIRE_BUDGET 256         // 定期清理时每个分片一次最多清理的记录数
+#define CACHE_EXPIRE_INTERVAL_MS 1000   // 工作线程定期清理的间隔
+
 DNSCache* dns_cache;
 
+#define CACHE_MAX_ANSWERS 32    // 一次命中最多返回的记录数（含 CNAME 链），512 字节的应答放不下更多
+
+// 借用的记录视图：指向缓存中的记录本身，调用方离开纪元临界区后失效
+typedef struct CacheView {
+    const CacheRecord* record;
+    const char* domain;         // 所有者名的规范形式
+    const char* target;         // CNAME 目标名，其他类型为 NULL
+} CacheView;
+
 typedef struct CacheQueryResult {
     DNSRecord* record;
     struct CacheQueryResult* next;
 }CacheQueryResult;
 
-DNSCache* cache_create(int capacity);
+// shards 向上取整为 2 的幂，且不超过 CACHE_MAX_SHARDS 与 capacity；容量平均分给各分片；按 CLOCK 淘汰
+DNSCache* cache_create(int capacity, int shards);
 
-void lru_insert(DNSCache* cache, DNSRecord* record);
+// 同 cache_create，指定淘汰策略
+DNSCache* cache_create_policy(int capacity, int shards, CachePolicy policy);
 
-void lru_delete(DNSCache* cache, DNSRecord* record);
+// 名字所在的分片
+CacheShard* cache_shard(DNSCache* cache, const char* domain);
 
-void cache_eliminate(DNSCache* cache);
+// 各分片记录数之和（不加锁读取，只用于统计）
+int cache_size(const DNSCache* cache);
+
+// 各分片记录占用的字节数之和（按大小类计，不加锁读取，只用于统计）
+size_t cache_record_bytes(const DNSCache* cache);
+
+// 汇总各线程在第 shard 个分片上的命中与未命中数（不加锁读取，只用于统计）
+void cache_shard_lookups(const DNSCache* cache, int shard, uint64_t* hits, uint64_t* misses);
 
 void cache_update(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl);
 
-CacheQueryResult* cache_query(DNSCache* cache, const char* domain, const uint8_t type);
+// 写入记录并附带 RECORD_* 标志
+void cache_insert(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl, uint8_t flags);
+
+// 写入负缓存条目（RFC 2308）：rcode 为 RCODE_NXDOMAIN 或 0（NODATA），zone、soa_ttl、soa 取自应答授权部分的 SOA
+// TTL 取 SOA 记录的 TTL 与 MINIMUM 中较小者；SOA 编码后放不下时不缓存
+void cache_insert_negative(DNSCache* cache, const char* domain, uint16_t qtype, uint8_t rcode, const char* zone,
+                           uint32_t soa_ttl, const DNSSoa* soa);
+
+// 写入本地配置的静态记录，TTL 只用于填写响应
+void cache_update_static(DNSCache* cache, const char* domain, const uint8_t type, const void* value, time_t ttl);
+
+// 从各分片清理过期时间加 keep_expired 不晚于 now 的记录，每个分片最多 budget 条；
+// 正被写者锁住的分片跳过，留到下一次。返回清理的条数
+int cache_expire(DNSCache* cache, time_t now, int budget);
+
+// 记录是否已过期
+int record_expired(const DNSRecord* record, time_t now);
+
+// 命中时把 CNAME 链与最终的记录依次填入 views（最多 max 条），返回条数，未命中返回 0；
+// 调用方须处于纪元临界区（epoch_enter），离开之前用完 views。不分配内存，命中只置位记录的标志
+int cache_query_views(DNSCache* cache, const char* domain, const uint8_t type, CacheView* views, int max);
+
+// 结果链表与其中的记录副本从 arena 分配，不需要单独释放，调用方 arena_reset 后失效
+CacheQueryResult* cache_query(DNSCache* cache, Arena* arena, const char* domain, const uint8_t type);
+
+// 同 cache_query，但接受过期不超过 max_stale 秒的记录，供 serve-stale 使用；只读，不计命中与访问频率
+CacheQueryResult* cache_query_stale(DNSCache* cache, Arena* arena, const char* domain, const uint8_t type,
+                                    time_t max_stale);
+
+// 查找未过期的负缓存条目：NXDOMAIN 覆盖所有类型，NODATA 只覆盖对应类型；返回 arena 中的副本
+DNSRecord* cache_query_negative(DNSCache* cache, Arena* arena, const char* domain, uint16_t qtype);
+
+// 命中结果可原样重复使用的截止时间：最早过期或到达预取点的时刻；含静态记录时返回 0
+time_t cache_views_fresh_until(const CacheView* views, int count, int percent);
 
-void cache_query_free(CacheQueryResult* result);
+// 命中结果中是否有被反复命中、剩余 TTL 已不足 percent% 的记录，需要提前刷新
+int cache_should_prefetch(const CacheView* views, int count, int percent);
 
 void cache_destroy(DNSCache* cache);
 
@@ -1,307 +1,230 @@
 #include "dnsStruct.h"
 /*DNS协议部分*/
 
+#define MAX_NAME_JUMPS 16   // 单个域名最多跟随的压缩指针数
+
+static uint16_t read_u16(const uint8_t *p){
+    return (uint16_t)((p[0]<<8)|p[1]);
+}
+
+static uint32_t read_u32(const uint8_t *p){
+    return ((uint32_t)p[0]<<24)|((uint32_t)p[1]<<16)|((uint32_t)p[2]<<8)|p[3];
+}
+
+int dns_view_init(DNSView *view, const char *buffer, int length){
+    if(length<DNS_HEADER_LEN){
+        return -1;
+    }
+    const uint8_t *ubuf=(const uint8_t *)buffer;
+    view->data=ubuf;
+    view->len=length;
+    view->id=read_u16(ubuf);
+    view->flags=read_u16(ubuf+2);
+    view->qdcount=read_u16(ubuf+4);
+    view->ancount=read_u16(ubuf+6);
+    view->nscount=read_u16(ubuf+8);
+    view->arcount=read_u16(ubuf+10);
+    return 0;
+}
+
 /*关键DNS域名压缩*/
-/*创建 256 字节缓冲区存储域名（DNS 域名最大长度限制）
-初始化位置指针和偏移量跟踪
-设置跳转计数器防止无限循环*/
-char *parse_dns_name(const char*buffer,int*offset,int max_length) {
-    char name[256];
-    int name_pos=0;
-    int initial_offset=*offset;
+/*逐个标签读取；遇到压缩指针跳转到报文前部继续，
+指针必须指向当前标签之前的位置，并限制跳转次数，防止构造的报文造成死循环*/
+int dns_name_decode(const DNSView *view, int offset, char *out, int out_size){
+    const uint8_t *ubuf=view->data;
+    int pos=offset;
+    int consumed=-1;//遇到第一个压缩指针时确定
     int jumps=0;
+    int name_pos=0;
 
     while(1){
-        if(*offset>=max_length){
-            return NULL;
+        if(pos>=view->len){
+            return -1;
         }
-
-        unsigned int len=(unsigned char)buffer[(*offset)++];
-        //检查单比特
+        unsigned int len=ubuf[pos];
         if(len==0){
-            if(name_pos==0){
-                name[name_pos++]='.';
-            }
-            name[name_pos]='\0';
+            pos++;
             break;
         }
-
         //检查双字节以上
-        if((len&0xc0)==0xc0){
-            if(*offset>=max_length){
-                return NULL;
+        if((len&0xC0)==0xC0){
+            if(pos+1>=view->len||++jumps>MAX_NAME_JUMPS){
+                return -1;
             }
-
-            //获取偏移指针
-            int ptr_offset=((len&0x3F)<<8)|(unsigned char)buffer[(*offset)++];
-            if(ptr_offset>=initial_offset)
-            {
-                return NULL;
+            int ptr_offset=((len&0x3F)<<8)|ubuf[pos+1];
+            if(ptr_offset>=pos){
+                return -1;
             }
-
-            if(jumps++>10){
-                return NULL;
+            if(consumed<0){
+                consumed=pos+2-offset;
             }
-
-            int saved_offset=*offset;
-            *offset=ptr_offset;
-            char *rest=parse_dns_name(buffer,offset,max_length);
-            *offset=saved_offset;
-
-            if(!rest){
-                return NULL;
-            }
-
-            if(name_pos>0){
-                name[name_pos++]='.';
-            }
-            strcpy(name+name_pos,rest);
-            name_pos+=strlen(rest);
-            free(rest);
-            break;
+            pos=ptr_offset;
+            continue;
+        }
+        if(len&0xC0){
+            return -1;//扩展标签类型不支持
         }
-
         //正常标签
-        if(name_pos>0){
-            name[name_pos++]='.';
+        if(pos+1+(int)len>view->len){
+            return -1;
         }
-
-        if(*offset+len>max_length)
-        {
-            return NULL;
+        int need=(name_pos>0?1:0)+(int)len;
+        if(name_pos+need+1>out_size){
+            return -1;
         }
-
-        memcpy(name+name_pos,buffer+*offset,len);
-        *offset+=len;
+        if(name_pos>0){
+            out[name_pos++]='.';
+        }
+        memcpy(out+name_pos,ubuf+pos+1,len);
         name_pos+=len;
-
-    }
-    return strdup(name);
-}
-
-
-//解析DNS报文
-void parse_dns_packet(DNS_message *msg,const char *buffer,int length){
-    if(length<12){
-        printf("DNS报文太短\n");
-        return;
+        pos+=1+len;
     }
-    //Parse DNS header
-    unsigned short transactionID=(buffer[0]<<8)|buffer[1];
-    unsigned short flags=(buffer[2]<<8)|buffer[3];
-    unsigned short qdCount=(buffer[4]<<8)|buffer[5];
-    unsigned short anCount=(buffer[6]<<8)|buffer[7];
-    unsigned short nsCount=(buffer[8]<<8)|buffer[9];
-    unsigned short arCount=(buffer[10]<<8)|buffer[11];
 
-    msg->header=malloc(sizeof(DNS_header));
-    if(!msg->header)
-    {
-        printf("DNS报文头部内存分配失败\n");
-        return;
-    }
-    msg->header->transactionID=transactionID;
-    msg->header->flags=flags;
-    msg->header->ques_num=qdCount;
-    msg->header->ans_num=anCount;
-    msg->header->auth_num=nsCount;
-    msg->header->add_num=arCount;
-
-    int offset=12;
-    //Parse questions
-    if(qdCount>0)
-    {
-        msg->question=malloc(qdCount * sizeof(DNS_question));
-        if(!msg->question)
-        {
-            printf("DNS报文问题部分内存分配失败\n");
-            return;
-        }
-        for(int i=0;i<qdCount;i++){
-            printf("\nQuestion #%d:\n",i+1);
-            msg->question[i].qname=parse_dns_name(buffer,&offset,length);
-            if(!msg->question[i].qname)
-            {
-                printf("DNS报文问题部分解析失败\n");
-                return;
-            }
-            printf(" Name:%s\n",msg->question[i].qname);
-
-            if(offset+4>length){
-                printf("DNS报文问题部分不完整.\n");
-                return;
-            }
-
-            msg->question[i].qtype=(buffer[offset]<<8)|buffer[offset+1];
-            msg->question[i].qclass=(buffer[offset+2]<<8)|buffer[offset+3];
-            offset+=4;
-
-            printf(" Type:%u\n",msg->question[i].qtype);
-            printf(" Class:%u\n",msg->question[i].qclass);
+    if(name_pos==0){
+        if(out_size<2){
+            return -1;
         }
+        out[name_pos++]='.';
     }
+    out[name_pos]='\0';
+    return consumed>=0?consumed:pos-offset;
+}
 
-            //Parse answers
-    if (anCount > 0)
-    {
-        msg->answer = malloc(anCount * sizeof(DNS_resource_record));
-        if (!msg->answer)
-        {
-            printf("Memory allocation failed for answers.\n");
-            return;
+//跳过域名，返回其后的偏移，格式错误返回 -1
+static int skip_name(const DNSView *view, int offset){
+    while(offset<view->len){
+        unsigned int len=view->data[offset];
+        if(len==0){
+            return offset+1;
         }
-
-        printf("\nAnswers:\n");
-        for (int i = 0; i < anCount; i++)
-        {
-            printf("\nAnswer #%d:\n", i + 1);
-            parse_resource_record(buffer, &offset, length, &msg->answer[i]);
+        if((len&0xC0)==0xC0){
+            return offset+2<=view->len?offset+2:-1;
         }
-    }
-        // Parse authority section
-    if(nsCount>0)
-    {
-        msg->authority=malloc(nsCount * sizeof(DNS_resource_record));
-        if(!msg->authority)
-        {
-            printf("Memory allocation failed for authority records.\n");
-            return;
+        if(len&0xC0){
+            return -1;
         }
+        offset+=1+len;
+    }
+    return -1;
+}
 
-        printf("\nAuthority records:\n");
-        for(int i=0;i<nsCount;i++)
-        {
-            printf("\nAuthority Records #%d:\n", i + 1);
-            parse_resource_record(buffer,&offset,length,&msg->authority[i]);
+int dns_view_question(const DNSView *view, DNSQuestionView *question){
+    if(view->qdcount==0){
+        return -1;
+    }
+    int end=skip_name(view,DNS_HEADER_LEN);
+    if(end<0||end+4>view->len){
+        return -1;
+    }
+    question->name_offset=DNS_HEADER_LEN;
+    question->qtype=read_u16(view->data+end);
+    question->qclass=read_u16(view->data+end+2);
+    return 0;
+}
 
-        }
+int dns_view_question_name(const DNSView *view, DNSQuestionView *question, char *out, int out_size){
+    if(dns_view_question(view,question)!=0||dns_name_decode(view,question->name_offset,out,out_size)<0){
+        return -1;
     }
-        //Parse additional records
-        if(arCount>0)
-        {
-            msg->additional=malloc(arCount * sizeof(DNS_resource_record));
-            if(!msg->additional)
-            {
-                printf("Memory allocation failed for additional records.\n");
-                return;
-            }
+    return 0;
+}
 
-            printf("\nAddtional records:\n");
-            for(int i=0;i<arCount;i++){
-                printf("\nAdditional Record #%d:\n",i+1);
-                parse_resource_record(buffer,&offset,length,&msg->additional[i]);
-            }
+int dns_rr_iter_init(DNSRRIter *iter, const DNSView *view){
+    int offset=DNS_HEADER_LEN;
+    for(int i=0;i<view->qdcount;i++){
+        offset=skip_name(view,offset);
+        if(offset<0||offset+4>view->len){
+            return -1;
         }
-
+        offset+=4;
+    }
+    iter->view=view;
+    iter->offset=offset;
+    iter->index=0;
+    return 0;
 }
 
-
-
-/*解析DNS资源记录的辅助函数*/
-void parse_resource_record(const char*buffer,int *offset,int max_length,DNS_resource_record *rr)
-{
-    rr->name=parse_dns_name(buffer,offset,max_length);
-    if(!rr->name){
-        printf("Failed to parse resource record name.\n");
-        return;
+int dns_rr_next(DNSRRIter *iter, DNSRRView *rr){
+    const DNSView *view=iter->view;
+    int index=iter->index;
+    if(index>=view->ancount+view->nscount+view->arcount){
+        return 0;
     }
-    printf(" Name:%s\n",rr->name);
-
-    if(*offset+10>max_length){
-        printf("Incomplete resource record.\n");
-        return;
+    int offset=skip_name(view,iter->offset);
+    if(offset<0||offset+10>view->len){
+        return -1;
     }
-
-    rr->type=(buffer[*offset]<<8)|buffer[*offset+1];
-    rr->class=(buffer[*offset+2]<<8)|buffer[*offset+3];
-    rr->ttl=(buffer[*offset+4]<<24)|(buffer[*offset+5]<<16)|(buffer[*offset+6]<<8)|buffer[*offset+7];
-    rr->rdlength=(buffer[*offset+8]<<8)|buffer[*offset+9];
-    *offset+=10;
-
-    printf(" Type:%u\n",rr->type);
-    printf(" Class:%u\n",rr->class);
-    printf(" TTL:%u\n",rr->ttl);
-    printf(" RD Length:%u\n",rr->rdlength);
-
-    if(*offset+rr->rdlength>max_length)
-    {
-        printf("Invalid RDATA length.\n");
-        return;
+    const uint8_t *p=view->data+offset;
+    rr->name_offset=iter->offset;
+    rr->type=read_u16(p);
+    rr->rclass=read_u16(p+2);
+    rr->ttl=read_u32(p+4);
+    rr->rdlength=read_u16(p+8);
+    rr->rdata_offset=offset+10;
+    if(rr->rdata_offset+rr->rdlength>view->len){
+        return -1;
     }
+    if(index<view->ancount){
+        rr->section=DNS_SECTION_ANSWER;
+    }else if(index<view->ancount+view->nscount){
+        rr->section=DNS_SECTION_AUTHORITY;
+    }else{
+        rr->section=DNS_SECTION_ADDITIONAL;
+    }
+    iter->offset=rr->rdata_offset+rr->rdlength;
+    iter->index++;
+    return 1;
+}
 
-    //解析资源数据（Rdata)
-    switch(rr->type)
-    {
-        case RR_A: //A记录(IPV4)
-            if(rr->rdlength == 4){
-                for(int i=0;i<4;i++){
-                    rr->data.a_record.IP_addr[i]=buffer[(*offset)++];
-                }
-                printf(" Address: %u.%u.%u.%u\n",rr->data.a_record.IP_addr[0],rr->data.a_record.IP_addr[1],
-                rr->data.a_record.IP_addr[2],rr->data.a_record.IP_addr[3]);
-            }
-            break;
-
-        case RR_AAAA: //AAAA记录(IPV6)
-            if(rr->rdlength==16) {
-                for(int i=0;i<16;i++){
-                    rr->data.aaaa_record.IP_addr[i]=buffer[(*offset)++];
-                }
-                printf("Address:");
-                for (int i = 0; i < 16; i++) {
-                    printf("%02x", rr->data.aaaa_record.IP_addr[i]);
-                    if (i % 2 == 1 && i != 15)
-                        printf(":");
-                }
-                printf("\n");
-            }
-            break;
-        
-        case RR_CNAME: //CNAME记录
-            rr->data.cname_record.name = parse_dns_name(buffer, offset, max_length);
-        if (rr->data.cname_record.name) {
-            printf("  CNAME: %s\n", rr->data.cname_record.name);
-        }
-        break;
+int dns_rr_soa(const DNSView *view, const DNSRRView *rr, DNSSoa *soa){
+    if(rr->type!=RR_SOA){
+        return -1;
+    }
+    int end=rr->rdata_offset+rr->rdlength;
+    int offset=rr->rdata_offset;
+    int len=dns_name_decode(view,offset,soa->mname,sizeof(soa->mname));
+    if(len<0){
+        return -1;
+    }
+    offset+=len;
+    len=dns_name_decode(view,offset,soa->rname,sizeof(soa->rname));
+    if(len<0){
+        return -1;
+    }
+    offset+=len;
+    if(offset+20>end){
+        return -1;
+    }
+    const uint8_t *p=view->data+offset;
+    soa->serial=read_u32(p);
+    soa->refresh=read_u32(p+4);
+    soa->retry=read_u32(p+8);
+    soa->expire=read_u32(p+12);
+    soa->minimum=read_u32(p+16);
+    return 0;
+}
 
-    case 6: // SOA record
-        rr->data.soa_record.MName = parse_dns_name(buffer, offset, max_length);
-        rr->data.soa_record.RName = parse_dns_name(buffer, offset, max_length);
-        if (*offset + 20 > max_length) {
-            printf("Incomplete SOA record.\n");
-            return;
+int encode_dns_name(const char *name, uint8_t *out, int max_length) {
+    int offset = 0;
+    const char *p = name;
+    while (*p && strcmp(p, ".") != 0) {
+        const char *dot = strchr(p, '.');
+        int len = dot ? (int)(dot - p) : (int)strlen(p);
+        if (len == 0 || len > 63 || offset + len + 1 >= max_length) {
+            return -1;
         }
-        rr->data.soa_record.serial = (buffer[*offset] << 24) | (buffer[*offset + 1] << 16) |
-                                     (buffer[*offset + 2] << 8) | buffer[*offset + 3];
-        rr->data.soa_record.refresh = (buffer[*offset + 4] << 24) | (buffer[*offset + 5] << 16) |
-                                      (buffer[*offset + 6] << 8) | buffer[*offset + 7];
-        rr->data.soa_record.retry = (buffer[*offset + 8] << 24) | (buffer[*offset + 9] << 16) |
-                                    (buffer[*offset + 10] << 8) | buffer[*offset + 11];
-        rr->data.soa_record.expire = (buffer[*offset + 12] << 24) | (buffer[*offset + 13] << 16) |
-                                     (buffer[*offset + 14] << 8) | buffer[*offset + 15];
-        rr->data.soa_record.minimum = (buffer[*offset + 16] << 24) | (buffer[*offset + 17] << 16) |
-                                      (buffer[*offset + 18] << 8) | buffer[*offset + 19];
-        *offset += 20;
-
-        printf("  SOA MName: %s\n", rr->data.soa_record.MName);
-        printf("  SOA RName: %s\n", rr->data.soa_record.RName);
-        printf("  SOA Serial: %u\n", rr->data.soa_record.serial);
-        printf("  SOA Refresh: %u\n", rr->data.soa_record.refresh);
-        printf("  SOA Retry: %u\n", rr->data.soa_record.retry);
-        printf("  SOA Expire: %u\n", rr->data.soa_record.expire);
-        printf("  SOA Minimum: %u\n", rr->data.soa_record.minimum);
-        break;
-
-    default:
-        // For unsupported types, just skip the data
-        printf("  Unsupported record type, skipping data.\n");
-        *offset += rr->rdlength;
-        break;
-    
+        out[offset++] = (uint8_t)len;
+        memcpy(out + offset, p, len);
+        offset += len;
+        p = dot ? dot + 1 : p + len;
     }
+    if (offset + 1 > max_length) {
+        return -1;
+    }
+    out[offset++] = 0;
+    return offset;
 }
 
-
 //构建DNS响应报文
 int build_dns_response(unsigned char *request, int requestLen, const char *ip) {
     // 假设你已经解析出请求中的 ID、问题部分等内容
@@ -339,22 +262,3 @@ int build_dns_response(unsigned char *request, int requestLen, const char *ip) {
 
     return offset;
 }
-
-int find_free_slot(void) {
-    for (int i = 0; i < MAX_INFLIGHT; i++) {
-        if (!ID_used[i]) {
-            return i;
-        }
-    }
-    return -1; // 没有空闲槽，表示并发已满
-}
-
-void cleanup_timeouts(void) {
-    time_t now = time(NULL);
-    for (int i = 0; i < MAX_INFLIGHT; i++) {
-        if (ID_used[i] && now - ID_list[i].timestamp > QUERY_TIMEOUT_SEC) {
-            ID_used[i] = false;
-            printf("Cleaning up timed out request for slot %d\n", i);
-        }
-    }
-}
\ No newline at end of file
@@ -21,71 +21,19 @@
 #define RR_A 1
 #define RR_AAAA 28
 #define RR_CNAME 5
+#define RR_SOA 6
 
-/*报文头部结构体*/
-typedef struct DNS_header{
-    uint16_t transactionID;//事务ID
-    uint16_t flags;//标志位
-    uint16_t ques_num;//问题数
-    uint16_t ans_num;//回答资源记录数
-    uint16_t auth_num;//授权资源记录数
-    uint16_t add_num;//附加资源记录数
-}DNS_header;
-
-
-typedef struct DNS_question{
-    char *qname;//域名
-    uint16_t qtype;//查询类型(如A,AAAA,)
-    uint16_t qclass;//查询类别(通常为IN，互联网)
-}DNS_question;
-
-union ResourceData{
-    struct/*ipv4*/
-    {
-        uint8_t IP_addr[4];
-    }a_record;
-
-    struct/*ipv6*/
-    {
-        uint8_t IP_addr[16];
-    }aaaa_record;
-
-    /* SOA：权威记录的起始 */
-    struct
-    {
-        char *MName;//主服务器域名
-        char *RName;//管理员域名
-        uint32_t serial;//版本号
-        uint32_t refresh;//刷新数据间歇
-        uint32_t retry;//重试间隔
-        uint32_t expire;//超时重传时间
-        uint32_t minimum;//最短有效时间
-
-    }soa_record;
-
-    struct 
-    {
-        char *name;
-    }cname_record;
-};
-
-typedef struct DNS_resource_record{
-    char *name;//域名
-    uint16_t type;//资源记录类型
-    uint16_t class;//资源记录类别
-    uint32_t ttl;//生存时间
-    uint16_t rdlength;//资源数据长度
-    union ResourceData data;//资源数据
-}DNS_resource_record;
-
+#define RCODE_SERVFAIL 2
+#define RCODE_NXDOMAIN 3
+#define RCODE_REFUSED 5
 
 /*
-    本头文件专门用于存放DNS报文结构体Message的定义，以及一切有关DNS报文的操作
+    本头文件专门用于存放DNS报文的视图定义，以及一切有关DNS报文的操作
     DNS 报文格式如下：
     +---------------------+
-    |        Header       | 报文头，固定12字节，由结构体DNS_header存储
+    |        Header       | 报文头，固定12字节
     +---------------------+
-    |       Question      | 向域名服务器的查询请求，由结构体DNS_question存储
+    |       Question      | 向域名服务器的查询请求
     +---------------------+
     |        Answer       | 对于查询问题的回复
     +---------------------+
@@ -93,42 +41,87 @@ typedef struct DNS_resource_record{
     +---------------------+
     |      Additional     | 附加信息
     +---------------------+
-    后面三个部分由结构体DNS_resource_record存储
+    解析不复制报文：DNSView 只解码固定 12 字节的头部，问题与资源记录在需要时才解析，
+    得到的是报文缓冲区中的偏移与长度；域名按需解码到调用方提供的缓冲区。
+    全程不分配内存，所有读取都检查边界，压缩指针只允许向前跳且限制跳转次数。
+    视图引用调用方的缓冲区，缓冲区被改写后视图随之失效。
 */
-typedef struct DNS_message{
-    struct DNS_header *header;//报文头部
-    struct DNS_question *question;
-    struct DNS_resource_record *answer;
-    struct DNS_resource_record *authority;
-    struct DNS_resource_record *additional;
-}DNS_message;
-
-void parse_dns_packet(DNS_message *msg,const char *buffer,int length);
-void parse_resource_record(const char*buffer,int *offset,int max_length,DNS_resource_record *rr);
 
-//转发查询
-typedef struct{
-    uint16_t orig_id;//客户端原始事务id
-    struct sockaddr_in cli;
-    time_t timestamp;
-}IDEntry;
+#define DNS_HEADER_LEN 12
 
-//转发查询表
-typedef struct{
-    IDEntry *entries;
-    int size;
-    int capacity;
-}IDTable;
+#define DNS_SECTION_ANSWER 0
+#define DNS_SECTION_AUTHORITY 1
+#define DNS_SECTION_ADDITIONAL 2
 
+/*报文视图：头部各字段已按主机字节序取出*/
+typedef struct DNSView{
+    const uint8_t *data;//报文缓冲区
+    int len;
+    uint16_t id;//事务ID
+    uint16_t flags;//标志位
+    uint16_t qdcount;//问题数
+    uint16_t ancount;//回答资源记录数
+    uint16_t nscount;//授权资源记录数
+    uint16_t arcount;//附加资源记录数
+}DNSView;
+
+/*问题视图*/
+typedef struct DNSQuestionView{
+    int name_offset;//域名在报文中的偏移，用 dns_name_decode 解码
+    uint16_t qtype;//查询类型(如A,AAAA,)
+    uint16_t qclass;//查询类别(通常为IN，互联网)
+}DNSQuestionView;
 
-IDTable *id_table;
-
-#define MAX_INFLIGHT 1024   // 最大并发未完成转发请求数
-#define QUERY_TIMEOUT_SEC 10 // 超时未得到上游响应
-
-IDEntry ID_list[MAX_INFLIGHT];
-bool ID_used[MAX_INFLIGHT];
-
-int find_free_slot(void);
-
-void cleanup_timeouts(void);
\ No newline at end of file
+/*资源记录视图*/
+typedef struct DNSRRView{
+    int section;//DNS_SECTION_*
+    int name_offset;//所有者名的偏移
+    uint16_t type;//资源记录类型
+    uint16_t rclass;//资源记录类别
+    uint32_t ttl;//生存时间
+    uint16_t rdlength;//资源数据长度
+    int rdata_offset;//资源数据的偏移，已确认不越界
+}DNSRRView;
+
+/*按顺序遍历回答、授权、附加三部分的资源记录*/
+typedef struct DNSRRIter{
+    const DNSView *view;
+    int offset;//下一条记录的偏移
+    int index;//已读出的记录数
+}DNSRRIter;
+
+/* SOA：权威记录的起始 */
+typedef struct DNSSoa{
+    char mname[DOMAIN_MAX_LEN];//主服务器域名
+    char rname[DOMAIN_MAX_LEN];//管理员域名
+    uint32_t serial;//版本号
+    uint32_t refresh;//刷新数据间歇
+    uint32_t retry;//重试间隔
+    uint32_t expire;//超时重传时间
+    uint32_t minimum;//最短有效时间
+}DNSSoa;
+
+// 建立报文视图，只读取头部；不足 12 字节返回 -1
+int dns_view_init(DNSView *view, const char *buffer, int length);
+
+// 取第一个问题，没有问题或格式错误返回 -1
+int dns_view_question(const DNSView *view, DNSQuestionView *question);
+
+// 取第一个问题并把问题名解码到 out；没有问题、格式错误或名字无法解码返回 -1
+int dns_view_question_name(const DNSView *view, DNSQuestionView *question, char *out, int out_size);
+
+// 把 offset 处的域名解码为点分形式写入 out，根域名为 "."
+// 返回该域名在 offset 处占用的字节数（遇到压缩指针时不含指针之后的部分），格式错误或放不下返回 -1
+int dns_name_decode(const DNSView *view, int offset, char *out, int out_size);
+
+// 跳过所有问题，定位到第一条资源记录；格式错误返回 -1
+int dns_rr_iter_init(DNSRRIter *iter, const DNSView *view);
+
+// 读出下一条资源记录，返回 1；没有更多记录返回 0；格式错误返回 -1
+int dns_rr_next(DNSRRIter *iter, DNSRRView *rr);
+
+// 解码 SOA 记录的资源数据，类型不符或格式错误返回 -1
+int dns_rr_soa(const DNSView *view, const DNSRRView *rr, DNSSoa *soa);
+
+// 把点分域名编码为 wire 格式（不压缩），返回写入的字节数，放不下或标签超长返回 -1
+int encode_dns_name(const char *name, uint8_t *out, int max_length);
@@ -0,0 +1,140 @@
+#include "epoch.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RETIRE_MIN_CAPACITY 64
+
+// 每个线程一个缓存行，读者进出临界区只写自己的槽位
+typedef struct __attribute__((aligned(64))) EpochSlot {
+    uint64_t epoch;         // 所在临界区开始时的全局纪元，0 表示不在临界区
+} EpochSlot;
+
+static EpochSlot slots[EPOCH_MAX_THREADS];
+static int slot_count;
+static uint64_t global_epoch = 1;
+static _Thread_local int thread_slot = -1;
+
+int epoch_thread_id(void) {
+    if (thread_slot < 0) {
+        int id = __atomic_fetch_add(&slot_count, 1, __ATOMIC_ACQ_REL);
+        if (id >= EPOCH_MAX_THREADS) {
+            fprintf(stderr, "Too many threads use the epoch reclamation (max %d)\n", EPOCH_MAX_THREADS);
+            abort();
+        }
+        thread_slot = id;
+    }
+    return thread_slot;
+}
+
+int epoch_threads(void) {
+    int count = __atomic_load_n(&slot_count, __ATOMIC_ACQUIRE);
+    return count < EPOCH_MAX_THREADS ? count : EPOCH_MAX_THREADS;
+}
+
+void epoch_enter(void) {
+    EpochSlot* slot = &slots[epoch_thread_id()];
+    __atomic_store_n(&slot->epoch, __atomic_load_n(&global_epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    // 先公开所在纪元再读共享结构：写者扫描槽位时要么看到本线程，要么本线程看到写者摘下对象之后的结构
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void epoch_exit(void) {
+    __atomic_store_n(&slots[thread_slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+uint64_t epoch_current(void) {
+    return __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+}
+
+uint64_t epoch_advance(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+    int count = epoch_threads();
+    for (int i = 0; i < count; i++) {
+        uint64_t local = __atomic_load_n(&slots[i].epoch, __ATOMIC_ACQUIRE);
+        if (local != 0 && local != epoch) {
+            return epoch;   // 还有读者停留在上一纪元
+        }
+    }
+    // 别的线程同时推进时比较失败，epoch 被更新为新值
+    if (__atomic_compare_exchange_n(&global_epoch, &epoch, epoch + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        epoch++;
+    }
+    return epoch;
+}
+
+void epoch_synchronize(void) {
+    uint64_t target = epoch_current() + 2;
+    while (epoch_advance() < target) {
+        thread_sleep_ms(1);
+    }
+}
+
+static void retired_release(EpochRetireList* list, void* ptr) {
+    if (list->release != NULL) {
+        list->release(ptr, list->release_arg);
+    } else {
+        free(ptr);
+    }
+}
+
+// 按原顺序搬到两倍大小的新数组
+static int retire_grow(EpochRetireList* list) {
+    size_t capacity = list->capacity == 0 ? RETIRE_MIN_CAPACITY : list->capacity * 2;
+    EpochRetired* items = (EpochRetired*)malloc(capacity * sizeof(EpochRetired));
+    if (items == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < list->count; i++) {
+        items[i] = list->items[(list->head + i) & (list->capacity - 1)];
+    }
+    free(list->items);
+    list->items = items;
+    list->head = 0;
+    list->capacity = capacity;
+    return 0;
+}
+
+void epoch_retire(EpochRetireList* list, void* ptr) {
+    if (list->count == list->capacity && retire_grow(list) != 0) {
+        epoch_synchronize();
+        retired_release(list, ptr);
+        return;
+    }
+    EpochRetired* item = &list->items[(list->head + list->count) & (list->capacity - 1)];
+    item->ptr = ptr;
+    item->epoch = epoch_current();
+    list->count++;
+}
+
+size_t epoch_reclaim(EpochRetireList* list) {
+    if (list->count == 0) {
+        return 0;
+    }
+    uint64_t now = epoch_advance();
+    size_t freed = 0;
+    while (list->count > 0) {
+        EpochRetired* item = &list->items[list->head];
+        if (item->epoch + 2 > now) {
+            break;  // 后面的纪元只会更新
+        }
+        retired_release(list, item->ptr);
+        list->head = (list->head + 1) & (list->capacity - 1);
+        list->count--;
+        freed++;
+    }
+    return freed;
+}
+
+void epoch_retire_list_free(EpochRetireList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        retired_release(list, list->items[(list->head + i) & (list->capacity - 1)].ptr);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->head = 0;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+基于纪元的延迟回收（epoch-based reclamation）
+    读者不加锁遍历共享结构，写者把摘下的对象放进回收队列，等所有读者都离开摘下时的纪元后再释放。
+    读者在 epoch_enter/epoch_exit 之间访问共享结构，进入时记下当时的全局纪元；
+    所有处于读临界区的线程都已看到当前纪元时，全局纪元才能加一。
+    在纪元 e 摘下的对象，全局纪元到达 e + 2 时已不可能被任何读者引用。
+    不在临界区的线程不阻碍回收，事件循环阻塞等待时也一样。
+    每个线程第一次使用时分配一个槽位，线程退出后槽位不回收，最多 EPOCH_MAX_THREADS 个。
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EPOCH_MAX_THREADS 128
+
+// 被回收的对象及摘下时的纪元
+typedef struct EpochRetired {
+    void* ptr;
+    uint64_t epoch;
+} EpochRetired;
+
+// 回收队列（环形，按纪元先后排列），不加锁，由调用方保证互斥
+typedef struct EpochRetireList {
+    EpochRetired* items;
+    size_t head;
+    size_t count;
+    size_t capacity;        // 2 的幂
+    void (*release)(void* ptr, void* arg);  // 释放对象，NULL 时用 free
+    void* release_arg;
+} EpochRetireList;
+
+// 本线程的槽位编号，首次调用时分配
+int epoch_thread_id(void);
+
+// 已分配的槽位数，用于汇总按线程分开的计数
+int epoch_threads(void);
+
+// 进入、离开读临界区，不可嵌套
+void epoch_enter(void);
+void epoch_exit(void);
+
+uint64_t epoch_current(void);
+
+// 所有处于临界区的线程都已看到当前纪元时推进一次，返回推进后的全局纪元
+uint64_t epoch_advance(void);
+
+// 等到当前所有读者都离开临界区，调用线程自己不能在临界区内
+void epoch_synchronize(void);
+
+// 把已从共享结构中摘下的对象放进回收队列；队列无法扩容时等待宽限期后直接释放
+void epoch_retire(EpochRetireList* list, void* ptr);
+
+// 释放队列中已安全的对象，返回释放的个数
+size_t epoch_reclaim(EpochRetireList* list);
+
+// 释放队列中全部对象，只在确定没有读者时使用；release 保留，队列可以继续使用
+void epoch_retire_list_free(EpochRetireList* list);
@@ -0,0 +1,288 @@
+#include "event.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/timerfd.h>
+    #define EVENT_BATCH 64  // 单次 epoll_wait 取回的最大事件数
+#endif
+
+uint64_t event_now_ms(void) {
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+uint64_t event_now_us(void) {
+#ifdef _WIN32
+    return GetTickCount64() * 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+EventLoop* event_loop_create(void) {
+    EventLoop* loop = (EventLoop*)calloc(1, sizeof(EventLoop));
+    if (loop == NULL) {
+        return NULL;
+    }
+#ifdef __linux__
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("epoll_create1 failed");
+        free(loop);
+        return NULL;
+    }
+#endif
+    return loop;
+}
+
+static EventHandler* handler_append(EventLoop* loop, event_fd_t fd, EventCallback callback, void* arg, int timer_id) {
+    if (loop->handler_count == loop->handler_capacity) {
+        int capacity = loop->handler_capacity ? loop->handler_capacity * 2 : 8;
+        EventHandler** handlers = (EventHandler**)realloc(loop->handlers, capacity * sizeof(EventHandler*));
+        if (handlers == NULL) {
+            return NULL;
+        }
+        loop->handlers = handlers;
+        loop->handler_capacity = capacity;
+    }
+    // 每个 handler 单独分配，保证 epoll 中保存的指针在扩容后仍然有效
+    EventHandler* handler = (EventHandler*)malloc(sizeof(EventHandler));
+    if (handler == NULL) {
+        return NULL;
+    }
+    handler->fd = fd;
+    handler->callback = callback;
+    handler->arg = arg;
+    handler->timer_id = timer_id;
+    loop->handlers[loop->handler_count++] = handler;
+#ifndef __linux__
+    loop->fds_dirty = 1;
+#endif
+    return handler;
+}
+
+int event_loop_add(EventLoop* loop, event_fd_t fd, EventCallback callback, void* arg) {
+    EventHandler* handler = handler_append(loop, fd, callback, arg, -1);
+    if (handler == NULL) {
+        return -1;
+    }
+#ifdef __linux__
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;  // 边缘触发：回调负责读到 EAGAIN
+    ev.data.ptr = handler;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl failed");
+        loop->handler_count--;
+        free(handler);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+int event_timer_add(EventLoop* loop, EventCallback callback, void* arg) {
+    if (loop->timer_count == loop->timer_capacity) {
+        int capacity = loop->timer_capacity ? loop->timer_capacity * 2 : 4;
+        EventTimer* timers = (EventTimer*)realloc(loop->timers, capacity * sizeof(EventTimer));
+        if (timers == NULL) {
+            return -1;
+        }
+        loop->timers = timers;
+        loop->timer_capacity = capacity;
+    }
+    int id = loop->timer_count;
+    EventTimer* timer = &loop->timers[id];
+    memset(timer, 0, sizeof(EventTimer));
+    timer->callback = callback;
+    timer->arg = arg;
+#ifdef __linux__
+    timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer->fd < 0) {
+        perror("timerfd_create failed");
+        return -1;
+    }
+    EventHandler* handler = handler_append(loop, timer->fd, NULL, NULL, id);
+    if (handler == NULL) {
+        close(timer->fd);
+        return -1;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = handler;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, timer->fd, &ev) < 0) {
+        perror("epoll_ctl failed");
+        loop->handler_count--;
+        free(handler);
+        close(timer->fd);
+        return -1;
+    }
+#endif
+    loop->timer_count++;
+    return id;
+}
+
+void event_timer_set(EventLoop* loop, int timer_id, int interval_ms) {
+    if (timer_id < 0 || timer_id >= loop->timer_count) {
+        return;
+    }
+    EventTimer* timer = &loop->timers[timer_id];
+    if (timer->interval_ms == interval_ms) {
+        return;
+    }
+    timer->interval_ms = interval_ms;
+    timer->deadline_ms = event_now_ms() + interval_ms;
+#ifdef __linux__
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));  // 全零即停用
+    if (interval_ms > 0) {
+        spec.it_interval.tv_sec = interval_ms / 1000;
+        spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000;
+        spec.it_value = spec.it_interval;
+    }
+    timerfd_settime(timer->fd, 0, &spec, NULL);
+#endif
+}
+
+static void timer_fire(EventLoop* loop, int timer_id) {
+    EventTimer* timer = &loop->timers[timer_id];
+#ifdef __linux__
+    uint64_t expirations;
+    // 读掉计数，否则边缘触发下不会再次通知
+    if (read(timer->fd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+#endif
+    if (timer->interval_ms > 0 && timer->callback) {
+        timer->callback(timer->arg);
+    }
+}
+
+#ifdef __linux__
+
+int event_loop_run_once(EventLoop* loop, int timeout_ms) {
+    struct epoll_event events[EVENT_BATCH];
+    int n = epoll_wait(loop->epoll_fd, events, EVENT_BATCH, timeout_ms);
+    if (n < 0) {
+        if (errno != EINTR) {
+            perror("epoll_wait failed");
+        }
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        EventHandler* handler = (EventHandler*)events[i].data.ptr;
+        if (handler->timer_id >= 0) {
+            timer_fire(loop, handler->timer_id);
+        } else {
+            handler->callback(handler->arg);
+        }
+    }
+    return n;
+}
+
+#else
+
+static void rebuild_fds(EventLoop* loop) {
+    free(loop->fds);
+    loop->fds = (struct pollfd*)calloc(loop->handler_count ? loop->handler_count : 1, sizeof(struct pollfd));
+    for (int i = 0; i < loop->handler_count; i++) {
+        loop->fds[i].fd = loop->handlers[i]->fd;
+        loop->fds[i].events = POLLIN;
+    }
+    loop->fds_dirty = 0;
+}
+
+int event_loop_run_once(EventLoop* loop, int timeout_ms) {
+    if (loop->fds_dirty) {
+        rebuild_fds(loop);
+    }
+
+    // 取最近的定时器截止时间作为 poll 的超时
+    uint64_t now = event_now_ms();
+    for (int i = 0; i < loop->timer_count; i++) {
+        EventTimer* timer = &loop->timers[i];
+        if (timer->interval_ms <= 0) continue;
+        int wait = timer->deadline_ms > now ? (int)(timer->deadline_ms - now) : 0;
+        if (timeout_ms < 0 || wait < timeout_ms) {
+            timeout_ms = wait;
+        }
+    }
+
+#ifdef _WIN32
+    int n = WSAPoll(loop->fds, loop->handler_count, timeout_ms);
+#else
+    int n = poll(loop->fds, loop->handler_count, timeout_ms);
+#endif
+    int dispatched = 0;
+    if (n > 0) {
+        for (int i = 0; i < loop->handler_count; i++) {
+            if (loop->fds[i].revents & POLLIN) {
+                loop->handlers[i]->callback(loop->handlers[i]->arg);
+                dispatched++;
+            }
+        }
+    }
+
+    now = event_now_ms();
+    for (int i = 0; i < loop->timer_count; i++) {
+        EventTimer* timer = &loop->timers[i];
+        if (timer->interval_ms > 0 && timer->deadline_ms <= now) {
+            timer->deadline_ms = now + timer->interval_ms;
+            timer_fire(loop, i);
+            dispatched++;
+        }
+    }
+    return dispatched;
+}
+
+#endif
+
+void event_loop_run(EventLoop* loop) {
+    loop->running = 1;
+    while (loop->running) {
+        event_loop_run_once(loop, -1);
+    }
+}
+
+void event_loop_stop(EventLoop* loop) {
+    loop->running = 0;
+}
+
+void event_loop_destroy(EventLoop* loop) {
+    if (loop == NULL) return;
+    for (int i = 0; i < loop->timer_count; i++) {
+#ifdef __linux__
+        close(loop->timers[i].fd);
+#endif
+    }
+    for (int i = 0; i < loop->handler_count; i++) {
+        free(loop->handlers[i]);
+    }
+#ifdef __linux__
+    close(loop->epoll_fd);
+#else
+    free(loop->fds);
+#endif
+    free(loop->handlers);
+    free(loop->timers);
+    free(loop);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+事件循环
+    Linux 下使用 epoll（边缘触发），回调必须把 socket 读到 EAGAIN 为止；
+    其他平台退化为 poll/WSAPoll（水平触发），回调同样循环读取即可。
+    定时器在 Linux 下是 timerfd，与 socket 一起注册进 epoll；
+    其他平台由 poll 的超时时间驱动。没有定时器挂起时无限期阻塞，空闲时不占用 CPU。
+*/
+
+#ifdef _WIN32
+    #include <WinSock2.h>
+    typedef SOCKET event_fd_t;
+#else
+    #include <poll.h>
+    typedef int event_fd_t;
+#endif
+
+#include <stdint.h>
+
+typedef void (*EventCallback)(void* arg);
+
+typedef struct EventHandler {
+    event_fd_t fd;          // 监听的描述符（Linux 下定时器为 timerfd）
+    EventCallback callback; // 可读时调用
+    void* arg;
+    int timer_id;           // 定时器编号，普通 socket 为 -1
+} EventHandler;
+
+typedef struct EventTimer {
+    EventCallback callback;
+    void* arg;
+    int interval_ms;        // 周期，0 表示未启用
+    uint64_t deadline_ms;   // 下次触发时间（poll 后端使用）
+#ifdef __linux__
+    int fd;                 // timerfd
+#endif
+} EventTimer;
+
+typedef struct EventLoop {
+#ifdef __linux__
+    int epoll_fd;
+#else
+    struct pollfd* fds;     // 仅在注册表变化时重建
+    int fds_dirty;
+#endif
+    EventHandler** handlers;
+    int handler_count;
+    int handler_capacity;
+    EventTimer* timers;
+    int timer_count;
+    int timer_capacity;
+    int running;
+} EventLoop;
+
+// 单调时钟，毫秒
+uint64_t event_now_ms(void);
+// 单调时钟，微秒，用于统计耗时
+uint64_t event_now_us(void);
+
+EventLoop* event_loop_create(void);
+
+// 注册一个非阻塞描述符，可读时调用 callback，返回 0 表示成功
+int event_loop_add(EventLoop* loop, event_fd_t fd, EventCallback callback, void* arg);
+
+// 注册一个定时器，返回定时器编号，失败返回 -1；注册后默认不启用
+int event_timer_add(EventLoop* loop, EventCallback callback, void* arg);
+
+// 设置定时器周期（毫秒），0 表示停用
+void event_timer_set(EventLoop* loop, int timer_id, int interval_ms);
+
+// 等待并分发一轮事件，timeout_ms 为 -1 时无限期等待，返回分发的事件数
+int event_loop_run_once(EventLoop* loop, int timeout_ms);
+
+// 持续运行直到 event_loop_stop
+void event_loop_run(EventLoop* loop);
+
+void event_loop_stop(EventLoop* loop);
+
+void event_loop_destroy(EventLoop* loop);
@@ -0,0 +1,282 @@
+#include "hashindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY ((int8_t)-128)   // 0x80
+#define CTRL_DELETED ((int8_t)-2)   // 0xFE
+#define HASH_MUL 0x9E3779B97F4A7C15ULL
+
+// NameId 与类型拼成一个整数再混合，相邻的 NameId 也能散开
+uint64_t hash_index_hash(NameId name, uint8_t type) {
+    uint64_t h = (((uint64_t)name << 8) | type) * HASH_MUL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline int8_t hash_h2(uint64_t hash) {
+    return (int8_t)(hash & 0x7F);
+}
+
+static inline size_t hash_group(const HashIndexTable* table, uint64_t hash) {
+    return (size_t)(hash >> 7) & (table->capacity / HASH_INDEX_GROUP - 1);
+}
+
+// 组内控制字节等于 byte 的槽位掩码
+// 与写者并发时整组读取：写者按字节原子写入，每个字节读到的要么是旧值要么是新值
+static inline uint32_t group_match(const int8_t* ctrl, int8_t byte) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASH_INDEX_GROUP; i++) {
+        mask |= (uint32_t)(__atomic_load_n(&ctrl[i], __ATOMIC_RELAXED) == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+// 组内空或已删除（最高位为 1）的槽位掩码
+static inline uint32_t group_free(const int8_t* ctrl) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASH_INDEX_GROUP; i++) {
+        mask |= (uint32_t)(__atomic_load_n(&ctrl[i], __ATOMIC_RELAXED) < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+static HashIndexTable* table_alloc(size_t capacity) {
+    HashIndexTable* table =
+        (HashIndexTable*)malloc(sizeof(HashIndexTable) + capacity * (sizeof(HashIndexSlot) + 1));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->capacity = capacity;
+    table->ctrl = (int8_t*)(table->slots + capacity);
+    memset(table->ctrl, CTRL_EMPTY, capacity);
+    return table;
+}
+
+static void table_retire(HashIndex* index, HashIndexTable* table) {
+    if (index->retire != NULL) {
+        index->retire(table, index->retire_arg);
+    } else {
+        free(table);
+    }
+}
+
+// 负载因子上限 7/8（占用与已删除合计）
+static size_t capacity_for(size_t keys) {
+    size_t capacity = HASH_INDEX_MIN_CAPACITY;
+    while (capacity / 8 * 7 <= keys) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+int hash_index_init(HashIndex* index, size_t capacity, const RecordArena* records) {
+    memset(index, 0, sizeof(*index));
+    index->records = records;
+    index->table = table_alloc(capacity_for(capacity));
+    if (index->table == NULL) {
+        return -1;
+    }
+    index->capacity = index->table->capacity;
+    return 0;
+}
+
+void hash_index_free(HashIndex* index) {
+    free(index->table);
+    index->table = NULL;
+    index->capacity = 0;
+    index->size = 0;
+}
+
+// 查找键所在的槽位，不存在返回 -1；可与写者并发，*head 为核对过名字和类型的链表头
+// （槽位随后可能被删除、复用，读者只能使用这里核对过的 head，不能再读一次槽位）
+static long find_slot(const HashIndex* index, const HashIndexTable* table, NameId name, uint8_t type, uint64_t hash,
+                      RecordRef* head) {
+    size_t groups_mask = table->capacity / HASH_INDEX_GROUP - 1;
+    size_t group = hash_group(table, hash);
+    int8_t h2 = hash_h2(hash);
+    for (size_t step = 1; step <= groups_mask + 1; step++) {
+        const int8_t* ctrl = table->ctrl + group * HASH_INDEX_GROUP;
+        uint32_t match = group_match(ctrl, h2);
+        // 与写者发布控制字节的 release 配对，之后读到的槽位内容不早于控制字节
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        while (match != 0) {
+            size_t i = group * HASH_INDEX_GROUP + __builtin_ctz(match);
+            const HashIndexSlot* slot = &table->slots[i];
+            // 槽位可能正被删除或复用，以记录本身的名字和类型为准
+            RecordRef ref = __atomic_load_n(&slot->head, __ATOMIC_ACQUIRE);
+            if (ref != RECORD_NIL && __atomic_load_n(&slot->hash, __ATOMIC_RELAXED) == hash) {
+                const CacheRecord* record = record_at(index->records, ref);
+                if (record->type == type && record->name == name) {
+                    *head = ref;
+                    return (long)i;
+                }
+            }
+            match &= match - 1;
+        }
+        if (group_match(ctrl, CTRL_EMPTY) != 0) {
+            return -1;
+        }
+        group = (group + step) & groups_mask;
+    }
+    return -1;
+}
+
+// 写者按记录查找所在的槽位
+static long record_slot(const HashIndex* index, const CacheRecord* record, uint64_t* hash) {
+    RecordRef head;
+    *hash = hash_index_hash(record->name, record->type);
+    return find_slot(index, index->table, record->name, record->type, *hash, &head);
+}
+
+// 沿探测序列找第一个空或已删除的槽位，调用方保证表未满
+static size_t free_slot(const HashIndexTable* table, uint64_t hash) {
+    size_t groups_mask = table->capacity / HASH_INDEX_GROUP - 1;
+    size_t group = hash_group(table, hash);
+    for (size_t step = 1;; step++) {
+        uint32_t mask = group_free(table->ctrl + group * HASH_INDEX_GROUP);
+        if (mask != 0) {
+            return group * HASH_INDEX_GROUP + __builtin_ctz(mask);
+        }
+        group = (group + step) & groups_mask;
+    }
+}
+
+// 在新表中重建，顺带清除已删除标记；建好后才替换表指针，旧表交给 retire
+static int rehash(HashIndex* index, size_t capacity) {
+    HashIndexTable* old = index->table;
+    HashIndexTable* table = table_alloc(capacity);
+    if (table == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < old->capacity; i++) {
+        if (old->ctrl[i] >= 0) {
+            size_t j = free_slot(table, old->slots[i].hash);
+            table->ctrl[j] = old->ctrl[i];
+            table->slots[j] = old->slots[i];
+        }
+    }
+    __atomic_store_n(&index->table, table, __ATOMIC_RELEASE);
+    index->capacity = capacity;
+    index->tombstones = 0;
+    index->rehashes++;
+    table_retire(index, old);
+    return 0;
+}
+
+RecordRef hash_index_find(const HashIndex* index, NameId name, uint8_t type) {
+    const HashIndexTable* table = __atomic_load_n(&index->table, __ATOMIC_ACQUIRE);
+    RecordRef head = RECORD_NIL;
+    find_slot(index, table, name, type, hash_index_hash(name, type), &head);
+    return head;
+}
+
+int hash_index_insert(HashIndex* index, RecordRef ref) {
+    CacheRecord* record = record_at(index->records, ref);
+    uint64_t hash;
+    long found = record_slot(index, record, &hash);
+    record->next = RECORD_NIL;
+    if (found >= 0) {
+        HashIndexSlot* slot = &index->table->slots[found];
+        record->prev = slot->tail;
+        __atomic_store_n(&record_at(index->records, slot->tail)->next, ref, __ATOMIC_RELEASE);
+        slot->tail = ref;
+        return 1;
+    }
+
+    if ((index->size + index->tombstones + 1) * 8 > index->capacity * 7) {
+        // 已删除的占了一半以上时原样大小重建即可，否则翻倍
+        size_t capacity = index->tombstones > index->size ? index->capacity : index->capacity * 2;
+        if (rehash(index, capacity) != 0) {
+            return -1;
+        }
+    }
+    HashIndexTable* table = index->table;
+    size_t i = free_slot(table, hash);
+    if (table->ctrl[i] == CTRL_DELETED) {
+        index->tombstones--;
+    }
+    record->prev = RECORD_NIL;
+    table->slots[i].tail = ref;
+    __atomic_store_n(&table->slots[i].hash, hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&table->slots[i].head, ref, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->ctrl[i], hash_h2(hash), __ATOMIC_RELEASE);
+    index->size++;
+    return 1;
+}
+
+// 让指向 old 的前驱（或槽位头）改指 next
+static void link_replace(const HashIndex* index, HashIndexSlot* slot, const CacheRecord* old, RecordRef next) {
+    if (old->prev == RECORD_NIL) {
+        __atomic_store_n(&slot->head, next, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&record_at(index->records, old->prev)->next, next, __ATOMIC_RELEASE);
+    }
+}
+
+void hash_index_delete(HashIndex* index, RecordRef ref) {
+    HashIndexTable* table = index->table;
+    CacheRecord* record = record_at(index->records, ref);
+    uint64_t hash;
+    long found = record_slot(index, record, &hash);
+    if (found < 0) {
+        return;
+    }
+    HashIndexSlot* slot = &table->slots[found];
+    link_replace(index, slot, record, record->next);
+    if (record->next == RECORD_NIL) {
+        slot->tail = record->prev;
+    } else {
+        record_at(index->records, record->next)->prev = record->prev;
+    }
+    // next 保留：正停在这条记录上的读者还要沿它走下去
+    record->prev = RECORD_NIL;
+    if (slot->head != RECORD_NIL) {
+        return;
+    }
+
+    // 所在组还有空槽时，任何探测都不会越过这一组，可以直接置空，否则留下删除标记
+    const int8_t* group = table->ctrl + (size_t)found / HASH_INDEX_GROUP * HASH_INDEX_GROUP;
+    if (group_match(group, CTRL_EMPTY) != 0) {
+        __atomic_store_n(&table->ctrl[found], CTRL_EMPTY, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&table->ctrl[found], CTRL_DELETED, __ATOMIC_RELEASE);
+        index->tombstones++;
+    }
+    index->size--;
+}
+
+void hash_index_replace(HashIndex* index, RecordRef old_ref, RecordRef ref) {
+    HashIndexTable* table = index->table;
+    CacheRecord* old = record_at(index->records, old_ref);
+    CacheRecord* record = record_at(index->records, ref);
+    uint64_t hash;
+    long found = record_slot(index, old, &hash);
+    if (found < 0) {
+        return;
+    }
+    HashIndexSlot* slot = &table->slots[found];
+    record->prev = old->prev;
+    record->next = old->next;
+    if (old->next == RECORD_NIL) {
+        slot->tail = ref;
+    } else {
+        record_at(index->records, old->next)->prev = ref;
+    }
+    link_replace(index, slot, old, ref);
+    old->prev = RECORD_NIL;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+记录缓存的哈希索引（Swiss table）
+    以 (名字, 类型) 为键，名字是驻留表中的 NameId（见 names.h），
+    每个槽位挂一条同名同类型的记录链表（records 中的紧凑记录，沿 next/prev），
+    查找只需对两个整数计算一次哈希，一般一到两次缓存未命中，不再像 Trie 那样每个字符走一个节点。
+    开放寻址，槽位按 16 个一组，每个槽位配一个控制字节：空、已删除，或哈希的低 7 位；
+    探测时用 SSE2 一次比较整组控制字节，只对低 7 位相同的槽位比较记录的 NameId 与类型，不比较字符串。
+    组之间按三角数序列探测，遇到含空槽的组即可停止。
+    名字在驻留表中已是规范的小写形式，查找与 Trie 一样不区分大小写；与 Trie 不同的是不限制字符集。
+    不加锁：写操作由调用方（DNSCache）保证互斥，hash_index_find 可以与一个写者并发执行。
+    为此控制字节、链表指针都在目标写好之后才以 release 方式发布，扩容时建好新表再整体替换表指针；
+    摘下的记录保留 next，正在遍历的读者可以继续走下去。
+    并发读时，摘下的记录与替换下来的旧表都要等读者离开后再释放（见 epoch.h 与 retire 回调）。
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "record.h"
+
+#define HASH_INDEX_GROUP 16
+#define HASH_INDEX_MIN_CAPACITY 64
+
+typedef struct HashIndexSlot {
+    RecordRef head;
+    RecordRef tail;
+    uint64_t hash;          // 扩容时不必重新计算
+} HashIndexSlot;
+
+// 槽位与控制字节在同一块内存里，读者取一次表指针即得到一致的 capacity、槽位和控制字节
+typedef struct HashIndexTable {
+    size_t capacity;        // 2 的幂，至少一组
+    int8_t* ctrl;           // 控制字节，capacity 个，紧跟在 slots 之后
+    HashIndexSlot slots[];
+} HashIndexTable;
+
+typedef struct HashIndex {
+    HashIndexTable* table;
+    size_t capacity;        // 同 table->capacity，供写者与统计使用
+    size_t size;            // 占用的槽位数（不同的 名字+类型 个数）
+    size_t tombstones;      // 已删除的槽位数，重建时清除
+    uint64_t rehashes;
+    void (*retire)(void* table, void* arg); // 扩容替换下来的旧表交给调用方延迟释放，NULL 时直接 free
+    void* retire_arg;
+    const RecordArena* records;     // 解析链表中的 RecordRef
+} HashIndex;
+
+// capacity 为预计的键数，按负载因子向上取整；失败返回 -1
+int hash_index_init(HashIndex* index, size_t capacity, const RecordArena* records);
+
+void hash_index_free(HashIndex* index);
+
+// 键的哈希
+uint64_t hash_index_hash(NameId name, uint8_t type);
+
+// 返回 name 下第一条 type 类型的记录，其余同类型记录沿 next 向后；不存在返回 RECORD_NIL
+RecordRef hash_index_find(const HashIndex* index, NameId name, uint8_t type);
+
+// 把记录追加到对应键的链表尾部，不检查重复；失败返回 -1
+int hash_index_insert(HashIndex* index, RecordRef record);
+
+// 从链表中摘下记录，链表为空时删除键
+void hash_index_delete(HashIndex* index, RecordRef record);
+
+// 用 record 原位替换链表中的 old（同一键），读者只会看到其中一条
+void hash_index_replace(HashIndex* index, RecordRef old, RecordRef record);
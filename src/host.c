@@ -122,14 +122,14 @@ int parse_hosts_line(char* line, int is_ipv6) {
         if (is_ipv6) {
             uint8_t ipv6_bytes[16];
             if (inet_pton(AF_INET6, ip_str, ipv6_bytes) == 1) {
-                cache_update(dns_cache, domain, RR_AAAA, ipv6_bytes, 86400); // TTL: 24小时
+                cache_update_static(dns_cache, domain, RR_AAAA, ipv6_bytes, 86400); // TTL: 24小时
                 hosts_stats.ipv6_entries++;
                 printf("Added IPv6 cache: %s -> %s\n", domain, ip_str);
             }
         } else {
             uint32_t ipv4_bytes;
             if (inet_pton(AF_INET, ip_str, &ipv4_bytes) == 1) {
-                cache_update(dns_cache, domain, RR_A, &ipv4_bytes, 86400); // TTL: 24小时
+                cache_update_static(dns_cache, domain, RR_A, &ipv4_bytes, 86400); // TTL: 24小时
                 hosts_stats.ipv4_entries++;
                 printf("Added IPv4 cache: %s -> %s\n", domain, ip_str);
             }
@@ -150,14 +150,14 @@ int parse_hosts_line(char* line, int is_ipv6) {
                 else if (is_ipv6) {
                     uint8_t ipv6_bytes[16];
                     if (inet_pton(AF_INET6, ip_str, ipv6_bytes) == 1) {
-                        cache_update(dns_cache, token, RR_AAAA, ipv6_bytes, 86400);
+                        cache_update_static(dns_cache, token, RR_AAAA, ipv6_bytes, 86400);
                         hosts_stats.ipv6_entries++;
                         printf("Added IPv6 alias cache: %s -> %s\n", token, ip_str);
                     }
                 } else {
                     uint32_t ipv4_bytes;
                     if (inet_pton(AF_INET, ip_str, &ipv4_bytes) == 1) {
-                        cache_update(dns_cache, token, RR_A, &ipv4_bytes, 86400);
+                        cache_update_static(dns_cache, token, RR_A, &ipv4_bytes, 86400);
                         hosts_stats.ipv4_entries++;
                         printf("Added IPv4 alias cache: %s -> %s\n", token, ip_str);
                     }
@@ -0,0 +1,317 @@
+#include "inflight.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+
+#define ID_SPACE 65536
+#define ID_RETRY 64     // 单个上游 socket 上随机选 ID 的最大尝试次数
+
+// 事务 ID 的随机性用于抵御伪造响应，种子取自系统随机源
+static uint64_t seed_random(const void* salt) {
+    uint64_t seed = 0;
+#ifndef _WIN32
+    FILE* fp = fopen("/dev/urandom", "rb");
+    if (fp) {
+        if (fread(&seed, sizeof(seed), 1, fp) != 1) {
+            seed = 0;
+        }
+        fclose(fp);
+    }
+#endif
+    if (seed == 0) {
+        seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ (uint64_t)(uintptr_t)salt;
+    }
+    return seed;
+}
+
+// splitmix64
+static uint64_t next_random(InflightTable* table) {
+    uint64_t z = (table->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int inflight_init(InflightTable* table) {
+    memset(table, 0, sizeof(*table));
+    table->capacity = INFLIGHT_CAPACITY;
+    // 条目与等待者都从 unused 起按需取用，未用到的部分不占物理内存
+    table->entries = (InflightEntry*)calloc(table->capacity, sizeof(InflightEntry));
+    table->waiter_pool = (InflightWaiter*)calloc(table->capacity, sizeof(InflightWaiter));
+    table->bucket_mask = table->capacity - 1;
+    table->buckets = (uint32_t*)calloc(table->capacity, sizeof(uint32_t));
+    if (table->entries == NULL || table->waiter_pool == NULL || table->buckets == NULL) {
+        inflight_destroy(table);
+        return -1;
+    }
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        table->id_map[i] = (uint32_t*)calloc(ID_SPACE, sizeof(uint32_t));
+        if (table->id_map[i] == NULL) {
+            inflight_destroy(table);
+            return -1;
+        }
+    }
+    table->free_head = INFLIGHT_NONE;
+    table->waiter_free = INFLIGHT_NONE;
+    table->rng = seed_random(table);
+    return 0;
+}
+
+void inflight_destroy(InflightTable* table) {
+    free(table->entries);
+    free(table->waiter_pool);
+    free(table->buckets);
+    table->entries = NULL;
+    table->waiter_pool = NULL;
+    table->buckets = NULL;
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        free(table->id_map[i]);
+        table->id_map[i] = NULL;
+    }
+}
+
+// 在指定上游 socket 上随机选一个未占用的事务 ID，失败返回 -1
+static int pick_txid(InflightTable* table, int upstream) {
+    uint32_t* map = table->id_map[upstream];
+    for (int i = 0; i < ID_RETRY; i++) {
+        uint64_t r = next_random(table);
+        // 一次随机数拆成四个候选 ID
+        for (int k = 0; k < 4; k++) {
+            uint16_t id = (uint16_t)(r >> (16 * k));
+            if (map[id] == 0) {
+                return id;
+            }
+        }
+    }
+    return -1;
+}
+
+// FNV-1a，结果为 0 时改为 1，0 留作“未加入索引”
+static uint32_t question_hash(const char* qname, uint16_t qtype, uint16_t qclass) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)qname; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    h = (h ^ qtype) * 16777619u;
+    h = (h ^ qclass) * 16777619u;
+    return h ? h : 1;
+}
+
+int inflight_question_matches(const InflightEntry* entry, const char* qname, uint16_t qtype, uint16_t qclass) {
+    return entry->qtype == qtype && entry->qclass == qclass && strcmp(entry->qname, qname) == 0;
+}
+
+static void index_insert(InflightTable* table, InflightEntry* entry, uint32_t hash) {
+    uint32_t* bucket = &table->buckets[hash & table->bucket_mask];
+    entry->hash = hash;
+    entry->hash_next = *bucket;
+    *bucket = (uint32_t)(entry - table->entries) + 1;
+}
+
+static void index_remove(InflightTable* table, InflightEntry* entry) {
+    uint32_t target = (uint32_t)(entry - table->entries) + 1;
+    uint32_t* link = &table->buckets[entry->hash & table->bucket_mask];
+    while (*link != 0) {
+        if (*link == target) {
+            *link = entry->hash_next;
+            break;
+        }
+        link = &table->entries[*link - 1].hash_next;
+    }
+    entry->hash = 0;
+    entry->hash_next = 0;
+}
+
+InflightEntry* inflight_find(InflightTable* table, const char* qname, uint16_t qtype, uint16_t qclass) {
+    uint32_t hash = question_hash(qname, qtype, qclass);
+    for (uint32_t i = table->buckets[hash & table->bucket_mask]; i != 0; i = table->entries[i - 1].hash_next) {
+        InflightEntry* entry = &table->entries[i - 1];
+        if (entry->hash == hash && inflight_question_matches(entry, qname, qtype, qclass)) {
+            return entry->waiter_count < INFLIGHT_MAX_WAITERS ? entry : NULL;
+        }
+    }
+    return NULL;
+}
+
+bool inflight_can_prefetch(InflightTable* table, uint32_t max, const char* qname, uint16_t qtype, uint16_t qclass) {
+    return table->prefetch_count < max && inflight_find(table, qname, qtype, qclass) == NULL;
+}
+
+int inflight_add_waiter(InflightTable* table, InflightEntry* entry, uint16_t orig_id, const struct sockaddr_in* cli) {
+    // 客户端超时重传的同一请求不重复挂载，否则会收到多份回复
+    if (entry->orig_id == orig_id && entry->cli.sin_addr.s_addr == cli->sin_addr.s_addr &&
+        entry->cli.sin_port == cli->sin_port) {
+        return 1;
+    }
+    for (uint32_t i = entry->waiters; i != INFLIGHT_NONE; i = table->waiter_pool[i].next) {
+        InflightWaiter* waiter = &table->waiter_pool[i];
+        if (waiter->orig_id == orig_id && waiter->cli.sin_addr.s_addr == cli->sin_addr.s_addr &&
+            waiter->cli.sin_port == cli->sin_port) {
+            return 1;
+        }
+    }
+
+    uint32_t index;
+    if (table->waiter_free != INFLIGHT_NONE) {
+        index = table->waiter_free;
+        table->waiter_free = table->waiter_pool[index].next;
+    } else if (table->waiter_unused < table->capacity) {
+        index = table->waiter_unused++;
+    } else {
+        return -1;
+    }
+    InflightWaiter* waiter = &table->waiter_pool[index];
+    waiter->orig_id = orig_id;
+    waiter->cli = *cli;
+    waiter->next = entry->waiters;
+    entry->waiters = index;
+    entry->waiter_count++;
+    table->coalesced++;
+    return 0;
+}
+
+void inflight_clear_waiters(InflightTable* table, InflightEntry* entry) {
+    uint32_t i = entry->waiters;
+    while (i != INFLIGHT_NONE) {
+        uint32_t next = table->waiter_pool[i].next;
+        table->waiter_pool[i].next = table->waiter_free;
+        table->waiter_free = i;
+        i = next;
+    }
+    entry->waiters = INFLIGHT_NONE;
+    entry->waiter_count = 0;
+}
+
+InflightEntry* inflight_alloc(InflightTable* table, uint64_t now_ms, const char* qname, uint16_t qtype, uint16_t qclass,
+                              bool prefetch) {
+    if (table->free_head == INFLIGHT_NONE && table->unused == table->capacity) {
+        table->rejected++;
+        return NULL;
+    }
+
+    // 轮流选择未满的上游 socket
+    int upstream = -1;
+    int txid = -1;
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        int candidate = (table->next_upstream + i) % UPSTREAM_SOCKETS;
+        if (table->load[candidate] >= INFLIGHT_PER_UPSTREAM) {
+            continue;
+        }
+        txid = pick_txid(table, candidate);
+        if (txid >= 0) {
+            upstream = candidate;
+            break;
+        }
+    }
+    if (upstream < 0) {
+        table->rejected++;
+        return NULL;
+    }
+    table->next_upstream = (upstream + 1) % UPSTREAM_SOCKETS;
+
+    uint32_t index;
+    if (table->free_head != INFLIGHT_NONE) {
+        index = table->free_head;
+        table->free_head = table->entries[index].next_free;
+    } else {
+        index = table->unused++;
+    }
+    InflightEntry* entry = &table->entries[index];
+    entry->next_free = INFLIGHT_NONE;
+    entry->waiters = INFLIGHT_NONE;
+    entry->waiter_count = 0;
+    entry->prefetch = prefetch;
+    entry->stale_served = false;
+    if (prefetch) {
+        memset(&entry->cli, 0, sizeof(entry->cli));
+        table->prefetch_count++;
+    }
+    entry->qtype = qtype;
+    entry->qclass = qclass;
+    entry->qname[0] = '\0';
+    if (qname != NULL && strlen(qname) < INFLIGHT_QNAME_LEN) {
+        strcpy(entry->qname, qname);
+        index_insert(table, entry, question_hash(qname, qtype, qclass));
+    }
+    entry->used = true;
+    entry->upstream = (uint8_t)upstream;
+    entry->txid = (uint16_t)txid;
+    entry->sent_ms = now_ms;
+    table->id_map[upstream][txid] = index + 1;
+    table->load[upstream]++;
+    table->count++;
+    timer_wheel_add(&table->timeouts, &entry->timer, now_ms, QUERY_TIMEOUT_SEC * 1000);
+    return entry;
+}
+
+InflightEntry* inflight_lookup(InflightTable* table, int upstream, uint16_t txid) {
+    if (upstream < 0 || upstream >= UPSTREAM_SOCKETS) {
+        return NULL;
+    }
+    uint32_t index = table->id_map[upstream][txid];
+    if (index == 0) {
+        return NULL;
+    }
+    return &table->entries[index - 1];
+}
+
+// 归还条目，不涉及超时定时器
+static void entry_free(InflightTable* table, InflightEntry* entry) {
+    uint32_t index = (uint32_t)(entry - table->entries);
+    timer_wheel_cancel(&table->deadlines, &entry->deadline);
+    if (entry->hash != 0) {
+        index_remove(table, entry);
+    }
+    inflight_clear_waiters(table, entry);
+    if (entry->prefetch) {
+        table->prefetch_count--;
+        entry->prefetch = false;
+    }
+    table->id_map[entry->upstream][entry->txid] = 0;
+    table->load[entry->upstream]--;
+    table->count--;
+    entry->used = false;
+    entry->next_free = table->free_head;
+    table->free_head = index;
+}
+
+void inflight_release(InflightTable* table, InflightEntry* entry) {
+    if (!entry->used) {
+        return;
+    }
+    timer_wheel_cancel(&table->timeouts, &entry->timer);
+    entry_free(table, entry);
+}
+
+static void on_entry_timeout(TimerNode* node, void* arg) {
+    InflightTable* table = (InflightTable*)arg;
+    InflightEntry* entry = (InflightEntry*)((char*)node - offsetof(InflightEntry, timer));
+    table->timed_out++;
+    entry_free(table, entry);
+}
+
+void inflight_set_deadline(InflightTable* table, InflightEntry* entry, uint64_t now_ms, uint64_t timeout_ms) {
+    timer_wheel_add(&table->deadlines, &entry->deadline, now_ms, timeout_ms);
+}
+
+typedef struct DeadlineContext {
+    InflightDeadlineCallback callback;
+    void* arg;
+} DeadlineContext;
+
+static void on_entry_deadline(TimerNode* node, void* arg) {
+    DeadlineContext* ctx = (DeadlineContext*)arg;
+    InflightEntry* entry = (InflightEntry*)((char*)node - offsetof(InflightEntry, deadline));
+    if (ctx->callback) {
+        ctx->callback(entry, ctx->arg);
+    }
+}
+
+int inflight_expire(InflightTable* table, uint64_t now_ms, InflightDeadlineCallback on_deadline, void* arg) {
+    // 先处理应答期限，与超时同一刻度到期时客户端仍能拿到过期数据
+    DeadlineContext ctx = {on_deadline, arg};
+    timer_wheel_advance(&table->deadlines, now_ms, on_entry_deadline, &ctx);
+    return timer_wheel_advance(&table->timeouts, now_ms, on_entry_timeout, table);
+}
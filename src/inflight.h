@@ -0,0 +1,129 @@
+#pragma once
+
+/*
+转发查询表（每个工作线程一张）
+    上游事务 ID 随机生成，与表中的位置无关；每个上游 socket 各有一张 65536 项的
+    ID -> 条目映射，回复按 (上游 socket, 事务 ID) 直接定位，分配与查找都是 O(1)。
+    空闲条目串成空闲链表；每个上游 socket 最多同时使用一半的 ID 空间，
+    随机选 ID 时期望不超过两次即可找到未占用的值。
+    容量为 UPSTREAM_SOCKETS * INFLIGHT_PER_UPSTREAM，超时由内嵌的时间轮回收。
+    有过期数据可用的条目另挂一个客户端应答期限（serve-stale），到期时回调调用方
+    先用过期数据应答，条目继续等待上游以刷新缓存。
+    条目另按问题 (qname, qtype, qclass) 建哈希索引：同一问题已在途时，
+    后来的客户端只挂为等待者，上游的一个回复分发给所有等待者。
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <netinet/in.h>
+#endif
+
+#include "timer.h"
+
+#define UPSTREAM_SOCKETS 4              // 每个工作线程连接上游的 socket（源端口）数
+#define INFLIGHT_PER_UPSTREAM 32768     // 每个上游 socket 同时在途的查询上限
+#define INFLIGHT_CAPACITY (UPSTREAM_SOCKETS * INFLIGHT_PER_UPSTREAM)
+#define QUERY_TIMEOUT_SEC 10            // 超时未得到上游响应
+#define INFLIGHT_MAX_WAITERS 256        // 单个在途查询最多合并的客户端数
+#define INFLIGHT_QNAME_LEN 256
+#define INFLIGHT_NONE UINT32_MAX
+
+// 合并到在途查询上的后来客户端
+typedef struct InflightWaiter {
+    uint16_t orig_id;
+    struct sockaddr_in cli;
+    uint32_t next;
+} InflightWaiter;
+
+typedef struct InflightEntry {
+    uint16_t orig_id;           // 客户端原始事务 ID
+    uint16_t txid;              // 发往上游的随机事务 ID
+    uint8_t upstream;           // 使用的上游 socket 序号
+    bool used;
+    bool prefetch;              // 预取发起的刷新，没有原始客户端
+    struct sockaddr_in cli;     // 客户端地址
+    uint64_t sent_ms;           // 转发时间（单调时钟毫秒）
+    uint64_t sent_us;           // 转发时刻（单调时钟微秒），用于统计上游耗时
+    TimerNode timer;            // 超时定时器
+    TimerNode deadline;         // 客户端应答期限，到期改用过期数据应答
+    bool stale_served;          // 已用过期数据应答过客户端，上游回复只刷新缓存
+    uint32_t next_free;         // 空闲链表
+    uint32_t hash;              // 问题的哈希，0 表示未加入问题索引
+    uint32_t hash_next;         // 问题索引的冲突链
+    uint32_t waiters;           // 等待者链表头
+    uint16_t waiter_count;
+    uint16_t qtype;
+    uint16_t qclass;
+    char qname[INFLIGHT_QNAME_LEN]; // 按原样比较，大小写不同（如 0x20 编码）的查询不合并
+} InflightEntry;
+
+typedef struct InflightTable {
+    InflightEntry* entries;
+    uint32_t capacity;
+    uint32_t count;                             // 在途查询数
+    uint32_t prefetch_count;                    // 其中预取的个数
+    uint32_t free_head;
+    uint32_t unused;                            // 从未使用过的条目起点，按需触及内存
+    uint32_t* buckets;                          // 问题索引，条目下标 + 1
+    uint32_t bucket_mask;
+    InflightWaiter* waiter_pool;
+    uint32_t waiter_free;
+    uint32_t waiter_unused;
+    uint32_t* id_map[UPSTREAM_SOCKETS];         // 事务 ID -> 条目下标 + 1，0 表示未占用
+    uint32_t load[UPSTREAM_SOCKETS];            // 各上游 socket 在途数
+    int next_upstream;                          // 轮流使用各上游 socket
+    uint64_t rng;
+    TimerWheel timeouts;
+    TimerWheel deadlines;                       // 客户端应答期限
+    uint64_t timed_out;                         // 累计超时数
+    uint64_t rejected;                          // 表满被拒绝的查询数
+    uint64_t coalesced;                         // 合并到已有在途查询的客户端数
+} InflightTable;
+
+// 客户端应答期限到期时的回调，条目仍在途
+typedef void (*InflightDeadlineCallback)(InflightEntry* entry, void* arg);
+
+int inflight_init(InflightTable* table);
+
+void inflight_destroy(InflightTable* table);
+
+// 分配条目：选定上游 socket 与随机事务 ID，并安排超时；表满返回 NULL
+// qname 不为空时加入问题索引，供后续相同问题合并；prefetch 表示没有原始客户端的预取
+InflightEntry* inflight_alloc(InflightTable* table, uint64_t now_ms, const char* qname, uint16_t qtype, uint16_t qclass,
+                              bool prefetch);
+
+// 查找同一问题的在途查询，不存在或等待者已满返回 NULL
+InflightEntry* inflight_find(InflightTable* table, const char* qname, uint16_t qtype, uint16_t qclass);
+
+// 能否为该问题发起预取：在途的预取少于 max，且相同问题不在途（在途查询的应答同样会刷新缓存）
+bool inflight_can_prefetch(InflightTable* table, uint32_t max, const char* qname, uint16_t qtype, uint16_t qclass);
+
+// 把客户端挂为等待者，返回 0；同一客户端重传的相同请求返回 1；等待者池耗尽返回 -1
+int inflight_add_waiter(InflightTable* table, InflightEntry* entry, uint16_t orig_id, const struct sockaddr_in* cli);
+
+// 遍历等待者：for (i = entry->waiters; i != INFLIGHT_NONE; i = table->waiter_pool[i].next)
+static inline InflightWaiter* inflight_waiter(InflightTable* table, uint32_t index) {
+    return &table->waiter_pool[index];
+}
+
+// 等待者均已另行应答后清空等待者链表，之后挂入的等待者照常等待上游回复
+void inflight_clear_waiters(InflightTable* table, InflightEntry* entry);
+
+// 回复中的问题是否与条目一致，用于丢弃伪造或错配的响应
+int inflight_question_matches(const InflightEntry* entry, const char* qname, uint16_t qtype, uint16_t qclass);
+
+// 按上游 socket 与事务 ID 查找在途条目，不存在返回 NULL
+InflightEntry* inflight_lookup(InflightTable* table, int upstream, uint16_t txid);
+
+// 完成后释放条目，O(1) 取消其超时
+void inflight_release(InflightTable* table, InflightEntry* entry);
+
+// 为条目安排客户端应答期限，已安排的改期
+void inflight_set_deadline(InflightTable* table, InflightEntry* entry, uint64_t now_ms, uint64_t timeout_ms);
+
+// 推进时间轮：对到期的应答期限调用 on_deadline，回收超时的条目，返回回收的个数
+int inflight_expire(InflightTable* table, uint64_t now_ms, InflightDeadlineCallback on_deadline, void* arg);
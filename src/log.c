@@ -1,50 +1,357 @@
 #include "log.h"
+#include "thread.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOG_IDLE_MS 5               // 队列为空时后台线程的休眠间隔
+#define LOG_LINE_MAX 1024           // 单条日志格式化后的最大长度
+#define LOG_OUT_BUFFER (64 * 1024)  // 后台线程每次写文件前攒下的字节数
+
+// 参数类型，由格式串中的转换说明决定
+enum {
+    ARG_NONE,       // %% 不消耗参数
+    ARG_BAD,        // 不支持的转换（* 宽度、%n、long double），记录到此截断
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_PTR,
+    ARG_STR,
+};
+
+typedef struct LogRecord {
+    size_t seq;                     // 等于写入位置时槽位空闲，等于写入位置 + 1 时可读
+    time_t time;
+    const char* tag;
+    const char* fmt;
+    uint8_t nargs;
+    uint8_t truncated;              // 参数超出 LOG_MAX_ARGS 或格式不支持，格式化到此为止
+    uint16_t text_used;
+    uint64_t args[LOG_MAX_ARGS];    // 数值参数的原始位；字符串参数为其在 text 中的偏移
+    char text[LOG_TEXT_SIZE];
+} LogRecord;
 
 LogLevel log_level = LOG_LEVEL_NONE;
 FILE* log_fp = NULL;
 
-void log_init(const char* path) {
-    // 以追加方式打开文件
-    log_fp = fopen(path, "a");
-    if (!log_fp) {
-        perror("Log init error");
-    }
-}
+static LogRecord* ring = NULL;
+static size_t ring_tail;            // 生产者用 CAS 抢占
+static size_t ring_head;            // 只由后台线程推进
+static uint64_t dropped;
+static int running;
+static thread_t writer;
 
-void log_close(void) {
-    if (log_fp) {
-        fclose(log_fp);
-        log_fp = NULL;
+// 解析 '%' 之后的一个转换说明，返回说明结束的位置
+static const char* parse_spec(const char* p, int* kind) {
+    while (*p && strchr("-+ #0", *p)) p++;
+    if (*p == '*') {
+        *kind = ARG_BAD;
+        return p;
     }
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            *kind = ARG_BAD;
+            return p;
+        }
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    int length = ARG_INT;
+    if (*p == 'h') {
+        p += p[1] == 'h' ? 2 : 1;
+    } else if (*p == 'l') {
+        length = p[1] == 'l' ? ARG_LLONG : ARG_LONG;
+        p += p[1] == 'l' ? 2 : 1;
+    } else if (*p == 'z') {
+        length = ARG_SIZE;
+        p++;
+    } else if (*p == 'j') {
+        length = ARG_INTMAX;
+        p++;
+    } else if (*p == 't') {
+        length = ARG_PTRDIFF;
+        p++;
+    } else if (*p == 'L') {
+        *kind = ARG_BAD;
+        return p;
+    }
+    switch (*p) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        *kind = length;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        *kind = ARG_DOUBLE;
+        break;
+    case 's':
+        *kind = ARG_STR;
+        break;
+    case 'p':
+        *kind = ARG_PTR;
+        break;
+    case '%':
+        *kind = ARG_NONE;
+        break;
+    default:
+        *kind = ARG_BAD;
+        return p;
+    }
+    return p + 1;
 }
 
 void log_write(const char* level_tag, const char* fmt, ...) {
-    if (!log_fp) {  // 异常处理
+    if (ring == NULL) {  // 异常处理
         printf("No log init\n");
         return;
     }
 
-    time_t now = time(NULL);     // 获取当前时间戳
-    struct tm tm_now;            // 声明一个结构化时间
+    // 抢占一个空闲槽位；队列满时计数后直接返回
+    size_t pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+    LogRecord* rec;
+    for (;;) {
+        rec = &ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring_tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    rec->time = time(NULL);
+    rec->tag = level_tag;
+    rec->fmt = fmt;
+    rec->nargs = 0;
+    rec->truncated = 0;
+    rec->text_used = 0;
+
+    // 按格式串取出参数原样保存，字符串复制进记录
+    va_list ap;
+    va_start(ap, fmt);
+    for (const char* p = fmt; *p;) {
+        if (*p++ != '%') {
+            continue;
+        }
+        int kind;
+        p = parse_spec(p, &kind);
+        if (kind == ARG_NONE) {
+            continue;
+        }
+        if (kind == ARG_BAD || rec->nargs == LOG_MAX_ARGS) {
+            rec->truncated = 1;
+            break;
+        }
+        uint64_t value = 0;
+        switch (kind) {
+        case ARG_INT: value = (uint64_t)va_arg(ap, int); break;
+        case ARG_LONG: value = (uint64_t)va_arg(ap, long); break;
+        case ARG_LLONG: value = (uint64_t)va_arg(ap, long long); break;
+        case ARG_SIZE: value = (uint64_t)va_arg(ap, size_t); break;
+        case ARG_INTMAX: value = (uint64_t)va_arg(ap, intmax_t); break;
+        case ARG_PTRDIFF: value = (uint64_t)va_arg(ap, ptrdiff_t); break;
+        case ARG_PTR: value = (uint64_t)(uintptr_t)va_arg(ap, void*); break;
+        case ARG_DOUBLE: {
+            double d = va_arg(ap, double);
+            memcpy(&value, &d, sizeof(value));
+            break;
+        }
+        case ARG_STR: {
+            const char* str = va_arg(ap, const char*);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            size_t room = LOG_TEXT_SIZE - rec->text_used - 1;
+            size_t len = strlen(str);
+            if (len > room) {
+                len = room;
+            }
+            memcpy(rec->text + rec->text_used, str, len);
+            rec->text[rec->text_used + len] = '\0';
+            value = rec->text_used;
+            rec->text_used += (uint16_t)(len + 1);
+            if (rec->text_used > LOG_TEXT_SIZE - 1) {
+                rec->text_used = LOG_TEXT_SIZE - 1;  // 之后的字符串都为空
+            }
+            break;
+        }
+        }
+        rec->args[rec->nargs++] = value;
+    }
+    va_end(ap);
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+}
 
-    // 跨平台时间转换
+// 每秒只做一次时间格式化
+static const char* format_time(time_t now) {
+    static time_t cached = -1;
+    static char time_string[20];
+    if (now != cached) {
+        struct tm tm_now;
+        // 跨平台时间转换
 #ifdef _WIN32
-    localtime_s(&tm_now, &now);  // Windows版本
+        localtime_s(&tm_now, &now);  // Windows版本
 #else
-    localtime_r(&now, &tm_now);  // Linux版本
+        localtime_r(&now, &tm_now);  // Linux版本
 #endif
-    char time_string[20];        // 生成格式化时间字符串
-    strftime(time_string, sizeof(time_string), "%Y-%m-%d %H:%M:%S", &tm_now);
+        strftime(time_string, sizeof(time_string), "%Y-%m-%d %H:%M:%S", &tm_now);
+        cached = now;
+    }
+    return time_string;
+}
+
+static int clamp(int n, int size) {
+    return n < 0 ? 0 : (n >= size ? size - 1 : n);
+}
+
+// 把一条记录格式化为 "[时间] 等级: 内容"，返回写入的字节数（不含结尾的 '\0'）
+static int format_record(const LogRecord* rec, char* out, int size) {
+    int len = clamp(snprintf(out, size, "[%s] %s: ", format_time(rec->time), rec->tag), size);
+    int arg = 0;
+    const char* p = rec->fmt;
+    while (*p && len < size - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        const char* start = p;
+        int kind;
+        p = parse_spec(p + 1, &kind);
+        if (kind == ARG_NONE) {
+            out[len++] = '%';
+            continue;
+        }
+        if (arg == rec->nargs) {
+            if (rec->truncated) {
+                len += clamp(snprintf(out + len, size - len, "...\n"), size - len);
+            }
+            break;
+        }
+        char spec[32];
+        if (p - start >= (ptrdiff_t)sizeof(spec)) {
+            break;
+        }
+        memcpy(spec, start, p - start);
+        spec[p - start] = '\0';
+        uint64_t value = rec->args[arg++];
+        int n = 0;
+        switch (kind) {
+        case ARG_INT: n = snprintf(out + len, size - len, spec, (int)value); break;
+        case ARG_LONG: n = snprintf(out + len, size - len, spec, (long)value); break;
+        case ARG_LLONG: n = snprintf(out + len, size - len, spec, (long long)value); break;
+        case ARG_SIZE: n = snprintf(out + len, size - len, spec, (size_t)value); break;
+        case ARG_INTMAX: n = snprintf(out + len, size - len, spec, (intmax_t)value); break;
+        case ARG_PTRDIFF: n = snprintf(out + len, size - len, spec, (ptrdiff_t)value); break;
+        case ARG_PTR: n = snprintf(out + len, size - len, spec, (void*)(uintptr_t)value); break;
+        case ARG_STR: n = snprintf(out + len, size - len, spec, rec->text + value); break;
+        case ARG_DOUBLE: {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            n = snprintf(out + len, size - len, spec, d);
+            break;
+        }
+        }
+        len += clamp(n, size - len);
+    }
+    if (len == size - 1 && out[len - 1] != '\n') {
+        out[len - 1] = '\n';  // 超长被截断的行
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// 后台写线程：取出队列中的日志批量格式化写入，队列为空时刷新文件并短暂休眠
+static void* log_writer(void* arg) {
+    (void)arg;
+    char* out = (char*)malloc(LOG_OUT_BUFFER);
+    if (out == NULL) {
+        return NULL;
+    }
+    uint64_t reported = 0;
+    for (;;) {
+        bool stop = !__atomic_load_n(&running, __ATOMIC_ACQUIRE);
+        int len = 0;
+        bool empty = false;
+        while (len + LOG_LINE_MAX <= LOG_OUT_BUFFER) {
+            LogRecord* rec = &ring[ring_head & (LOG_RING_SIZE - 1)];
+            if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != ring_head + 1) {
+                empty = true;
+                break;
+            }
+            len += format_record(rec, out + len, LOG_LINE_MAX);
+            __atomic_store_n(&rec->seq, ring_head + LOG_RING_SIZE, __ATOMIC_RELEASE);
+            ring_head++;
+        }
+        uint64_t lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+        if (lost != reported && len + LOG_LINE_MAX <= LOG_OUT_BUFFER) {
+            len += clamp(snprintf(out + len, LOG_LINE_MAX, "[%s] WARN : log queue full, %llu records dropped so far\n",
+                                  format_time(time(NULL)), (unsigned long long)lost), LOG_LINE_MAX);
+            reported = lost;
+        }
+        if (len > 0) {
+            fwrite(out, 1, len, log_fp);
+        }
+        if (empty) {
+            fflush(log_fp);
+            if (stop) {
+                break;
+            }
+            thread_sleep_ms(LOG_IDLE_MS);
+        }
+    }
+    free(out);
+    return NULL;
+}
 
-    fprintf(log_fp, "[%s] %s: ", time_string, level_tag);  // 打印日志头部
+void log_init(const char* path) {
+    // 以追加方式打开文件
+    log_fp = fopen(path, "a");
+    if (!log_fp) {
+        perror("Log init error");
+        return;
+    }
+    ring = (LogRecord*)malloc(sizeof(LogRecord) * LOG_RING_SIZE);
+    if (ring == NULL) {
+        perror("Log init error");
+        return;
+    }
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].seq = i;
+    }
+    ring_head = 0;
+    ring_tail = 0;
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    if (thread_create(&writer, log_writer, NULL) != 0) {
+        perror("Log init error");
+        free(ring);
+        ring = NULL;
+    }
+}
 
-    va_list ap;                 // 声明一个可变参数读取器
-    va_start(ap, fmt);          // 初始化读取器ap，指定从fmt之后的参数开始读
-    vfprintf(log_fp, fmt, ap);  // 格式化输出变参内容
-    va_end(ap);                 // 结束可变参数处理
+void log_close(void) {
+    if (ring) {
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        thread_join(writer);
+        free(ring);
+        ring = NULL;
+    }
+    if (log_fp) {
+        fclose(log_fp);
+        log_fp = NULL;
+    }
+}
 
-    // fprintf(log_fp, "\n");  // 打印换行符
-    fflush(log_fp);  // 刷新文件缓冲区，确保数据立即写入
+uint64_t log_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
 }
 
 void print_project_info(void) {
@@ -68,5 +375,19 @@ void print_project_info(void) {
     printf("|    -d   : Level 1 debugging                                    |\n");
     printf("|    -dd  : Level 2 debugging                                    |\n");
     printf("|    -ddd : Level 3 debugging                                    |\n");
+    printf("|    -b N : Datagrams per recvmmsg/sendmmsg batch (default 32)   |\n");
+    printf("|    -w N : Worker threads sharing port 53 (default 1)           |\n");
+    printf("|    -io uring|epoll : I/O backend (default epoll)               |\n");
+    printf("|    -pf P : Prefetch hot names at P%% of TTL left (default 10)   |\n");
+    printf("|    -pfmax N : Concurrent prefetches per worker (default 64)    |\n");
+    printf("|    -stale S : Serve expired answers for S sec (default 86400)  |\n");
+    printf("|    -stalewait MS : Upstream wait before stale answer (1800)    |\n");
+    printf("|    -pc N : Packet cache entries per worker (default 4096)      |\n");
+    printf("|    -qlog DIR : Write binary query log segments into DIR        |\n");
+    printf("|    -qlogsize MB : Query log segment size (default 64)          |\n");
+    printf("|    -qlogkeep N : Segments kept per worker (default 8, 0 = all) |\n");
+    printf("|    -shards N : Record cache shards (default 16)                |\n");
+    printf("|    -policy clock|tinylfu : Cache eviction (default clock)      |\n");
+    printf("|    -metrics NAME|off : Shared memory for dnsrelay-stats        |\n");
     printf("==================================================================\n");
 }
@@ -1,5 +1,13 @@
 #pragma once
 
+/*
+异步日志
+    查询线程只把时间戳、格式串指针和参数原样写进无锁环形队列（多生产者单消费者），
+    不做格式化也不碰文件；后台线程批量取出、格式化并写入日志文件。
+    格式串必须是字符串常量（它本身就是这类日志的标识），%s 参数在写入时复制。
+    队列满时丢弃并计数，不阻塞查询线程。
+*/
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -15,49 +23,62 @@ typedef enum {
     LOG_LEVEL_BYTE = 3    // 打印字节信息
 } LogLevel;
 
+// 编译期日志上限：高于此等级的日志调用整个被编译器删掉，例如 -DLOG_MAX_LEVEL=0
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_LEVEL_BYTE
+#endif
+
+#define LOG_RING_SIZE 4096  // 队列槽数，必须是 2 的幂
+#define LOG_MAX_ARGS 8      // 每条日志最多记录的参数个数，之后的内容截断
+#define LOG_TEXT_SIZE 320   // 每条日志中 %s 参数的总字节数，超出部分截断
+
 extern LogLevel log_level;
 extern FILE* log_fp;
 
-// 传入日志文件路径，初始化日志文件指针
+// 传入日志文件路径，打开文件并启动后台写线程
 void log_init(const char* path);
-// 关闭打开的日志文件
+// 写完队列中剩余的日志，停止后台线程并关闭日志文件
 void log_close(void);
-// 传入日志等级、格式化字符串、所用参数，将信息写入日志文件中
+// 传入日志等级、格式化字符串、所用参数，放进日志队列；fmt 必须是字符串常量
 void log_write(const char* level_tag, const char* fmt, ...);
+// 队列满而丢弃的日志条数
+uint64_t log_dropped(void);
 // 打印项目信息
 void print_project_info(void);
 
+#define LOG_ENABLED(level) (LOG_MAX_LEVEL >= (level) && log_level >= (level))
+
 #define LOG_INFO(fmt, ...)                          \
     do {                                            \
-        if (log_level >= LOG_LEVEL_INFO) {          \
+        if (LOG_ENABLED(LOG_LEVEL_INFO)) {          \
             log_write("INFO ", fmt, ##__VA_ARGS__); \
         }                                           \
     } while (0)
 
 #define LOG_DEBUG(fmt, ...)                         \
     do {                                            \
-        if (log_level >= LOG_LEVEL_DEBUG) {         \
+        if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {         \
             log_write("DEBUG", fmt, ##__VA_ARGS__); \
         }                                           \
     } while (0)
 
 #define LOG_BYTE(fmt, ...)                 \
     do {                                   \
-        if (log_level >= LOG_LEVEL_BYTE) { \
+        if (LOG_ENABLED(LOG_LEVEL_BYTE)) { \
             printf(fmt, ##__VA_ARGS__);    \
         }                                  \
     } while (0)
 
 #define LOG_ERROR(fmt, ...)                         \
     do {                                            \
-        if (log_level >= LOG_LEVEL_INFO) {          \
+        if (LOG_ENABLED(LOG_LEVEL_INFO)) {          \
             log_write("ERROR", fmt, ##__VA_ARGS__); \
         }                                           \
     } while (0)
 
 #define LOG_WARNING(fmt, ...)                       \
     do {                                            \
-        if (log_level >= LOG_LEVEL_INFO) {          \
+        if (LOG_ENABLED(LOG_LEVEL_INFO)) {          \
             log_write("WARN ", fmt, ##__VA_ARGS__); \
         }                                           \
     } while (0)
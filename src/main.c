@@ -13,6 +13,45 @@ int main(int argc, char* argv[]) {
             log_level = LOG_LEVEL_DEBUG;
         } else if (!strcmp(argv[i], "-ddd")) {
             log_level = LOG_LEVEL_BYTE;
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);  // 每次 recvmmsg/sendmmsg 的最大数据报数
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            worker_count = atoi(argv[++i]); // 工作线程数，各自以 SO_REUSEPORT 监听
+        } else if (!strcmp(argv[i], "-io") && i + 1 < argc) {
+            i++;
+            io_backend = !strcmp(argv[i], "uring") ? IO_BACKEND_URING : IO_BACKEND_EPOLL;
+        } else if (!strcmp(argv[i], "-pf") && i + 1 < argc) {
+            prefetch_percent = atoi(argv[++i]); // 剩余 TTL 百分比低于此值时预取，0 关闭
+        } else if (!strcmp(argv[i], "-pfmax") && i + 1 < argc) {
+            prefetch_max = atoi(argv[++i]);     // 每个工作线程同时在途的预取上限
+        } else if (!strcmp(argv[i], "-stale") && i + 1 < argc) {
+            stale_window = atoi(argv[++i]);     // 过期记录可用于应答的时长（秒），0 关闭
+        } else if (!strcmp(argv[i], "-stalewait") && i + 1 < argc) {
+            stale_wait_ms = atoi(argv[++i]);    // 等待上游多久后改用过期数据应答
+        } else if (!strcmp(argv[i], "-pc") && i + 1 < argc) {
+            packet_cache_size = atoi(argv[++i]); // 每个工作线程的报文缓存条目数，0 关闭
+        } else if (!strcmp(argv[i], "-qlog") && i + 1 < argc) {
+            qlog_dir = argv[++i];               // 二进制查询日志目录
+        } else if (!strcmp(argv[i], "-qlogsize") && i + 1 < argc) {
+            qlog_segment_mb = atoi(argv[++i]);  // 每个段文件的大小（MB）
+        } else if (!strcmp(argv[i], "-qlogkeep") && i + 1 < argc) {
+            qlog_keep = atoi(argv[++i]);        // 每个工作线程保留的段文件数，0 全部保留
+        } else if (!strcmp(argv[i], "-shards") && i + 1 < argc) {
+            cache_shards = atoi(argv[++i]);     // 记录缓存的分片数，取 2 的幂
+        } else if (!strcmp(argv[i], "-policy") && i + 1 < argc) {
+            i++;
+            // 记录缓存的淘汰策略，拼错时不能悄悄退回默认策略
+            if (!strcmp(argv[i], "clock")) {
+                cache_policy = CACHE_POLICY_CLOCK;
+            } else if (!strcmp(argv[i], "tinylfu")) {
+                cache_policy = CACHE_POLICY_TINYLFU;
+            } else {
+                fprintf(stderr, "Unknown cache policy '%s', usage: -policy clock|tinylfu\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-metrics") && i + 1 < argc) {
+            i++;
+            metrics_name = strcmp(argv[i], "off") ? argv[i] : NULL; // 导出指标的共享内存名
         }
     }
 
@@ -28,7 +67,7 @@ int main(int argc, char* argv[]) {
     dns_poll();
 
     // 跨平台清理
-    CLOSE_SOCKET(sock);
     network_cleanup();
+    log_close();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void metrics_header(MetricsShared* metrics, int worker_count) {
+    memcpy(metrics->magic, METRICS_MAGIC, sizeof(metrics->magic));
+    metrics->version = METRICS_VERSION;
+    metrics->worker_count = (uint32_t)worker_count;
+    metrics->upstream_sockets = UPSTREAM_SOCKETS;
+    metrics->started_us = now_us();
+#ifndef _WIN32
+    metrics->pid = (uint32_t)getpid();
+#endif
+}
+
+MetricsShared* metrics_open(const char* name, int worker_count) {
+#ifndef _WIN32
+    if (name != NULL) {
+        // 上次运行留下的段直接丢弃，重新建立保证计数从零开始
+        shm_unlink(name);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0 && ftruncate(fd, sizeof(MetricsShared)) == 0) {
+            void* base = mmap(NULL, sizeof(MetricsShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (base != MAP_FAILED) {
+                metrics_header((MetricsShared*)base, worker_count);
+                return (MetricsShared*)base;
+            }
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        perror("Metrics shared memory");
+        shm_unlink(name);
+    }
+#else
+    (void)name;
+#endif
+    MetricsShared* metrics = (MetricsShared*)calloc(1, sizeof(MetricsShared));
+    if (metrics != NULL) {
+        metrics_header(metrics, worker_count);
+    }
+    return metrics;
+}
+
+void metrics_close(MetricsShared* metrics, const char* name) {
+#ifndef _WIN32
+    if (name != NULL) {
+        munmap(metrics, sizeof(MetricsShared));
+        shm_unlink(name);
+        return;
+    }
+#else
+    (void)name;
+#endif
+    free(metrics);
+}
+
+const MetricsShared* metrics_attach(const char* name) {
+#ifndef _WIN32
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MetricsShared)) {
+        close(fd);
+        return NULL;
+    }
+    void* base = mmap(NULL, sizeof(MetricsShared), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    const MetricsShared* metrics = (const MetricsShared*)base;
+    if (memcmp(metrics->magic, METRICS_MAGIC, sizeof(metrics->magic)) != 0 || metrics->version != METRICS_VERSION) {
+        munmap(base, sizeof(MetricsShared));
+        return NULL;
+    }
+    return metrics;
+#else
+    (void)name;
+    return NULL;
+#endif
+}
+
+uint64_t histogram_bucket_low(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS);
+    return (HISTOGRAM_SUB_BUCKETS + sub) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+void histogram_merge(Histogram* into, const Histogram* from) {
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+}
+
+uint64_t histogram_percentile(const Histogram* histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(histogram->count * percentile / 100.0 + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t high = i + 1 < HISTOGRAM_BUCKETS ? histogram_bucket_low(i + 1) - 1 : histogram->max;
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+/*
+运行指标（共享内存导出）
+    每个工作线程只写自己的 WorkerMetrics，计数用普通的加法，不用原子操作；
+    各块按缓存行对齐，线程之间没有伪共享。整个 MetricsShared 放在 POSIX 共享内存里，
+    dnsrelay-stats 以只读方式映射后直接读取、汇总，不需要向中继发任何请求。
+    读取与写入之间没有同步，读到的是某一时刻附近的近似值，对统计用途足够。
+    耗时用 HDR 风格的对数直方图记录（微秒）：每个 2 的幂区间再等分 8 个桶，相对误差不超过 12.5%。
+*/
+
+#include <stdint.h>
+#include "inflight.h"
+
+#define METRICS_MAGIC "DNSMETR1"
+#define METRICS_VERSION 6
+#define METRICS_DEFAULT_NAME "/dnsrelay-stats"
+#define METRICS_MAX_WORKERS 64
+#define METRICS_MAX_SHARDS 64
+#define METRICS_SOURCES 8           // 应答来源，按 QLOG_SRC_* 下标
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((32 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)   // 覆盖到 2^32 微秒
+
+typedef struct Histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+typedef struct __attribute__((aligned(64))) WorkerMetrics {
+    uint64_t queries;                       // 收到的客户端查询
+    uint64_t answers[METRICS_SOURCES];      // 按来源统计的应答，QLOG_SRC_BLOCKED 即黑名单命中
+    uint64_t forwarded;                     // 转发给上游的查询（含预取）
+    uint64_t upstream_responses;
+    uint64_t upstream_unmatched;            // 找不到在途条目或问题不符的响应
+    uint64_t upstream_malformed;
+    uint64_t upstream_failures;             // 上游返回 SERVFAIL/REFUSED
+    // 以下每批处理完后从各模块自己的统计复制
+    uint64_t inflight_used;                 // 在途查询槽位
+    uint64_t inflight_capacity;
+    uint64_t inflight_timed_out;
+    uint64_t inflight_rejected;             // 表满丢弃的查询
+    uint64_t inflight_coalesced;
+    uint64_t tx_dropped;                    // 发送失败丢弃的数据报
+    uint64_t rx_max_batch;                  // 单次收包最多的个数
+    Histogram answer_latency;               // 经上游应答时客户端的等待时间
+    Histogram upstream_rtt[UPSTREAM_SOCKETS];   // 各上游 socket 的往返时间
+} WorkerMetrics;
+
+// 记录缓存各分片的统计
+typedef struct CacheShardMetrics {
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t rejected;          // W-TinyLFU 拒绝准入的候选（已计入 evictions）
+    uint64_t expired;           // 过期后被清理的记录
+    uint64_t bytes;             // 记录占用的内存（按大小类计）
+} CacheShardMetrics;
+
+typedef struct MetricsShared {
+    char magic[8];
+    uint32_t version;
+    uint32_t worker_count;
+    uint32_t upstream_sockets;
+    uint32_t pid;
+    uint64_t started_us;                    // 启动时刻（Unix 微秒）
+    // 全局值与分片统计，由 0 号工作线程随定期清理每秒更新
+    uint64_t cache_size;
+    uint64_t cache_capacity;
+    uint64_t cache_shards;
+    uint64_t cache_bytes;                   // 各分片记录占用的内存之和
+    uint64_t names;                         // 名字表中的名字数（缓存与黑名单共用）
+    uint64_t name_bytes;                    // 名字占用的内存
+    uint64_t prefetch_issued;
+    uint64_t prefetch_used;
+    uint64_t stale_served;
+    uint64_t log_dropped;
+    CacheShardMetrics shards[METRICS_MAX_SHARDS];
+    WorkerMetrics workers[METRICS_MAX_WORKERS];
+} MetricsShared;
+
+// 建立名为 name 的共享内存并清零；name 为 NULL 或建立失败时退回进程私有内存，指标照常维护
+MetricsShared* metrics_open(const char* name, int worker_count);
+
+void metrics_close(MetricsShared* metrics, const char* name);
+
+// 只读映射中继导出的指标，供 dnsrelay-stats 使用；失败返回 NULL
+const MetricsShared* metrics_attach(const char* name);
+
+static inline int histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+    if (value > UINT32_MAX) {
+        value = UINT32_MAX;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS +
+           (int)((value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+static inline void histogram_record(Histogram* histogram, uint64_t value) {
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->buckets[histogram_bucket(value)]++;
+}
+
+// 桶的下界
+uint64_t histogram_bucket_low(int bucket);
+
+void histogram_merge(Histogram* into, const Histogram* from);
+
+// 第 percentile 百分位的近似值（所在桶的上界，不超过最大值）
+uint64_t histogram_percentile(const Histogram* histogram, double percentile);
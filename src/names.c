@@ -0,0 +1,299 @@
+#include "names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <malloc.h>
+    #define table_alloc(size) _aligned_malloc(size, 64)
+    #define table_free(p) _aligned_free(p)
+#else
+    #define table_alloc(size) aligned_alloc(64, size)
+    #define table_free(p) free(p)
+#endif
+
+#define NAME_TOMBSTONE UINT32_MAX
+#define ENTRY_HEADER offsetof(NameEntry, name)
+#define LOWER_MASK 0x2020202020202020ULL
+#define HASH_MUL 0x9E3779B97F4A7C15ULL
+
+// 8 字节一组混合；每个字节或上 0x20 即忽略大小写，由此产生的碰撞在比较名字时排除
+uint64_t name_hash(const char* name, size_t len) {
+    uint64_t h = HASH_MUL ^ ((uint64_t)len << 8);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, name + i, 8);
+        h = (h ^ (word | LOWER_MASK)) * HASH_MUL;
+        h ^= h >> 29;
+    }
+    if (i < len) {
+        uint64_t word = 0;
+        memcpy(&word, name + i, len - i);
+        h = (h ^ (word | LOWER_MASK)) * HASH_MUL;
+    }
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+// 转成规范形式写入 key，返回长度；过长返回 -1
+static int canonical(const char* name, char* key) {
+    size_t len = strlen(name);
+    if (len >= DOMAIN_MAX_LEN) {
+        return -1;
+    }
+    for (size_t i = 0; i <= len; i++) {
+        char c = name[i];
+        key[i] = c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    }
+    return (int)len;
+}
+
+static inline NameEntry* entry_at(const NameTable* table, NameId id) {
+    return (NameEntry*)name_entry(table, id);
+}
+
+static inline NameStripe* stripe_of(NameTable* table, uint64_t hash) {
+    return &table->stripes[hash & (NAME_STRIPES - 1)];
+}
+
+// 低位已用于选段，槽位从更高的位开始
+static inline size_t slot_start(const NameSlots* slots, uint64_t hash) {
+    return (size_t)(hash >> 8) & (slots->capacity - 1);
+}
+
+static NameSlots* slots_alloc(size_t capacity) {
+    NameSlots* slots = (NameSlots*)calloc(1, sizeof(NameSlots) + capacity * sizeof(NameSlot));
+    if (slots != NULL) {
+        slots->capacity = capacity;
+    }
+    return slots;
+}
+
+// 线性探测查找，可与写者并发；写者先写 tag 再以 release 写 id，读到 id 后读到的 tag 不会更旧
+static NameId slots_find(const NameTable* table, const NameSlots* slots, const char* key, size_t len, uint64_t hash) {
+    size_t mask = slots->capacity - 1;
+    uint32_t tag = (uint32_t)(hash >> 32);
+    size_t i = slot_start(slots, hash);
+    for (size_t n = 0; n <= mask; n++, i = (i + 1) & mask) {
+        NameId id = __atomic_load_n(&slots->slots[i].id, __ATOMIC_ACQUIRE);
+        if (id == NAME_NIL) {
+            return NAME_NIL;
+        }
+        if (id == NAME_TOMBSTONE || __atomic_load_n(&slots->slots[i].tag, __ATOMIC_RELAXED) != tag) {
+            continue;
+        }
+        const NameEntry* entry = name_entry(table, id);
+        if (entry->hash == hash && entry->len == len && memcmp(entry->name, key, len) == 0) {
+            return id;
+        }
+    }
+    return NAME_NIL;
+}
+
+// 沿探测序列找第一个空或已删除的槽位，调用方保证表未满
+static size_t slots_free(const NameSlots* slots, uint64_t hash) {
+    size_t mask = slots->capacity - 1;
+    size_t i = slot_start(slots, hash);
+    while (slots->slots[i].id != NAME_NIL && slots->slots[i].id != NAME_TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void slot_publish(NameSlot* slot, uint64_t hash, NameId id) {
+    __atomic_store_n(&slot->tag, (uint32_t)(hash >> 32), __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->id, id, __ATOMIC_RELEASE);
+}
+
+// 在新表中重建，顺带清除已删除标记；建好后才替换表指针，旧表等读者离开后释放
+static int stripe_rehash(NameTable* table, NameStripe* stripe, size_t capacity) {
+    NameSlots* old = stripe->table;
+    NameSlots* slots = slots_alloc(capacity);
+    if (slots == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < old->capacity; i++) {
+        NameId id = old->slots[i].id;
+        if (id != NAME_NIL && id != NAME_TOMBSTONE) {
+            uint64_t hash = name_entry(table, id)->hash;
+            NameSlot* slot = &slots->slots[slots_free(slots, hash)];
+            slot->tag = old->slots[i].tag;
+            slot->id = id;
+        }
+    }
+    __atomic_store_n(&stripe->table, slots, __ATOMIC_RELEASE);
+    stripe->tombstones = 0;
+    epoch_retire(&stripe->retired, old);
+    return 0;
+}
+
+// 宽限期过后，名字回到所在段的 slab（回收在持有段锁时进行）
+static void entry_release(void* ptr, void* arg) {
+    NameStripe* stripe = (NameStripe*)arg;
+    NameEntry* entry = (NameEntry*)ptr;
+    RecordRef ref = (RecordRef)(((char*)entry - stripe->arena->base) / RECORD_UNIT);
+    slab_free(stripe->arena, &stripe->slab, ref, entry->size_class);
+}
+
+NameTable* name_table_create(size_t reserve) {
+    NameTable* table = (NameTable*)table_alloc(sizeof(NameTable));
+    if (table == NULL) {
+        return NULL;
+    }
+    memset(table, 0, sizeof(NameTable));
+    if (record_arena_init(&table->arena, reserve) != 0) {
+        table_free(table);
+        return NULL;
+    }
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        NameStripe* stripe = &table->stripes[i];
+        stripe->table = slots_alloc(NAME_TABLE_MIN_CAPACITY);
+        if (stripe->table == NULL) {
+            name_table_destroy(table);
+            return NULL;
+        }
+        stripe->arena = &table->arena;
+        stripe->retired_names.release = entry_release;
+        stripe->retired_names.release_arg = stripe;
+        mutex_init(&stripe->lock);
+    }
+    return table;
+}
+
+void name_table_destroy(NameTable* table) {
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        NameStripe* stripe = &table->stripes[i];
+        if (stripe->table == NULL) {
+            continue;
+        }
+        free(stripe->table);
+        epoch_retire_list_free(&stripe->retired_names);
+        epoch_retire_list_free(&stripe->retired);
+        mutex_destroy(&stripe->lock);
+    }
+    record_arena_destroy(&table->arena);     // 名字随 arena 一起归还
+    table_free(table);
+}
+
+NameTable* name_table_shared(void) {
+    if (name_table == NULL) {
+        name_table = name_table_create(NAME_TABLE_RESERVE);
+        if (name_table == NULL) {
+            fprintf(stderr, "Failed to create the name table\n");
+            exit(1);
+        }
+    }
+    return name_table;
+}
+
+NameId name_find(const NameTable* table, const char* name) {
+    char key[DOMAIN_MAX_LEN];
+    int len = canonical(name, key);
+    if (len < 0) {
+        return NAME_NIL;
+    }
+    uint64_t hash = name_hash(key, (size_t)len);
+    const NameStripe* stripe = &table->stripes[hash & (NAME_STRIPES - 1)];
+    const NameSlots* slots = __atomic_load_n(&stripe->table, __ATOMIC_ACQUIRE);
+    return slots_find(table, slots, key, (size_t)len, hash);
+}
+
+NameId name_intern(NameTable* table, const char* name) {
+    char key[DOMAIN_MAX_LEN];
+    int len = canonical(name, key);
+    if (len < 0) {
+        return NAME_NIL;
+    }
+    uint64_t hash = name_hash(key, (size_t)len);
+    NameStripe* stripe = stripe_of(table, hash);
+    mutex_lock(&stripe->lock);
+    NameId id = slots_find(table, stripe->table, key, (size_t)len, hash);
+    if (id != NAME_NIL) {
+        entry_at(table, id)->refs++;
+        mutex_unlock(&stripe->lock);
+        return id;
+    }
+
+    if ((stripe->size + stripe->tombstones + 1) * 8 > stripe->table->capacity * 7) {
+        // 名字占不到一半时原样大小重建，只清除删除标记，否则翻倍
+        size_t capacity = (stripe->size + 1) * 2 > stripe->table->capacity ? stripe->table->capacity * 2
+                                                                            : stripe->table->capacity;
+        if (stripe_rehash(table, stripe, capacity) != 0) {
+            mutex_unlock(&stripe->lock);
+            return NAME_NIL;
+        }
+    }
+    int cls = slab_class(ENTRY_HEADER + (size_t)len + 1);
+    id = slab_alloc(&table->arena, &stripe->slab, cls);
+    if (id != NAME_NIL) {
+        NameEntry* entry = entry_at(table, id);
+        entry->next = RECORD_NIL;
+        entry->refs = 1;
+        entry->hash = hash;
+        entry->len = (uint8_t)len;
+        entry->size_class = (uint8_t)cls;
+        memcpy(entry->name, key, (size_t)len + 1);
+        NameSlots* slots = stripe->table;
+        size_t i = slots_free(slots, hash);
+        if (slots->slots[i].id == NAME_TOMBSTONE) {
+            stripe->tombstones--;
+        }
+        slot_publish(&slots->slots[i], hash, id);
+        stripe->size++;
+    }
+    epoch_reclaim(&stripe->retired_names);
+    epoch_reclaim(&stripe->retired);
+    mutex_unlock(&stripe->lock);
+    return id;
+}
+
+void name_release(NameTable* table, NameId id) {
+    if (id == NAME_NIL) {
+        return;
+    }
+    NameEntry* entry = entry_at(table, id);
+    NameStripe* stripe = stripe_of(table, entry->hash);
+    mutex_lock(&stripe->lock);
+    if (--entry->refs == 0) {
+        // 按 id 找槽位。后一个槽位为空时任何探测都不会越过这里，可以直接置空；
+        // 否则留下删除标记，正在探测的读者不会因此提前停下
+        NameSlots* slots = stripe->table;
+        size_t mask = slots->capacity - 1;
+        size_t i = slot_start(slots, entry->hash);
+        for (size_t n = 0; n <= mask; n++, i = (i + 1) & mask) {
+            if (slots->slots[i].id == id) {
+                if (slots->slots[(i + 1) & mask].id == NAME_NIL) {
+                    __atomic_store_n(&slots->slots[i].id, NAME_NIL, __ATOMIC_RELEASE);
+                } else {
+                    __atomic_store_n(&slots->slots[i].id, NAME_TOMBSTONE, __ATOMIC_RELEASE);
+                    stripe->tombstones++;
+                }
+                stripe->size--;
+                break;
+            }
+        }
+        epoch_retire(&stripe->retired_names, entry);
+    }
+    epoch_reclaim(&stripe->retired_names);
+    epoch_reclaim(&stripe->retired);
+    mutex_unlock(&stripe->lock);
+}
+
+size_t name_count(const NameTable* table) {
+    size_t count = 0;
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        count += table->stripes[i].size;
+    }
+    return count;
+}
+
+size_t name_bytes(const NameTable* table) {
+    size_t bytes = 0;
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        bytes += table->stripes[i].slab.bytes;
+    }
+    return bytes;
+}
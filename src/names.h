@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+域名驻留表（interning）
+    每个不同的域名只保存一份规范形式（ASCII 字母转小写），带引用计数和哈希值。
+    缓存记录的所有者名、CNAME 目标和黑名单条目都保存 NameId 而不是字符串：
+    判断名字是否相同只比较整数，沿 CNAME 链前进直接使用目标的 NameId，同一个名字不再重复保存。
+    NameId 是名字在表的 arena 中的位置（与 RecordRef 编码相同，见 record.h），取字符串不需要查表；
+    名字被引用期间 NameId 不变，最后一个引用释放后删除，之后 NameId 可能分给别的名字。
+    按哈希分成 NAME_STRIPES 段，每段有自己的锁、开放寻址的查找表和 slab，增删名字只锁所在的段；
+    段锁总是最后获取（可以在持有缓存分片锁时释放名字），段内不再获取其他锁。
+    name_find 不加锁，可与写者并发，调用方需处于纪元临界区（见 epoch.h）：
+    删除的名字和扩容换下的旧查找表都等读者离开后再释放。
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "record.h"
+#include "epoch.h"
+#include "thread.h"
+
+#define NAME_STRIPES 16
+#define NAME_TABLE_MIN_CAPACITY 64              // 每段查找表的初始槽位数
+#define NAME_TABLE_RESERVE ((size_t)1 << 30)    // 名字 arena 保留的地址空间，用到时才占用内存
+
+// 名字本身，分配在表的 arena 中，NameId 即其位置
+typedef struct NameEntry {
+    RecordRef next;             // 只在 slab 空闲链表中使用
+    uint32_t refs;              // 由所在段的锁保护
+    uint64_t hash;              // name_hash 的结果，低位选段
+    uint8_t len;                // 不含结尾 0
+    uint8_t size_class;
+    char name[];                // 规范形式，含结尾 0
+} NameEntry;
+
+// 查找表槽位：id 为 NAME_NIL 表示空，NAME_TOMBSTONE 表示已删除；tag 为哈希高 32 位，先比它再读名字
+typedef struct NameSlot {
+    uint32_t tag;
+    NameId id;
+} NameSlot;
+
+typedef struct NameSlots {
+    size_t capacity;            // 2 的幂
+    NameSlot slots[];
+} NameSlots;
+
+typedef struct __attribute__((aligned(64))) NameStripe {
+    mutex_t lock;
+    NameSlots* table;           // 读者原子读取，扩容时整体替换
+    size_t size;                // 名字数
+    size_t tombstones;          // 已删除的槽位数，重建时清除
+    RecordSlab slab;
+    RecordArena* arena;         // 所有段共用
+    EpochRetireList retired;        // 扩容换下的旧表
+    EpochRetireList retired_names;  // 已删除、等读者离开后放回 slab 的名字
+} NameStripe;
+
+struct NameTable {
+    RecordArena arena;
+    NameStripe stripes[NAME_STRIPES];
+};
+
+// 缓存和黑名单共用的全局表，见 name_table_shared
+NameTable* name_table;
+
+// reserve 为名字 arena 保留的地址空间；失败返回 NULL
+NameTable* name_table_create(size_t reserve);
+
+// 只在确定没有读者、也没有其他引用者时调用
+void name_table_destroy(NameTable* table);
+
+// 返回全局的 name_table，尚未建立时建立（启动阶段单线程调用）；失败时退出
+NameTable* name_table_shared(void);
+
+// 名字的哈希，大小写不敏感：规范形式与原始形式的结果相同
+uint64_t name_hash(const char* name, size_t len);
+
+// 查找名字（不区分大小写），不存在返回 NAME_NIL；不取得引用，调用方需处于纪元临界区
+NameId name_find(const NameTable* table, const char* name);
+
+// 查找或加入名字并取得一个引用；名字过长或 arena 用尽返回 NAME_NIL
+NameId name_intern(NameTable* table, const char* name);
+
+// 释放一个引用，最后一个引用释放时删除名字
+void name_release(NameTable* table, NameId id);
+
+static inline const NameEntry* name_entry(const NameTable* table, NameId id) {
+    return (const NameEntry*)(table->arena.base + (size_t)id * RECORD_UNIT);
+}
+
+// 规范形式的名字，在名字被引用期间（或读临界区内）有效
+static inline const char* name_string(const NameTable* table, NameId id) {
+    return name_entry(table, id)->name;
+}
+
+// 名字数与占用的字节数（按大小类计，不加锁读取，只用于统计）
+size_t name_count(const NameTable* table);
+size_t name_bytes(const NameTable* table);
@@ -0,0 +1,202 @@
+#include "pktcache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_LEN 12
+#define RR_OPT 41   // EDNS 伪记录，TTL 字段另有含义
+
+// 问题部分的长度（qname + qtype + qclass），不是单问题的标准查询或格式异常返回 -1
+static int question_span(const uint8_t* p, int len) {
+    if (len < HEADER_LEN + 5 || p[4] != 0 || p[5] != 1) {
+        return -1;
+    }
+    int offset = HEADER_LEN;
+    while (offset < len && p[offset] != 0) {
+        if (p[offset] & 0xC0) {
+            return -1;  // 问题部分不应出现压缩指针
+        }
+        offset += p[offset] + 1;
+    }
+    offset += 1 + 4;
+    return offset <= len ? offset - HEADER_LEN : -1;
+}
+
+// 跳过资源记录的名字，返回其后的偏移，越界返回 -1
+static int skip_name(const uint8_t* p, int offset, int len) {
+    while (offset < len) {
+        uint8_t label = p[offset];
+        if (label == 0) {
+            return offset + 1;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            return offset + 2 <= len ? offset + 2 : -1;
+        }
+        offset += label + 1;
+    }
+    return -1;
+}
+
+static uint32_t question_hash(const uint8_t* question, int question_len, uint16_t flags) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < question_len; i++) {
+        h = (h ^ question[i]) * 16777619u;
+    }
+    h = (h ^ (flags >> 8)) * 16777619u;
+    h = (h ^ (flags & 0xFF)) * 16777619u;
+    return h ? h : 1;
+}
+
+static uint32_t read_u32(const char* p) {
+    const uint8_t* u = (const uint8_t*)p;
+    return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+static void write_u32(char* p, uint32_t v) {
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+int packet_cache_init(PacketCache* cache, int capacity) {
+    memset(cache, 0, sizeof(*cache));
+    if (capacity <= 0) {
+        return 0;
+    }
+    uint32_t sets = 1;
+    while (sets * PACKET_CACHE_WAYS < (uint32_t)capacity) {
+        sets <<= 1;
+    }
+    cache->entries = (PacketCacheEntry*)calloc((size_t)sets * PACKET_CACHE_WAYS, sizeof(PacketCacheEntry));
+    if (cache->entries == NULL) {
+        return -1;
+    }
+    cache->set_mask = sets - 1;
+    return 0;
+}
+
+void packet_cache_destroy(PacketCache* cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+int packet_cache_answer(PacketCache* cache, char* buf, int len, time_t now) {
+    if (cache->entries == NULL) {
+        return 0;
+    }
+    const uint8_t* query = (const uint8_t*)buf;
+    // 只处理标准查询：QR=0，OPCODE=0
+    if (len < HEADER_LEN || (query[2] & 0xF8) != 0) {
+        return 0;
+    }
+    int question_len = question_span(query, len);
+    if (question_len < 0) {
+        return 0;
+    }
+    uint16_t flags = (uint16_t)(((query[2] << 8) | query[3]) & PACKET_CACHE_KEY_FLAGS);
+    uint32_t hash = question_hash(query + HEADER_LEN, question_len, flags);
+
+    PacketCacheEntry* set = &cache->entries[(hash & cache->set_mask) * PACKET_CACHE_WAYS];
+    for (int i = 0; i < PACKET_CACHE_WAYS; i++) {
+        PacketCacheEntry* entry = &set[i];
+        if (entry->hash != hash || entry->flags != flags || entry->question_len != question_len ||
+            memcmp(entry->data + HEADER_LEN, buf + HEADER_LEN, question_len) != 0) {
+            continue;
+        }
+        if (now >= entry->expire) {
+            entry->hash = 0;
+            break;
+        }
+        // 先保留查询的事务 ID，再整体复制应答
+        char id0 = buf[0], id1 = buf[1];
+        memcpy(buf, entry->data, entry->len);
+        buf[0] = id0;
+        buf[1] = id1;
+        uint32_t elapsed = (uint32_t)(now - entry->inserted);
+        for (int k = 0; k < entry->ttl_count; k++) {
+            char* field = buf + entry->ttl_offsets[k];
+            write_u32(field, read_u32(field) - elapsed);
+        }
+        cache->hits++;
+        return entry->len;
+    }
+    cache->misses++;
+    return 0;
+}
+
+void packet_cache_insert(PacketCache* cache, uint16_t query_flags, const char* response, int len, time_t now,
+                         time_t expire) {
+    if (cache->entries == NULL || len > BUFFER_SIZE || expire <= now) {
+        return;
+    }
+    const uint8_t* p = (const uint8_t*)response;
+    int question_len = question_span(p, len);
+    if (question_len < 0) {
+        return;
+    }
+
+    // 找出所有资源记录的 TTL 字段，失效时间不晚于其中最小的 TTL
+    uint16_t offsets[PACKET_CACHE_MAX_TTLS];
+    int ttl_count = 0;
+    int records = ((p[6] << 8) | p[7]) + ((p[8] << 8) | p[9]) + ((p[10] << 8) | p[11]);
+    int offset = HEADER_LEN + question_len;
+    for (int i = 0; i < records; i++) {
+        offset = skip_name(p, offset, len);
+        if (offset < 0 || offset + 10 > len) {
+            return;
+        }
+        uint16_t type = (uint16_t)((p[offset] << 8) | p[offset + 1]);
+        uint16_t rdlength = (uint16_t)((p[offset + 8] << 8) | p[offset + 9]);
+        if (type != RR_OPT) {
+            if (ttl_count == PACKET_CACHE_MAX_TTLS) {
+                return;
+            }
+            uint32_t ttl = read_u32(response + offset + 4);
+            if (now + (time_t)ttl < expire) {
+                expire = now + (time_t)ttl;
+            }
+            offsets[ttl_count++] = (uint16_t)(offset + 4);
+        }
+        offset += 10 + rdlength;
+        if (offset > len) {
+            return;
+        }
+    }
+    if (expire <= now) {
+        return;
+    }
+
+    uint16_t flags = query_flags & PACKET_CACHE_KEY_FLAGS;
+    uint32_t hash = question_hash(p + HEADER_LEN, question_len, flags);
+    PacketCacheEntry* set = &cache->entries[(hash & cache->set_mask) * PACKET_CACHE_WAYS];
+    // 优先覆盖同键的项，其次空项或已失效的项，否则替换最早失效的一项
+    PacketCacheEntry* victim = NULL;
+    int victim_free = 0;
+    for (int i = 0; i < PACKET_CACHE_WAYS; i++) {
+        PacketCacheEntry* entry = &set[i];
+        if (entry->hash == hash && entry->flags == flags && entry->question_len == question_len &&
+            memcmp(entry->data + HEADER_LEN, response + HEADER_LEN, question_len) == 0) {
+            victim = entry;
+            break;
+        }
+        if (entry->hash == 0 || entry->expire <= now) {
+            if (!victim_free) {
+                victim = entry;
+                victim_free = 1;
+            }
+        } else if (!victim_free && (victim == NULL || entry->expire < victim->expire)) {
+            victim = entry;
+        }
+    }
+
+    victim->hash = hash;
+    victim->flags = flags;
+    victim->question_len = (uint16_t)question_len;
+    victim->len = (uint16_t)len;
+    victim->ttl_count = (uint8_t)ttl_count;
+    victim->inserted = now;
+    victim->expire = expire;
+    memcpy(victim->ttl_offsets, offsets, sizeof(uint16_t) * ttl_count);
+    memcpy(victim->data, response, len);
+    cache->inserts++;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+报文缓存（每个工作线程一份，不需要加锁）
+    以查询的问题部分（wire 格式的 qname + qtype + qclass）和影响应答的标志位为键，
+    保存最终发给客户端的应答报文。命中时直接复制报文，只改写事务 ID，
+    并按写入以来经过的秒数扣减各资源记录的 TTL，不再解析查询、查 Trie、重新编码。
+    应答只在写入时由记录缓存编码一次；过了调用方给定的截止时间（最早过期或需要预取的时刻）即失效。
+    组相联：每组 PACKET_CACHE_WAYS 项，组内替换最早失效的一项。
+*/
+
+#include <stdint.h>
+#include <time.h>
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 512
+#endif
+
+#define PACKET_CACHE_DEFAULT_SIZE 4096  // 每个工作线程的默认条目数
+#define PACKET_CACHE_WAYS 4
+#define PACKET_CACHE_MAX_TTLS 16        // 单个应答中最多可调整的 TTL 字段数
+#define PACKET_CACHE_KEY_FLAGS 0x0110   // 参与区分的查询标志：RD、CD
+
+typedef struct PacketCacheEntry {
+    uint32_t hash;              // 0 表示空
+    uint16_t flags;             // 查询标志中 PACKET_CACHE_KEY_FLAGS 部分
+    uint16_t question_len;      // 问题部分长度，问题部分位于 data + 12
+    uint16_t len;               // 应答长度
+    uint8_t ttl_count;
+    time_t inserted;            // 写入时间，TTL 按此扣减
+    time_t expire;              // 到此时刻失效
+    uint16_t ttl_offsets[PACKET_CACHE_MAX_TTLS];
+    char data[BUFFER_SIZE];
+} PacketCacheEntry;
+
+typedef struct PacketCache {
+    PacketCacheEntry* entries;
+    uint32_t set_mask;          // 组数 - 1，entries 为 NULL 时关闭
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+} PacketCache;
+
+// capacity 向上取整为 2 的幂；0 表示关闭报文缓存。失败返回 -1
+int packet_cache_init(PacketCache* cache, int capacity);
+
+void packet_cache_destroy(PacketCache* cache);
+
+// 命中时把应答写入 buf（覆盖查询），换成查询的事务 ID 并扣减 TTL，返回应答长度；未命中返回 0
+int packet_cache_answer(PacketCache* cache, char* buf, int len, time_t now);
+
+// 写入应答，query_flags 为原查询的标志位；expire 之后不再使用
+// 应答格式异常或 TTL 字段过多时不缓存
+void packet_cache_insert(PacketCache* cache, uint16_t query_flags, const char* response, int len, time_t now,
+                         time_t expire);
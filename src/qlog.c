@@ -0,0 +1,257 @@
+#include "qlog.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define HEADER_LEN 12
+#define RECORD_ALIGN 8
+
+uint64_t qlog_now_us(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return t / 10 - 11644473600000000ULL;   // 1601 年起的 100ns -> Unix 微秒
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+#ifdef _WIN32
+
+int qlog_open(QueryLog* log, const char* dir, uint32_t worker, size_t segment_size, int keep) {
+    (void)dir;
+    (void)worker;
+    (void)segment_size;
+    (void)keep;
+    memset(log, 0, sizeof(*log));
+    printf("Query log is not supported on this platform\n");
+    return -1;
+}
+
+void qlog_close(QueryLog* log) {
+    (void)log;
+}
+
+void qlog_write(QueryLog* log, const struct sockaddr_in* client, const char* packet, int len, uint8_t source,
+                uint32_t latency_us) {
+    (void)log;
+    (void)client;
+    (void)packet;
+    (void)len;
+    (void)source;
+    (void)latency_us;
+}
+
+#else
+
+static void segment_path(const QueryLog* log, uint32_t sequence, char* path, size_t size) {
+    snprintf(path, size, "%s/qlog-w%u-%s-%06u.bin", log->dir, log->worker, log->stamp, sequence);
+}
+
+// 建立并映射下一个段文件
+static int segment_open(QueryLog* log) {
+    char path[QLOG_PATH_MAX + 64];
+    segment_path(log, log->sequence, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Query log open failed");
+        return -1;
+    }
+    // 真正分配磁盘块，磁盘满时在这里失败，而不是写映射时收到 SIGBUS
+    if (ftruncate(fd, (off_t)log->capacity) != 0 || posix_fallocate(fd, 0, (off_t)log->capacity) != 0) {
+        perror("Query log allocate failed");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    void* base = mmap(NULL, log->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("Query log mmap failed");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    QlogSegmentHeader* header = (QlogSegmentHeader*)base;
+    memcpy(header->magic, QLOG_MAGIC, sizeof(header->magic));
+    header->version = QLOG_VERSION;
+    header->header_size = sizeof(QlogSegmentHeader);
+    header->capacity = log->capacity;
+    header->used = sizeof(QlogSegmentHeader);
+    header->created_us = qlog_now_us();
+    header->worker = log->worker;
+    header->sequence = log->sequence;
+
+    log->fd = fd;
+    log->base = (uint8_t*)base;
+    log->used = sizeof(QlogSegmentHeader);
+
+    // 只保留最近 keep 个段
+    if (log->keep > 0 && log->sequence >= (uint32_t)log->keep) {
+        segment_path(log, log->sequence - log->keep, path, sizeof(path));
+        unlink(path);
+    }
+    return 0;
+}
+
+static void segment_close(QueryLog* log) {
+    munmap(log->base, log->capacity);
+    if (ftruncate(log->fd, (off_t)log->used) != 0) {
+        perror("Query log truncate failed");
+    }
+    close(log->fd);
+    log->base = NULL;
+}
+
+int qlog_open(QueryLog* log, const char* dir, uint32_t worker, size_t segment_size, int keep) {
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    if (strlen(dir) >= sizeof(log->dir) || segment_size < 4096) {
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("Query log directory");
+        return -1;
+    }
+    strcpy(log->dir, dir);
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(log->stamp, sizeof(log->stamp), "%Y%m%d-%H%M%S", &tm_now);
+    log->worker = worker;
+    log->keep = keep;
+    log->capacity = segment_size;
+    return segment_open(log);
+}
+
+void qlog_close(QueryLog* log) {
+    if (log->base != NULL) {
+        segment_close(log);
+    }
+}
+
+void qlog_write(QueryLog* log, const struct sockaddr_in* client, const char* packet, int len, uint8_t source,
+                uint32_t latency_us) {
+    if (log->base == NULL || len < HEADER_LEN) {
+        return;
+    }
+    // 问题部分不含压缩指针，直接按标签长度走到结尾
+    const uint8_t* p = (const uint8_t*)packet;
+    int name_len = 0;
+    uint16_t qtype = 0;
+    if (p[4] != 0 || p[5] != 0) {
+        int offset = HEADER_LEN;
+        while (offset < len && p[offset] != 0 && !(p[offset] & 0xC0)) {
+            offset += p[offset] + 1;
+        }
+        if (offset + 3 <= len && p[offset] == 0) {
+            // 超过 255 字节的名字 name_len 存不下，只记录类型
+            name_len = offset + 1 - HEADER_LEN <= UINT8_MAX ? offset + 1 - HEADER_LEN : 0;
+            qtype = (uint16_t)((p[offset + 1] << 8) | p[offset + 2]);
+        }
+    }
+
+    size_t size = (sizeof(QlogRecord) + name_len + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+    if (log->used + size > log->capacity) {
+        segment_close(log);
+        log->sequence++;
+        log->rotations++;
+        if (segment_open(log) != 0) {
+            log->errors++;
+            return;
+        }
+    }
+
+    QlogRecord* record = (QlogRecord*)(log->base + log->used);
+    record->time_us = qlog_now_us();
+    record->latency_us = latency_us;
+    record->client_addr = client->sin_addr.s_addr;
+    record->client_port = client->sin_port;
+    record->qtype = qtype;
+    record->source = source;
+    record->rcode = p[3] & 0x0F;
+    record->name_len = (uint8_t)name_len;
+    record->reserved = 0;
+    memcpy(record->name, p + HEADER_LEN, name_len);
+    log->used += size;
+    ((QlogSegmentHeader*)log->base)->used = log->used;
+    log->records++;
+}
+
+#endif
+
+size_t qlog_segment_used(const uint8_t* data, size_t size) {
+    const QlogSegmentHeader* header = (const QlogSegmentHeader*)data;
+    if (size < sizeof(QlogSegmentHeader) || memcmp(header->magic, QLOG_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != QLOG_VERSION || header->header_size != sizeof(QlogSegmentHeader)) {
+        return 0;
+    }
+    // 截断后的文件以实际大小为准，写入中途退出的段以头部记录的 used 为准
+    return header->used < size ? header->used : size;
+}
+
+const QlogRecord* qlog_next(const uint8_t* data, size_t used, size_t* offset) {
+    if (*offset < sizeof(QlogSegmentHeader)) {
+        *offset = sizeof(QlogSegmentHeader);
+    }
+    if (*offset + sizeof(QlogRecord) > used) {
+        return NULL;
+    }
+    const QlogRecord* record = (const QlogRecord*)(data + *offset);
+    size_t size = (sizeof(QlogRecord) + record->name_len + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+    if (record->time_us == 0 || *offset + size > used) {
+        return NULL;
+    }
+    *offset += size;
+    return record;
+}
+
+int qlog_name(const QlogRecord* record, char* out, int out_size) {
+    int offset = 0;
+    int pos = 0;
+    if (record->name_len == 0 || out_size < 2) {
+        return -1;
+    }
+    while (offset < record->name_len && record->name[offset] != 0) {
+        int label = record->name[offset++];
+        if (offset + label > record->name_len || pos + label + 2 > out_size) {
+            return -1;
+        }
+        if (pos > 0) {
+            out[pos++] = '.';
+        }
+        memcpy(out + pos, record->name + offset, label);
+        pos += label;
+        offset += label;
+    }
+    if (pos == 0) {
+        out[pos++] = '.';   // 根
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+const char* qlog_source_name(uint8_t source) {
+    switch (source) {
+    case QLOG_SRC_PACKET_CACHE: return "packet-cache";
+    case QLOG_SRC_CACHE: return "cache";
+    case QLOG_SRC_NEGATIVE: return "negative-cache";
+    case QLOG_SRC_STALE: return "stale";
+    case QLOG_SRC_UPSTREAM: return "upstream";
+    case QLOG_SRC_COALESCED: return "coalesced";
+    case QLOG_SRC_BLOCKED: return "blocked";
+    default: return "unknown";
+    }
+}
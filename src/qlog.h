@@ -0,0 +1,107 @@
+#pragma once
+
+/*
+二进制查询日志（每个工作线程一份）
+    每个发给客户端的应答记一条：时间、客户端、查询名、类型、RCODE、应答来源（报文缓存、
+    记录缓存、上游……）与上游耗时。记录追加写入预先分配并 mmap 的段文件，
+    写入只是一次内存复制，不经过 stdio，也没有系统调用；段写满时截断到实际长度并换下一个文件，
+    只保留最近 keep 个。
+    段文件格式：QlogSegmentHeader，之后是按 8 字节对齐的 QlogRecord 序列，used 之后全为 0。
+    整数按主机字节序保存，地址与端口保持网络字节序，查询名保持线上格式；
+    tools/qlogread 离线转换为文本或 CSV。
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <netinet/in.h>
+#endif
+
+#define QLOG_MAGIC "DNSQLOG1"
+#define QLOG_VERSION 1
+#define QLOG_DEFAULT_SEGMENT_MB 64  // 每个段文件的大小
+#define QLOG_DEFAULT_KEEP 8         // 每个工作线程保留的段文件数，0 表示全部保留
+#define QLOG_PATH_MAX 512
+
+typedef struct QlogSegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity;      // 段文件大小
+    uint64_t used;          // 已写入的字节数（含头部），每条记录后更新
+    uint64_t created_us;    // 段创建时刻（Unix 微秒）
+    uint32_t worker;
+    uint32_t sequence;
+    uint8_t reserved[16];
+} QlogSegmentHeader;
+
+// 应答来源
+enum {
+    QLOG_SRC_PACKET_CACHE = 1,  // 报文缓存
+    QLOG_SRC_CACHE,             // 记录缓存
+    QLOG_SRC_NEGATIVE,          // 负缓存
+    QLOG_SRC_STALE,             // 过期数据
+    QLOG_SRC_UPSTREAM,          // 上游应答
+    QLOG_SRC_COALESCED,         // 合并到在途查询上，随上游应答一起回复
+    QLOG_SRC_BLOCKED,           // 黑名单或 0.0.0.0 拦截
+};
+
+typedef struct QlogRecord {
+    uint64_t time_us;       // 应答发出时刻（Unix 微秒）
+    uint32_t latency_us;    // 上游耗时，缓存应答为 0
+    uint32_t client_addr;   // 网络字节序
+    uint16_t client_port;   // 网络字节序
+    uint16_t qtype;
+    uint8_t source;         // QLOG_SRC_*
+    uint8_t rcode;
+    uint8_t name_len;       // 线上格式查询名的长度（含结尾的 0），没有问题时为 0
+    uint8_t reserved;
+    uint8_t name[];
+} QlogRecord;
+
+typedef struct QueryLog {
+    uint8_t* base;          // 当前段的映射，NULL 表示未开启
+    size_t capacity;
+    size_t used;
+    int fd;
+    int keep;
+    uint32_t worker;
+    uint32_t sequence;
+    char dir[QLOG_PATH_MAX];
+    char stamp[32];         // 启动时刻，区分每次运行的段文件
+    uint64_t records;
+    uint64_t rotations;
+    uint64_t errors;        // 换段失败而丢弃的记录
+} QueryLog;
+
+// 在 dir 下建立第一个段文件；失败返回 -1，日志保持关闭
+int qlog_open(QueryLog* log, const char* dir, uint32_t worker, size_t segment_size, int keep);
+
+// 把当前段截断到实际长度并关闭
+void qlog_close(QueryLog* log);
+
+static inline bool qlog_enabled(const QueryLog* log) {
+    return log->base != NULL;
+}
+
+// 当前时刻（Unix 微秒）
+uint64_t qlog_now_us(void);
+
+// 记录一个发给 client 的应答，查询名、类型、RCODE 取自应答报文本身
+void qlog_write(QueryLog* log, const struct sockaddr_in* client, const char* packet, int len, uint8_t source,
+                uint32_t latency_us);
+
+// 校验段文件头，返回记录区的结束位置；格式不对返回 0
+size_t qlog_segment_used(const uint8_t* data, size_t size);
+
+// 取 offset 处的记录并前移 offset，到末尾返回 NULL
+const QlogRecord* qlog_next(const uint8_t* data, size_t used, size_t* offset);
+
+// 把记录中的查询名转换为点分形式，失败返回 -1
+int qlog_name(const QlogRecord* record, char* out, int out_size);
+
+const char* qlog_source_name(uint8_t source);
@@ -0,0 +1,282 @@
+#include "record.h"
+#include "names.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define SLAB_CHUNK_SIZE ((size_t)64 << 10)  // 分片每次从 arena 切出的大小
+#define HEADER_SIZE offsetof(CacheRecord, data)
+#define NEGATIVE_HEADER 5                   // qtype、rcode、owner_len、rdata_len
+
+// 各大小类的 RECORD_UNIT 数；最大一类放得下最长的负缓存条目和最长的名字
+static const uint8_t class_units[RECORD_CLASSES] = {2, 3, 4, 5, 6, 8, 10, 12, 16, 20};
+
+int DNSRecord_init(DNSRecord* record, const char* domain, time_t expire_time, uint8_t type, const void* value) {
+    int len = strlen(domain);
+    if (len >= DOMAIN_MAX_LEN) {
+        return -1;
+    }
+    memcpy(record->domain, domain, len);
+    record->domain[len]='\0';
+    record->expire_time = expire_time;
+    record->ttl = 0;
+    record->hits = 0;
+    record->flags = 0;
+    record->type = type;
+    if (type == RR_A) {
+        record->value.ipv4 = *(uint32_t*)value;
+    } else if (type == RR_AAAA) {
+        memcpy (record->value.ipv6, (uint8_t*)value, 16);
+    } else if (type == RR_CNAME) {
+        strncpy(record->value.cname, (char*)value, DOMAIN_MAX_LEN - 1);
+        record->value.cname[DOMAIN_MAX_LEN - 1] = '\0';
+    } else if (type == RR_NEGATIVE) {
+        record->value.negative = *(const NegativeAnswer*)value;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+DNSRecord* DNSRecord_create(const char* domain, time_t expire_time, uint8_t type, const void* value) {
+    DNSRecord* record = (DNSRecord*)malloc(sizeof(DNSRecord));
+    if (record == NULL) {
+        return NULL;
+    }
+    if (DNSRecord_init(record, domain, expire_time, type, value) != 0) {
+        free(record);
+        return NULL;
+    }
+    return record;
+}
+
+int DNSRecord_compare(const DNSRecord* a, const DNSRecord* b) {
+    if(strcmp(a->domain, b->domain)) return 0;
+    if(a->type != b->type) return 0;
+    if(a->type == RR_A && a->value.ipv4 != b->value.ipv4) return 0;
+    if(a->type == RR_AAAA && memcmp(a->value.ipv6, b->value.ipv6, 16)) return 0;
+    if(a->type == RR_CNAME && strcmp(a->value.cname, b->value.cname)) return 0;
+    if(a->type == RR_NEGATIVE && a->value.negative.qtype != b->value.negative.qtype) return 0;
+    return 1;
+}
+
+int record_arena_init(RecordArena* arena, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (size == 0 || size > RECORD_MAX_ARENA) {
+        size = size == 0 ? HUGE_PAGE_SIZE : RECORD_MAX_ARENA & ~(HUGE_PAGE_SIZE - 1);
+    }
+#ifdef _WIN32
+    // 只保留地址空间，切块时再提交（大页需要特权，这里不用）
+    arena->base = (char*)VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+    if (arena->base == NULL) {
+        return -1;
+    }
+#else
+    // 多映射 2 MB 以便把起点对齐到大页边界，页面第一次写入时才分配物理内存
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    char* raw = (char*)mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (raw == MAP_FAILED) {
+        return -1;
+    }
+    char* base = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (base > raw) {
+        munmap(raw, base - raw);
+    }
+    if (base + size < raw + size + HUGE_PAGE_SIZE) {
+        munmap(base + size, raw + size + HUGE_PAGE_SIZE - (base + size));
+    }
+    arena->base = base;
+#ifdef MADV_HUGEPAGE
+    arena->hugepages = madvise(base, size, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+    arena->size = size;
+    arena->used = RECORD_UNIT;      // 偏移 0 留给 RECORD_NIL
+    return 0;
+}
+
+void record_arena_destroy(RecordArena* arena) {
+    if (arena->base == NULL) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(arena->base, 0, MEM_RELEASE);
+#else
+    munmap(arena->base, arena->size);
+#endif
+    memset(arena, 0, sizeof(*arena));
+}
+
+// 从 arena 切一块给 slab，上一块剩下不足一条的尾巴放弃
+static int slab_refill(RecordArena* arena, RecordSlab* slab) {
+    size_t offset = __atomic_fetch_add(&arena->used, SLAB_CHUNK_SIZE, __ATOMIC_RELAXED);
+    if (offset + SLAB_CHUNK_SIZE > arena->size) {
+        return -1;
+    }
+#ifdef _WIN32
+    if (VirtualAlloc(arena->base + offset, SLAB_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE) == NULL) {
+        return -1;
+    }
+#endif
+    slab->chunk = (RecordRef)(offset / RECORD_UNIT);
+    slab->chunk_end = (RecordRef)((offset + SLAB_CHUNK_SIZE) / RECORD_UNIT);
+    return 0;
+}
+
+int slab_class(size_t size) {
+    size_t units = (size + RECORD_UNIT - 1) / RECORD_UNIT;
+    for (int i = 0; i < RECORD_CLASSES; i++) {
+        if (units <= class_units[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+RecordRef slab_alloc(RecordArena* arena, RecordSlab* slab, int cls) {
+    RecordRef ref = slab->free[cls];
+    if (ref != RECORD_NIL) {
+        memcpy(&slab->free[cls], arena->base + (size_t)ref * RECORD_UNIT, sizeof(RecordRef));
+    } else {
+        if (slab->chunk + class_units[cls] > slab->chunk_end && slab_refill(arena, slab) != 0) {
+            return RECORD_NIL;
+        }
+        ref = slab->chunk;
+        slab->chunk += class_units[cls];
+    }
+    slab->bytes += (size_t)class_units[cls] * RECORD_UNIT;
+    return ref;
+}
+
+void slab_free(RecordArena* arena, RecordSlab* slab, RecordRef ref, int cls) {
+    memcpy(arena->base + (size_t)ref * RECORD_UNIT, &slab->free[cls], sizeof(RecordRef));
+    slab->free[cls] = ref;
+    slab->bytes -= (size_t)class_units[cls] * RECORD_UNIT;
+}
+
+void record_free(RecordArena* arena, RecordSlab* slab, RecordRef ref) {
+    slab_free(arena, slab, ref, record_at(arena, ref)->size_class);
+}
+
+static size_t rdata_size(const DNSRecord* value) {
+    switch (value->type) {
+    case RR_A:
+        return 4;
+    case RR_AAAA:
+        return 16;
+    case RR_CNAME:
+        return sizeof(NameId);
+    default:
+        return NEGATIVE_HEADER + value->value.negative.owner_len + value->value.negative.rdata_len;
+    }
+}
+
+size_t record_packed_size(const DNSRecord* value) {
+    return HEADER_SIZE + rdata_size(value);
+}
+
+RecordRef record_pack(RecordArena* arena, RecordSlab* slab, const DNSRecord* value, NameId name, NameId target) {
+    size_t rdata_len = rdata_size(value);
+    int cls = slab_class(HEADER_SIZE + rdata_len);
+    if (cls < 0) {
+        return RECORD_NIL;
+    }
+    RecordRef ref = slab_alloc(arena, slab, cls);
+    if (ref == RECORD_NIL) {
+        return RECORD_NIL;
+    }
+    CacheRecord* record = record_at(arena, ref);
+    record->next = record->prev = record->lru_next = record->lru_prev = RECORD_NIL;
+    record->expire_time = value->expire_time;
+    record->name = name;
+    record->ttl = value->ttl;
+    record->expiry = RECORD_NO_EXPIRY;
+    record->hits = (uint8_t)(value->hits < UINT8_MAX ? value->hits : UINT8_MAX);
+    record->flags = value->flags;
+    record->type = value->type;
+    record->size_class = (uint8_t)cls;
+    record->rdata_len = (uint16_t)rdata_len;
+    record->segment = 0;
+    uint8_t* rdata = record->data;
+    switch (value->type) {
+    case RR_A:
+        memcpy(rdata, &value->value.ipv4, 4);
+        break;
+    case RR_AAAA:
+        memcpy(rdata, value->value.ipv6, 16);
+        break;
+    case RR_CNAME:
+        memcpy(rdata, &target, sizeof(target));
+        break;
+    default: {
+        const NegativeAnswer* negative = &value->value.negative;
+        memcpy(rdata, &negative->qtype, 2);
+        rdata[2] = negative->rcode;
+        rdata[3] = negative->owner_len;
+        rdata[4] = negative->rdata_len;
+        memcpy(rdata + NEGATIVE_HEADER, negative->soa, rdata_len - NEGATIVE_HEADER);
+        break;
+    }
+    }
+    return ref;
+}
+
+void record_unpack(const CacheRecord* record, const NameTable* names, DNSRecord* out) {
+    const NameEntry* name = name_entry(names, record->name);
+    memcpy(out->domain, name->name, (size_t)name->len + 1);
+    out->expire_time = record->expire_time;
+    out->ttl = record->ttl;
+    out->hits = __atomic_load_n(&record->hits, __ATOMIC_RELAXED);
+    out->flags = __atomic_load_n(&record->flags, __ATOMIC_RELAXED);
+    out->type = record->type;
+    const uint8_t* rdata = record_rdata(record);
+    switch (record->type) {
+    case RR_A:
+        memcpy(&out->value.ipv4, rdata, 4);
+        break;
+    case RR_AAAA:
+        memcpy(out->value.ipv6, rdata, 16);
+        break;
+    case RR_CNAME: {
+        const NameEntry* target = name_entry(names, record_cname(record));
+        memcpy(out->value.cname, target->name, (size_t)target->len + 1);
+        break;
+    }
+    default: {
+        NegativeAnswer* negative = &out->value.negative;
+        memcpy(&negative->qtype, rdata, 2);
+        negative->rcode = rdata[2];
+        negative->owner_len = rdata[3];
+        negative->rdata_len = rdata[4];
+        memcpy(negative->soa, rdata + NEGATIVE_HEADER, record->rdata_len - NEGATIVE_HEADER);
+        break;
+    }
+    }
+}
+
+int record_equal(const CacheRecord* record, const DNSRecord* value, NameId name, NameId target) {
+    if (record->type != value->type || record->name != name) {
+        return 0;
+    }
+    const uint8_t* rdata = record_rdata(record);
+    switch (record->type) {
+    case RR_A:
+        return memcmp(rdata, &value->value.ipv4, 4) == 0;
+    case RR_AAAA:
+        return memcmp(rdata, value->value.ipv6, 16) == 0;
+    case RR_CNAME:
+        return record_cname(record) == target;
+    default:
+        return record_negative_qtype(record) == value->value.negative.qtype;
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+/*
+DNS 记录的两种形式
+    DNSRecord：解码后的定长记录，域名和 CNAME 目标各占 DOMAIN_MAX_LEN 字节（一条 A 记录 500 多字节），
+        用于构造候选记录、查询结果（调用方 arena 中的副本）和生成响应，不长期保存。
+    CacheRecord：缓存中保存的紧凑形式，定长头部之后是按类型变长的 rdata，常见的 A 记录 48 字节。
+        所有者名和 CNAME 目标是名字驻留表中的 NameId（见 names.h），比较名字只需比较整数。
+        同键链表与 LRU 链表用 32 位的 RecordRef 而不是指针连接。
+记录的内存
+    RecordArena 启动时一次保留整块地址空间（Linux 下按 2 MB 对齐并请求透明大页，页面用到时才提交），
+    RecordRef 是记录在其中以 16 字节为单位的偏移，最多寻址 64 GB，0 表示空。
+    各分片用自己的 RecordSlab 从 arena 成块切出内存，按大小类分配记录，释放的记录挂到对应大小类的
+    空闲链表上复用；slab 由分片锁保护，只有切新块时原子地推进 arena 的用量，分片之间不争用。
+    名字驻留表用同样的 arena 与 slab 保存名字。
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "dnsStruct.h"
+
+#define RECORD_STATIC 0x01      // 来自 hosts 等本地配置，不过期也不预取
+#define RECORD_PREFETCHED 0x02  // 由预取写入，尚未被命中过
+#define RECORD_REFERENCED 0x04  // 上次淘汰扫描以来被命中过（读者不加锁置位，见 cache.c）
+
+#define RR_NEGATIVE 0           // 负缓存条目（RFC 2308），类型 0 不会出现在查询中
+
+// 负缓存：NXDOMAIN 或 NODATA 应答，连同授权部分的 SOA 一起保存
+typedef struct NegativeAnswer {
+    uint16_t qtype;             // NODATA 对应的查询类型，NXDOMAIN 为 0 表示所有类型
+    uint8_t rcode;              // RCODE_NXDOMAIN 或 0（NODATA）
+    uint8_t owner_len;          // soa 开头 SOA 所有者名的长度，其后是 RDATA
+    uint8_t rdata_len;
+    uint8_t soa[DOMAIN_MAX_LEN - 5]; // wire 格式，不含压缩指针
+} NegativeAnswer;
+
+// DNS记录结构（解码后的形式）
+typedef struct DNSRecord {
+    char domain[DOMAIN_MAX_LEN];
+    time_t expire_time;
+    uint32_t ttl;               // 写入时的 TTL
+    uint32_t hits;              // 写入以来的命中次数，计到 PREFETCH_MIN_HITS 为止
+    uint8_t flags;              // RECORD_*
+    uint8_t type;
+    union {
+        uint32_t ipv4;              // IPv4 地址
+        uint8_t ipv6[16];           // IPv6 地址
+        char cname[DOMAIN_MAX_LEN]; // CNAME记录
+        NegativeAnswer negative;    // RR_NEGATIVE
+    } value;
+} DNSRecord;
+
+// 在调用方提供的内存上初始化记录，不支持的类型返回 -1
+int DNSRecord_init(DNSRecord* record, const char* domain, time_t expire_time, uint8_t type, const void* value);
+
+DNSRecord* DNSRecord_create(const char* domain, time_t expire_time, uint8_t type, const void* value);
+
+int DNSRecord_compare(const DNSRecord* a, const DNSRecord* b);
+
+typedef uint32_t RecordRef;
+
+// 名字驻留表中的名字（见 names.h），与 RecordRef 编码相同
+typedef RecordRef NameId;
+
+typedef struct NameTable NameTable;
+
+#define RECORD_NIL 0
+#define NAME_NIL RECORD_NIL
+#define RECORD_NO_EXPIRY UINT32_MAX
+#define RECORD_UNIT 16              // RecordRef 的单位与记录的对齐
+#define RECORD_CLASSES 10           // 大小类：32 到 320 字节
+#define RECORD_MAX_ARENA ((size_t)UINT32_MAX * RECORD_UNIT)
+
+// 缓存中的记录：头部 43 字节，data 为 rdata：
+// A 为 4 字节地址，AAAA 为 16 字节，CNAME 为目标名的 NameId，
+// 负缓存为 qtype（2 字节）、rcode、owner_len、rdata_len 和 SOA 的 wire 格式
+typedef struct CacheRecord {
+    RecordRef next;             // 同一索引键的下一条（Trie 为同域名，哈希索引为同域名同类型）；空闲时串起空闲链表
+    RecordRef prev;
+    RecordRef lru_next;
+    RecordRef lru_prev;
+    time_t expire_time;
+    NameId name;                // 所有者名；记录持有它（和 CNAME 目标）的一个引用
+    uint32_t ttl;               // 写入时的 TTL
+    uint32_t expiry;            // 在所属分片过期堆中的位置，不在堆中为 RECORD_NO_EXPIRY（见 cache.c）
+    uint8_t hits;               // 写入以来的命中次数，计到 PREFETCH_MIN_HITS 为止
+    uint8_t flags;              // RECORD_*
+    uint8_t type;
+    uint8_t size_class;
+    uint16_t rdata_len;
+    uint8_t segment;            // 所在的淘汰链表（CACHE_SEGMENT_*，见 cache.h），由分片锁保护
+    uint8_t data[];
+} CacheRecord;
+
+typedef struct RecordArena {
+    char* base;
+    size_t size;                // 保留的地址空间
+    size_t used;                // 已切给各分片的字节数，原子推进
+    int hugepages;              // 是否已请求透明大页
+} RecordArena;
+
+// 每个分片一个，由分片锁保护
+typedef struct RecordSlab {
+    RecordRef free[RECORD_CLASSES];     // 各大小类的空闲块，沿块开头的 RecordRef 相连
+    RecordRef chunk;                    // 当前块中尚未分配的部分 [chunk, chunk_end)
+    RecordRef chunk_end;
+    size_t bytes;                       // 正在使用的字节数（按大小类计）
+} RecordSlab;
+
+// 保留 size 字节（向上取整到 2 MB，不超过 RECORD_MAX_ARENA）；失败返回 -1
+int record_arena_init(RecordArena* arena, size_t size);
+
+void record_arena_destroy(RecordArena* arena);
+
+// 放得下 size 字节的最小大小类，超过最大一类返回 -1
+int slab_class(size_t size);
+
+// 分配 cls 类的一块，块开头的 4 字节在空闲时用作链表指针；arena 用尽返回 RECORD_NIL
+RecordRef slab_alloc(RecordArena* arena, RecordSlab* slab, int cls);
+
+void slab_free(RecordArena* arena, RecordSlab* slab, RecordRef ref, int cls);
+
+static inline CacheRecord* record_at(const RecordArena* arena, RecordRef ref) {
+    return (CacheRecord*)(arena->base + (size_t)ref * RECORD_UNIT);
+}
+
+static inline RecordRef record_ref(const RecordArena* arena, const CacheRecord* record) {
+    return (RecordRef)(((const char*)record - arena->base) / RECORD_UNIT);
+}
+
+static inline const uint8_t* record_rdata(const CacheRecord* record) {
+    return record->data;
+}
+
+// CNAME 记录的目标名
+static inline NameId record_cname(const CacheRecord* record) {
+    NameId target;
+    memcpy(&target, record_rdata(record), sizeof(target));
+    return target;
+}
+
+// 负缓存条目对应的查询类型
+static inline uint16_t record_negative_qtype(const CacheRecord* record) {
+    uint16_t qtype;
+    memcpy(&qtype, record_rdata(record), sizeof(qtype));
+    return qtype;
+}
+
+// 按 value 的内容分配并填好一条记录，链表字段清零，所有者名与 CNAME 目标用调用方驻留好的 name、target
+// （value 中的字符串不再使用），两者的引用交给记录；arena 用尽返回 RECORD_NIL，引用仍归调用方
+RecordRef record_pack(RecordArena* arena, RecordSlab* slab, const DNSRecord* value, NameId name, NameId target);
+
+// 记录放回所属大小类的空闲链表；记录持有的名字引用由调用方释放
+void record_free(RecordArena* arena, RecordSlab* slab, RecordRef ref);
+
+// 解码到 out，名字从 names 取回规范形式；命中计数与标志可能被其他读者同时修改，原子读取
+void record_unpack(const CacheRecord* record, const NameTable* names, DNSRecord* out);
+
+// 与 DNSRecord_compare 相同的判等：同名、同类型、同值（负缓存比较 qtype），名字只比较 NameId
+int record_equal(const CacheRecord* record, const DNSRecord* value, NameId name, NameId target);
+
+// 写入 value 需要的字节数（按大小类取整前）
+size_t record_packed_size(const DNSRecord* value);
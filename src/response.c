@@ -1,7 +1,60 @@
 #include "response.h"
+#include "log.h"
+
+// 一条待写入答案部分的记录，由缓存记录的副本或借用视图转换而来，不复制 rdata
+typedef struct AnswerRecord {
+    const char *domain;         // 所有者名，第一条用指向问题的压缩指针代替
+    uint8_t type;
+    uint32_t ttl;
+    const uint8_t *address;     // A 为 4 字节，AAAA 为 16 字节（网络字节序）
+    const char *cname;          // CNAME 目标名
+} AnswerRecord;
+
+// 应答中的 TTL：剩余时间；静态记录不过期，始终报告配置的 TTL；已过期的记录只会经 serve-stale 应答
+static uint32_t answer_ttl(time_t expire_time, uint32_t ttl, uint8_t flags, time_t now) {
+    if (flags & RECORD_STATIC) {
+        return ttl;
+    }
+    return expire_time > now ? (uint32_t)(expire_time - now) : CACHE_STALE_TTL;
+}
+
+// 按标签写入域名，www.baidu.com -> 3www5baidu3com0；放不下返回 -1
+static int write_name(unsigned char *buffer, int buf_size, int offset, const char *name) {
+    while (*name) {
+        const char *dot = strchr(name, '.'); // 查找当前部分第一个点的位置
+        int len = dot ? (int)(dot - name) : (int)strlen(name);
+
+        if (offset + len + 1 > buf_size) {
+            return -1;
+        }
+
+        buffer[offset++] = len;
+        memcpy(buffer + offset, name, len);
+        offset += len;
+
+        name = dot ? dot + 1 : name + len;
+    }
+    if (offset + 1 > buf_size) {
+        return -1;
+    }
+    buffer[offset++] = 0; // 域名结束
+    return offset;
+}
+
+// 域名编码后的长度
+static int name_wire_length(const char *name) {
+    int length = 0;
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        int label_len = dot ? (int)(dot - name) : (int)strlen(name);
+        length += label_len + 1;
+        name = dot ? dot + 1 : name + label_len;
+    }
+    return length + 1; // 域名结束符0
+}
 
 /**
- * 构建包含多个相同类型记录的DNS响应（直接生成wire format）
+ * 构建包含多个记录的DNS响应（直接生成wire format）
  *
  * 参数：
  *   buffer - 输出缓冲区
@@ -9,38 +62,35 @@
  *   transactionID - 事务ID
  *   query_name - 查询域名
  *   query_type - 查询类型
- *   first_record - 第一个记录（链表头）
+ *   answers - 按 CNAME 链顺序排列的记录
+ *   count - 记录数
  *
  * 返回值：
  *   成功时返回消息长度，失败返回-1
  */
-int build_multi_record_response(unsigned char *buffer,
-                                int buf_size,
-                                uint16_t transactionID,
-                                const char *query_name,
-                                uint16_t query_type,
-                                CacheQueryResult *first_record) {
-    if (!buffer || !query_name || !first_record) {
-        return -1;
-    }
+static int build_answer_response(unsigned char *buffer,
+                                 int buf_size,
+                                 uint16_t transactionID,
+                                 const char *query_name,
+                                 uint16_t query_type,
+                                 const AnswerRecord *answers,
+                                 int count) {
     int offset = 0;
 
     // 计算所有记录的数量（包括CNAME记录）
+    // 当查询A/AAAA记录时，如果有CNAME链，需要包含CNAME记录和最终的A/AAAA记录
     int answer_count = 0;
-    CacheQueryResult *current = first_record;
-    while (current) {
-        // 当查询A/AAAA记录时，如果有CNAME链，需要包含CNAME记录和最终的A/AAAA记录
-        if (current->record->type == query_type || ((query_type == RR_A || query_type == RR_AAAA) && current->record->type == RR_CNAME)) {
+    for (int i = 0; i < count; i++) {
+        if (answers[i].type == query_type || ((query_type == RR_A || query_type == RR_AAAA) && answers[i].type == RR_CNAME)) {
             answer_count++;
         }
-        current = current->next;
     }
 
     if (answer_count == 0) {
         return -1;
     }
 
-    printf("Building multi-record response for %s (type=%d), found %d records\n", query_name, query_type, answer_count);
+    LOG_DEBUG("Building multi-record response for %s (type=%d), found %d records\n", query_name, query_type, answer_count);
 
     // 1. 写入DNS头部 (12字节)
     if (offset + 12 > buf_size)
@@ -70,26 +120,8 @@ int build_multi_record_response(unsigned char *buffer,
     offset += 2;
 
     // 2. 写入问题部分
-    const char *name = query_name;
-    while (*name)
-    {
-        char *dot = strchr(name, '.'); // 查找当前部分第一个点的位置
-        int len = dot ? (dot - name) : strlen(name);
-
-        if (offset + len + 1 > buf_size) {
-            return -1;
-        }
-            
-        buffer[offset++] = len;
-        memcpy(buffer + offset, name, len);
-        offset += len;
-
-        name = dot ? dot + 1 : name + len;
-    }
-    buffer[offset++] = 0; // 域名结束
-    // 存放question当中的域名, www.baidu.com -> 3www5baidu3com0
-
-    if (offset + 4 > buf_size) {
+    offset = write_name(buffer, buf_size, offset, query_name);
+    if (offset < 0 || offset + 4 > buf_size) {
         return -1;
     }
     uint16_t qtype = htons(query_type);
@@ -102,15 +134,15 @@ int build_multi_record_response(unsigned char *buffer,
     offset += 2;
 
     // 3. 写入答案部分（多个记录）
-    current = first_record;
-    while (current) {
+    for (int i = 0; i < count; i++) {
+        const AnswerRecord *current = &answers[i];
         // 当查询A/AAAA记录时，包含CNAME记录和最终的A/AAAA记录
-        if (current->record->type == query_type || ((query_type == RR_A || query_type == RR_AAAA) && current->record->type == RR_CNAME)) {
+        if (current->type == query_type || ((query_type == RR_A || query_type == RR_AAAA) && current->type == RR_CNAME)) {
             /*
-            对于链表中的第一个记录，它的域名和Question中的域名相同，所以使用指针压缩。写入 0xC00C，0xC0是压缩指针标志，0x0C (十进制12) 指向DNS报文开头偏移12字节的位置，那里正好是Question部分的域名。这能节省空间。
+            对于第一个记录，它的域名和Question中的域名相同，所以使用指针压缩。写入 0xC00C，0xC0是压缩指针标志，0x0C (十进制12) 指向DNS报文开头偏移12字节的位置，那里正好是Question部分的域名。这能节省空间。
             对于后续的记录（比如CNAME链中的第二个域名），它们的域名与原始查询不同，因此必须完整地编码写入。
             */
-            if (current == first_record) {
+            if (i == 0) {
                 // 第一个记录，使用指针压缩
                 if (offset + 2 > buf_size) {
                     return -1;
@@ -120,76 +152,51 @@ int build_multi_record_response(unsigned char *buffer,
                 buffer[offset++] = 0x0C; // 指向偏移量12（问题部分的域名）
             } else {
                 // 后续记录，写入完整域名
-                const char *domain_name = current->record->domain;
-                while (*domain_name) {
-                    char *dot = strchr(domain_name, '.');
-                    int len = dot ? (dot - domain_name) : strlen(domain_name);
-
-                    if (offset + len + 1 > buf_size) {
-                        return -1;
-                    }
-                       
-                    buffer[offset++] = len;
-                    memcpy(buffer + offset, domain_name, len);
-                    offset += len;
-
-                    domain_name = dot ? dot + 1 : domain_name + len;
+                offset = write_name(buffer, buf_size, offset, current->domain);
+                if (offset < 0) {
+                    return -1;
                 }
-                buffer[offset++] = 0; // 域名结束
             }
 
             // 写入TYPE, CLASS, TTL
             if (offset + 10 > buf_size) {
                 return -1;
             }
-            uint16_t type = htons(current->record->type); // 使用当前记录的实际类型
+            uint16_t type = htons(current->type); // 使用当前记录的实际类型
             uint16_t class = htons(1);
             memcpy(buffer + offset, &type, 2);
             offset += 2;
             memcpy(buffer + offset, &class, 2);
             offset += 2;
 
-            time_t current_time = time(NULL);
-            uint32_t ttl = (current->record->expire_time > current_time) ? (current->record->expire_time - current_time) : 0;
+            uint32_t ttl = current->ttl;
             uint32_t ttl_net = htonl(ttl);
             memcpy(buffer + offset, &ttl_net, 4);
             offset += 4;
 
             // 写入RDLENGTH和RDATA
-            if (current->record->type == RR_A) {
+            if (current->type == RR_A) {
                 if (offset + 6 > buf_size) return -1;
                 uint16_t rdlength = htons(4); // A记录长度为4字节
                 memcpy(buffer + offset, &rdlength, 2);
                 offset += 2;
-                memcpy(buffer + offset, &current->record->value.ipv4, 4);
+                memcpy(buffer + offset, current->address, 4);
                 offset += 4;
 
                 // 打印IP地址调试信息
-                uint32_t ip = current->record->value.ipv4;
-                printf("  Added a record: %u.%u.%u.%u (TTL: %u)\n", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF, ttl);
-            } else if (current->record->type == RR_AAAA) {
+                const uint8_t *ip = current->address;
+                LOG_DEBUG("  Added a record: %u.%u.%u.%u (TTL: %u)\n", ip[0], ip[1], ip[2], ip[3], ttl);
+            } else if (current->type == RR_AAAA) {
                 if (offset + 18 > buf_size) return -1;
                 uint16_t rdlength = htons(16); // AAAA记录长度为16字节
                 memcpy(buffer + offset, &rdlength, 2);
                 offset += 2;
-                memcpy(buffer + offset, current->record->value.ipv6, 16);
+                memcpy(buffer + offset, current->address, 16);
                 offset += 16;
-                printf("  Added AAAA record (TTL: %u)\n", ttl);
-            } else if (current->record->type == RR_CNAME) {
+                LOG_DEBUG("  Added AAAA record (TTL: %u)\n", ttl);
+            } else if (current->type == RR_CNAME) {
                 // CNAME记录处理
-                const char *cname = current->record->value.cname;
-                int name_wire_len = 0;
-                const char *temp_name = cname;
-
-                // 计算编码后的域名长度
-                while (*temp_name) {
-                    char *dot = strchr(temp_name, '.');
-                    int label_len = dot ? (dot - temp_name) : strlen(temp_name);
-                    name_wire_len += label_len + 1;
-                    temp_name = dot ? dot + 1 : temp_name + label_len;
-                }
-                name_wire_len += 1; // 域名结束符0
-
+                int name_wire_len = name_wire_length(current->cname);
                 if (offset + 2 + name_wire_len > buf_size)
                     return -1;
                 uint16_t rdlength = htons(name_wire_len);
@@ -197,30 +204,68 @@ int build_multi_record_response(unsigned char *buffer,
                 offset += 2;
 
                 // 写入CNAME域名
-                const char *name_ptr = cname;
-                while (*name_ptr)
-                {
-                    char *dot = strchr(name_ptr, '.');
-                    int len = dot ? (dot - name_ptr) : strlen(name_ptr);
+                offset = write_name(buffer, buf_size, offset, current->cname);
 
-                    buffer[offset++] = len;
-                    memcpy(buffer + offset, name_ptr, len);
-                    offset += len;
-
-                    name_ptr = dot ? dot + 1 : name_ptr + len;
-                }
-                buffer[offset++] = 0;
-
-                printf("  Added CNAME record: %s -> %s (TTL: %u)\n", query_name, cname, ttl);
+                LOG_DEBUG("  Added CNAME record: %s -> %s (TTL: %u)\n", query_name, current->cname, ttl);
             }
         }
-        current = current->next;
     }
 
-    printf("Multi-record response built successfully, total length: %d bytes\n", offset);
+    LOG_DEBUG("Multi-record response built successfully, total length: %d bytes\n", offset);
     return offset;
 }
 
+int build_multi_record_response(unsigned char *buffer,
+                                int buf_size,
+                                uint16_t transactionID,
+                                const char *query_name,
+                                uint16_t query_type,
+                                CacheQueryResult *first_record) {
+    if (!buffer || !query_name || !first_record) {
+        return -1;
+    }
+    AnswerRecord answers[CACHE_MAX_ANSWERS];
+    int count = 0;
+    time_t now = time(NULL);
+    for (CacheQueryResult *current = first_record; current && count < CACHE_MAX_ANSWERS; current = current->next) {
+        const DNSRecord *record = current->record;
+        AnswerRecord *answer = &answers[count++];
+        answer->domain = record->domain;
+        answer->type = record->type;
+        answer->ttl = answer_ttl(record->expire_time, record->ttl, record->flags, now);
+        answer->address = record->type == RR_A ? (const uint8_t *)&record->value.ipv4 : record->value.ipv6;
+        answer->cname = record->value.cname;
+    }
+    return build_answer_response(buffer, buf_size, transactionID, query_name, query_type, answers, count);
+}
+
+int build_view_response(unsigned char *buffer,
+                        int buf_size,
+                        uint16_t transactionID,
+                        const char *query_name,
+                        uint16_t query_type,
+                        const CacheView *views,
+                        int count) {
+    if (!buffer || !query_name || count <= 0) {
+        return -1;
+    }
+    AnswerRecord answers[CACHE_MAX_ANSWERS];
+    if (count > CACHE_MAX_ANSWERS) {
+        count = CACHE_MAX_ANSWERS;
+    }
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++) {
+        const CacheRecord *record = views[i].record;
+        AnswerRecord *answer = &answers[i];
+        answer->domain = views[i].domain;
+        answer->type = record->type;
+        answer->ttl = answer_ttl(record->expire_time, record->ttl, __atomic_load_n(&record->flags, __ATOMIC_RELAXED), now);
+        answer->address = record_rdata(record);
+        answer->cname = views[i].target;
+    }
+    return build_answer_response(buffer, buf_size, transactionID, query_name, query_type, answers, count);
+}
+
 /*
  * 构建DNS NXDOMAIN响应（域名不存在错误）
  * 用于拦截域名时返回给客户端
@@ -319,4 +364,47 @@ int build_nxdomain_response(unsigned char *buffer, int buf_size, uint16_t transa
     offset += 2;
 
     return offset;
-}
\ No newline at end of file
+}
+/*
+ * 用负缓存条目构建 NXDOMAIN/NODATA 响应（RFC 2308）
+ * 授权部分带上缓存的 SOA，TTL 为剩余时间，下游缓存据此决定负缓存时长
+ */
+int build_negative_response(unsigned char *buffer, int buf_size, uint16_t transactionID, const char *query_name,
+                            uint16_t query_type, const DNSRecord *negative)
+{
+    if (!negative || negative->type != RR_NEGATIVE) {
+        return -1;
+    }
+    // 头部和问题部分与 NXDOMAIN 响应相同，之后改写 RCODE 并追加 SOA
+    int offset = build_nxdomain_response(buffer, buf_size, transactionID, query_name, query_type);
+    if (offset < 0) {
+        return -1;
+    }
+    const NegativeAnswer *answer = &negative->value.negative;
+    buffer[3] = (buffer[3] & 0xF0) | (answer->rcode & 0x0F);
+    buffer[8] = 0x00;
+    buffer[9] = 0x01; // Authority RRs: 1
+
+    if (offset + answer->owner_len + 10 + answer->rdata_len > buf_size) {
+        return -1;
+    }
+    memcpy(buffer + offset, answer->soa, answer->owner_len);
+    offset += answer->owner_len;
+
+    time_t now = time(NULL);
+    uint32_t ttl = negative->expire_time > now ? (uint32_t)(negative->expire_time - now) : 0;
+    uint16_t type = htons(RR_SOA);
+    uint16_t class = htons(1);
+    uint32_t ttl_net = htonl(ttl);
+    uint16_t rdlength = htons(answer->rdata_len);
+    memcpy(buffer + offset, &type, 2);
+    memcpy(buffer + offset + 2, &class, 2);
+    memcpy(buffer + offset + 4, &ttl_net, 4);
+    memcpy(buffer + offset + 8, &rdlength, 2);
+    offset += 10;
+    memcpy(buffer + offset, answer->soa + answer->owner_len, answer->rdata_len);
+    offset += answer->rdata_len;
+
+    LOG_DEBUG("Negative response built (rcode=%u), total length: %d bytes\n", answer->rcode, offset);
+    return offset;
+}
@@ -28,4 +28,17 @@ int build_multi_record_response(unsigned char *buffer,
                                 uint16_t query_type,
                                 CacheQueryResult *first_record);
 
-int build_nxdomain_response(unsigned char *buffer, int buf_size, uint16_t transactionID, const char *query_name, uint16_t query_type);
\ No newline at end of file
+// 同 build_multi_record_response，直接从借用的缓存记录编码，须在取得 views 的纪元临界区内调用
+int build_view_response(unsigned char *buffer,
+                        int buf_size,
+                        uint16_t transactionID,
+                        const char *query_name,
+                        uint16_t query_type,
+                        const CacheView *views,
+                        int count);
+
+int build_nxdomain_response(unsigned char *buffer, int buf_size, uint16_t transactionID, const char *query_name, uint16_t query_type);
+
+// 用负缓存条目构建 NXDOMAIN/NODATA 响应，授权部分带 SOA
+int build_negative_response(unsigned char *buffer, int buf_size, uint16_t transactionID, const char *query_name,
+                            uint16_t query_type, const DNSRecord *negative);
\ No newline at end of file
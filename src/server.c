@@ -53,59 +53,139 @@ int ip_str_to_bytes_sscanf(const char* ip_str, uint8_t* bytes) {
 
     return 0;
 }
-void init_socket(int port) {
-    // 跨平台网络初始化
-    if (network_init() != 0) {
-        printf("Failed to initialize network\n");
-        return;
+int worker_count = 1;
+int prefetch_percent = PREFETCH_DEFAULT_PERCENT;
+int prefetch_max = PREFETCH_DEFAULT_MAX;
+int stale_window = STALE_DEFAULT_WINDOW;
+int stale_wait_ms = STALE_DEFAULT_WAIT_MS;
+int packet_cache_size = PACKET_CACHE_DEFAULT_SIZE;
+const char *qlog_dir = NULL;
+int qlog_segment_mb = QLOG_DEFAULT_SEGMENT_MB;
+int qlog_keep = QLOG_DEFAULT_KEEP;
+const char *metrics_name = METRICS_DEFAULT_NAME;
+int cache_shards = CACHE_DEFAULT_SHARDS;
+CachePolicy cache_policy = CACHE_POLICY_CLOCK;
+MetricsShared *metrics;
+
+_Static_assert(MAX_WORKERS <= METRICS_MAX_WORKERS, "metrics segment must cover every worker");
+_Static_assert(CACHE_MAX_SHARDS <= METRICS_MAX_SHARDS, "metrics segment must cover every cache shard");
+
+static DNSWorker workers[MAX_WORKERS];
+
+// 创建一个连接上游的 socket，绑定到系统分配的临时端口
+static socket_t open_upstream_socket(void) {
+    socket_t sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == INVALID_SOCKET_VALUE) {
+        return INVALID_SOCKET_VALUE;
+    }
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = INADDR_ANY;
+    local.sin_port = 0;
+    if (bind(sock, (struct sockaddr *)&local, sizeof(local)) < 0 || set_socket_nonblocking(sock) != 0) {
+        CLOSE_SOCKET(sock);
+        return INVALID_SOCKET_VALUE;
     }
+    return sock;
+}
 
-    client_socket = socket(AF_INET, SOCK_DGRAM, 0);
-    server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+// 为一个工作线程创建并绑定 socket
+static void worker_open_sockets(DNSWorker *w, int port) {
+    w->client_socket = socket(AF_INET, SOCK_DGRAM, 0);
 
-    if (client_socket == INVALID_SOCKET_VALUE || server_socket == INVALID_SOCKET_VALUE) {
+    if (w->client_socket == INVALID_SOCKET_VALUE) {
         printf("ERROR: Could not create socket: %d\n", GET_SOCKET_ERROR());
         network_cleanup();
         exit(-1);
     }
 
-    memset(&client_address, 0, sizeof(client_address));
-    memset(&server_address, 0, sizeof(server_address));
-
-    address_length = sizeof(client_address);
+    // 多个源端口分摊事务 ID 空间，在途查询数不再受 65536 个 ID 限制
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        w->upstreams[i].w = w;
+        w->upstreams[i].index = i;
+        w->upstreams[i].sock = open_upstream_socket();
+        if (w->upstreams[i].sock == INVALID_SOCKET_VALUE) {
+            printf("ERROR: Could not create upstream socket: %d\n", GET_SOCKET_ERROR());
+            network_cleanup();
+            exit(-1);
+        }
+    }
 
+    struct sockaddr_in client_address;
+    memset(&client_address, 0, sizeof(client_address));
     client_address.sin_family = AF_INET;
     client_address.sin_addr.s_addr = INADDR_ANY; // INADDR_ANY表示本机的任意IP地址
     client_address.sin_port = htons(port);
-    server_address.sin_family = AF_INET;
-    server_address.sin_addr.s_addr = inet_addr(remote_dns); // 远程主机地址
-    server_address.sin_port = htons(port);
 
     // 端口复用
     const int REUSE = 1;
 #ifdef _WIN32
-    setsockopt(client_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&REUSE, sizeof(REUSE));
+    setsockopt(w->client_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&REUSE, sizeof(REUSE));
 #else
-    setsockopt(client_socket, SOL_SOCKET, SO_REUSEADDR, &REUSE, sizeof(REUSE));
+    setsockopt(w->client_socket, SOL_SOCKET, SO_REUSEADDR, &REUSE, sizeof(REUSE));
+#endif
+#ifdef SO_REUSEPORT
+    // 多个工作线程各绑定一个 socket 到同一端口，由内核按四元组哈希分流
+    if (worker_count > 1) {
+        setsockopt(w->client_socket, SOL_SOCKET, SO_REUSEPORT, &REUSE, sizeof(REUSE));
+    }
 #endif
 
-    if (bind(client_socket, (struct sockaddr *)&client_address, address_length) < 0)
+    if (bind(w->client_socket, (struct sockaddr *)&client_address, sizeof(client_address)) < 0)
     {
         printf("ERROR: Could not bind: %d\n", GET_SOCKET_ERROR());
-        CLOSE_SOCKET(client_socket);
-        CLOSE_SOCKET(server_socket);
+        CLOSE_SOCKET(w->client_socket);
+        network_cleanup();
+        exit(-1);
+    }
+
+    // 设置为非阻塞模式: recvform被调用时如果没有数据会立即返回错误，不会阻塞调用线程(主循环)
+    if (set_socket_nonblocking(w->client_socket) != 0)
+    {
+        printf("Set socket non-blocking failed with error: %d\n", GET_SOCKET_ERROR());
+        CLOSE_SOCKET(w->client_socket);
         network_cleanup();
         exit(-1);
     }
+}
+
+void init_socket(int port) {
+    // 跨平台网络初始化
+    if (network_init() != 0) {
+        printf("Failed to initialize network\n");
+        return;
+    }
+
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family = AF_INET;
+    server_address.sin_addr.s_addr = inet_addr(remote_dns); // 远程主机地址
+    server_address.sin_port = htons(port);
+
+#ifndef SO_REUSEPORT
+    if (worker_count > 1) {
+        printf("SO_REUSEPORT is not supported on this platform, running a single worker\n");
+        worker_count = 1;
+    }
+#endif
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > MAX_WORKERS) worker_count = MAX_WORKERS;
+
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].id = i;
+        worker_open_sockets(&workers[i], port);
+    }
 
     printf("======================= DNS server running =======================\n");
     printf("| DNS server: %-12s                                       |\n", remote_dns);
     printf("| Listening on port %-12d                                 |\n", port);
+    printf("| Workers: %-12d                                          |\n", worker_count);
     printf("==================================================================\n");
 }
 
 void init_DNS(void) {
-    dns_cache = cache_create(1024);
+    dns_cache = cache_create_policy(1024, cache_shards, cache_policy);
+    dns_cache->keep_expired = stale_window;     // serve-stale 可能还要用到的过期记录不清理
 
     // 初始化域名拦截表
     blacklist = blacklist_create();
@@ -123,356 +203,693 @@ void init_DNS(void) {
     inet_pton(AF_INET, "192.168.1.1", &ipv4);
     ip_str_to_bytes_sscanf("192.168.1.1", (uint8_t*)&ipv4);
     // printf("ipv4 %u\n", ipv4);
-    cache_update(dns_cache, "example.com", RR_A, &ipv4, 3600);
+    cache_update_static(dns_cache, "example.com", RR_A, &ipv4, 3600);
 
     uint8_t ipv6[16];
     // 将文本形式的 IP 地址转换为二进制形式的函数
     inet_pton(AF_INET6, "2001:db8:85a3:0000:0000:8a2e:370:7334", ipv6);
-    cache_update(dns_cache, "ipv.example.com", RR_AAAA, ipv6, 7200);
+    cache_update_static(dns_cache, "ipv.example.com", RR_AAAA, ipv6, 7200);
 }
+void init_metrics(void) {
+    metrics = metrics_open(metrics_name, worker_count);
+    if (metrics == NULL) {
+        printf("ERROR: Could not allocate metrics\n");
+        exit(-1);
+    }
+    metrics->cache_capacity = (uint64_t)dns_cache->capacity;
+    metrics->cache_shards = (uint64_t)dns_cache->shard_count;
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].metrics = &metrics->workers[i];
+        workers[i].metrics->inflight_capacity = INFLIGHT_CAPACITY;
+    }
+}
+
 void init() {
     remote_dns = "10.3.9.6";
     init_socket(PORT);
     init_DNS();
+    init_metrics();
+}
+
+// 每批处理完后把各模块自己维护的统计复制到导出的指标里
+static void publish_metrics(DNSWorker *w) {
+    WorkerMetrics *m = w->metrics;
+    m->inflight_used = w->inflight.count;
+    m->inflight_timed_out = w->inflight.timed_out;
+    m->inflight_rejected = w->inflight.rejected;
+    m->inflight_coalesced = w->inflight.coalesced;
+    m->rx_max_batch = w->client_rx->stats.max_batch;
+    uint64_t dropped = w->client_tx->stats.dropped;
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        dropped += w->upstreams[i].tx->stats.dropped;
+    }
+    m->tx_dropped = dropped;
+}
+
+// 全进程共享的指标要遍历所有分片和线程，由 0 号工作线程随定期清理发布，不放在每批的路径上
+static void publish_shared_metrics(void) {
+    // 各分片的值不加锁读取，只用于展示
+    uint64_t prefetch_used = 0;
+    for (int i = 0; i < dns_cache->shard_count; i++) {
+        const CacheShard *shard = &dns_cache->shards[i];
+        CacheShardMetrics *out = &metrics->shards[i];
+        out->size = (uint64_t)shard->size;
+        out->capacity = (uint64_t)shard->capacity;
+        cache_shard_lookups(dns_cache, i, &out->hits, &out->misses);
+        out->inserts = shard->inserts;
+        out->evictions = shard->evictions;
+        out->rejected = shard->rejections;
+        out->expired = shard->expirations;
+        out->bytes = shard->slab.bytes;
+        prefetch_used += shard->prefetch_used;
+    }
+    metrics->prefetch_used = prefetch_used;
+    metrics->cache_size = (uint64_t)cache_size(dns_cache);
+    metrics->cache_bytes = (uint64_t)cache_record_bytes(dns_cache);
+    metrics->names = (uint64_t)name_count(dns_cache->names);
+    metrics->name_bytes = (uint64_t)name_bytes(dns_cache->names);
+    metrics->prefetch_issued = dns_cache->prefetch_issued;
+    metrics->stale_served = dns_cache->stale_served;
+    metrics->log_dropped = log_dropped();
+}
+
+void worker_flush(DNSWorker *w) {
+    batch_flush(w->client_tx);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        batch_flush(w->upstreams[i].tx);
+    }
+    publish_metrics(w);
+    // 本批请求的回复都已发出，临时对象一次性回收
+    arena_reset(&w->arena);
+}
+
+// client_socket 可读：边缘触发下必须一直读到 EAGAIN
+static void on_client_readable(void* arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+    int n;
+    while ((n = batch_recv(w->client_rx)) > 0) {
+        for (int i = 0; i < n; i++) {
+            DNSPacket* pkt = &w->client_rx->slots[i];
+            receiveClient(w, pkt->data, pkt->len, &pkt->addr);
+        }
+        // 整批处理完后统一发出回复和转发
+        worker_flush(w);
+        // 没取满说明接收队列已空，省掉一次必然返回 EAGAIN 的调用
+        if (n < w->client_rx->size) break;
+    }
+}
+
+// 上游 socket 可读：同上
+static void on_upstream_readable(void* arg) {
+    Upstream *up = (Upstream *)arg;
+    int n;
+    while ((n = batch_recv(up->rx)) > 0) {
+        for (int i = 0; i < n; i++) {
+            DNSPacket* pkt = &up->rx->slots[i];
+            receiveServer(up, pkt->data, pkt->len);
+        }
+        batch_flush(up->w->client_tx);
+        publish_metrics(up->w);
+        arena_reset(&up->w->arena);
+        if (n < up->rx->size) break;
+    }
+}
+
+// 调试模式下定期输出批量收发统计
+static void on_stats_timer(void* arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+    LOG_DEBUG("Worker %d statistics:\n", w->id);
+    batch_print_stats("client rx", w->client_rx);
+    batch_print_stats("client tx", w->client_tx);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        batch_print_stats("upstream rx", w->upstreams[i].rx);
+        batch_print_stats("upstream tx", w->upstreams[i].tx);
+    }
+    LOG_DEBUG("in-flight: %u, timed out %llu, rejected %llu, coalesced %llu\n", w->inflight.count,
+              (unsigned long long)w->inflight.timed_out, (unsigned long long)w->inflight.rejected,
+              (unsigned long long)w->inflight.coalesced);
+    LOG_DEBUG("prefetch: issued %llu, used %llu\n", (unsigned long long)metrics->prefetch_issued,
+              (unsigned long long)metrics->prefetch_used);
+    LOG_DEBUG("stale answers: %llu\n", (unsigned long long)dns_cache->stale_served);
+    LOG_DEBUG("arena: peak %zu bytes per batch\n", w->arena.peak);
+    if (qlog_enabled(&w->qlog)) {
+        LOG_DEBUG("query log: records %llu, rotations %llu, errors %llu\n", (unsigned long long)w->qlog.records,
+                  (unsigned long long)w->qlog.rotations, (unsigned long long)w->qlog.errors);
+    }
+    LOG_DEBUG("packet cache: hits %llu, misses %llu, inserts %llu\n", (unsigned long long)w->packets.hits,
+              (unsigned long long)w->packets.misses, (unsigned long long)w->packets.inserts);
+}
+
+// 把应答放进客户端发送批次，开启查询日志时同时记一条
+static void reply_client(DNSWorker *w, const char *buf, int len, const struct sockaddr_in *cli, uint8_t source,
+                         uint32_t latency_us) {
+    batch_queue(w->client_tx, buf, len, cli);
+    w->metrics->answers[source]++;
+    if (source == QLOG_SRC_UPSTREAM || source == QLOG_SRC_COALESCED || source == QLOG_SRC_STALE) {
+        histogram_record(&w->metrics->answer_latency, latency_us);
+    }
+    if (qlog_enabled(&w->qlog)) {
+        qlog_write(&w->qlog, cli, buf, len, source, latency_us);
+    }
+}
+
+// 从转发到现在的耗时（微秒）
+static uint32_t upstream_latency_us(const InflightEntry *entry) {
+    return (uint32_t)(event_now_us() - entry->sent_us);
+}
+
+// 用过期记录构建应答发给一个客户端，TTL 由 build_multi_record_response 填为 CACHE_STALE_TTL
+static void answer_stale(DNSWorker *w, CacheQueryResult *stale, const char *qname, uint16_t qtype, uint16_t txid,
+                         const struct sockaddr_in *cli, uint32_t latency_us) {
+    unsigned char response[BUFFER_SIZE];
+    int response_len = build_multi_record_response(response, BUFFER_SIZE, txid, qname, qtype, stale);
+    if (response_len > 0) {
+        reply_client(w, (char *)response, response_len, cli, QLOG_SRC_STALE, latency_us);
+        __atomic_fetch_add(&dns_cache->stale_served, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// 上游迟迟不应答或返回失败时，用过期数据应答条目上的所有客户端；没有可用的过期数据返回 false
+// 预取没有原始客户端，只应答挂在上面的等待者。条目继续在途，上游的回复到达后只刷新缓存
+static bool serve_stale(DNSWorker *w, InflightEntry *entry) {
+    if (entry->stale_served || (entry->prefetch && entry->waiters == INFLIGHT_NONE)) {
+        return false;
+    }
+    CacheQueryResult *stale = cache_query_stale(dns_cache, &w->arena, entry->qname, entry->qtype, stale_window);
+    for (CacheQueryResult *p = stale; p != NULL; p = p->next) {
+        if (blacklist_query(blacklist, p->record->domain)) {
+            stale = NULL;
+            break;
+        }
+    }
+    if (stale == NULL) {
+        return false;
+    }
+    LOG_INFO("Upstream slow for %s, answering from stale cache\n", entry->qname);
+    uint32_t latency_us = upstream_latency_us(entry);
+    if (!entry->prefetch) {
+        answer_stale(w, stale, entry->qname, entry->qtype, entry->orig_id, &entry->cli, latency_us);
+    }
+    for (uint32_t i = entry->waiters; i != INFLIGHT_NONE; i = inflight_waiter(&w->inflight, i)->next) {
+        InflightWaiter *waiter = inflight_waiter(&w->inflight, i);
+        answer_stale(w, stale, entry->qname, entry->qtype, waiter->orig_id, &waiter->cli, latency_us);
+    }
+    entry->stale_served = true;
+    inflight_clear_waiters(&w->inflight, entry);
+    return true;
+}
+
+static void on_stale_deadline(InflightEntry *entry, void *arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+    if (serve_stale(w, entry)) {
+        batch_flush(w->client_tx);
+        arena_reset(&w->arena);
+    }
+}
+
+// 定期清理过期的缓存记录，没有新的写入时过期数据也不会一直占着缓存
+static void on_expire_timer(void* arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+    int expired = cache_expire(dns_cache, time(NULL), CACHE_EXPIRE_BUDGET);
+    if (expired > 0) {
+        LOG_DEBUG("Removed %d expired cache records\n", expired);
+    }
+    if (w->id == 0) {
+        publish_shared_metrics();
+    }
+}
+
+// 推进超时时间轮，表空后停用定时器，空闲时不再唤醒
+static void on_timeout_timer(void* arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+    int expired = inflight_expire(&w->inflight, event_now_ms(), on_stale_deadline, w);
+    if (expired > 0) {
+        LOG_INFO("Cleaned up %d timed out requests\n", expired);
+    }
+    if (w->inflight.count == 0) {
+        event_timer_set(w->loop, w->timeout_timer, 0);
+        w->timeout_armed = false;
+    }
+}
+
+static void worker_free_batches(DNSWorker *w) {
+    batch_destroy(w->client_rx);
+    batch_destroy(w->client_tx);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        batch_destroy(w->upstreams[i].rx);
+        batch_destroy(w->upstreams[i].tx);
+    }
+}
+
+// 工作线程主体：建立自己的事件循环和收发批次后一直运行
+static void* worker_run(void* arg) {
+    DNSWorker *w = (DNSWorker *)arg;
+
+    bool ok = true;
+    w->client_rx = batch_create(w->client_socket, batch_size);
+    w->client_tx = batch_create(w->client_socket, batch_size);
+    ok = w->client_rx && w->client_tx;
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        w->upstreams[i].rx = batch_create(w->upstreams[i].sock, batch_size);
+        w->upstreams[i].tx = batch_create(w->upstreams[i].sock, batch_size);
+        ok = ok && w->upstreams[i].rx && w->upstreams[i].tx;
+    }
+    if (!ok || inflight_init(&w->inflight) != 0 || packet_cache_init(&w->packets, packet_cache_size) != 0 ||
+        arena_init(&w->arena, 0) != 0) {
+        printf("ERROR: Could not allocate packet batches\n");
+        return NULL;
+    }
+    if (qlog_dir != NULL &&
+        qlog_open(&w->qlog, qlog_dir, (uint32_t)w->id, (size_t)qlog_segment_mb << 20, qlog_keep) != 0) {
+        printf("Worker %d: could not open query log in %s, query logging disabled\n", w->id, qlog_dir);
+    }
+
+    // 事件循环只在注册时建立一次，空闲时阻塞等待，不再每 5ms 轮询
+    w->loop = event_loop_create();
+    if (w->loop == NULL) {
+        printf("ERROR: Could not create event loop\n");
+        LOG_ERROR("Could not create event loop\n");
+        return NULL;
+    }
+
+    w->timeout_timer = event_timer_add(w->loop, on_timeout_timer, w);
+    if (w->timeout_timer < 0) {
+        printf("ERROR: Could not create timeout timer\n");
+        event_loop_destroy(w->loop);
+        return NULL;
+    }
+
+    int expire_timer = event_timer_add(w->loop, on_expire_timer, w);
+    if (expire_timer >= 0) {
+        event_timer_set(w->loop, expire_timer, CACHE_EXPIRE_INTERVAL_MS);
+    }
+
+    if (log_level >= LOG_LEVEL_DEBUG) {
+        int stats_timer = event_timer_add(w->loop, on_stats_timer, w);
+        event_timer_set(w->loop, stats_timer, STATS_INTERVAL_MS);
+    }
+
+    // io_uring 模式下事件循环只承载定时器，socket 由 io_uring 收发
+    if (io_backend == IO_BACKEND_URING && uring_worker_run(w) == 0) {
+        goto done;
+    }
+    if (io_backend == IO_BACKEND_URING) {
+        printf("Worker %d: io_uring unavailable, falling back to epoll\n", w->id);
+    }
+
+    ok = event_loop_add(w->loop, w->client_socket, on_client_readable, w) == 0;
+    for (int i = 0; i < UPSTREAM_SOCKETS && ok; i++) {
+        ok = event_loop_add(w->loop, w->upstreams[i].sock, on_upstream_readable, &w->upstreams[i]) == 0;
+    }
+    if (!ok) {
+        printf("ERROR: Could not register sockets\n");
+        LOG_ERROR("Could not register sockets\n");
+        event_loop_destroy(w->loop);
+        return NULL;
+    }
+
+    event_loop_run(w->loop);
+done:
+    event_loop_destroy(w->loop);
+    worker_free_batches(w);
+    inflight_destroy(&w->inflight);
+    packet_cache_destroy(&w->packets);
+    arena_destroy(&w->arena);
+    qlog_close(&w->qlog);
+    return NULL;
 }
 
 void dns_poll() {
-    // 设置为非阻塞模式: recvform被调用时如果没有数据会立即返回错误，不会阻塞调用线程(主循环)
-    int server_result = set_socket_nonblocking(server_socket);
-    int client_result = set_socket_nonblocking(client_socket);
+    // 单线程时直接在主线程中运行，保持原有行为
+    if (worker_count == 1) {
+        worker_run(&workers[0]);
+        return;
+    }
 
-    // 检查是否设置非阻塞失败
-    if (server_result != 0 || client_result != 0)
-    {
-        printf("Set socket non-blocking failed with error: %d\n", GET_SOCKET_ERROR());
-        CLOSE_SOCKET(server_socket);
-        CLOSE_SOCKET(client_socket);
-        network_cleanup();
+    for (int i = 0; i < worker_count; i++) {
+        if (thread_create(&workers[i].thread, worker_run, &workers[i]) != 0) {
+            printf("ERROR: Could not start worker %d\n", i);
+            exit(-1);
+        }
+    }
+    for (int i = 0; i < worker_count; i++) {
+        thread_join(workers[i].thread);
+    }
+}
+
+// 分配在途条目（随机事务 ID + 上游 socket）并把查询放进上游发送批次；表满返回 NULL
+// 超时回收由事件循环中的定时器完成，发送失败的条目同样由超时回收
+static InflightEntry *forward_query(DNSWorker *w, char *buf, int len, const char *qname, uint16_t qtype,
+                                    uint16_t qclass, bool prefetch) {
+    InflightEntry *entry = inflight_alloc(&w->inflight, event_now_ms(), qname, qtype, qclass, prefetch);
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->sent_us = event_now_us();
+    w->metrics->forwarded++;
+    if (!w->timeout_armed) {
+        event_timer_set(w->loop, w->timeout_timer, TIMER_WHEEL_TICK_MS);
+        w->timeout_armed = true;
+    }
+
+    // 换成随机事务ID，回复按 (上游 socket, 事务ID) 找回本条目
+    buf[0] = (entry->txid >> 8) & 0xFF;
+    buf[1] = entry->txid & 0xFF;
+
+    LOG_DEBUG("Before sendto: server_address.sin_family = %d (should be 2), IP = %s\n",
+              server_address.sin_family, inet_ntoa(server_address.sin_addr));
+
+    // 转发请求到远程DNS服务器，随本批次一起发出
+    batch_queue(w->upstreams[entry->upstream].tx, buf, len, &server_address);
+    return entry;
+}
+
+// 后台刷新即将过期的热点记录：复制客户端的查询转发给上游，应答只写入缓存
+static void prefetch(DNSWorker *w, const char *buf, int len, const char *qname, uint16_t qtype, uint16_t qclass) {
+    if (!inflight_can_prefetch(&w->inflight, (uint32_t)prefetch_max, qname, qtype, qclass)) {
         return;
     }
+    char query[BUFFER_SIZE];
+    memcpy(query, buf, len);
+    if (forward_query(w, query, len, qname, qtype, qclass, true) != NULL) {
+        __atomic_fetch_add(&dns_cache->prefetch_issued, 1, __ATOMIC_RELAXED);
+        LOG_INFO("Prefetching %s before it expires\n", qname);
+    }
+}
 
-    struct pollfd fds[2];
+// 拦截的域名以 NXDOMAIN 应答
+static void reply_blocked(DNSWorker *w, char *buf, uint16_t txid, const char *qname, uint16_t qtype,
+                          const struct sockaddr_in *cli) {
+    int response_len = build_nxdomain_response((unsigned char *)buf, BUFFER_SIZE, txid, qname, qtype);
+    if (response_len > 0) {
+        // 发送NXDOMAIN响应给客户端
+        reply_client(w, buf, response_len, cli, QLOG_SRC_BLOCKED, 0);
+        LOG_INFO("Sent NXDOMAIN response for blocked domain: %s\n", qname);
+    } else {
+        LOG_ERROR("Failed to build NXDOMAIN response for: %s\n", qname);
+    }
+}
 
-    while (1)
-    {
+// 用缓存命中的记录应答：直接从借用的记录编码，不复制、不分配；调用方处于纪元临界区
+static bool answer_cached(DNSWorker *w, char *buf, int recv_len, const char *query_name, uint16_t query_type,
+                          uint16_t query_class, uint16_t query_flags, uint16_t client_txid,
+                          const struct sockaddr_in *cli, const CacheView *views, int count) {
+    // CNAME 链上的名字在黑名单中，或者地址是 0.0.0.0 的不良记录，都需要拦截
+    static const uint8_t zero_ipv6[16] = {0};
+    for (int i = 0; i < count; i++) {
+        const CacheRecord *record = views[i].record;
+        if (blacklist_contains(blacklist, record->name) ||
+            (record->type == RR_A && memcmp(record_rdata(record), zero_ipv6, 4) == 0) ||
+            (record->type == RR_AAAA && memcmp(record_rdata(record), zero_ipv6, 16) == 0)) {
+            LOG_INFO("Domain %s is BLOCKED, returning NXDOMAIN response\n", query_name);
+            reply_blocked(w, buf, client_txid, query_name, query_type, cli);
+            return true;
+        }
+    }
 
-        fds[0].fd = client_socket;
-        fds[0].events = POLLIN;  // POLLIN 表示可读
-        fds[1].fd = server_socket;
-        fds[1].events = POLLIN;
+    // 热点记录临近过期时在后台刷新，刷新期间继续用缓存应答
+    if (cache_should_prefetch(views, count, prefetch_percent)) {
+        prefetch(w, buf, recv_len, query_name, query_type, query_class);
+    }
 
-        // 跨平台轮询等待
-#ifdef _WIN32
-        int ret = WSAPoll(fds, 2, 5);
-#else
-        int ret = poll(fds, 2, 5);
-#endif
+    // 应答编码到单独的缓冲区，编码失败时 buf 中仍是原查询，可以转发给上游
+    char response[BUFFER_SIZE];
+    int response_len = build_view_response((unsigned char *)response, BUFFER_SIZE, client_txid, query_name, query_type,
+                                           views, count);
+    if (response_len <= 0) {
+        return false;
+    }
+    // 编码好的应答放进报文缓存，到最早过期或需要预取时失效
+    packet_cache_insert(&w->packets, query_flags, response, response_len, time(NULL),
+                        cache_views_fresh_until(views, count, prefetch_percent));
 
-        if (ret == SOCKET_ERROR_VALUE)
+    // 如果是CNAME或者RR_A查询，打印要发送的字节数据
+    if (query_type == RR_CNAME || query_type == RR_A)
+    {
+        LOG_BYTE("=== CNAME Response Bytes Debug (Length: %d) ===\n", response_len);
+        for (int i = 0; i < response_len; i++)
         {
-            printf("ERROR Poll: %d.\n", GET_SOCKET_ERROR());
-            LOG_INFO("ERROR Poll: %d.\n", GET_SOCKET_ERROR());
+            LOG_BYTE("%02X ", (unsigned char)response[i]);
+            if ((i + 1) % 16 == 0)
+                LOG_BYTE("\n"); // 每16字节换行
         }
-        else if (ret > 0)
+        if (response_len % 16 != 0)
+            LOG_BYTE("\n"); // 最后一行换行
+
+        // 也打印ASCII可读部分
+        LOG_BYTE("ASCII representation:\n");
+        for (int i = 0; i < response_len; i++)
         {
-            if (fds[0].revents & POLLIN) //revents是真实发生的事件类型，与POLLIN进行按位与运算可以判断是否有数据可读
+            char c = response[i];
+            if (c >= 32 && c <= 126)
             {
-                // client_sock 有数据到达，处理客户端请求
-                receiveClient();
+                LOG_BYTE("%c", c);
             }
-            if (fds[1].revents & POLLIN)
+            else
             {
-                // server_sock 有数据到达，处理服务器响应
-                receiveServer();
+                LOG_BYTE(".");
             }
+            if ((i + 1) % 64 == 0)
+                LOG_BYTE("\n"); // 每64字符换行
         }
+        if (response_len % 64 != 0)
+            LOG_BYTE("\n");
+        LOG_BYTE("===============================================\n");
     }
+
+    // 发送缓存响应给客户端
+    reply_client(w, response, response_len, cli, QLOG_SRC_CACHE, 0);
+    return true;
 }
 
-void receiveClient() { 
-    DNS_message msg;
-    int recv_len = recvfrom(client_socket, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&clientAddress, &address_length);
-    // printf("111");
-    printf("Received DNS packet from %s:%d, length = %d bytes\n", inet_ntoa(clientAddress.sin_addr), ntohs(clientAddress.sin_port), recv_len);
-    if(recv_len < 0) {
-        perror("recvfrom failed");
-        return ;
+void receiveClient(DNSWorker *w, char *buf, int recv_len, const struct sockaddr_in *cli) {
+    w->metrics->queries++;
+    // 报文缓存命中：复制应答，只改事务ID和TTL，不解析也不加锁
+    int cached_len = packet_cache_answer(&w->packets, buf, recv_len, time(NULL));
+    if (cached_len > 0) {
+        reply_client(w, buf, cached_len, cli, QLOG_SRC_PACKET_CACHE, 0);
+        return;
     }
-    // printf("222");
-    // 解析 DNS 消息
-    parse_dns_packet(&msg, buffer, recv_len);
-    // printf("333");
 
-    // 检查缓存（这里假设只检查第一个问题）
-    char *query_name = NULL;
-    uint16_t query_type = 0;
-    if (msg.header->ques_num > 0 && msg.question != NULL) {
-        query_name = msg.question[0].qname;
-        query_type = msg.question[0].qtype;
-    }
-    if (query_name != NULL) {
-        printf("query_name : %s  %d \n", query_name, query_type);
-        // printf("444");
-    } else {
-        return ;
+    DNSView view;
+    DNSQuestionView question;
+    char query_name[DOMAIN_MAX_LEN];
+    LOG_INFO("Received DNS packet from %s:%d, length = %d bytes\n", inet_ntoa(cli->sin_addr), ntohs(cli->sin_port), recv_len);
+    // 只解析头部和第一个问题（这里假设只检查第一个问题）
+    if (dns_view_init(&view, buf, recv_len) != 0 ||
+        dns_view_question_name(&view, &question, query_name, sizeof(query_name)) != 0) {
+        return;
     }
+    uint16_t query_type = question.qtype;
+    uint16_t query_class = question.qclass;
+    uint16_t query_flags = view.flags;
+    LOG_DEBUG("query_name : %s  %d \n", query_name, query_type);
 
-    uint16_t client_txid = msg.header->transactionID;
+    uint16_t client_txid = view.id;
     // 保存客户端地址以便后续回复
-    struct sockaddr_in original_client = clientAddress;
+    struct sockaddr_in original_client = *cli;
 
+    // 缓存内部按分片加锁，这里不需要持锁
     if(log_level >= LOG_LEVEL_DEBUG) cache_print_status(dns_cache);
 
+    // 1. 检查黑名单
+    if (blacklist_query(blacklist, query_name)) {
+        LOG_INFO("Domain %s is in blacklist, returning NXDOMAIN response\n", query_name);
+        reply_blocked(w, buf, client_txid, query_name, query_type, &original_client);
+        return;
+    }
 
-    // 1. 先查询缓存，支持CNAME链解析
-    CacheQueryResult* query_res;
-    query_res = cache_query(dns_cache, query_name, msg.question->qtype);
+    // 2. 查询缓存，支持CNAME链解析；views 借用缓存中的记录，用完之前不离开纪元临界区
+    CacheView views[CACHE_MAX_ANSWERS];
+    epoch_enter();
+    int answer_count = cache_query_views(dns_cache, query_name, query_type, views, CACHE_MAX_ANSWERS);
 
-    // 2. 检查黑名单
-    if (blacklist_query(blacklist, query_name)) {
-        printf("Domain %s is in blacklist, returning NXDOMAIN response\n", query_name);
+    // 3. 如果缓存命中
+    bool answered = false;
+    if (answer_count > 0) {
+        LOG_INFO("Cache hit for: %s\n", query_name);
+        answered = answer_cached(w, buf, recv_len, query_name, query_type, query_class, query_flags, client_txid,
+                                 &original_client, views, answer_count);
+    }
+    epoch_exit();
+    if (answered) {
+        return;
+    }
+    if (answer_count > 0) {
+        LOG_WARNING("Cached answer for %s does not fit in a response, forwarding to remote DNS\n", query_name);
+    }
 
-        // 构建NXDOMAIN响应
-        int response_len = build_nxdomain_response((unsigned char *)buffer, BUFFER_SIZE, client_txid, query_name, query_type);
+    // 负缓存命中：名字不存在或没有该类型的记录，按原 RCODE 带 SOA 应答
+    DNSRecord *negative = query_class == 1 ? cache_query_negative(dns_cache, &w->arena, query_name, query_type) : NULL;
+    if (negative != NULL) {
+        LOG_INFO("Negative cache hit for: %s\n", query_name);
+        int response_len = build_negative_response((unsigned char *)buf, BUFFER_SIZE, client_txid, query_name, query_type, negative);
         if (response_len > 0) {
-            // 发送NXDOMAIN响应给客户端
-            sendto(client_socket, buffer, response_len, 0, (struct sockaddr *)&original_client, address_length);
-            printf("Sent NXDOMAIN response for blocked domain: %s\n", query_name);
-        } else {
-            printf("Failed to build NXDOMAIN response for: %s\n", query_name);
-        }
-        cache_query_free(query_res);
-        return ;
-    }
-    CacheQueryResult* current = query_res;
-    while(current) {
-        int is_in_blacklist = blacklist_query(blacklist, current->record->domain);
-        if(is_in_blacklist) {
-            printf("Domain %s is in blacklist, returning NXDOMAIN response\n", current->record->domain);
-
-            // 构建NXDOMAIN响应
-            int response_len = build_nxdomain_response((unsigned char *)buffer, BUFFER_SIZE, client_txid, query_name, query_type);
-            if (response_len > 0) {
-                // 发送NXDOMAIN响应给客户端
-                sendto(client_socket, buffer, response_len, 0, (struct sockaddr *)&original_client, address_length);
-                printf("Sent NXDOMAIN response for blocked domain: %s\n", query_name);
-            } else {
-                printf("Failed to build NXDOMAIN response for: %s\n", query_name);
-            }
-            cache_query_free(query_res);
-            return ;
+            packet_cache_insert(&w->packets, query_flags, buf, response_len, time(NULL), negative->expire_time);
+            reply_client(w, buf, response_len, &original_client, QLOG_SRC_NEGATIVE, 0);
         }
-        current=current->next;
+        return;
     }
 
-    // 3. 如果缓存命中
-    if (query_res != NULL) {
-        printf("Cache hit for: %s\n", query_name);
-
-        // 先判断ip地址中是否有0.0.0.0的不良记录需要拦截
-        CacheQueryResult *current = query_res;
-        bool is_blocked = false;
-        uint8_t zero_ipv6[16] = {0};
-
-        while (current != NULL) {
-            if (current->record->type == RR_A && current->record->value.ipv4 == 0) {
-                is_blocked = true;
-                break;
-            } else if(current->record->type == RR_AAAA && memcmp(current->record->value.ipv6, zero_ipv6, 16) == 0) {
-                is_blocked = true;
-                break;
-            }
-            current = current->next;
+    // 过期不久的记录留作上游迟迟不应答时的后备；只在应答期限到期或上游失败时才去查，未命中时不复制记录
+    InflightEntry *pending = inflight_find(&w->inflight, query_name, query_type, query_class);
+    // 刷新仍在途且已经在用过期数据应答，后来的客户端直接应答
+    if (pending != NULL && pending->stale_served) {
+        CacheQueryResult *stale = cache_query_stale(dns_cache, &w->arena, query_name, query_type, stale_window);
+        if (stale != NULL) {
+            answer_stale(w, stale, query_name, query_type, client_txid, &original_client, upstream_latency_us(pending));
+            return;
         }
-
-        if (is_blocked) {
-            printf("Domain %s is BLOCKED, returning NXDOMAIN response\n", query_name);
-
-            // 构建NXDOMAIN响应
-            int response_len = build_nxdomain_response((unsigned char *)buffer, BUFFER_SIZE, client_txid, query_name, query_type);
-            if (response_len > 0) {
-                // 发送NXDOMAIN响应给客户端
-                sendto(client_socket, buffer, response_len, 0, (struct sockaddr *)&original_client, address_length);
-                printf("Sent NXDOMAIN response for blocked domain: %s\n", query_name);
-            } else {
-                printf("Failed to build NXDOMAIN response for: %s\n", query_name);
-            }
-            cache_query_free(query_res);
-            return ;
-        } else {
-            // 使用多记录响应构建函数
-            int response_len = build_multi_record_response((unsigned char *)buffer, BUFFER_SIZE, client_txid, query_name, query_type, query_res);
-
-            // 如果是CNAME或者RR_A查询，打印要发送的字节数据
-            if ((query_type == RR_CNAME || query_type == RR_A) && response_len > 0)
-            {
-                LOG_BYTE("=== CNAME Response Bytes Debug (Length: %d) ===\n", response_len);
-                for (int i = 0; i < response_len; i++)
-                {
-                    LOG_BYTE("%02X ", (unsigned char)buffer[i]);
-                    if ((i + 1) % 16 == 0)
-                        LOG_BYTE("\n"); // 每16字节换行
-                }
-                if (response_len % 16 != 0)
-                    LOG_BYTE("\n"); // 最后一行换行
-
-                // 也打印ASCII可读部分
-                LOG_BYTE("ASCII representation:\n");
-                for (int i = 0; i < response_len; i++)
-                {
-                    char c = buffer[i];
-                    if (c >= 32 && c <= 126)
-                    {
-                        LOG_BYTE("%c", c);
-                    }
-                    else
-                    {
-                        LOG_BYTE(".");
-                    }
-                    if ((i + 1) % 64 == 0)
-                        LOG_BYTE("\n"); // 每64字符换行
-                }
-                if (response_len % 64 != 0)
-                    LOG_BYTE("\n");
-                LOG_BYTE("===============================================\n");
-            }
-
-            // 发送缓存响应给客户端
-            sendto(client_socket, buffer, response_len, 0, (struct sockaddr *)&original_client, address_length);
+    }
+    LOG_INFO("Cache miss for: %s, forwarding to remote DNS\n", query_name);
+
+    // 同一问题已在途时只挂为等待者，等上游的同一个回复
+    // 在途的查询（如预取）还没有应答期限时由这个客户端补上，上游不应答时等待者同样能拿到过期数据
+    if (pending != NULL && inflight_add_waiter(&w->inflight, pending, client_txid, &original_client) >= 0) {
+        LOG_INFO("Query for %s already in flight, waiting for its answer\n", query_name);
+        if (stale_window > 0 && !timer_node_pending(&pending->deadline)) {
+            inflight_set_deadline(&w->inflight, pending, event_now_ms(), (uint64_t)stale_wait_ms);
         }
-        cache_query_free(query_res);
-    } else {
-        printf("Cache miss for: %s, forwarding to remote DNS\n", query_name);
+        return;
+    }
 
-        // 查找空闲槽位
-        cleanup_timeouts();
-        int slot = find_free_slot();
-        if (slot == -1)
-        {
-            printf("No free slots available, dropping request\n");
-            return;
-        }
+    InflightEntry *entry = forward_query(w, buf, recv_len, query_name, query_type, query_class, false);
+    if (entry == NULL)
+    {
+        LOG_WARNING("In-flight table full, dropping request\n");
+        return;
+    }
 
-        // 保存事务ID和客户端信息
-        ID_list[slot].orig_id = client_txid;
-        ID_list[slot].cli = original_client;
-        ID_list[slot].timestamp = time(NULL);
-        ID_used[slot] = true;
-
-        // 修改事务ID为槽位索引+1，避免冲突
-        uint16_t new_txid = (slot % 0xFFFF) + 1;
-        buffer[0] = (new_txid >> 8) & 0xFF;
-        buffer[1] = new_txid & 0xFF;
-
-        printf("DEBUG: Before sendto: server_address.sin_family = %d (should be 2), IP = %s\n",
-           server_address.sin_family, inet_ntoa(server_address.sin_addr));
-
-        // 转发请求到远程DNS服务器
-        if(sendto(server_socket, buffer, recv_len, 0, (struct sockaddr *)&server_address, sizeof(server_address)) == SOCKET_ERROR_VALUE) {
-            printf("Error sending request to remote DNS server\n");
-            LOG_ERROR("Sendto failed: %d", GET_SOCKET_ERROR());
-            ID_used[slot] = false; // 立即释放槽位
-        }
+    // 保存事务ID和客户端信息
+    entry->orig_id = client_txid;
+    entry->cli = original_client;
+    if (stale_window > 0) {
+        inflight_set_deadline(&w->inflight, entry, event_now_ms(), (uint64_t)stale_wait_ms);
     }
 }
 
-void receiveServer() {
-    socklen_t remote_addr_len = sizeof(server_address);
-    int remote_recvLen = recvfrom(server_socket, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&server_address, &remote_addr_len);
-
-    if (remote_recvLen > 0) {
-        printf("Received response from remote DNS, length = %d bytes\n", remote_recvLen);
+void receiveServer(Upstream *up, char *buf, int remote_recvLen) {
+    DNSWorker *w = up->w;
+    if (remote_recvLen >= 2) {
+        LOG_INFO("Received response from remote DNS, length = %d bytes\n", remote_recvLen);
 
         // 获取服务器响应中的事务ID
-        uint16_t server_txid = (buffer[0] << 8) | buffer[1];
-
-        // 检查事务ID是否有效
-        if (server_txid == 0 || server_txid > MAX_INFLIGHT)
-        {
-            printf("Invalid transaction ID in response: %d\n", server_txid);
-            return;
-        }
-
-        int slot = server_txid - 1; // 转换为槽位索引，由于事务ID是通过数组的槽位加一产生，所以这里需要减一
-
-        // 检查事务ID是否在使用中
-        if (!ID_used[slot]) {
-            printf("No matching request found for transaction ID %d\n", server_txid);
+        uint16_t server_txid = ((uint8_t)buf[0] << 8) | (uint8_t)buf[1];
+
+        // 按收到响应的上游 socket 与事务ID查找在途查询
+        InflightEntry *entry = inflight_lookup(&w->inflight, up->index, server_txid);
+        w->metrics->upstream_responses++;
+        if (entry == NULL) {
+            w->metrics->upstream_unmatched++;
+            LOG_WARNING("No matching request found for transaction ID %d\n", server_txid);
             return;
         }
 
         // 恢复原始事务ID，将从服务器返回的ID映射到原始客户端的事务ID，并发送到服务器
-        uint16_t orig_txid = ID_list[slot].orig_id;
-        buffer[0] = (orig_txid >> 8) & 0xFF;
-        buffer[1] = orig_txid & 0xFF;
+        uint16_t orig_txid = entry->orig_id;
+        buf[0] = (orig_txid >> 8) & 0xFF;
+        buf[1] = orig_txid & 0xFF;
 
         // 获取原始客户端地址
-        struct sockaddr_in original_client = ID_list[slot].cli;
+        struct sockaddr_in original_client = entry->cli;
+
+        // 解析DNS报文以获取查询名和响应记录，资源记录逐条按需解码
+        // 没有问题或问题名无法解码的响应无法确认是对哪个查询的回答，与头部不完整一样丢弃，条目继续等待
+        DNSView view;
+        DNSQuestionView question;
+        char query_name[DOMAIN_MAX_LEN];
+        if (dns_view_init(&view, buf, remote_recvLen) != 0 ||
+            dns_view_question_name(&view, &question, query_name, sizeof(query_name)) != 0) {
+            w->metrics->upstream_malformed++;
+            LOG_WARNING("Malformed response for transaction ID %d, ignored\n", server_txid);
+            return;
+        }
+        // 问题与转发的不一致，视为伪造或错配的响应，条目继续等待
+        if (!inflight_question_matches(entry, query_name, question.qtype, question.qclass)) {
+            w->metrics->upstream_unmatched++;
+            LOG_WARNING("Response question mismatch for transaction ID %d, ignored\n", server_txid);
+            return;
+        }
 
-        // 解析DNS报文以获取查询名和响应记录
-        DNS_message response_msg;
-        parse_dns_packet(&response_msg, buffer, remote_recvLen);
+        histogram_record(&w->metrics->upstream_rtt[up->index], upstream_latency_us(entry));
 
-        char *query_name = NULL;
-        if (response_msg.header->ques_num > 0 && response_msg.question != NULL) {
-            query_name = response_msg.question[0].qname;
+        // 上游返回 SERVFAIL/REFUSED 时优先用过期数据应答（RFC 8767）
+        uint16_t rcode = view.flags & 0x000F;
+        if (rcode == RCODE_SERVFAIL || rcode == RCODE_REFUSED) {
+            w->metrics->upstream_failures++;
+        }
+        if ((rcode == RCODE_SERVFAIL || rcode == RCODE_REFUSED) && stale_window > 0 && serve_stale(w, entry)) {
+            inflight_release(&w->inflight, entry);
+            return;
         }
 
-        // 缓存远程服务器的响应（Answer Section）
-        if (query_name != NULL && response_msg.header->ans_num > 0 && response_msg.answer != NULL) {
-            for (int i = 0; i < response_msg.header->ans_num; i++) {
-                DNS_resource_record *rr = &response_msg.answer[i];
-
-                if (rr->type == RR_A) {
-                    uint32_t ipv4_addr;
-                    memcpy(&ipv4_addr, rr->data.a_record.IP_addr, 4);
-                    // 使用资源记录的实际名称作为缓存键，而不是查询名称
-                    cache_update(dns_cache, rr->name, RR_A, &ipv4_addr, rr->ttl);
-                    printf("Cached A record: %s -> %d.%d.%d.%d, TTL: %u\n", rr->name, rr->data.a_record.IP_addr[0], rr->data.a_record.IP_addr[1],
-                           rr->data.a_record.IP_addr[2], rr->data.a_record.IP_addr[3], rr->ttl);
+        // 预取的应答写入后若再被命中，计为一次有效预取
+        uint8_t cache_flags = entry->prefetch ? RECORD_PREFETCHED : 0;
+        // NXDOMAIN/NODATA 按授权部分的 SOA 写入负缓存（RFC 2308），带 CNAME 的应答不缓存
+        bool negative = view.ancount == 0 && (rcode == RCODE_NXDOMAIN || rcode == 0) &&
+                        question.qclass == 1;
+
+        // 缓存远程服务器的响应（Answer 与 Additional Section），授权部分只取负缓存用的 SOA
+        DNSRRIter iter;
+        DNSRRView rr;
+        if (dns_rr_iter_init(&iter, &view) == 0) {
+            while (dns_rr_next(&iter, &rr) > 0) {
+                if (rr.section == DNS_SECTION_AUTHORITY && !(negative && rr.type == RR_SOA)) {
+                    continue;
                 }
-                else if (rr->type == RR_AAAA) {
-                    uint8_t ipv6_addr[16];
-                    memcpy(&ipv6_addr, rr->data.aaaa_record.IP_addr, 16);
-                    cache_update(dns_cache, rr->name, RR_AAAA, &ipv6_addr, rr->ttl);
-                    printf("Cached AAAA record: %s -> [IPv6], TTL: %u\n", rr->name, rr->ttl);
+                // 使用资源记录的实际名称作为缓存键，而不是查询名称
+                char rr_name[DOMAIN_MAX_LEN];
+                if (dns_name_decode(&view, rr.name_offset, rr_name, sizeof(rr_name)) < 0) {
+                    break;
                 }
-                else if (rr->type == RR_CNAME) {
+                const char *section = rr.section == DNS_SECTION_ADDITIONAL ? "Additional " : "";
+                const uint8_t *rdata = view.data + rr.rdata_offset;
+
+                if (rr.type == RR_SOA) {
+                    DNSSoa soa;
+                    if (dns_rr_soa(&view, &rr, &soa) == 0) {
+                        cache_insert_negative(dns_cache, query_name, question.qtype, (uint8_t)rcode, rr_name, rr.ttl, &soa);
+                        LOG_DEBUG("Cached negative answer: %s (type=%d, rcode=%d)\n", query_name, question.qtype, rcode);
+                        negative = false;
+                    }
+                } else if (rr.type == RR_A && rr.rdlength == 4) {
+                    uint32_t ipv4_addr;
+                    memcpy(&ipv4_addr, rdata, 4);
+                    cache_insert(dns_cache, rr_name, RR_A, &ipv4_addr, rr.ttl, cache_flags);
+                    LOG_DEBUG("Cached %sA record: %s -> %d.%d.%d.%d, TTL: %u\n", section, rr_name, rdata[0], rdata[1],
+                              rdata[2], rdata[3], rr.ttl);
+                } else if (rr.type == RR_AAAA && rr.rdlength == 16) {
+                    uint8_t ipv6_addr[16];
+                    memcpy(&ipv6_addr, rdata, 16);
+                    cache_insert(dns_cache, rr_name, RR_AAAA, &ipv6_addr, rr.ttl, cache_flags);
+                    LOG_DEBUG("Cached %sAAAA record: %s -> [IPv6], TTL: %u\n", section, rr_name, rr.ttl);
+                } else if (rr.type == RR_CNAME) {
                     // 缓存CNAME记录
-                    cache_update(dns_cache, rr->name, RR_CNAME, rr->data.cname_record.name, rr->ttl);
-                    printf("Cached Additional CNAME record: %s -> %s, TTL: %u\n", rr->name, rr->data.cname_record.name, rr->ttl);
+                    char cname[DOMAIN_MAX_LEN];
+                    if (dns_name_decode(&view, rr.rdata_offset, cname, sizeof(cname)) >= 0) {
+                        cache_insert(dns_cache, rr_name, RR_CNAME, cname, rr.ttl, cache_flags);
+                        LOG_DEBUG("Cached %sCNAME record: %s -> %s, TTL: %u\n", section, rr_name, cname, rr.ttl);
+                    }
                 }
             }
         }
 
-        // 缓存远程服务器的响应（Additional Section）
-        if (query_name != NULL && response_msg.header->add_num > 0 && response_msg.additional != NULL) {
-            printf("Processing %d additional records\n", response_msg.header->add_num);
-            for (int i = 0; i < response_msg.header->add_num; i++) {
-                DNS_resource_record *rr = &response_msg.additional[i];
-
-                if (rr->type == RR_A) {
-                    uint32_t ipv4_addr;
-                    memcpy(&ipv4_addr, rr->data.a_record.IP_addr, 4);
-                    cache_update(dns_cache, rr->name, RR_A, &ipv4_addr, rr->ttl);
-                    printf("Cached Additional A record: %s -> %d.%d.%d.%d, TTL: %u\n", rr->name, rr->data.a_record.IP_addr[0],
-                           rr->data.a_record.IP_addr[1], rr->data.a_record.IP_addr[2], rr->data.a_record.IP_addr[3], rr->ttl);
-                } else if (rr->type == RR_AAAA) {
-                    uint8_t ipv6_addr[16];
-                    memcpy(&ipv6_addr, rr->data.aaaa_record.IP_addr, 16);
-                    cache_update(dns_cache, rr->name, RR_AAAA, &ipv6_addr, rr->ttl);
-                    printf("Cached Additional AAAA record: %s -> [IPv6], TTL: %u\n", rr->name, rr->ttl);
-                } else if (rr->type == RR_CNAME) {
-                    cache_update(dns_cache, rr->name, RR_CNAME, rr->data.cname_record.name, rr->ttl);
-                    printf("Cached Additional CNAME record: %s -> %s, TTL: %u\n", rr->name, rr->data.cname_record.name, rr->ttl);
-                }
-            }
+        // 将响应返回给原始客户端，预取没有原始客户端，已用过期数据应答过的不再重复发送
+        uint32_t latency_us = upstream_latency_us(entry);
+        if (!entry->prefetch && !entry->stale_served) {
+            reply_client(w, buf, remote_recvLen, &original_client, QLOG_SRC_UPSTREAM, latency_us);
         }
 
-        // 将响应返回给原始客户端
-        sendto(client_socket, buffer, remote_recvLen, 0, (struct sockaddr *)&original_client, address_length);
+        // 分发给合并进来的等待者，各自换回自己的事务ID（batch_queue 会复制数据），耗时按首个查询计
+        for (uint32_t i = entry->waiters; i != INFLIGHT_NONE; ) {
+            InflightWaiter *waiter = inflight_waiter(&w->inflight, i);
+            buf[0] = (waiter->orig_id >> 8) & 0xFF;
+            buf[1] = waiter->orig_id & 0xFF;
+            reply_client(w, buf, remote_recvLen, &waiter->cli, QLOG_SRC_COALESCED, latency_us);
+            i = waiter->next;
+        }
 
-        // 释放槽位
-        ID_used[slot] = false;
+        // 释放条目并取消超时
+        inflight_release(&w->inflight, entry);
     }
 }
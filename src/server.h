@@ -62,6 +62,14 @@
 #include "dnsStruct.h"
 #include "log.h"
 #include "host.h"
+#include "event.h"
+#include "batch.h"
+#include "thread.h"
+#include "uring.h"
+#include "inflight.h"
+#include "pktcache.h"
+#include "qlog.h"
+#include "metrics.h"
 
 // #pragma comment(lib, "ws2_32.lib")
 // #pragma warning(disable : 4996)
@@ -69,27 +77,73 @@
 
 #define PORT 53
 #define BUFFER_SIZE 512
+#define STATS_INTERVAL_MS 10000 // 调试模式下输出统计的间隔
 
-// 跨平台socket变量
-socket_t client_socket;
-socket_t server_socket;
+#define MAX_WORKERS 64
 
-// 用于将socket绑定到本地地址
-struct sockaddr_in client_address;
-struct sockaddr_in server_address;
+struct sockaddr_in server_address; // 远程DNS服务器地址
 
-socklen_t address_length;
 char *remote_dns; // 远程主机ip地址
 
 // 跨平台兼容变量
 WSADATA wsa_data;
-socket_t sock;
-// 用于recvform获取服务器和客户端的地址信息
-struct sockaddr_in serverAddress;
-struct sockaddr_in clientAddress;
-socklen_t addressLength;
 
-char buffer[BUFFER_SIZE];
+/*
+工作线程
+    每个线程各自持有一个以 SO_REUSEPORT 绑定到 53 端口的监听 socket、
+    UPSTREAM_SOCKETS 个连接上游的 socket、自己的收发批次和转发查询表，
+    线程之间只共享 dns_cache（由 cache_lock 保护）与只读的拦截表
+*/
+struct DNSWorker;
+
+// 连接上游的 socket，各自绑定一个临时源端口
+typedef struct Upstream {
+    struct DNSWorker* w;
+    int index;           // 在 upstreams 中的序号，与事务 ID 一起定位在途查询
+    socket_t sock;
+    DNSBatch* rx;        // 上游响应
+    DNSBatch* tx;        // 转发给上游的请求
+} Upstream;
+
+typedef struct DNSWorker {
+    int id;
+    socket_t client_socket;
+    EventLoop* loop;
+    DNSBatch* client_rx; // 客户端请求
+    DNSBatch* client_tx; // 发往客户端的回复
+    Upstream upstreams[UPSTREAM_SOCKETS];
+    InflightTable inflight; // 转发查询表
+    PacketCache packets;    // 应答报文缓存，命中时不再查记录缓存
+    Arena arena;            // 处理一批请求期间的临时分配，回复发出后重置
+    QueryLog qlog;          // 二进制查询日志，未开启时 base 为 NULL
+    WorkerMetrics* metrics; // 本线程导出的指标，只由本线程写
+    int timeout_timer;   // 推进转发查询超时的定时器，仅在有在途查询时启用
+    bool timeout_armed;
+    thread_t thread;
+} DNSWorker;
+
+extern int worker_count; // 由命令行 -w 配置
+
+#define PREFETCH_DEFAULT_PERCENT 10 // 剩余 TTL 不足原 TTL 的这一比例时预取
+#define PREFETCH_DEFAULT_MAX 64     // 每个工作线程同时在途的预取上限
+extern int prefetch_percent;        // 由命令行 -pf 配置，0 表示关闭预取
+extern int prefetch_max;            // 由命令行 -pfmax 配置
+
+#define STALE_DEFAULT_WINDOW 86400  // 过期记录保留可用于应答的时长（秒），RFC 8767 建议 1 到 3 天
+#define STALE_DEFAULT_WAIT_MS 1800  // 上游在此时间内未应答时改用过期数据应答客户端
+extern int stale_window;            // 由命令行 -stale 配置，0 表示关闭 serve-stale
+extern int stale_wait_ms;           // 由命令行 -stalewait 配置
+
+extern int packet_cache_size;       // 由命令行 -pc 配置，每个工作线程的报文缓存条目数，0 表示关闭
+
+extern const char *qlog_dir;        // 由命令行 -qlog 配置，查询日志段文件所在目录，NULL 表示关闭
+extern int qlog_segment_mb;         // 由命令行 -qlogsize 配置，每个段文件的大小（MB）
+extern int qlog_keep;               // 由命令行 -qlogkeep 配置，每个工作线程保留的段文件数
+
+extern int cache_shards;             // 由命令行 -shards 配置，记录缓存的分片数
+extern CachePolicy cache_policy;     // 由命令行 -policy 配置，记录缓存的淘汰策略
+extern const char *metrics_name;    // 由命令行 -metrics 配置，导出指标的共享内存名，NULL 表示不导出
+extern MetricsShared *metrics;
 
 // 跨平台网络函数
 int network_init(void);
@@ -97,6 +151,14 @@ void network_cleanup(void);
 int set_socket_nonblocking(socket_t sock);
 
 void init();
+// init() 的三步，可指定端口与上游（remote_dns）单独调用
+void init_socket(int port);
+void init_DNS(void);
+void init_metrics(void);
 void dns_poll();  // 重命名避免与系统poll()函数冲突
-void receiveClient();
-void receiveServer();
+// 发出所有发送批次中攒下的回复与转发
+void worker_flush(DNSWorker *w);
+// 处理一个客户端请求，回复与转发先放进发送批次
+void receiveClient(DNSWorker *w, char *buf, int recv_len, const struct sockaddr_in *cli);
+// 处理一个上游响应
+void receiveServer(Upstream *up, char *buf, int recv_len);
@@ -0,0 +1,91 @@
+#include "sketch.h"
+#include <stdlib.h>
+
+#define SKETCH_MIN_GROUPS 8
+#define SKETCH_GROUP 64         // 一组占一条缓存行：4 行，每行 16 个计数
+
+// 再混合一次：缓存分片用了名字哈希的高位，同一分片内的键高位相同
+static inline uint64_t spread(uint64_t hash) {
+    hash = (hash ^ (hash >> 29)) * 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 32);
+}
+
+// 第 row 行的计数：高 32 位选组，低位每 4 位选一行中的计数
+static inline size_t counter_index(const FrequencySketch* sketch, uint64_t h, int row) {
+    size_t group = (size_t)(h >> 32) & sketch->mask;
+    return group * SKETCH_GROUP + (size_t)row * 16 + (size_t)((h >> (row * 4)) & 15);
+}
+
+int sketch_init(FrequencySketch* sketch, size_t capacity) {
+    size_t groups = SKETCH_MIN_GROUPS;
+    while (groups * 4 < capacity) {
+        groups *= 2;
+    }
+    sketch->table = (uint8_t*)calloc(groups, SKETCH_GROUP);
+    if (sketch->table == NULL) {
+        return -1;
+    }
+    sketch->mask = groups - 1;
+    sketch->additions = 0;
+    size_t sample = capacity * SKETCH_SAMPLE_FACTOR;
+    sketch->sample = sample == 0 ? SKETCH_SAMPLE_FACTOR : sample > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)sample;
+    return 0;
+}
+
+void sketch_free(FrequencySketch* sketch) {
+    free(sketch->table);
+    sketch->table = NULL;
+}
+
+// 保守更新：只增加 4 个计数中等于最小值的，别的键撞上的计数不再跟着变大，估计更接近实际次数。
+// 读改写不是一个原子操作：并发时丢掉的增加无关紧要，换来增加时不锁总线
+void sketch_increment(FrequencySketch* sketch, uint64_t hash) {
+    uint64_t h = spread(hash);
+    uint8_t* counters[4];
+    uint8_t values[4];
+    uint8_t min = SKETCH_MAX;
+    for (int row = 0; row < 4; row++) {
+        counters[row] = &sketch->table[counter_index(sketch, h, row)];
+        values[row] = __atomic_load_n(counters[row], __ATOMIC_RELAXED);
+        if (values[row] < min) {
+            min = values[row];
+        }
+    }
+    if (min == SKETCH_MAX) {
+        return;
+    }
+    for (int row = 0; row < 4; row++) {
+        if (values[row] == min) {
+            __atomic_store_n(counters[row], (uint8_t)(min + 1), __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&sketch->additions, __atomic_load_n(&sketch->additions, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+int sketch_estimate(const FrequencySketch* sketch, uint64_t hash) {
+    uint64_t h = spread(hash);
+    int estimate = SKETCH_MAX;
+    for (int row = 0; row < 4; row++) {
+        int value = __atomic_load_n(&sketch->table[counter_index(sketch, h, row)], __ATOMIC_RELAXED);
+        if (value < estimate) {
+            estimate = value;
+        }
+    }
+    return estimate;
+}
+
+int sketch_age(FrequencySketch* sketch) {
+    if (__atomic_load_n(&sketch->additions, __ATOMIC_RELAXED) < sketch->sample) {
+        return 0;
+    }
+    size_t count = (sketch->mask + 1) * SKETCH_GROUP;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t value = __atomic_load_n(&sketch->table[i], __ATOMIC_RELAXED);
+        if (value != 0) {
+            __atomic_store_n(&sketch->table[i], (uint8_t)(value >> 1), __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&sketch->additions, __atomic_load_n(&sketch->additions, __ATOMIC_RELAXED) / 2,
+                     __ATOMIC_RELAXED);
+    return 1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+访问频率估计（count-min sketch），供记录缓存的 W-TinyLFU 准入使用（见 cache.h）
+    每个计数 8 位、计到 SKETCH_MAX 为止；一个键的 4 个计数分别落在同一个 64 字节组的 4 行中，
+    增加和估计都只碰一条缓存行。估计取 4 个计数的最小值，增加时只增加等于最小值的计数（保守更新），
+    只会因碰撞高估，不会低估。
+    计数累计增加 sample 次后全部减半（老化），过去的热点逐渐让位给新的热点。
+    增加与估计不加锁，可由多个线程并发调用：计数用宽松的原子读写，并发时偶尔丢掉一次增加，不影响估计；
+    老化由调用方保证同一时刻只有一个线程进行（缓存在分片锁内进行）。
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SKETCH_MAX 15           // 计数上限：超过这个次数的名字同样热门，不必区分
+#define SKETCH_SAMPLE_FACTOR 10 // 每 容量 * 10 次增加老化一次
+
+typedef struct FrequencySketch {
+    uint8_t* table;
+    size_t mask;                // 组数 - 1，每组 64 个计数
+    uint32_t additions;         // 上次老化以来的增加次数，读者宽松地累加
+    uint32_t sample;
+} FrequencySketch;
+
+// 按要估计的键数 capacity 分配（每个键约 16 个计数）；失败返回 -1
+int sketch_init(FrequencySketch* sketch, size_t capacity);
+
+void sketch_free(FrequencySketch* sketch);
+
+// hash 为键的 64 位哈希（缓存用驻留表中名字的哈希）
+void sketch_increment(FrequencySketch* sketch, uint64_t hash);
+
+int sketch_estimate(const FrequencySketch* sketch, uint64_t hash);
+
+// 累计增加达到 sample 时把所有计数减半，返回是否老化
+int sketch_age(FrequencySketch* sketch);
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+跨平台线程与互斥锁
+    Linux 下封装 pthread，Windows 下封装 CreateThread 与 CRITICAL_SECTION
+    mutex_trylock 不等待，取得锁时为真
+*/
+
+#include <stdlib.h>
+
+typedef void* (*thread_func_t)(void* arg);
+
+#ifdef _WIN32
+    #include <windows.h>
+
+    typedef HANDLE thread_t;
+    typedef CRITICAL_SECTION mutex_t;
+
+    #define mutex_init(m) InitializeCriticalSection(m)
+    #define mutex_lock(m) EnterCriticalSection(m)
+    #define mutex_unlock(m) LeaveCriticalSection(m)
+    #define mutex_trylock(m) (TryEnterCriticalSection(m) != 0)
+    #define mutex_destroy(m) DeleteCriticalSection(m)
+
+    typedef struct ThreadStart {
+        thread_func_t func;
+        void* arg;
+    } ThreadStart;
+
+    static DWORD WINAPI thread_trampoline(LPVOID param) {
+        ThreadStart start = *(ThreadStart*)param;
+        free(param);
+        start.func(start.arg);
+        return 0;
+    }
+
+    static inline int thread_create(thread_t* thread, thread_func_t func, void* arg) {
+        ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+        if (start == NULL) return -1;
+        start->func = func;
+        start->arg = arg;
+        *thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+        if (*thread == NULL) {
+            free(start);
+            return -1;
+        }
+        return 0;
+    }
+
+    static inline void thread_join(thread_t thread) {
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+
+    static inline void thread_sleep_ms(int ms) {
+        Sleep(ms);
+    }
+#else
+    #include <pthread.h>
+    #include <time.h>
+
+    typedef pthread_t thread_t;
+    typedef pthread_mutex_t mutex_t;
+
+    #define mutex_init(m) pthread_mutex_init(m, NULL)
+    #define mutex_lock(m) pthread_mutex_lock(m)
+    #define mutex_unlock(m) pthread_mutex_unlock(m)
+    #define mutex_trylock(m) (pthread_mutex_trylock(m) == 0)
+    #define mutex_destroy(m) pthread_mutex_destroy(m)
+
+    static inline int thread_create(thread_t* thread, thread_func_t func, void* arg) {
+        return pthread_create(thread, NULL, func, arg) == 0 ? 0 : -1;
+    }
+
+    static inline void thread_join(thread_t thread) {
+        pthread_join(thread, NULL);
+    }
+
+    static inline void thread_sleep_ms(int ms) {
+        struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
+    }
+#endif
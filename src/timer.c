@@ -0,0 +1,105 @@
+#include "timer.h"
+#include <stddef.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static void slot_link(TimerNode** head, TimerNode* node) {
+    node->next = *head;
+    if (node->next) {
+        node->next->pprev = &node->next;
+    }
+    node->pprev = head;
+    *head = node;
+}
+
+static void slot_unlink(TimerNode* node) {
+    *node->pprev = node->next;
+    if (node->next) {
+        node->next->pprev = node->pprev;
+    }
+    node->next = NULL;
+    node->pprev = NULL;
+}
+
+// 按到期刻度与当前刻度之差选择层与槽
+static void wheel_place(TimerWheel* wheel, TimerNode* node) {
+    uint64_t expire = node->expire;
+    if (expire < wheel->current) {
+        expire = wheel->current;  // 已过期的放进当前槽，本刻度内触发
+    }
+    uint64_t delta = expire - wheel->current;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t max_delta = (1ULL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > max_delta) {
+        expire = wheel->current + max_delta;  // 超出范围的截断到最高层
+    }
+    int slot = (int)((expire >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK);
+    slot_link(&wheel->slots[level][slot], node);
+}
+
+void timer_wheel_add(TimerWheel* wheel, TimerNode* node, uint64_t now_ms, uint64_t timeout_ms) {
+    if (timer_node_pending(node)) {
+        timer_wheel_cancel(wheel, node);
+    }
+    uint64_t now = now_ms / TIMER_WHEEL_TICK_MS;
+    if (wheel->count == 0) {
+        wheel->current = now;  // 空轮直接对齐当前时间，省去空转
+    }
+    // 向上取整，保证不早于 timeout_ms 到期
+    node->expire = (now_ms + timeout_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    wheel_place(wheel, node);
+    wheel->count++;
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, TimerNode* node) {
+    if (!timer_node_pending(node)) {
+        return;
+    }
+    slot_unlink(node);
+    wheel->count--;
+}
+
+// 把高层某个槽中的定时器按当前刻度重新放置
+static void wheel_cascade(TimerWheel* wheel, int level, int slot) {
+    TimerNode* node = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    while (node) {
+        TimerNode* next = node->next;
+        node->next = NULL;
+        node->pprev = NULL;
+        wheel_place(wheel, node);
+        node = next;
+    }
+}
+
+int timer_wheel_advance(TimerWheel* wheel, uint64_t now_ms, TimerWheelCallback callback, void* arg) {
+    uint64_t target = now_ms / TIMER_WHEEL_TICK_MS;
+    int expired = 0;
+    while (wheel->current <= target) {
+        if (wheel->count == 0) {
+            wheel->current = target + 1;
+            break;
+        }
+        uint64_t tick = wheel->current;
+        // 低层转完一圈时逐级下放
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((tick & ((1ULL << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            wheel_cascade(wheel, level, (int)((tick >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK));
+        }
+        TimerNode** head = &wheel->slots[0][tick & SLOT_MASK];
+        while (*head) {
+            TimerNode* node = *head;
+            slot_unlink(node);
+            wheel->count--;
+            expired++;
+            callback(node, arg);
+        }
+        wheel->current++;
+    }
+    return expired;
+}
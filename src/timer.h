@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+分层时间轮
+    4 层，每层 64 个槽，一个刻度 TIMER_WHEEL_TICK_MS 毫秒。
+    到期时间距当前刻度越远放在越高的层，低层转完一圈时把高层对应槽中的定时器逐级下放；
+    添加与取消都是 O(1)，推进的代价只与经过的刻度数和到期的定时器数有关。
+    节点嵌入在使用方的结构体中，不单独分配内存。
+    槽位链表是以 NULL 结尾的单向链表加 pprev 指针，全零的结构体即为合法的空时间轮。
+*/
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_TICK_MS 100
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef struct TimerNode {
+    struct TimerNode* next;
+    struct TimerNode** pprev;   // 指向前一个节点的 next（或槽头），NULL 表示未挂在轮上
+    uint64_t expire;            // 到期刻度
+} TimerNode;
+
+typedef struct TimerWheel {
+    TimerNode* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t current;           // 已处理到的刻度
+    int count;                  // 挂在轮上的定时器数
+} TimerWheel;
+
+// 到期回调，调用前节点已从时间轮上摘下，回调中可以重新添加
+typedef void (*TimerWheelCallback)(TimerNode* node, void* arg);
+
+// 在 now_ms 之后 timeout_ms 毫秒到期，节点已挂在轮上时先取消
+void timer_wheel_add(TimerWheel* wheel, TimerNode* node, uint64_t now_ms, uint64_t timeout_ms);
+
+// 取消定时器，未挂在轮上时什么也不做
+void timer_wheel_cancel(TimerWheel* wheel, TimerNode* node);
+
+static inline int timer_node_pending(const TimerNode* node) {
+    return node->pprev != 0;
+}
+
+// 推进到 now_ms，对每个到期的定时器调用 callback，返回到期的个数
+int timer_wheel_advance(TimerWheel* wheel, uint64_t now_ms, TimerWheelCallback callback, void* arg);
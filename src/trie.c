@@ -4,273 +4,561 @@
 
 #include "trie.h"
 
-DNSRecord* DNSRecord_create(const char* domain, time_t expire_time, uint8_t type, const void* value) {
-    DNSRecord* record = (DNSRecord*)malloc(sizeof(DNSRecord));
-    int len = strlen(domain);
-    memcpy(record->domain, domain, len);
-    record->domain[len]='\0';
-    record->expire_time = expire_time;
-    record->type = type;
-    if (type == RR_A) {
-        record->value.ipv4 = *(uint32_t*)value;
-    } else if (type == RR_AAAA) {
-        memcpy (record->value.ipv6, (uint8_t*)value, 16);
-    } else if (type == RR_CNAME) {
-        strncpy(record->value.cname, (char*)value, DOMAIN_MAX_LEN - 1);
-    } else {
-        free(record);
-        return NULL;
-    }
-    record->trie_next = NULL;
-    record->trie_prev = NULL;
-    record->lru_next = NULL;
-    record->lru_prev = NULL;
-    return record;
-}
+// 各类节点：TrieNode 头部之后是子节点表，再之后是压缩路径（prefix_len 字节）
+// 关键字节只可能是 [0-9a-z-.]，Node4/16 的 keys 不排序，删除时用最后一项填补
+typedef struct TrieNode4 {
+    TrieNode node;
+    uint8_t keys[4];
+    TrieNode* children[4];
+} TrieNode4;
+
+typedef struct TrieNode16 {
+    TrieNode node;
+    uint8_t keys[16];
+    TrieNode* children[16];
+} TrieNode16;
+
+typedef struct TrieNode48 {
+    TrieNode node;
+    uint8_t index[256];         // 关键字节 -> children 下标 + 1，0 表示没有
+    TrieNode* children[48];
+} TrieNode48;
+
+typedef struct TrieNode256 {
+    TrieNode node;
+    TrieNode* children[256];
+} TrieNode256;
+
+static const size_t node_size[] = {sizeof(TrieNode4), sizeof(TrieNode16), sizeof(TrieNode48), sizeof(TrieNode256)};
+static const int node_capacity[] = {4, 16, 48, 256};
 
-int DNSRecord_compare(const DNSRecord* a, const DNSRecord* b) {
-    if(strcmp(a->domain, b->domain)) return 0;
-    if(a->type != b->type) return 0;
-    if(a->type == RR_A && a->value.ipv4 != b->value.ipv4) return 0;
-    if(a->type == RR_AAAA && memcmp(a->value.ipv6, b->value.ipv6, 16)) return 0;
-    if(a->type == RR_CNAME && strcmp(a->value.cname, b->value.cname)) return 0;
-    return 1;
+#define KEY_MAX (DOMAIN_MAX_LEN + 1)
+
+static inline uint8_t* node_prefix(TrieNode* node) {
+    return (uint8_t*)node + node_size[node->kind];
 }
 
-// 创建Trie树节点
-TrieNode* trie_create() {
-    TrieNode* node = (TrieNode*)malloc(sizeof(TrieNode));
+static TrieNode* node_alloc(uint8_t kind, int prefix_len) {
+    TrieNode* node = (TrieNode*)calloc(1, node_size[kind] + prefix_len);
     if (node == NULL) {
         fprintf(stderr, "Memory allocation failed for TrieNode\n");
         exit(1);
     }
-    for (int i = 0; i < 37; i++) {
-        node->children[i] = NULL;
-    }
-    node->head = NULL;
-    node->tail = NULL;
-    node->isEnd = 0;
-    node->sum = 0;
+    node->kind = kind;
+    node->prefix_len = (uint8_t)prefix_len;
     return node;
 }
 
-// 倒序插入域名和IP到Trie树
-int trie_insert(TrieNode* root, const char* domain, DNSRecord* record) {
+// 把域名转换为键：标签倒序、转小写，每个标签后接 '.'，如 www.example.com -> com.example.www.
+// 同一后缀下的名字共享前缀，名字只落在标签边界上；含不支持的字符返回 -1
+static int make_key(const char* domain, uint8_t* key) {
     int len = strlen(domain);
-    TrieNode* node = root;
-    for (int i = len - 1; i >= 0; i--) {
-        int index = -1; 
-        if (domain[i]>='0' && domain[i]<='9') index = domain[i] - '0';
-        else if(domain[i] >= 'a' && domain[i] <= 'z') {
-            index = domain[i] - 'a' + 10;
-        } else if(domain[i] >= 'A' && domain[i] <= 'Z') {
-            index = domain[i] - 'A' + 10;
-        } else if(domain[i] == '-') {
-            index = 36;
-        } else if(domain[i] == '.') {
-            index = 37;
-        } else {
-            return -1;
+    if (len == 0) {
+        return 0;
+    }
+    if (len + 1 > KEY_MAX) {
+        return -1;
+    }
+    int pos = 0;
+    int end = len;
+    for (int i = len - 1; i >= -1; i--) {
+        if (i >= 0 && domain[i] != '.') {
+            continue;
         }
+        for (int j = i + 1; j < end; j++) {
+            char c = domain[j];
+            if (c >= 'A' && c <= 'Z') {
+                c = c - 'A' + 'a';
+            } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-')) {
+                return -1;
+            }
+            key[pos++] = (uint8_t)c;
+        }
+        key[pos++] = '.';
+        end = i;
+    }
+    return pos;
+}
 
-        if (node->children[index] == NULL) {
-            // 如果当前字符不存在，则创建新节点
-            node->children[index] = trie_create();
+static TrieNode** find_child(TrieNode* node, uint8_t byte) {
+    switch (node->kind) {
+    case TRIE_NODE4: {
+        TrieNode4* n = (TrieNode4*)node;
+        for (int i = 0; i < node->count; i++) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
+            }
         }
-        node = node->children[index];
+        return NULL;
     }
-    if (node->isEnd == 1) {
-        int isExist = 0;
-        DNSRecord* p = node->head;
-        while(p != NULL) {
-            if (DNSRecord_compare(p, record) == 1) {
-                isExist = 1;
-                break;
+    case TRIE_NODE16: {
+        TrieNode16* n = (TrieNode16*)node;
+        for (int i = 0; i < node->count; i++) {
+            if (n->keys[i] == byte) {
+                return &n->children[i];
             }
-            p = p->trie_next;
         }
-        if (isExist == 1) return 0; // 已经存在
+        return NULL;
+    }
+    case TRIE_NODE48: {
+        TrieNode48* n = (TrieNode48*)node;
+        return n->index[byte] ? &n->children[n->index[byte] - 1] : NULL;
+    }
+    default: {
+        TrieNode256* n = (TrieNode256*)node;
+        return n->children[byte] ? &n->children[byte] : NULL;
+    }
+    }
+}
 
-        node->tail->trie_next = record;
-        node->tail->trie_next->trie_next = NULL;
-        node->tail->trie_next->trie_prev = node->tail;
-        node->tail = node->tail->trie_next;
-    } else {
-        node->head = record;
-        node->tail = record;
-        node->head->trie_prev = NULL;
-        node->tail->trie_next = NULL;
-
-        node->isEnd = 1;
-        node->sum ++;
-
-        node = root;
-        for (int i = len - 1; i >= 0; i--) {
-            node->sum++;
-
-            int index = -1; 
-            if (domain[i]>='0' && domain[i]<='9') index = domain[i] - '0';
-            else if(domain[i] >= 'a' && domain[i] <= 'z') {
-                index = domain[i] - 'a' + 10;
-            } else if(domain[i] >= 'A' && domain[i] <= 'Z') {
-                index = domain[i] - 'A' + 10;
-            } else if(domain[i] == '-') {
-                index = 36;
-            } else if(domain[i] == '.') {
-                index = 37;
-            } else {
-                return -1;
+// 依次取出 node 的全部子节点
+static int node_children(TrieNode* node, uint8_t* keys, TrieNode** children) {
+    int count = 0;
+    switch (node->kind) {
+    case TRIE_NODE4:
+        memcpy(keys, ((TrieNode4*)node)->keys, node->count);
+        memcpy(children, ((TrieNode4*)node)->children, node->count * sizeof(TrieNode*));
+        return node->count;
+    case TRIE_NODE16:
+        memcpy(keys, ((TrieNode16*)node)->keys, node->count);
+        memcpy(children, ((TrieNode16*)node)->children, node->count * sizeof(TrieNode*));
+        return node->count;
+    case TRIE_NODE48:
+        for (int b = 0; b < 256; b++) {
+            if (((TrieNode48*)node)->index[b]) {
+                keys[count] = (uint8_t)b;
+                children[count++] = ((TrieNode48*)node)->children[((TrieNode48*)node)->index[b] - 1];
+            }
+        }
+        return count;
+    default:
+        for (int b = 0; b < 256; b++) {
+            if (((TrieNode256*)node)->children[b]) {
+                keys[count] = (uint8_t)b;
+                children[count++] = ((TrieNode256*)node)->children[b];
             }
+        }
+        return count;
+    }
+}
 
-            if (node->children[index] == NULL) {
-                // 如果当前字符不存在，则创建新节点
-                node->children[index] = trie_create();
+// 在未满的节点上加一个子节点
+static void put_child(TrieNode* node, uint8_t byte, TrieNode* child) {
+    switch (node->kind) {
+    case TRIE_NODE4:
+        ((TrieNode4*)node)->keys[node->count] = byte;
+        ((TrieNode4*)node)->children[node->count] = child;
+        break;
+    case TRIE_NODE16:
+        ((TrieNode16*)node)->keys[node->count] = byte;
+        ((TrieNode16*)node)->children[node->count] = child;
+        break;
+    case TRIE_NODE48: {
+        TrieNode48* n = (TrieNode48*)node;
+        int slot = 0;
+        while (n->children[slot] != NULL) {
+            slot++;
+        }
+        n->children[slot] = child;
+        n->index[byte] = (uint8_t)(slot + 1);
+        break;
+    }
+    default:
+        ((TrieNode256*)node)->children[byte] = child;
+        break;
+    }
+    node->count++;
+}
+
+// 换成 kind 类型的节点（扩大或缩小），头部、压缩路径与子节点原样搬过去
+static TrieNode* node_resize(TrieNode* node, uint8_t kind) {
+    uint8_t keys[256];
+    TrieNode* children[256];
+    int count = node_children(node, keys, children);
+    TrieNode* resized = node_alloc(kind, node->prefix_len);
+    resized->head = node->head;
+    resized->tail = node->tail;
+    resized->isEnd = node->isEnd;
+    resized->sum = node->sum;
+    memcpy(node_prefix(resized), node_prefix(node), node->prefix_len);
+    for (int i = 0; i < count; i++) {
+        put_child(resized, keys[i], children[i]);
+    }
+    free(node);
+    return resized;
+}
+
+// 加子节点，满了先换大一号的节点；*ref 是父节点中指向 node 的位置，根节点为 NULL（根是 Node256，不会满）
+static void add_child(TrieNode** ref, TrieNode* node, uint8_t byte, TrieNode* child) {
+    if (node->count == node_capacity[node->kind]) {
+        node = node_resize(node, node->kind + 1);
+        *ref = node;
+    }
+    put_child(node, byte, child);
+}
+
+// 删子节点，子节点数降到下一档的一小部分时换小一号的节点（留出余量避免反复扩缩）
+static void remove_child(TrieNode** ref, TrieNode* node, uint8_t byte) {
+    switch (node->kind) {
+    case TRIE_NODE4:
+    case TRIE_NODE16: {
+        uint8_t* keys = node->kind == TRIE_NODE4 ? ((TrieNode4*)node)->keys : ((TrieNode16*)node)->keys;
+        TrieNode** children = node->kind == TRIE_NODE4 ? ((TrieNode4*)node)->children : ((TrieNode16*)node)->children;
+        for (int i = 0; i < node->count; i++) {
+            if (keys[i] == byte) {
+                keys[i] = keys[node->count - 1];
+                children[i] = children[node->count - 1];
+                children[node->count - 1] = NULL;
+                break;
             }
-            node = node->children[index];
         }
+        break;
+    }
+    case TRIE_NODE48: {
+        TrieNode48* n = (TrieNode48*)node;
+        n->children[n->index[byte] - 1] = NULL;
+        n->index[byte] = 0;
+        break;
+    }
+    default:
+        ((TrieNode256*)node)->children[byte] = NULL;
+        break;
+    }
+    node->count--;
+    if (ref == NULL || node->kind == TRIE_NODE4) {
+        return;
+    }
+    static const int shrink_at[] = {0, 3, 12, 37};
+    if (node->count <= shrink_at[node->kind]) {
+        *ref = node_resize(node, node->kind - 1);
     }
-    return 1; // 插入成功
 }
 
-// 通过域名查找对应的Trie节点
-TrieNode* trie_search(TrieNode* root, const char* domain) {
-    int len = strlen(domain);
+// 没有记录、只剩一个子节点的节点与子节点合并，恢复路径压缩
+static void merge_child(TrieNode** ref, TrieNode* node) {
+    uint8_t byte;
+    TrieNode* child;
+    node_children(node, &byte, &child);
+    int prefix_len = node->prefix_len + 1 + child->prefix_len;
+    child = (TrieNode*)realloc(child, node_size[child->kind] + prefix_len);
+    if (child == NULL) {
+        fprintf(stderr, "Memory allocation failed for TrieNode\n");
+        exit(1);
+    }
+    uint8_t* prefix = node_prefix(child);
+    memmove(prefix + node->prefix_len + 1, prefix, child->prefix_len);
+    memcpy(prefix, node_prefix(node), node->prefix_len);
+    prefix[node->prefix_len] = byte;
+    child->prefix_len = (uint8_t)prefix_len;
+    *ref = child;
+    free(node);
+}
+
+// node 的压缩路径与 key[depth..] 的公共长度
+static int prefix_match(TrieNode* node, const uint8_t* key, int key_len, int depth) {
+    const uint8_t* prefix = node_prefix(node);
+    int limit = node->prefix_len < key_len - depth ? node->prefix_len : key_len - depth;
+    int i = 0;
+    while (i < limit && prefix[i] == key[depth + i]) {
+        i++;
+    }
+    return i;
+}
+
+// 只承载 key[depth..] 剩余部分的叶子
+static TrieNode* leaf_create(const uint8_t* key, int key_len, int depth) {
+    TrieNode* leaf = node_alloc(TRIE_NODE4, key_len - depth);
+    memcpy(node_prefix(leaf), key + depth, key_len - depth);
+    return leaf;
+}
+
+// 创建Trie树的根节点；根固定为 Node256，地址在整个生命周期内不变
+TrieNode* trie_create() {
+    return node_alloc(TRIE_NODE256, 0);
+}
+
+// 找到或建出 key 对应的节点，必要时拆开压缩路径
+static TrieNode* trie_reach(TrieNode* root, const uint8_t* key, int key_len) {
+    TrieNode** ref = NULL;
     TrieNode* node = root;
-    for (int i = len - 1; i >= 0; i--) {
-        int index = -1;
-        if (domain[i]>='0' && domain[i]<='9') index = domain[i] - '0';
-        else if(domain[i] >= 'a' && domain[i] <= 'z') {
-            index = domain[i] - 'a' + 10;
-        } else if(domain[i] >= 'A' && domain[i] <= 'Z') {
-            index = domain[i] - 'A' + 10;
-        } else if(domain[i] == '-') {
-            index = 36;
-        } else if(domain[i] == '.') {
-            index = 37;
-        } else {
-            return NULL;
+    int depth = 0;
+    for (;;) {
+        int matched = prefix_match(node, key, key_len, depth);
+        if (matched < node->prefix_len) {
+            // 在第 matched 个字节处拆开：新的中间节点接管前半段，原节点保留后半段
+            TrieNode* split = node_alloc(TRIE_NODE4, matched);
+            uint8_t* prefix = node_prefix(node);
+            memcpy(node_prefix(split), prefix, matched);
+            split->sum = node->sum;
+            uint8_t byte = prefix[matched];
+            node->prefix_len -= matched + 1;
+            memmove(prefix, prefix + matched + 1, node->prefix_len);
+            put_child(split, byte, node);
+            *ref = split;
+            depth += matched;
+            if (depth == key_len) {
+                return split;
+            }
+            TrieNode* leaf = leaf_create(key, key_len, depth + 1);
+            put_child(split, key[depth], leaf);
+            return leaf;
+        }
+        depth += matched;
+        if (depth == key_len) {
+            return node;
         }
+        TrieNode** child = find_child(node, key[depth]);
+        if (child == NULL) {
+            TrieNode* leaf = leaf_create(key, key_len, depth + 1);
+            add_child(ref, node, key[depth], leaf);
+            return leaf;
+        }
+        ref = child;
+        node = *child;
+        depth++;
+    }
+}
 
-        if (node->children[index] == NULL) {
-            // 如果找不到匹配的域名，返回NULL
+// 沿已有的路径走到 key 对应的节点；path 记下途经节点在父节点中的位置（根为 NULL），
+// edges 记下进入各节点的关键字节
+static TrieNode* trie_walk(TrieNode* root, const uint8_t* key, int key_len, TrieNode*** path, uint8_t* edges,
+                           int* path_len) {
+    TrieNode** ref = NULL;
+    TrieNode* node = root;
+    int depth = 0;
+    int n = 0;
+    for (;;) {
+        if (path != NULL) {
+            path[n] = ref;
+            edges[n] = depth > 0 ? key[depth - 1] : 0;
+            n++;
+        }
+        if (prefix_match(node, key, key_len, depth) < node->prefix_len) {
+            return NULL;
+        }
+        depth += node->prefix_len;
+        if (depth == key_len) {
+            if (path_len != NULL) {
+                *path_len = n;
+            }
+            return node;
+        }
+        ref = find_child(node, key[depth]);
+        if (ref == NULL) {
             return NULL;
         }
-        node = node->children[index];
+        node = *ref;
+        depth++;
     }
-    return node->isEnd ? node : NULL;
 }
 
-void trie_delete(TrieNode* root, const char* domain, const DNSRecord* record) {
-    int len = strlen(domain);
-    TrieNode* node = trie_search(root, domain);
-    if (node == NULL) return ;
-    
-    if (node->isEnd == 0) return ;
-
-    DNSRecord* p = node->head;
-    while(p != NULL) {
-        if (DNSRecord_compare(p, record) == 1) {
-            if (p->trie_prev == NULL) {
-                node->head = p->trie_next;
-            } else {
-                p->trie_prev->trie_next = p->trie_next;
-            }
-            if (p->trie_next == NULL) {
-                node->tail = p->trie_prev;
-            } else {
-                p->trie_next->trie_prev = p->trie_prev;
+// 插入记录（键为域名倒序的标签）
+int trie_insert(TrieNode* root, const char* domain, const RecordArena* records, RecordRef ref) {
+    CacheRecord* record = record_at(records, ref);
+    uint8_t key[KEY_MAX];
+    int key_len = make_key(domain, key);
+    if (key_len < 0) {
+        return -1;
+    }
+    TrieNode* node = trie_reach(root, key, key_len);
+    if (node->isEnd == 1) {
+        for (RecordRef p = node->head; p != RECORD_NIL; p = record_at(records, p)->next) {
+            if (p == ref) {
+                return 0; // 已经存在
             }
-            break;
         }
-        p = p->trie_next;
+
+        record_at(records, node->tail)->next = ref;
+        record->next = RECORD_NIL;
+        record->prev = node->tail;
+        node->tail = ref;
+        return 1;
+    }
+
+    node->head = ref;
+    node->tail = ref;
+    record->prev = RECORD_NIL;
+    record->next = RECORD_NIL;
+    node->isEnd = 1;
+
+    // 路径上每个节点（含根和该节点）的有效域名数加一
+    TrieNode** path[KEY_MAX + 1];
+    uint8_t edges[KEY_MAX + 1];
+    int path_len = 0;
+    trie_walk(root, key, key_len, path, edges, &path_len);
+    root->sum++;
+    for (int i = 1; i < path_len; i++) {
+        (*path[i])->sum++;
+    }
+    return 1; // 插入成功
+}
+
+// 通过域名查找对应的Trie节点
+TrieNode* trie_search(TrieNode* root, const char* domain) {
+    uint8_t key[KEY_MAX];
+    int key_len = make_key(domain, key);
+    if (key_len < 0) {
+        return NULL;
+    }
+    TrieNode* node = trie_walk(root, key, key_len, NULL, NULL, NULL);
+    return node != NULL && node->isEnd ? node : NULL;
+}
+
+void trie_delete(TrieNode* root, const char* domain, const RecordArena* records, RecordRef ref) {
+    CacheRecord* record = record_at(records, ref);
+    uint8_t key[KEY_MAX];
+    int key_len = make_key(domain, key);
+    if (key_len < 0) {
+        return;
+    }
+    TrieNode** path[KEY_MAX + 1];
+    uint8_t edges[KEY_MAX + 1];
+    int path_len = 0;
+    TrieNode* node = trie_walk(root, key, key_len, path, edges, &path_len);
+    if (node == NULL || node->isEnd == 0) {
+        return;
     }
 
-    if (node->head != NULL) { // 无需删除这个域名的节点
+    RecordRef p = node->head;
+    while (p != RECORD_NIL && p != ref) {
+        p = record_at(records, p)->next;
+    }
+    if (p == RECORD_NIL) {
+        return;
+    }
+    if (record->prev == RECORD_NIL) {
+        node->head = record->next;
+    } else {
+        record_at(records, record->prev)->next = record->next;
+    }
+    if (record->next == RECORD_NIL) {
+        node->tail = record->prev;
+    } else {
+        record_at(records, record->next)->prev = record->prev;
+    }
+    record->prev = RECORD_NIL;
+
+    if (node->head != RECORD_NIL) { // 无需删除这个域名的节点
         return ;
     }
 
     node->isEnd = 0;
+    root->sum--;
+    for (int i = 1; i < path_len; i++) {
+        (*path[i])->sum--;
+    }
+    if (node == root) {
+        return;
+    }
 
-    node = root;
-    node->sum--;
-    for (int i = len - 1; i >= 0; i--) {
-        int index = -1; 
-        if (domain[i]>='0' && domain[i]<='9') index = domain[i] - '0';
-        else if(domain[i] >= 'a' && domain[i] <= 'z') {
-            index = domain[i] - 'a' + 10;
-        } else if(domain[i] >= 'A' && domain[i] <= 'Z') {
-            index = domain[i] - 'A' + 10;
-        } else if(domain[i] == '-') {
-            index = 36;
-        } else if(domain[i] == '.') {
-            index = 37;
-        } else {
-            return;
-        }
-
-        if (node->children[index]->sum == 1) {
-            free(node->children[index]);
-            node->children[index] = NULL;
-            return ;
+    // 不再承载域名的节点：没有子节点就摘掉，只有一个子节点就与它合并；
+    // 摘掉之后父节点也可能只剩一个子节点，同样合并
+    if (node->count == 1) {
+        merge_child(path[path_len - 1], node);
+    } else if (node->count == 0) {
+        TrieNode** parent_ref = path[path_len - 2];
+        TrieNode* parent = parent_ref != NULL ? *parent_ref : root;
+        remove_child(parent_ref, parent, edges[path_len - 1]);
+        free(node);
+        if (parent_ref != NULL) {
+            parent = *parent_ref;   // remove_child 可能换了更小的节点
+            if (!parent->isEnd && parent->count == 1) {
+                merge_child(parent_ref, parent);
+            }
         }
-        node = node->children[index];
-        node->sum--;
     }
 }
 
+void trie_replace(TrieNode* root, const char* domain, const RecordArena* records, RecordRef old_ref, RecordRef ref) {
+    CacheRecord* old = record_at(records, old_ref);
+    CacheRecord* record = record_at(records, ref);
+    TrieNode* node = trie_search(root, domain);
+    if (node == NULL) {
+        return;
+    }
+    record->prev = old->prev;
+    record->next = old->next;
+    if (old->prev == RECORD_NIL) {
+        node->head = ref;
+    } else {
+        record_at(records, old->prev)->next = ref;
+    }
+    if (old->next == RECORD_NIL) {
+        node->tail = ref;
+    } else {
+        record_at(records, old->next)->prev = ref;
+    }
+    old->prev = RECORD_NIL;
+    old->next = RECORD_NIL;
+}
 
 // 清理Trie树释放内存
 void trie_free(TrieNode* root) {
     if (root == NULL) return;
-    
-    for (int i = 0; i < 37; i++) {
-        if (root->children[i] != NULL) {
-            trie_free(root->children[i]); // 递归清理子节点
-            root->children[i] = NULL;
-        }
+
+    uint8_t keys[256];
+    TrieNode* children[256];
+    int count = node_children(root, keys, children);
+    for (int i = 0; i < count; i++) {
+        trie_free(children[i]); // 递归清理子节点
     }
     // 释放当前节点
     free(root);
 }
 
+size_t trie_memory(TrieNode* root, size_t* nodes) {
+    uint8_t keys[256];
+    TrieNode* children[256];
+    int count = node_children(root, keys, children);
+    size_t bytes = node_size[root->kind] + root->prefix_len;
+    (*nodes)++;
+    for (int i = 0; i < count; i++) {
+        bytes += trie_memory(children[i], nodes);
+    }
+    return bytes;
+}
+
 // 输出路径上的信息
-void trie_print(TrieNode* root, const char* domain) {
-    int len = strlen(domain);
+void trie_print(TrieNode* root, const RecordArena* records, const NameTable* names, const char* domain) {
+    uint8_t key[KEY_MAX];
+    int key_len = make_key(domain, key);
+    if (key_len < 0) {
+        return;
+    }
     TrieNode* node = root;
-    for (int i = len - 1; i >= 0; i--) {
-        int index = -1;
-        if (domain[i]>='0' && domain[i]<='9') index = domain[i] - '0';
-        else if(domain[i] >= 'a' && domain[i] <= 'z') {
-            index = domain[i] - 'a' + 10;
-        } else if(domain[i] >= 'A' && domain[i] <= 'Z') {
-            index = domain[i] - 'A' + 10;
-        } else if(domain[i] == '-') {
-            index = 36;
-        } else if(domain[i] == '.') {
-            index = 37;
-        } else {
+    int depth = 0;
+    for (;;) {
+        printf("prefix=%.*s,node%d,count=%d,sum=%d,isEnd=%d\n", node->prefix_len, (const char*)node_prefix(node),
+               node_capacity[node->kind], node->count, node->sum, node->isEnd);
+        if (prefix_match(node, key, key_len, depth) < node->prefix_len) {
             return;
         }
-
-        if (node->children[index] == NULL) {
-            return ;
+        depth += node->prefix_len;
+        if (depth == key_len) {
+            break;
         }
-        node = node->children[index];
-
-        printf("domain[i]=%c,sum=%d,isEnd=%d\n", domain[i], node->sum, node->isEnd);
+        TrieNode** child = find_child(node, key[depth]);
+        if (child == NULL) {
+            return;
+        }
+        printf("key[%d]=%c\n", depth, key[depth]);
+        node = *child;
+        depth++;
     }
-    DNSRecord* p = node->head;
-    while(p != NULL) {
-        if (p->type == RR_A) {
-            printf("A: %u\n", p->value.ipv4);
-        } else if (p->type == RR_AAAA) {
+    for (RecordRef ref = node->head; ref != RECORD_NIL; ref = record_at(records, ref)->next) {
+        DNSRecord p;
+        record_unpack(record_at(records, ref), names, &p);
+        if (p.type == RR_A) {
+            printf("A: %u\n", p.value.ipv4);
+        } else if (p.type == RR_AAAA) {
             printf("AAAA: ");
             for (int i = 0; i < 16; i++) 
-                printf("%u", p->value.ipv6[i]);
+                printf("%u", p.value.ipv6[i]);
             putchar('\n');
-        } else if (p->type == RR_CNAME) {
-            printf("CNAME: %s\n", p->value.cname);
+        } else if (p.type == RR_CNAME) {
+            printf("CNAME: %s\n", p.value.cname);
+        } else if (p.type == RR_NEGATIVE) {
+            printf("NEGATIVE: rcode %u, qtype %u\n", p.value.negative.rcode, p.value.negative.qtype);
         }
-        p = p->trie_next;
     }
-}
\ No newline at end of file
+}
@@ -6,53 +6,55 @@
 #include <string.h>
 #include <stdint.h>
 #include "dnsStruct.h"
-
-// DNS记录结构
-typedef struct DNSRecord {
-    char domain[DOMAIN_MAX_LEN];
-    time_t expire_time;
-    uint8_t type;
-    union {
-        uint32_t ipv4;              // IPv4 地址
-        uint8_t ipv6[16];           // IPv6 地址
-        char cname[DOMAIN_MAX_LEN]; // CNAME记录
-    } value;
-
-    struct DNSRecord* trie_next; // 同域名的下一个记录
-    struct DNSRecord* trie_prev; // 同域名的上一个记录
-    struct DNSRecord* lru_next; // LRU链表的下一个节点
-    struct DNSRecord* lru_prev; // LRU链表的上一个节点
-} DNSRecord;
-
-DNSRecord* DNSRecord_create(const char* domain, time_t expire_time, uint8_t type, const void* value);
-
-int DNSRecord_compare(const DNSRecord* a, const DNSRecord* b);
-
-// Trie树的节点结构
+#include "record.h"
+
+/*
+Trie树：以标签为单位的压缩基数树（ART）
+    键是倒序、转小写的标签序列，每个标签后接 '.'，如 www.example.com -> com.example.www.，
+    同一后缀下的名字共享路径。只有一个子节点的路径压缩进节点的 prefix，
+    查找只在分叉处跳一次节点，而不是每个字符一次。
+    节点按子节点数选用 Node4/16/48/256 四种大小，下面的 TrieNode 是各类节点共同的头部，
+    其后是子节点表和压缩路径。增删子节点时节点可能换大小、换地址，
+    因此 trie_search 返回的节点只在下一次 trie_insert/trie_delete 之前有效；根节点地址不变。
+    节点上挂的是 records 中的紧凑记录（见 record.h），沿 CacheRecord.next 相连；
+    记录只保存名字的 NameId，增删时由调用方给出域名。
+*/
+
+enum { TRIE_NODE4, TRIE_NODE16, TRIE_NODE48, TRIE_NODE256 };
+
+// Trie树的节点结构（各类节点的公共头部）
 typedef struct TrieNode {
-    struct TrieNode* children[38];  // 0-9, a-z, -, .
-    DNSRecord* head;                // 域名对应的DNS记录链表头指针
-    DNSRecord* tail;                // 域名对应的DNS记录链表尾指针
+    RecordRef head;                 // 域名对应的DNS记录链表头
+    RecordRef tail;                 // 域名对应的DNS记录链表尾
     int isEnd;                      // 是否是域名字符串的末端
-    int sum;                        // 包含的有效域名数
+    int sum;                        // 子树（含本节点）包含的有效域名数
+    uint8_t kind;                   // TRIE_NODE*
+    uint8_t prefix_len;             // 压缩路径的字节数
+    uint16_t count;                 // 子节点数
 } TrieNode;
 
-// 创建一个新的Trie树节点
+// 创建Trie树的根节点
 TrieNode* trie_create();
 
-// 插入域名和IP到Trie树
-int trie_insert(TrieNode* root, const char* domain, DNSRecord* record);
+// 插入到 domain 的记录链表尾部；记录已在链表中返回 0，域名含不支持的字符返回 -1
+int trie_insert(TrieNode* root, const char* domain, const RecordArena* records, RecordRef record);
 
 // 通过域名查找对应的节点
 TrieNode* trie_search(TrieNode* root, const char* domain);
 
-// 在Trie树中删除域名
-void trie_delete(TrieNode* root, const char* domain, const DNSRecord* record);
+// 从域名的记录链表中摘下 record，链表为空时删除域名
+void trie_delete(TrieNode* root, const char* domain, const RecordArena* records, RecordRef record);
+
+// 用 record 原位替换域名记录链表中的 old，树的结构不变
+void trie_replace(TrieNode* root, const char* domain, const RecordArena* records, RecordRef old, RecordRef record);
 
 // 清理Trie树释放内存
 void trie_free(TrieNode* root);
 
+// 统计树占用的内存字节数与节点数（累加到 *nodes）
+size_t trie_memory(TrieNode* root, size_t* nodes);
+
 // 输出路径上的节点信息
-void trie_print(TrieNode* root, const char* domain);
+void trie_print(TrieNode* root, const RecordArena* records, const NameTable* names, const char* domain);
 
 #endif // TRIE_H
\ No newline at end of file
@@ -0,0 +1,514 @@
+#include "uring.h"
+#include "server.h"
+
+IOBackend io_backend = IO_BACKEND_EPOLL;
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #ifdef IORING_RECV_MULTISHOT
+            #define URING_SUPPORTED 1
+        #endif
+    #endif
+#endif
+
+#ifdef URING_SUPPORTED
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define URING_SQ_ENTRIES 1024
+#define URING_CQ_ENTRIES 8192
+#define URING_BUF_COUNT 1024    // 每个缓冲区环的缓冲区数，必须是 2 的幂
+#define URING_SEND_SLOTS 1024   // 同时在途的 sendmsg 数
+// 缓冲区布局：recvmsg_out 头 + 来源地址 + 数据报，数据报之后留足 BUFFER_SIZE 供原地构造回复
+#define URING_BUF_SIZE (sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + BUFFER_SIZE)
+
+#define URING_BGID_CLIENT 0
+#define URING_BGID_SERVER 1
+
+// user_data 的高 8 位为类型，低 32 位为序号
+enum { TAG_RECV_CLIENT = 1, TAG_RECV_SERVER, TAG_SEND, TAG_POLL };
+#define MAKE_TAG(kind, index) (((uint64_t)(kind) << 56) | (uint64_t)(index))
+#define TAG_KIND(user_data) ((int)((user_data) >> 56))
+#define TAG_INDEX(user_data) ((uint32_t)((user_data) & 0xFFFFFFFF))
+
+// 提供给内核的接收缓冲区环
+typedef struct UringBufRing {
+    struct io_uring_buf_ring* ring;
+    size_t ring_size;
+    char* bufs;
+    uint16_t tail;      // 本地尾指针，每轮处理完统一发布
+} UringBufRing;
+
+// 在途 sendmsg 的缓冲区，收到对应 CQE 后才能复用
+typedef struct UringSendSlot {
+    DNSPacket pkt;
+    struct msghdr msg;
+    struct iovec iov;
+    BatchStats* stats;  // 发送失败时计入所属批次
+    int next_free;
+} UringSendSlot;
+
+// 暂存的完成事件
+typedef struct UringCqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+} UringCqe;
+
+typedef struct Uring {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe* sqes;
+    unsigned sq_pending;        // 已填写但尚未提交的 SQE 数
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+
+    UringBufRing br[2];         // 客户端与上游各一个缓冲区环
+    struct msghdr recv_msg;     // multishot recvmsg 模板，只使用 msg_namelen
+    UringSendSlot* send_slots;
+    int send_free;              // 空闲发送槽位链表头，-1 表示用尽
+
+    UringCqe* backlog;          // 收割到但尚未处理的完成事件
+    int backlog_count;
+    int backlog_capacity;
+
+    DNSWorker* w;
+} Uring;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// 提交已填写的 SQE，min_complete > 0 时同时等待完成事件
+static void uring_enter(Uring* u, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    if (u->sq_pending == 0 && min_complete == 0) {
+        return;
+    }
+    int ret = sys_io_uring_enter(u->fd, u->sq_pending, min_complete, flags);
+    if (ret < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("io_uring_enter failed");
+        }
+        return;
+    }
+    u->sq_pending -= (unsigned)ret < u->sq_pending ? (unsigned)ret : u->sq_pending;
+}
+
+static void backlog_push(Uring* u, const struct io_uring_cqe* cqe) {
+    if (u->backlog_count == u->backlog_capacity) {
+        int capacity = u->backlog_capacity ? u->backlog_capacity * 2 : 256;
+        UringCqe* backlog = (UringCqe*)realloc(u->backlog, capacity * sizeof(UringCqe));
+        if (backlog == NULL) {
+            return;
+        }
+        u->backlog = backlog;
+        u->backlog_capacity = capacity;
+    }
+    UringCqe* entry = &u->backlog[u->backlog_count++];
+    entry->user_data = cqe->user_data;
+    entry->res = cqe->res;
+    entry->flags = cqe->flags;
+}
+
+// 收割完成队列：发送完成直接回收槽位，其余事件放入 backlog 由主循环处理
+static void uring_reap(Uring* u) {
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &u->cqes[head & *u->cq_mask];
+        if (TAG_KIND(cqe->user_data) == TAG_SEND) {
+            UringSendSlot* slot = &u->send_slots[TAG_INDEX(cqe->user_data)];
+            if (cqe->res < 0) {
+                slot->stats->dropped++;
+            }
+            slot->next_free = u->send_free;
+            u->send_free = TAG_INDEX(cqe->user_data);
+        } else {
+            backlog_push(u, cqe);
+        }
+        head++;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static struct io_uring_sqe* uring_get_sqe(Uring* u) {
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *u->sq_tail;
+    if (tail - head >= u->sq_entries) {
+        // 提交队列已满，先交给内核
+        uring_enter(u, 0);
+        head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= u->sq_entries) {
+            return NULL;
+        }
+    }
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe* sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    return sqe;
+}
+
+// 发布一个填写好的 SQE，等下次 uring_enter 一并提交
+static void uring_commit_sqe(Uring* u) {
+    __atomic_store_n(u->sq_tail, *u->sq_tail + 1, __ATOMIC_RELEASE);
+    u->sq_pending++;
+}
+
+static void bufring_add(UringBufRing* br, int bid) {
+    struct io_uring_buf* buf = &br->ring->bufs[br->tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(br->bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    br->tail++;
+}
+
+static void bufring_publish(UringBufRing* br) {
+    __atomic_store_n(&br->ring->tail, br->tail, __ATOMIC_RELEASE);
+}
+
+static int bufring_init(Uring* u, UringBufRing* br, int bgid) {
+    br->ring_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    br->ring = (struct io_uring_buf_ring*)mmap(NULL, br->ring_size, PROT_READ | PROT_WRITE,
+                                               MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (br->ring == MAP_FAILED) {
+        br->ring = NULL;
+        return -1;
+    }
+    br->bufs = (char*)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (br->bufs == NULL) {
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)br->ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = bgid;
+    if (sys_io_uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+
+    br->tail = 0;
+    for (int i = 0; i < URING_BUF_COUNT; i++) {
+        bufring_add(br, i);
+    }
+    bufring_publish(br);
+    return 0;
+}
+
+static void uring_destroy(Uring* u) {
+    if (u->fd >= 0) {
+        close(u->fd);  // 关闭即取消全部在途请求
+    }
+    for (int i = 0; i < 2; i++) {
+        if (u->br[i].ring) munmap(u->br[i].ring, u->br[i].ring_size);
+        free(u->br[i].bufs);
+    }
+    if (u->sqes) munmap(u->sqes, u->sqes_len);
+    if (u->cq_ptr && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+    if (u->sq_ptr) munmap(u->sq_ptr, u->sq_len);
+    free(u->send_slots);
+    free(u->backlog);
+}
+
+static int uring_init(Uring* u, DNSWorker* w) {
+    memset(u, 0, sizeof(*u));
+    u->fd = -1;
+    u->w = w;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+    u->fd = sys_io_uring_setup(URING_SQ_ENTRIES, &params);
+    if (u->fd < 0) {
+        return -1;
+    }
+
+    u->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_len > u->sq_len) u->sq_len = u->cq_len;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        u->sq_ptr = NULL;
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) {
+            u->cq_ptr = NULL;
+            return -1;
+        }
+    }
+    u->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe*)mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        return -1;
+    }
+
+    char* sq = (char*)u->sq_ptr;
+    u->sq_head = (unsigned*)(sq + params.sq_off.head);
+    u->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    u->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    u->sq_array = (unsigned*)(sq + params.sq_off.array);
+    u->sq_entries = params.sq_entries;
+    char* cq = (char*)u->cq_ptr;
+    u->cq_head = (unsigned*)(cq + params.cq_off.head);
+    u->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    u->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // 内核 5.19 起才支持缓冲区环
+    if (bufring_init(u, &u->br[URING_BGID_CLIENT], URING_BGID_CLIENT) != 0 ||
+        bufring_init(u, &u->br[URING_BGID_SERVER], URING_BGID_SERVER) != 0) {
+        return -1;
+    }
+
+    u->send_slots = (UringSendSlot*)calloc(URING_SEND_SLOTS, sizeof(UringSendSlot));
+    if (u->send_slots == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < URING_SEND_SLOTS; i++) {
+        u->send_slots[i].next_free = i + 1 < URING_SEND_SLOTS ? i + 1 : -1;
+    }
+    u->send_free = 0;
+
+    memset(&u->recv_msg, 0, sizeof(u->recv_msg));
+    u->recv_msg.msg_namelen = sizeof(struct sockaddr_in);
+    return 0;
+}
+
+// index 为上游 socket 序号，客户端 socket 忽略
+static void uring_arm_recv(Uring* u, int kind, int index) {
+    struct io_uring_sqe* sqe = uring_get_sqe(u);
+    if (sqe == NULL) return;
+    int client = kind == TAG_RECV_CLIENT;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = client ? u->w->client_socket : u->w->upstreams[index].sock;
+    sqe->addr = (uint64_t)(uintptr_t)&u->recv_msg;
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = client ? URING_BGID_CLIENT : URING_BGID_SERVER;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = MAKE_TAG(kind, index);
+    uring_commit_sqe(u);
+}
+
+// 监视事件循环的 epoll fd，定时器等到期时由它转发
+static void uring_arm_poll(Uring* u) {
+    struct io_uring_sqe* sqe = uring_get_sqe(u);
+    if (sqe == NULL) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = u->w->loop->epoll_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = MAKE_TAG(TAG_POLL, 0);
+    uring_commit_sqe(u);
+}
+
+// 发送批次的钩子：复制进在途槽位并填写 sendmsg SQE，随下一次 io_uring_enter 提交
+static int uring_flush(DNSBatch* batch, void* ctx) {
+    Uring* u = (Uring*)ctx;
+    for (int i = 0; i < batch->count; i++) {
+        while (u->send_free < 0) {
+            // 槽位用尽：提交并等待已有发送完成
+            uring_enter(u, 1);
+            uring_reap(u);
+        }
+        struct io_uring_sqe* sqe = uring_get_sqe(u);
+        if (sqe == NULL) {
+            batch->stats.dropped++;
+            continue;
+        }
+        int index = u->send_free;
+        UringSendSlot* slot = &u->send_slots[index];
+        u->send_free = slot->next_free;
+
+        DNSPacket* pkt = &batch->slots[i];
+        memcpy(slot->pkt.data, pkt->data, pkt->len);
+        slot->pkt.len = pkt->len;
+        slot->pkt.addr = pkt->addr;
+        slot->stats = &batch->stats;
+        slot->iov.iov_base = slot->pkt.data;
+        slot->iov.iov_len = pkt->len;
+        memset(&slot->msg, 0, sizeof(slot->msg));
+        slot->msg.msg_name = &slot->pkt.addr;
+        slot->msg.msg_namelen = sizeof(slot->pkt.addr);
+        slot->msg.msg_iov = &slot->iov;
+        slot->msg.msg_iovlen = 1;
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = batch->sock;
+        sqe->addr = (uint64_t)(uintptr_t)&slot->msg;
+        sqe->len = 1;
+        sqe->user_data = MAKE_TAG(TAG_SEND, index);
+        uring_commit_sqe(u);
+    }
+    return batch->count;
+}
+
+// 处理一个 recvmsg 完成事件，返回是否收到数据报
+static int uring_handle_recv(Uring* u, const UringCqe* cqe, int client, int index) {
+    if (cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER)) {
+        if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+            LOG_ERROR("io_uring recvmsg failed: %d\n", -cqe->res);
+        }
+        return 0;
+    }
+    UringBufRing* br = &u->br[client ? URING_BGID_CLIENT : URING_BGID_SERVER];
+    int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    char* buf = br->bufs + (size_t)bid * URING_BUF_SIZE;
+    struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)buf;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    memcpy(&addr, buf + sizeof(*out), out->namelen < sizeof(addr) ? out->namelen : sizeof(addr));
+
+    size_t header = sizeof(*out) + u->recv_msg.msg_namelen + u->recv_msg.msg_controllen;
+    int len = (int)out->payloadlen;
+    if ((size_t)cqe->res < header) {
+        len = 0;
+    } else if (len > cqe->res - (int)header) {
+        len = cqe->res - (int)header;  // 被截断的数据报只取实际写入的部分
+    }
+    if (len > 0) {
+        if (client) {
+            receiveClient(u->w, buf + header, len, &addr);
+        } else {
+            receiveServer(&u->w->upstreams[index], buf + header, len);
+        }
+    }
+    bufring_add(br, bid);
+    return 1;
+}
+
+// 让所有发送批次经由 io_uring 发出，u 为 NULL 时恢复默认发送方式
+static void uring_set_hooks(DNSWorker* w, Uring* u) {
+    BatchFlushHook hook = u ? uring_flush : NULL;
+    w->client_tx->flush_hook = hook;
+    w->client_tx->flush_ctx = u;
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        w->upstreams[i].tx->flush_hook = hook;
+        w->upstreams[i].tx->flush_ctx = u;
+    }
+}
+
+int uring_worker_run(DNSWorker* w) {
+    Uring u;
+    if (uring_init(&u, w) != 0) {
+        LOG_INFO("io_uring setup failed: %d\n", errno);
+        uring_destroy(&u);
+        return -1;
+    }
+
+    uring_set_hooks(w, &u);
+    uring_arm_recv(&u, TAG_RECV_CLIENT, 0);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        uring_arm_recv(&u, TAG_RECV_SERVER, i);
+    }
+    uring_arm_poll(&u);
+    uring_enter(&u, 0);
+
+    // 不支持 multishot recvmsg 的内核会立即以 -EINVAL 完成
+    uring_reap(&u);
+    for (int i = 0; i < u.backlog_count; i++) {
+        int kind = TAG_KIND(u.backlog[i].user_data);
+        if ((kind == TAG_RECV_CLIENT || kind == TAG_RECV_SERVER) &&
+            (u.backlog[i].res == -EINVAL || u.backlog[i].res == -EOPNOTSUPP)) {
+            LOG_INFO("io_uring multishot recvmsg unsupported\n");
+            uring_set_hooks(w, NULL);
+            uring_destroy(&u);
+            return -1;
+        }
+    }
+
+    printf("Worker %d using io_uring backend\n", w->id);
+    w->loop->running = 1;
+    while (w->loop->running) {
+        // 一次系统调用同时提交上一轮的发送与重新挂载，并等待新的完成事件
+        uring_enter(&u, u.backlog_count ? 0 : 1);
+        uring_reap(&u);
+
+        int client_packets = 0;
+        int server_packets[UPSTREAM_SOCKETS] = {0};
+        int rearm_client = 0, rearm_poll = 0;
+        unsigned rearm_server = 0;  // 按上游 socket 序号的位图
+        // 处理过程中发送钩子可能继续收割，backlog 会增长，因此按下标遍历并按值取出
+        for (int i = 0; i < u.backlog_count; i++) {
+            UringCqe cqe = u.backlog[i];
+            int more = cqe.flags & IORING_CQE_F_MORE;
+            switch (TAG_KIND(cqe.user_data)) {
+            case TAG_RECV_CLIENT:
+                client_packets += uring_handle_recv(&u, &cqe, 1, 0);
+                if (!more) rearm_client = 1;
+                break;
+            case TAG_RECV_SERVER: {
+                int index = (int)TAG_INDEX(cqe.user_data);
+                server_packets[index] += uring_handle_recv(&u, &cqe, 0, index);
+                if (!more) rearm_server |= 1u << index;
+                break;
+            }
+            case TAG_POLL:
+                event_loop_run_once(w->loop, 0);
+                if (!more) rearm_poll = 1;
+                break;
+            default:
+                break;
+            }
+        }
+        u.backlog_count = 0;
+
+        if (client_packets) batch_stats_add(&w->client_rx->stats, client_packets);
+        for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+            if (server_packets[i]) batch_stats_add(&w->upstreams[i].rx->stats, server_packets[i]);
+        }
+
+        // 归还本轮用完的缓冲区
+        bufring_publish(&u.br[URING_BGID_CLIENT]);
+        bufring_publish(&u.br[URING_BGID_SERVER]);
+        worker_flush(w);
+
+        // multishot 请求因缓冲区耗尽等原因结束后重新挂载
+        if (rearm_client) uring_arm_recv(&u, TAG_RECV_CLIENT, 0);
+        for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+            if (rearm_server & (1u << i)) uring_arm_recv(&u, TAG_RECV_SERVER, i);
+        }
+        if (rearm_poll) uring_arm_poll(&u);
+    }
+
+    uring_set_hooks(w, NULL);
+    uring_destroy(&u);
+    return 0;
+}
+
+#else
+
+int uring_worker_run(struct DNSWorker* w) {
+    (void)w;
+    return -1;  // 当前平台不支持 io_uring
+}
+
+#endif
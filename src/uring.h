@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+io_uring 收发后端（仅 Linux，直接使用系统调用，不依赖 liburing）
+    在客户端与上游 socket 上各挂一个常驻的 multishot recvmsg，
+    数据报由内核直接写入提供缓冲区环（provided buffer ring）中的缓冲区；
+    回复与转发以 sendmsg SQE 的形式攒起来，与下一次等待合并为一次 io_uring_enter。
+    事件循环中的定时器等其他描述符通过对 epoll fd 的 multishot poll 接入。
+    内核不支持（无 io_uring、无缓冲区环或 multishot recvmsg）时返回 -1，
+    由调用方退回 epoll 路径。
+*/
+
+struct DNSWorker;
+
+typedef enum {
+    IO_BACKEND_EPOLL = 0,  // 事件循环 + recvmmsg/sendmmsg（非 Linux 为 poll）
+    IO_BACKEND_URING = 1   // io_uring
+} IOBackend;
+
+extern IOBackend io_backend; // 由命令行 -io 配置
+
+// 以 io_uring 运行工作线程，正常情况下不返回；初始化失败时返回 -1
+int uring_worker_run(struct DNSWorker* w);
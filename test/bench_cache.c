@@ -0,0 +1,201 @@
+/*
+记录缓存读基准：
+    先单线程比较两种命中路径：cache_query 把记录解码到 arena，cache_query_views 只返回借用的记录；
+    Linux 下用链接器包装 malloc/calloc/realloc，统计每次命中的堆分配次数。
+    再让 1、2、4… 个线程同时查询命中的名字（借用视图），另有一个线程持续写入上游应答（刷新与淘汰）
+gcc -O2 -I src -DBENCH_COUNT_ALLOCS -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc src/cache.c src/sketch.c src/hashindex.c src/trie.c src/record.c src/names.c src/epoch.c src/arena.c src/log.c src/dnsStruct.c test/bench_cache.c -o test/bench_cache -lpthread
+用法：bench_cache [最多线程数]
+*/
+
+#include "../src/cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NAMES 20000
+#define DURATION_MS 1000
+#define PATH_LOOKUPS 4000000
+
+static volatile int running;
+static int writer_on;
+static char names[NAMES][32];
+
+#ifdef BENCH_COUNT_ALLOCS
+// 所有线程的堆分配次数
+static uint64_t allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct Reader {
+    thread_t thread;
+    int id;
+    uint64_t lookups;
+    char pad[64];
+} Reader;
+
+static inline uint32_t next_random(uint32_t x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// 与应答路径相同：在纪元临界区内取得借用视图，用完即离开
+static void* reader_run(void* arg) {
+    Reader* reader = (Reader*)arg;
+    CacheView views[CACHE_MAX_ANSWERS];
+    uint32_t x = 2463534242u + (uint32_t)reader->id * 7919u;
+    uint64_t lookups = 0;
+    while (__atomic_load_n(&running, __ATOMIC_RELAXED)) {
+        for (int i = 0; i < 256; i++) {
+            x = next_random(x);
+            epoch_enter();
+            cache_query_views(dns_cache, names[x % NAMES], RR_A, views, CACHE_MAX_ANSWERS);
+            epoch_exit();
+        }
+        lookups += 256;
+    }
+    reader->lookups = lookups;
+    return NULL;
+}
+
+static void report_path(const char* name, double seconds, uint64_t hits, uint64_t allocs) {
+    printf("  %-6s %10.0f lookups/s  %4.0f ns/hit", name, PATH_LOOKUPS / seconds, seconds * 1e9 / PATH_LOOKUPS);
+#ifdef BENCH_COUNT_ALLOCS
+    printf("  %.4f heap allocations/hit", (double)allocs / PATH_LOOKUPS);
+#else
+    (void)allocs;
+#endif
+    printf("%s\n", hits == PATH_LOOKUPS ? "" : "  (some lookups missed)");
+}
+
+static uint64_t allocation_count(void) {
+#ifdef BENCH_COUNT_ALLOCS
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+#else
+    return 0;
+#endif
+}
+
+// 单线程、没有写者，比较复制与借用两种命中路径
+static void compare_paths(void) {
+    printf("hit path, one thread, no writer\n");
+    Arena arena;
+    arena_init(&arena, 0);
+    uint32_t x = 2463534242u;
+    uint64_t hits = 0;
+    uint64_t allocs = allocation_count();
+    double start = now_sec();
+    for (int i = 0; i < PATH_LOOKUPS; i++) {
+        x = next_random(x);
+        hits += cache_query(dns_cache, &arena, names[x % NAMES], RR_A) != NULL;
+        if (i % 256 == 255) {
+            arena_reset(&arena);
+        }
+    }
+    report_path("copy", now_sec() - start, hits, allocation_count() - allocs);
+    arena_destroy(&arena);
+
+    CacheView views[CACHE_MAX_ANSWERS];
+    x = 2463534242u;
+    hits = 0;
+    allocs = allocation_count();
+    start = now_sec();
+    for (int i = 0; i < PATH_LOOKUPS; i++) {
+        x = next_random(x);
+        epoch_enter();
+        hits += cache_query_views(dns_cache, names[x % NAMES], RR_A, views, CACHE_MAX_ANSWERS) > 0;
+        epoch_exit();
+    }
+    report_path("views", now_sec() - start, hits, allocation_count() - allocs);
+}
+
+// 刷新已有记录并写入新名字，写入速度接近真实的上游应答
+static void* writer_run(void* arg) {
+    (void)arg;
+    char name[32];
+    uint32_t i = 0;
+    while (__atomic_load_n(&writer_on, __ATOMIC_RELAXED)) {
+        uint32_t ip = i % NAMES;
+        cache_insert(dns_cache, names[i % NAMES], RR_A, &ip, 300, 0);
+        snprintf(name, sizeof(name), "new%u.example", i);
+        cache_insert(dns_cache, name, RR_A, &ip, 300, 0);
+        i++;
+        if (i % 64 == 0) {
+            thread_sleep_ms(1);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    if (max_threads < 1 || max_threads > 64) {
+        max_threads = 8;
+    }
+    dns_cache = cache_create(NAMES * 2, CACHE_DEFAULT_SHARDS);
+    for (int i = 0; i < NAMES; i++) {
+        uint32_t ip = (uint32_t)i;
+        snprintf(names[i], sizeof(names[i]), "host%d.example", i);
+        cache_insert(dns_cache, names[i], RR_A, &ip, 300, 0);
+    }
+    compare_paths();
+    printf("%d names, %d shards, one writer thread, %d ms per run\n", NAMES, dns_cache->shard_count, DURATION_MS);
+
+    Reader* readers = (Reader*)calloc(max_threads, sizeof(Reader));
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        thread_t writer;
+        writer_on = 1;
+        running = 1;
+        thread_create(&writer, writer_run, NULL);
+        for (int i = 0; i < threads; i++) {
+            readers[i].id = i;
+            thread_create(&readers[i].thread, reader_run, &readers[i]);
+        }
+        double start = now_sec();
+        thread_sleep_ms(DURATION_MS);
+        __atomic_store_n(&running, 0, __ATOMIC_RELAXED);
+        uint64_t total = 0;
+        for (int i = 0; i < threads; i++) {
+            thread_join(readers[i].thread);
+            total += readers[i].lookups;
+        }
+        double seconds = now_sec() - start;
+        __atomic_store_n(&writer_on, 0, __ATOMIC_RELAXED);
+        thread_join(writer);
+        double rate = total / seconds;
+        if (threads == 1) {
+            base = rate;
+        }
+        printf("  %2d threads %10.0f lookups/s  %5.2fx\n", threads, rate, rate / base);
+    }
+    free(readers);
+    cache_destroy(dns_cache);
+    return 0;
+}
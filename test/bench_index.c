@@ -0,0 +1,158 @@
+/*
+名字索引基准：Trie 与哈希索引（Swiss table）的插入、命中、未命中与删除耗时
+gcc -O2 -I src src/hashindex.c src/trie.c src/record.c src/names.c src/epoch.c test/bench_index.c -o test/bench_index -lpthread
+用法：bench_index [名字数]
+*/
+
+#include "../src/hashindex.h"
+#include "../src/trie.h"
+#include "../src/names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_NAMES 100000
+#define LOOKUP_ROUNDS 10
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// 大致模仿真实流量的名字：若干常见后缀加上长度不一的子域
+static void make_name(char* out, size_t size, int i) {
+    static const char* zones[] = {"com", "net", "org", "cn", "edu.cn", "co.uk", "cloudfront.net", "akamaiedge.net"};
+    static const char* words[] = {"www", "api", "static", "img", "cdn", "mail", "login", "video", "m", "assets"};
+    snprintf(out, size, "%s.%s-%d.%s", words[rng() % 10], words[rng() % 10], i, zones[rng() % 8]);
+}
+
+static void report(const char* what, double seconds, long ops) {
+    printf("  %-22s %8.1f ns/op\n", what, seconds * 1e9 / ops);
+}
+
+int main(int argc, char* argv[]) {
+    int names = argc > 1 ? atoi(argv[1]) : DEFAULT_NAMES;
+    if (names <= 0) {
+        names = DEFAULT_NAMES;
+    }
+    RecordArena arena;
+    RecordSlab slab;
+    memset(&slab, 0, sizeof(slab));
+    RecordRef* records = (RecordRef*)malloc(names * sizeof(RecordRef));
+    char (*hits)[64] = malloc((size_t)names * 64);
+    char (*misses)[64] = malloc((size_t)names * 64);
+    int* order = (int*)malloc(names * sizeof(int));
+    NameTable* table = name_table_create((size_t)names * 128);
+    if (records == NULL || hits == NULL || misses == NULL || order == NULL || table == NULL ||
+        record_arena_init(&arena, (size_t)names * 128) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < names; i++) {
+        DNSRecord value;
+        uint32_t ip = (uint32_t)i;
+        make_name(hits[i], sizeof(hits[i]), i);
+        DNSRecord_init(&value, hits[i], 0, RR_A, &ip);
+        records[i] = record_pack(&arena, &slab, &value, name_intern(table, hits[i]), NAME_NIL);
+        make_name(misses[i], sizeof(misses[i]), names + i);
+        order[i] = i;
+    }
+    for (int i = names - 1; i > 0; i--) {     // 随机查询顺序，避免顺序访问掩盖缓存未命中
+        int j = (int)(rng() % (uint64_t)(i + 1));
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    printf("%d names, %d lookup rounds, records %zu bytes each on average (%zu decoded), names %zu bytes each\n",
+           names, LOOKUP_ROUNDS, slab.bytes / names, sizeof(DNSRecord), name_bytes(table) / names);
+    volatile uintptr_t sink = 0;
+
+    printf("trie (label radix tree, Node4/16/48/256)\n");
+    TrieNode* root = trie_create();
+    double start = now_sec();
+    for (int i = 0; i < names; i++) {
+        trie_insert(root, hits[i], &arena, records[i]);
+    }
+    report("insert", now_sec() - start, names);
+    size_t nodes = 0;
+    size_t bytes = trie_memory(root, &nodes);
+    printf("  %-22s %zu nodes, %zu KB, %zu bytes per name\n", "tree", nodes, bytes / 1024, bytes / names);
+    start = now_sec();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+        for (int i = 0; i < names; i++) {
+            sink += (uintptr_t)trie_search(root, hits[order[i]]);
+        }
+    }
+    report("hit", now_sec() - start, (long)names * LOOKUP_ROUNDS);
+    start = now_sec();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+        for (int i = 0; i < names; i++) {
+            sink += (uintptr_t)trie_search(root, misses[order[i]]);
+        }
+    }
+    report("miss", now_sec() - start, (long)names * LOOKUP_ROUNDS);
+    start = now_sec();
+    for (int i = 0; i < names; i++) {
+        trie_delete(root, hits[order[i]], &arena, records[order[i]]);
+    }
+    report("delete", now_sec() - start, names);
+    trie_free(root);
+
+    // 与缓存的查询路径相同：先在驻留表中找到名字，再按 (NameId, 类型) 查索引；不在表中的名字直接未命中
+    printf("hash index (name table + Swiss table, %zu bytes per slot, %s group probe)\n", sizeof(HashIndexSlot),
+#ifdef __SSE2__
+           "SSE2"
+#else
+           "scalar"
+#endif
+    );
+    HashIndex index;
+    hash_index_init(&index, 0, &arena);     // 从最小容量开始，计入扩容开销
+    start = now_sec();
+    for (int i = 0; i < names; i++) {
+        hash_index_insert(&index, records[i]);
+    }
+    report("insert", now_sec() - start, names);
+    printf("  %-22s %zu slots, %zu KB\n", "table", index.capacity,
+           index.capacity * (sizeof(HashIndexSlot) + 1) / 1024);
+    start = now_sec();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+        for (int i = 0; i < names; i++) {
+            sink += hash_index_find(&index, name_find(table, hits[order[i]]), RR_A);
+        }
+    }
+    report("hit", now_sec() - start, (long)names * LOOKUP_ROUNDS);
+    start = now_sec();
+    for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+        for (int i = 0; i < names; i++) {
+            NameId name = name_find(table, misses[order[i]]);
+            sink += name != NAME_NIL ? hash_index_find(&index, name, RR_A) : 0;
+        }
+    }
+    report("miss", now_sec() - start, (long)names * LOOKUP_ROUNDS);
+    start = now_sec();
+    for (int i = 0; i < names; i++) {
+        hash_index_delete(&index, records[order[i]]);
+    }
+    report("delete", now_sec() - start, names);
+    hash_index_free(&index);
+
+    (void)sink;
+    record_arena_destroy(&arena);
+    name_table_destroy(table);
+    free(records);
+    free(hits);
+    free(misses);
+    free(order);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+gcc -I src src/arena.c test/test_arena.c -o test/test_arena
+*/
+
+#include "../src/arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    Arena arena;
+    check(arena_init(&arena, 256) == 0, "init");
+
+    char* a = arena_alloc(&arena, 10);
+    char* b = arena_alloc(&arena, 10);
+    check(a != NULL && b != NULL, "alloc");
+    check(((uintptr_t)a % ARENA_ALIGN) == 0 && ((uintptr_t)b % ARENA_ALIGN) == 0, "aligned");
+    check(b - a == ARENA_ALIGN, "sequential within a block");
+    memset(a, 'x', 10);
+    memset(b, 'y', 10);
+    check(a[9] == 'x', "no overlap");
+
+    // 超出块大小时追加新块，大于块大小的请求单独成块
+    char* big = arena_alloc(&arena, 1000);
+    check(big != NULL && arena.head->next != NULL, "chained block for large request");
+    memset(big, 'z', 1000);
+    check(arena.allocated == 2 * ARENA_ALIGN + 1008, "allocated bytes");
+
+    // 重置后从第一块重新分配，已有的块保留
+    ArenaBlock* second = arena.head->next;
+    arena_reset(&arena);
+    check(arena.allocated == 0 && arena.peak == 2 * ARENA_ALIGN + 1008, "reset keeps peak");
+    check(arena_alloc(&arena, 10) == a, "reuses first block after reset");
+    check(arena_alloc(&arena, 1000) != NULL && arena.head->next == second, "reuses chained block after reset");
+
+    // 多轮分配释放不再增加块数
+    for (int round = 0; round < 100; round++) {
+        arena_reset(&arena);
+        for (int i = 0; i < 20; i++) {
+            arena_alloc(&arena, 48);
+        }
+    }
+    int blocks = 0;
+    for (ArenaBlock* block = arena.head; block; block = block->next) {
+        blocks++;
+    }
+    check(blocks <= 5, "blocks bounded across resets");
+
+    arena_destroy(&arena);
+    check(arena_alloc(&arena, 1) == NULL, "alloc after destroy fails");
+
+    if (failures == 0) {
+        printf("All arena tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
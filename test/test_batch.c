@@ -0,0 +1,162 @@
+/*
+gcc -I src src/batch.c src/event.c src/log.c test/test_batch.c -o test/test_batch -lpthread -Wl,--wrap=sendmmsg
+包装 sendmmsg 以模拟内核只发出一部分、发送缓冲区满（EAGAIN/ENOBUFS）等情况，数据报仍经回环真实发送
+*/
+
+#define _GNU_SOURCE
+#include "../src/batch.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SIZE 8
+
+typedef struct SendStep {
+    int limit;  // 本次调用最多真实发出的个数
+    int error;  // 不为 0 时本次调用以该错误失败
+} SendStep;
+
+static SendStep script[4];
+static int script_len;
+static int script_pos;
+static int send_calls;
+static int failures;
+
+int __real_sendmmsg(int fd, struct mmsghdr* msgs, unsigned int vlen, int flags);
+
+int __wrap_sendmmsg(int fd, struct mmsghdr* msgs, unsigned int vlen, int flags) {
+    send_calls++;
+    if (script_pos < script_len) {
+        SendStep step = script[script_pos++];
+        if (step.error) {
+            errno = step.error;
+            return -1;
+        }
+        if ((unsigned int)step.limit < vlen) {
+            vlen = step.limit;
+        }
+    }
+    return __real_sendmmsg(fd, msgs, vlen, flags);
+}
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static int udp_socket(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+        getsockname(fd, (struct sockaddr*)addr, &len) < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+// 按 script 填满一批 SIZE 个数据报并发出，返回 batch_flush 的结果；数据报内容为其序号
+static int flush_with(DNSBatch* tx, const struct sockaddr_in* to, const SendStep* steps, int count) {
+    for (int i = 0; i < count; i++) {
+        script[i] = steps[i];
+    }
+    script_len = count;
+    script_pos = 0;
+    send_calls = 0;
+    for (int i = 0; i < SIZE; i++) {
+        char data[16];
+        int len = snprintf(data, sizeof(data), "%d", i);
+        batch_queue(tx, data, len, to);
+    }
+    check(tx->count == SIZE, "batch filled");
+    int sent = batch_flush(tx);
+    check(tx->count == 0, "batch empty after flush");
+    return sent;
+}
+
+// 收下所有已到达的数据报，依次写入 seen（各数据报的序号），返回个数
+static int drain(DNSBatch* rx, int* seen) {
+    int total = 0;
+    int n;
+    while ((n = batch_recv(rx)) > 0) {
+        for (int i = 0; i < n; i++) {
+            seen[total++] = rx->slots[i].data[0] - '0';
+        }
+    }
+    return total;
+}
+
+int main() {
+    struct sockaddr_in tx_addr, rx_addr;
+    int tx_sock = udp_socket(&tx_addr);
+    int rx_sock = udp_socket(&rx_addr);
+    if (tx_sock < 0 || rx_sock < 0) {
+        printf("FAIL: could not open loopback sockets\n");
+        return 1;
+    }
+    DNSBatch* tx = batch_create(tx_sock, SIZE);
+    DNSBatch* rx = batch_create(rx_sock, SIZE);
+    int seen[SIZE * 2];
+
+    // 一次 sendmmsg 发出整批，一次 recvmmsg 收下整批，来源地址与长度逐个保留
+    check(flush_with(tx, &rx_addr, NULL, 0) == SIZE && send_calls == 1, "full batch in one call");
+    check(batch_recv(rx) == SIZE, "full batch received in one call");
+    check(rx->slots[0].len == 1 && rx->slots[SIZE - 1].data[0] == '0' + SIZE - 1 &&
+          rx->slots[3].addr.sin_port == tx_addr.sin_port, "lengths, payloads and source kept");
+    check(batch_recv(rx) == 0, "nothing left");
+    check(tx->stats.calls == 1 && tx->stats.packets == SIZE && tx->stats.max_batch == SIZE && tx->stats.dropped == 0,
+          "send stats");
+
+    // 批满时 batch_queue 先把已有的发出
+    for (int i = 0; i < SIZE + 2; i++) {
+        batch_queue(tx, "x", 1, &rx_addr);
+    }
+    check(tx->count == 2 && tx->stats.packets == SIZE * 2, "full batch flushed before queueing more");
+    batch_flush(tx);
+    check(drain(rx, seen) == SIZE + 2, "auto-flushed datagrams arrive");
+
+    // 内核只发出一部分：从未发出的位置继续，直到全部发出
+    SendStep partial[] = {{3, 0}, {2, 0}};
+    check(flush_with(tx, &rx_addr, partial, 2) == SIZE && send_calls == 3, "partial sends resumed");
+    check(drain(rx, seen) == SIZE && seen[0] == 0 && seen[3] == 3 && seen[SIZE - 1] == SIZE - 1,
+          "every datagram sent once, in order");
+
+    // 发送缓冲区满：已发出的之后全部丢弃并计数，不再重试
+    uint64_t dropped = tx->stats.dropped;
+    SendStep full[] = {{3, 0}, {0, EAGAIN}};
+    check(flush_with(tx, &rx_addr, full, 2) == 3 && send_calls == 2, "EAGAIN drops the rest in one go");
+    check(tx->stats.dropped == dropped + SIZE - 3, "dropped datagrams counted");
+    check(drain(rx, seen) == 3 && seen[2] == 2, "only the datagrams before EAGAIN arrive");
+    SendStep nobufs[] = {{0, ENOBUFS}};
+    check(flush_with(tx, &rx_addr, nobufs, 1) == 0 && send_calls == 1 &&
+          tx->stats.dropped == dropped + SIZE - 3 + SIZE, "ENOBUFS drops the whole batch");
+    check(drain(rx, seen) == 0, "nothing sent after ENOBUFS");
+
+    // 被信号打断的调用原样重试
+    SendStep interrupted[] = {{0, EINTR}};
+    check(flush_with(tx, &rx_addr, interrupted, 1) == SIZE && send_calls == 2, "EINTR retried");
+    check(drain(rx, seen) == SIZE, "all datagrams sent after EINTR");
+
+    // 其他错误只跳过出错的那个数据报，其余照常发出
+    dropped = tx->stats.dropped;
+    SendStep refused[] = {{4, 0}, {0, ECONNREFUSED}};
+    check(flush_with(tx, &rx_addr, refused, 2) == SIZE - 1 && tx->stats.dropped == dropped + 1,
+          "per-datagram error skips one");
+    check(drain(rx, seen) == SIZE - 1 && seen[3] == 3 && seen[4] == 5, "datagram after the failed one still sent");
+
+    batch_destroy(tx);
+    batch_destroy(rx);
+    close(tx_sock);
+    close(rx_sock);
+    if (failures == 0) {
+        printf("All batch tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,430 @@
+/*
+gcc -I src src/cache.c src/sketch.c src/trie.c src/hashindex.c src/record.c src/names.c src/epoch.c src/arena.c src/log.c src/dnsStruct.c test/test_dnscache.c -o test/test_dnscache -lpthread
+*/
+
+#include "../src/cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+#define THREAD_ROUNDS 20000
+#define STRESS_NAMES 2000
+#define STRESS_ROUNDS 50000
+
+DNSCache* dns_cache;
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static int result_length(const CacheQueryResult* p) {
+    int n = 0;
+    for (; p != NULL; p = p->next) {
+        n++;
+    }
+    return n;
+}
+
+// 各线程混合写入与查询，名字分布在所有分片上
+static void* hammer(void* arg) {
+    int id = (int)(intptr_t)arg;
+    Arena arena;
+    arena_init(&arena, 0);
+    char name[64];
+    for (int i = 0; i < THREAD_ROUNDS; i++) {
+        uint32_t ip = (uint32_t)(i % 500);     // 同名同值，重复写入不增加记录
+        snprintf(name, sizeof(name), "t%d-%d.example", id, i % 500);
+        if (i % 3 == 0) {
+            cache_insert(dns_cache, name, RR_A, &ip, 60, 0);
+        } else {
+            CacheQueryResult* result = cache_query(dns_cache, &arena, name, RR_A);
+            for (CacheQueryResult* p = result; p != NULL; p = p->next) {
+                if (strcmp(p->record->domain, name) != 0) {
+                    __atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+                }
+            }
+        }
+        if (i % 64 == 0) {
+            arena_reset(&arena);
+        }
+    }
+    arena_destroy(&arena);
+    return NULL;
+}
+
+static int stop;
+
+// 写者不停刷新和写入新名字，小容量下同时不断淘汰；值等于名字编号
+static void* stress_writer(void* arg) {
+    int id = (int)(intptr_t)arg;
+    char name[64];
+    for (int i = 0; i < STRESS_ROUNDS; i++) {
+        uint32_t n = (uint32_t)((i * 7 + id * 13) % STRESS_NAMES);
+        snprintf(name, sizeof(name), "s%u.stress", n);
+        cache_insert(dns_cache, name, RR_A, &n, 60 + i % 5, 0);
+    }
+    return NULL;
+}
+
+// 读者不加锁查询，副本的内容必须与名字一致（读到已释放或写了一半的记录会在这里或 ASan 下暴露）
+static void* stress_reader(void* arg) {
+    int id = (int)(intptr_t)arg;
+    Arena arena;
+    arena_init(&arena, 0);
+    char name[64];
+    for (uint32_t i = 0; !__atomic_load_n(&stop, __ATOMIC_ACQUIRE); i++) {
+        uint32_t n = (i * 31 + (uint32_t)id) % STRESS_NAMES;
+        snprintf(name, sizeof(name), "s%u.stress", n);
+        for (CacheQueryResult* p = cache_query(dns_cache, &arena, name, RR_A); p != NULL; p = p->next) {
+            if (p->record->value.ipv4 != n || strcmp(p->record->domain, name) != 0) {
+                __atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+            }
+        }
+        arena_reset(&arena);
+    }
+    arena_destroy(&arena);
+    return NULL;
+}
+
+int main() {
+    Arena arena;
+    arena_init(&arena, 0);
+    uint32_t ip = 0x01020304;
+    CacheQueryResult* result;
+
+    // 分片数取 2 的幂，不超过容量与上限，容量平均分配
+    DNSCache* cache = cache_create(1000, 12);
+    check(cache->shard_count == 16, "shards rounded up to a power of two");
+    int capacity = 0;
+    for (int i = 0; i < cache->shard_count; i++) {
+        capacity += cache->shards[i].capacity;
+    }
+    check(capacity == 1000, "capacity split across shards");
+    cache_destroy(cache);
+    cache = cache_create(4, 16);
+    check(cache->shard_count == 4, "no more shards than capacity");
+    cache_destroy(cache);
+    cache = cache_create(100000, 1000);
+    check(cache->shard_count == CACHE_MAX_SHARDS, "shard limit");
+    cache_destroy(cache);
+
+    // 每个分片各自淘汰
+    cache = cache_create(64, 4);
+    char name[64];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "host%d.example", i);
+        cache_insert(cache, name, RR_A, &ip, 60, 0);
+    }
+    uint64_t inserts = 0, evictions = 0;
+    int full = 1;
+    for (int i = 0; i < cache->shard_count; i++) {
+        inserts += cache->shards[i].inserts;
+        evictions += cache->shards[i].evictions;
+        full &= cache->shards[i].size == cache->shards[i].capacity;
+    }
+    check(cache_size(cache) == 64 && full, "every shard filled to its capacity");
+    check(inserts == 1000 && evictions == 1000 - 64, "insert and eviction counters");
+    snprintf(name, sizeof(name), "host%d.example", 999);
+    check(cache_query(cache, &arena, name, RR_A) != NULL, "newest name kept");
+    check(cache_query(cache, &arena, "host0.example", RR_A) == NULL, "oldest name evicted");
+    uint64_t hits, misses, other_hits, other_misses;
+    cache_shard_lookups(cache, (int)(cache_shard(cache, "host0.example") - cache->shards), &hits, &misses);
+    cache_shard_lookups(cache, (int)(cache_shard(cache, name) - cache->shards), &other_hits, &other_misses);
+    check(misses == 1 && other_hits == 1, "hit and miss counted on the name's shard");
+    // 紧凑记录：这些 A 记录各占 48 字节；淘汰的记录宽限期后回到 slab，最多还有几条在等待
+    size_t bytes = cache_record_bytes(cache);
+    check(bytes >= 48 * 64 && bytes <= 48 * (64 + 4 * cache->shard_count), "records packed into 48 bytes");
+    check(cache->records.used < (size_t)cache->shard_count * 2 * (64 << 10), "evicted records reused");
+    cache_destroy(cache);
+
+    // CLOCK：命中过的记录得到第二次机会，淘汰下一条没被命中的
+    cache = cache_create(4, 1);
+    for (int i = 0; i < 4; i++) {
+        snprintf(name, sizeof(name), "clock%d.example", i);
+        cache_insert(cache, name, RR_A, &ip, 60, 0);
+    }
+    check(cache_query(cache, &arena, "clock0.example", RR_A) != NULL, "clock hit");
+    cache_insert(cache, "clock4.example", RR_A, &ip, 60, 0);
+    check(cache_query(cache, &arena, "clock0.example", RR_A) != NULL, "referenced record kept");
+    check(cache_query(cache, &arena, "clock1.example", RR_A) == NULL, "unreferenced record evicted");
+    // 刷新换上新副本，记录数不变
+    cache_insert(cache, "clock3.example", RR_A, &ip, 120, 0);
+    result = cache_query(cache, &arena, "clock3.example", RR_A);
+    check(result_length(result) == 1 && cache_size(cache) == 4, "refresh replaces the record");
+    check(result != NULL && result->record->ttl == 120 && cache->shards[0].evictions == 1, "refreshed TTL");
+    cache_destroy(cache);
+
+    // 扫描：热点名字反复被查询后，大量只查一次的名字涌入。CLOCK 把热点冲掉，W-TinyLFU 留下热点：
+    // 进入主区后再被命中的热点在扫描时升入保护段，只查一次的名字频率比不过试用段里的记录
+    for (int policy = CACHE_POLICY_CLOCK; policy <= CACHE_POLICY_TINYLFU; policy++) {
+        cache = cache_create_policy(100, 1, (CachePolicy)policy);
+        for (int i = 0; i < 50; i++) {
+            snprintf(name, sizeof(name), "hot%d.example", i);
+            cache_query(cache, &arena, name, RR_A);     // 未命中也计入频率
+            cache_insert(cache, name, RR_A, &ip, 600, 0);
+            for (int j = 0; j < 4; j++) {
+                cache_query(cache, &arena, name, RR_A);
+            }
+            arena_reset(&arena);
+        }
+        cache_insert(cache, "filler.example", RR_A, &ip, 600, 0);     // 最后一个热点也移出窗口
+        for (int i = 0; i < 50; i++) {
+            snprintf(name, sizeof(name), "hot%d.example", i);
+            cache_query(cache, &arena, name, RR_A);
+        }
+        arena_reset(&arena);
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "scan%d.example", i);
+            cache_query(cache, &arena, name, RR_A);
+            cache_insert(cache, name, RR_A, &ip, 600, 0);
+        }
+        int kept = 0;
+        for (int i = 0; i < 50; i++) {
+            snprintf(name, sizeof(name), "hot%d.example", i);
+            kept += cache_query(cache, &arena, name, RR_A) != NULL;
+        }
+        arena_reset(&arena);
+        const CacheShard* shard = &cache->shards[0];
+        check(cache_size(cache) == 100 && shard->evictions == 1000 + 1 - 50, "full after the scan");
+        if (policy == CACHE_POLICY_CLOCK) {
+            check(kept == 0, "scan flushes CLOCK");
+            cache_destroy(cache);
+            continue;
+        }
+        check(kept == 50, "hot names survive the scan");
+        check(shard->rejections > 800 && shard->lru[CACHE_SEGMENT_WINDOW].size == shard->window_capacity &&
+              shard->lru[CACHE_SEGMENT_PROTECTED].size == 50, "scan rejected at admission, hot names protected");
+        // 还没缓存时就被反复查询的名字，从窗口挤出时能换掉只查过一次的记录
+        for (int i = 0; i < 5; i++) {
+            cache_query(cache, &arena, "wanted.example", RR_A);
+        }
+        cache_insert(cache, "wanted.example", RR_A, &ip, 600, 0);
+        cache_insert(cache, "scan-next.example", RR_A, &ip, 600, 0);
+        check(cache_query(cache, &arena, "wanted.example", RR_A) != NULL &&
+              record_at(&cache->records, shard->lru[CACHE_SEGMENT_PROBATION].tail)->name ==
+                  name_find(cache->names, "wanted.example"), "frequent candidate admitted");
+        arena_reset(&arena);
+        cache_destroy(cache);
+    }
+
+    // 过期堆：按过期时间先后清理，静态记录与 serve-stale 保留期内的记录不清理
+    cache = cache_create(64, 1);
+    time_t now = time(NULL);
+    for (int i = 0; i < 8; i++) {
+        snprintf(name, sizeof(name), "ttl%d.example", i);
+        cache_insert(cache, name, RR_A, &ip, 10 * (8 - i), 0);     // 越晚写入越早过期
+    }
+    cache_update_static(cache, "static.example", RR_A, &ip, 1);
+    check(cache_expire(cache, now, 100) == 0, "nothing expired yet");
+    check(cache_expire(cache, now + 35, 100) == 3 && cache_size(cache) == 6, "expired records removed");
+    check(cache_query(cache, &arena, "ttl5.example", RR_A) == NULL &&
+          cache_query(cache, &arena, "ttl4.example", RR_A) != NULL, "earliest expiry first");
+    cache->keep_expired = 100;
+    check(cache_expire(cache, now + 85, 100) == 0, "kept for serve-stale");
+    cache->keep_expired = 0;
+    check(cache_expire(cache, now + 1000, 2) == 2, "budget per shard");
+    cache_expire(cache, now + 1000, 100);
+    check(cache_size(cache) == 1 && cache->shards[0].expirations == 8 && cache->shards[0].expiry_count == 0,
+          "static record never expires");
+    cache_destroy(cache);
+
+    // serve-stale 的查找只读：不计命中、不消耗预取标记、不累加访问频率
+    cache = cache_create_policy(64, 1, CACHE_POLICY_TINYLFU);
+    cache_insert(cache, "stale.example", RR_A, &ip, 0, RECORD_PREFETCHED);
+    const CacheRecord* stale_record = record_at(&cache->records, cache->shards[0].lru[CACHE_SEGMENT_WINDOW].head);
+    uint64_t stale_hash = name_entry(cache->names, stale_record->name)->hash;
+    int frequency = sketch_estimate(&cache->shards[0].sketch, stale_hash);
+    for (int i = 0; i < 3; i++) {
+        check(cache_query_stale(cache, &arena, "stale.example", RR_A, 60) != NULL, "stale record returned");
+    }
+    arena_reset(&arena);
+    check(stale_record->hits == 0 && stale_record->flags == RECORD_PREFETCHED && cache->shards[0].prefetch_used == 0,
+          "stale lookup leaves the record untouched");
+    check(sketch_estimate(&cache->shards[0].sketch, stale_hash) == frequency, "stale lookup not counted as an access");
+    cache_destroy(cache);
+
+    // 刷新、淘汰打乱堆之后，每次清理都正好清掉到期的记录；链表的长度与记录数一致
+    for (int policy = CACHE_POLICY_CLOCK; policy <= CACHE_POLICY_TINYLFU; policy++) {
+        cache = cache_create_policy(128, 1, (CachePolicy)policy);
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "heap%d.example", (i * 7919) % 300);
+            if (i % 3 == 0) {
+                cache_query(cache, &arena, name, RR_A);
+            }
+            cache_insert(cache, name, RR_A, &ip, 1 + (i * 2654435761u) % 500, 0);
+        }
+        arena_reset(&arena);
+        CacheShard* shard = &cache->shards[0];
+        int consistent = shard->expiry_count == (uint32_t)shard->size;
+        for (time_t t = now; t <= now + 520; t += 13) {
+            cache_expire(cache, t, 1000);
+            int listed = 0;
+            for (int segment = 0; segment < CACHE_SEGMENTS; segment++) {
+                int length = 0;
+                for (RecordRef ref = shard->lru[segment].head; ref != RECORD_NIL;
+                     ref = record_at(&cache->records, ref)->lru_next) {
+                    const CacheRecord* record = record_at(&cache->records, ref);
+                    consistent &= record->expire_time > t && shard->expiry[record->expiry].ref == ref &&
+                                  record->segment == segment;
+                    length++;
+                }
+                consistent &= length == shard->lru[segment].size;
+                listed += length;
+            }
+            consistent &= listed == shard->size && shard->lru[CACHE_SEGMENT_PROTECTED].size <= shard->protected_capacity;
+        }
+        check(consistent && cache_size(cache) == 0, "heap and lists kept in order through refreshes and evictions");
+        cache_destroy(cache);
+    }
+
+    // CNAME 链跨分片，结果是副本，原记录被淘汰后仍可使用
+    cache = cache_create(1024, 64);
+    cache_insert(cache, "www.a.test", RR_CNAME, "edge.b.test", 60, 0);
+    cache_insert(cache, "edge.b.test", RR_CNAME, "host.c.test", 60, 0);
+    cache_insert(cache, "host.c.test", RR_A, &ip, 60, 0);
+    ip++;
+    cache_insert(cache, "HOST.c.test", RR_A, &ip, 60, 0);
+    check(name_count(cache->names) == 3, "one name per owner and CNAME target");
+    cache_insert(cache, "Host.C.Test", RR_A, &ip, 60, 0);
+    check(cache_size(cache) == 4, "same record in another case");
+    result = cache_query(cache, &arena, "WWW.A.Test", RR_A);
+    check(result_length(result) == 4, "chain across shards");
+    check(result != NULL && result->record->type == RR_CNAME &&
+          ((const char*)result->record < cache->records.base ||
+           (const char*)result->record >= cache->records.base + cache->records.size),
+          "decoded copy outside the cache");
+    check(result_length(cache_query(cache, &arena, "www.a.test", RR_CNAME)) == 2, "CNAME query");
+    check(cache_query(cache, &arena, "www.a.test", RR_AAAA) == NULL, "missing type at the end of the chain");
+
+    // 借用视图：直接指向缓存中的记录，不复制也不分配
+    CacheView views[CACHE_MAX_ANSWERS];
+    size_t allocated = arena.allocated;
+    epoch_enter();
+    int count = cache_query_views(cache, "WWW.A.Test", RR_A, views, CACHE_MAX_ANSWERS);
+    check(count == 4 && arena.allocated == allocated, "views without copies");
+    check(count == 4 && (const char*)views[0].record >= cache->records.base &&
+          (const char*)views[0].record < cache->records.base + cache->records.size, "views borrow cached records");
+    check(count == 4 && strcmp(views[0].domain, "www.a.test") == 0 && strcmp(views[0].target, "edge.b.test") == 0 &&
+          strcmp(views[1].target, "host.c.test") == 0 && views[2].record->type == RR_A && views[3].target == NULL,
+          "views follow the chain");
+    check(cache_query_views(cache, "WWW.A.Test", RR_A, views, 3) == 3, "views limited by the array");
+    check(cache_query_views(cache, "host.c.test", RR_A, views, CACHE_MAX_ANSWERS) == 2 &&
+          strcmp(views[0].domain, "host.c.test") == 0, "direct hit");
+    check(cache_query_views(cache, "nowhere.test", RR_A, views, CACHE_MAX_ANSWERS) == 0, "views miss");
+    epoch_exit();
+    cache_destroy(cache);
+    check(result != NULL && strcmp(result->record->value.cname, "edge.b.test") == 0, "copy outlives the cache");
+
+    // 预取：本次写入以来至少命中 PREFETCH_MIN_HITS 次、剩余 TTL 不超过 percent% 的记录才预取；静态记录不预取
+    cache = cache_create(64, 1);
+    cache_insert(cache, "hot.example", RR_A, &ip, 100, 0);
+    cache_update_static(cache, "static.example", RR_A, &ip, 1);
+    epoch_enter();
+    count = cache_query_views(cache, "hot.example", RR_A, views, CACHE_MAX_ANSWERS);
+    check(count == 1 && !cache_should_prefetch(views, count, 100), "below PREFETCH_MIN_HITS not prefetched");
+    for (int i = 1; i < PREFETCH_MIN_HITS; i++) {
+        count = cache_query_views(cache, "hot.example", RR_A, views, CACHE_MAX_ANSWERS);
+    }
+    check(count == 1 && cache_should_prefetch(views, count, 100), "hot record within the window prefetched");
+    check(!cache_should_prefetch(views, count, 10), "most of the ttl left, not prefetched yet");
+    check(!cache_should_prefetch(views, count, 0), "prefetch disabled");
+    for (int i = 0; i < 10; i++) {
+        cache_query_views(cache, "hot.example", RR_A, views, CACHE_MAX_ANSWERS);
+    }
+    check(views[0].record->hits == PREFETCH_MIN_HITS, "hit counter saturates");
+    for (int i = 0; i < PREFETCH_MIN_HITS + 1; i++) {
+        count = cache_query_views(cache, "static.example", RR_A, views, CACHE_MAX_ANSWERS);
+    }
+    check(count == 1 && !cache_should_prefetch(views, count, 100), "static record never prefetched");
+    epoch_exit();
+    // 上游刷新写入新的副本，命中重新计数
+    cache_insert(cache, "hot.example", RR_A, &ip, 100, 0);
+    epoch_enter();
+    count = cache_query_views(cache, "hot.example", RR_A, views, CACHE_MAX_ANSWERS);
+    check(count == 1 && views[0].record->hits == 1 && !cache_should_prefetch(views, count, 100),
+          "refreshed record counts hits again");
+    epoch_exit();
+    cache_destroy(cache);
+
+    // 负缓存（RFC 2308）：NXDOMAIN 覆盖所有类型，NODATA 只覆盖查询的类型，TTL 取 SOA 的 TTL 与 MINIMUM 中较小者；
+    // 新记录使被取代的负缓存作废
+    cache = cache_create(256, 8);
+    DNSSoa soa;
+    memset(&soa, 0, sizeof(soa));
+    strcpy(soa.mname, "ns.example");
+    strcpy(soa.rname, "admin.example");
+    soa.minimum = 300;
+    cache_insert_negative(cache, "gone.example", RR_A, RCODE_NXDOMAIN, "example", 600, &soa);
+    DNSRecord* negative = cache_query_negative(cache, &arena, "gone.example", RR_AAAA);
+    check(negative != NULL && negative->value.negative.rcode == RCODE_NXDOMAIN && negative->value.negative.qtype == 0,
+          "nxdomain covers every type");
+    check(negative != NULL && negative->ttl == 300, "ttl capped by soa minimum");
+    check(negative != NULL && negative->value.negative.owner_len == 9 && negative->value.negative.rdata_len == 12 + 15 + 20,
+          "soa kept in wire format");
+    cache_insert_negative(cache, "empty.example", RR_AAAA, 0, "example", 60, &soa);
+    negative = cache_query_negative(cache, &arena, "empty.example", RR_AAAA);
+    check(negative != NULL && negative->value.negative.rcode == 0 && negative->value.negative.qtype == RR_AAAA &&
+          negative->ttl == 60, "nodata for the queried type, ttl capped by soa ttl");
+    check(cache_query_negative(cache, &arena, "empty.example", RR_A) == NULL, "nodata does not cover other types");
+    cache_insert_negative(cache, "zero.example", RR_A, RCODE_NXDOMAIN, "example", 0, &soa);
+    check(cache_query_negative(cache, &arena, "zero.example", RR_A) == NULL, "zero ttl not cached");
+    cache_insert(cache, "gone.example", RR_A, &ip, 60, 0);
+    check(cache_query_negative(cache, &arena, "gone.example", RR_AAAA) == NULL, "negative dropped by new data");
+    cache_insert(cache, "empty.example", RR_A, &ip, 60, 0);
+    check(cache_query_negative(cache, &arena, "empty.example", RR_AAAA) != NULL, "nodata for another type kept");
+    arena_reset(&arena);
+    cache_destroy(cache);
+
+    // 多线程同时读写不同和相同的分片
+    dns_cache = cache_create(16384, 16);
+    thread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        thread_create(&threads[i], hammer, (void*)(intptr_t)i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        thread_join(threads[i]);
+    }
+    uint64_t lookups = 0;
+    for (int i = 0; i < dns_cache->shard_count; i++) {
+        cache_shard_lookups(dns_cache, i, &hits, &misses);
+        lookups += hits + misses;
+    }
+    check(lookups == (uint64_t)THREADS * (THREAD_ROUNDS - (THREAD_ROUNDS + 2) / 3), "every lookup counted");
+    check(cache_size(dns_cache) == THREADS * 500, "concurrent inserts");
+    cache_destroy(dns_cache);
+
+    // 不加锁的读者与刷新、淘汰并发（W-TinyLFU 下读者同时累加频率）
+    for (int policy = CACHE_POLICY_CLOCK; policy <= CACHE_POLICY_TINYLFU; policy++) {
+        dns_cache = cache_create_policy(256, 4, (CachePolicy)policy);
+        thread_t writers[2], readers[THREADS];
+        __atomic_store_n(&stop, 0, __ATOMIC_RELEASE);
+        for (int i = 0; i < THREADS; i++) {
+            thread_create(&readers[i], stress_reader, (void*)(intptr_t)i);
+        }
+        for (int i = 0; i < 2; i++) {
+            thread_create(&writers[i], stress_writer, (void*)(intptr_t)i);
+        }
+        for (int i = 0; i < 2; i++) {
+            thread_join(writers[i]);
+        }
+        __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+        for (int i = 0; i < THREADS; i++) {
+            thread_join(readers[i]);
+        }
+        check(failures == 0, "readers saw consistent records");
+        check(cache_size(dns_cache) == 256, "full after stress");
+        cache_destroy(dns_cache);
+    }
+    check(name_count(name_table) == 0, "names released with the caches");
+    arena_destroy(&arena);
+
+    if (failures == 0) {
+        printf("All record cache tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
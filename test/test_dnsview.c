@@ -0,0 +1,98 @@
+/*
+gcc -I src src/dnsStruct.c test/test_dnsview.c -o test/test_dnsview
+*/
+
+#include "../src/dnsStruct.h"
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// 问题 www.example.com A；回答 CNAME -> cdn.example.com（压缩）、A 1.2.3.4；授权 SOA；附加 AAAA
+static const unsigned char response[] = {
+    0x12, 0x34, 0x81, 0x80, 0, 1, 0, 2, 0, 1, 0, 1,
+    3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0, 0, 1, 0, 1,
+    // CNAME：所有者名指向问题，目标名 cdn + 指向 example.com（偏移 16）
+    0xC0, 0x0C, 0, 5, 0, 1, 0, 0, 0, 60, 0, 6, 3, 'c', 'd', 'n', 0xC0, 0x10,
+    // A：所有者名指向 cdn.example.com（偏移 45）
+    0xC0, 0x2D, 0, 1, 0, 1, 0, 0, 0, 30, 0, 4, 1, 2, 3, 4,
+    // SOA：example.com，MNAME ns + 指针，RNAME 根
+    0xC0, 0x10, 0, 6, 0, 1, 0, 0, 1, 0x2C, 0, 26, 2, 'n', 's', 0xC0, 0x10, 0,
+    0, 0, 0, 1, 0, 0, 0x0E, 0x10, 0, 0, 2, 0x58, 0, 1, 0x51, 0x80, 0, 0, 0, 0x78,
+    // AAAA
+    0xC0, 0x0C, 0, 28, 0, 1, 0, 0, 0, 60, 0, 16, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+int main() {
+    DNSView view;
+    DNSQuestionView question;
+    DNSRRIter iter;
+    DNSRRView rr;
+    char name[DOMAIN_MAX_LEN];
+
+    check(dns_view_init(&view, (const char*)response, 11) == -1, "short header rejected");
+    check(dns_view_init(&view, (const char*)response, sizeof(response)) == 0, "init");
+    check(view.id == 0x1234 && view.flags == 0x8180 && view.ancount == 2 && view.nscount == 1 && view.arcount == 1,
+          "header fields");
+
+    check(dns_view_question(&view, &question) == 0, "question");
+    check(question.qtype == 1 && question.qclass == 1, "question type and class");
+    check(dns_name_decode(&view, question.name_offset, name, sizeof(name)) == 17 && strcmp(name, "www.example.com") == 0,
+          "question name");
+    check(dns_name_decode(&view, question.name_offset, name, 10) == -1, "name longer than buffer rejected");
+    check(dns_view_question_name(&view, &question, name, sizeof(name)) == 0 && strcmp(name, "www.example.com") == 0 &&
+          question.qtype == 1, "question with name");
+
+    check(dns_rr_iter_init(&iter, &view) == 0, "iter init");
+    check(dns_rr_next(&iter, &rr) == 1 && rr.section == DNS_SECTION_ANSWER && rr.type == RR_CNAME && rr.ttl == 60,
+          "cname record");
+    check(dns_name_decode(&view, rr.rdata_offset, name, sizeof(name)) == 6 && strcmp(name, "cdn.example.com") == 0,
+          "compressed cname target");
+    check(dns_rr_next(&iter, &rr) == 1 && rr.type == RR_A && rr.rdlength == 4 && view.data[rr.rdata_offset] == 1,
+          "a record");
+    check(dns_name_decode(&view, rr.name_offset, name, sizeof(name)) == 2 && strcmp(name, "cdn.example.com") == 0,
+          "pointer to pointer");
+    check(dns_rr_next(&iter, &rr) == 1 && rr.section == DNS_SECTION_AUTHORITY && rr.type == RR_SOA, "soa record");
+    DNSSoa soa;
+    check(dns_rr_soa(&view, &rr, &soa) == 0 && strcmp(soa.mname, "ns.example.com") == 0 && strcmp(soa.rname, ".") == 0 &&
+          soa.serial == 1 && soa.minimum == 120, "soa rdata");
+    check(dns_rr_next(&iter, &rr) == 1 && rr.section == DNS_SECTION_ADDITIONAL && rr.type == RR_AAAA, "aaaa record");
+    check(dns_rr_next(&iter, &rr) == 0, "end of records");
+
+    // 截断：最后一条记录的资源数据不完整
+    check(dns_view_init(&view, (const char*)response, sizeof(response) - 1) == 0, "init truncated");
+    check(dns_rr_iter_init(&iter, &view) == 0, "iter init truncated");
+    int ret;
+    while ((ret = dns_rr_next(&iter, &rr)) == 1) {
+    }
+    check(ret == -1, "truncated rdata rejected");
+
+    // 指向自身或指向后文的压缩指针
+    unsigned char loop[] = {0, 0, 0x81, 0x80, 0, 1, 0, 0, 0, 0, 0, 0, 0xC0, 0x0C, 0, 1, 0, 1};
+    check(dns_view_init(&view, (const char*)loop, sizeof(loop)) == 0, "init loop");
+    check(dns_name_decode(&view, 12, name, sizeof(name)) == -1, "self pointer rejected");
+    check(dns_view_question_name(&view, &question, name, sizeof(name)) == -1, "undecodable question name rejected");
+    unsigned char forward[] = {0, 0, 0x81, 0x80, 0, 1, 0, 0, 0, 0, 0, 0, 0xC0, 0x0E, 1, 'a', 0, 0, 1, 0, 1};
+    check(dns_view_init(&view, (const char*)forward, sizeof(forward)) == 0, "init forward");
+    check(dns_name_decode(&view, 12, name, sizeof(name)) == -1, "forward pointer rejected");
+
+    // 没有问题
+    unsigned char empty[12] = {0};
+    check(dns_view_init(&view, (const char*)empty, sizeof(empty)) == 0, "init empty");
+    check(dns_view_question(&view, &question) == -1, "no question");
+    // 没有问题的应答（qdcount 为 0、带一条回答）不能当作任何查询的回答
+    unsigned char bare[] = {0x12, 0x34, 0x81, 0x80, 0, 0, 0, 1, 0, 0, 0, 0,
+                            1, 'a', 0, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 1, 2, 3, 4};
+    check(dns_view_init(&view, (const char*)bare, sizeof(bare)) == 0, "init answer without question");
+    check(dns_view_question_name(&view, &question, name, sizeof(name)) == -1, "answer without question rejected");
+
+    if (failures == 0) {
+        printf("All DNS view tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/*
+gcc -I src src/epoch.c test/test_epoch.c -o test/test_epoch -lpthread
+*/
+
+#include "../src/epoch.h"
+#include "../src/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static int released;
+
+static void count_release(void* ptr, void* arg) {
+    (*(int*)arg)++;
+    free(ptr);
+}
+
+static int reader_state;     // 1：已进入临界区，2：主线程要求离开，3：已离开
+static int reader_id;
+
+static void* reader(void* arg) {
+    (void)arg;
+    reader_id = epoch_thread_id();
+    epoch_enter();
+    __atomic_store_n(&reader_state, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&reader_state, __ATOMIC_ACQUIRE) != 2) {
+        thread_sleep_ms(1);
+    }
+    epoch_exit();
+    __atomic_store_n(&reader_state, 3, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int main() {
+    EpochRetireList list;
+    memset(&list, 0, sizeof(list));
+
+    // 没有读者时两次推进后即可释放
+    epoch_retire(&list, malloc(16));
+    epoch_retire(&list, malloc(16));
+    check(list.count == 2, "retired");
+    size_t freed = epoch_reclaim(&list);
+    freed += epoch_reclaim(&list);
+    freed += epoch_reclaim(&list);
+    check(freed == 2 && list.count == 0, "reclaimed without readers");
+
+    // 不在临界区的线程不阻碍推进
+    int self = epoch_thread_id();
+    uint64_t epoch = epoch_current();
+    check(epoch_advance() == epoch + 1, "idle thread does not block");
+    epoch_enter();
+    check(epoch_advance() == epoch + 2, "reader on the current epoch does not block one step");
+    check(epoch_advance() == epoch + 2, "reader on an older epoch blocks");
+    epoch_exit();
+
+    // 读者停留在临界区时，之后摘下的对象不会被释放
+    thread_t thread;
+    thread_create(&thread, reader, NULL);
+    while (__atomic_load_n(&reader_state, __ATOMIC_ACQUIRE) != 1) {
+        thread_sleep_ms(1);
+    }
+    check(reader_id != self && epoch_threads() >= 2, "separate slots per thread");
+    epoch_retire(&list, malloc(16));
+    freed = 0;
+    for (int i = 0; i < 10; i++) {
+        freed += epoch_reclaim(&list);
+    }
+    check(freed == 0 && list.count == 1, "kept while a reader is inside");
+    __atomic_store_n(&reader_state, 2, __ATOMIC_RELEASE);
+    thread_join(thread);
+    freed = 0;
+    for (int i = 0; i < 3; i++) {
+        freed += epoch_reclaim(&list);
+    }
+    check(freed == 1 && list.count == 0, "reclaimed after the reader left");
+
+    // 队列扩容保持先后顺序，同步后全部可释放
+    for (int i = 0; i < 1000; i++) {
+        epoch_retire(&list, malloc(16));
+        if (i % 100 == 0) {
+            epoch_advance();
+        }
+    }
+    int ordered = 1;
+    for (size_t i = 1; i < list.count; i++) {
+        ordered &= list.items[(list.head + i) & (list.capacity - 1)].epoch >=
+                   list.items[(list.head + i - 1) & (list.capacity - 1)].epoch;
+    }
+    check(list.count == 1000 && ordered, "queue grows in order");
+    epoch_synchronize();
+    freed = epoch_reclaim(&list);
+    check(freed == 1000, "all reclaimed after synchronize");
+    epoch_retire(&list, malloc(16));
+    epoch_retire_list_free(&list);
+    check(list.items == NULL && list.count == 0, "list freed");
+
+    // 自定义释放：宽限期过后与清空队列时都经由 release
+    list.release = count_release;
+    list.release_arg = &released;
+    epoch_retire(&list, malloc(16));
+    epoch_retire(&list, malloc(16));
+    epoch_synchronize();
+    epoch_reclaim(&list);
+    epoch_retire(&list, malloc(16));
+    epoch_retire_list_free(&list);
+    check(released == 3 && list.release == count_release, "release callback");
+
+    if (failures == 0) {
+        printf("All epoch reclamation tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+/*
+gcc -I src src/event.c test/test_event.c -o test/test_event
+*/
+
+#include "../src/event.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+typedef struct Reader {
+    int fd;
+    int calls;      // 回调次数
+    int datagrams;  // 读到的报文数
+} Reader;
+
+typedef struct Ticker {
+    EventLoop* loop;
+    int ticks;
+    int stop_after;
+    int peer;               // 每次触发时往 reader 发一个报文
+    struct sockaddr_in to;
+} Ticker;
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// 边缘触发：读到 EAGAIN 为止
+static void on_readable(void* arg) {
+    Reader* reader = (Reader*)arg;
+    char buf[64];
+    reader->calls++;
+    while (recv(reader->fd, buf, sizeof(buf), 0) >= 0) {
+        reader->datagrams++;
+    }
+}
+
+static void on_tick(void* arg) {
+    Ticker* ticker = (Ticker*)arg;
+    ticker->ticks++;
+    sendto(ticker->peer, "t", 1, 0, (struct sockaddr*)&ticker->to, sizeof(ticker->to));
+    if (ticker->ticks == ticker->stop_after) {
+        event_loop_stop(ticker->loop);
+    }
+}
+
+static int udp_socket(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+        getsockname(fd, (struct sockaddr*)addr, &len) < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+int main() {
+    struct sockaddr_in server_addr, peer_addr;
+    int server = udp_socket(&server_addr);
+    int peer = udp_socket(&peer_addr);
+    if (server < 0 || peer < 0) {
+        printf("FAIL: could not open loopback sockets\n");
+        return 1;
+    }
+
+    EventLoop* loop = event_loop_create();
+    check(loop != NULL, "loop created");
+    Reader reader = {server, 0, 0};
+    check(event_loop_add(loop, server, on_readable, &reader) == 0, "socket registered");
+
+    // 空闲时不分发任何事件
+    check(event_loop_run_once(loop, 10) == 0, "idle loop dispatches nothing");
+
+    // 一次可读通知里读完所有已到达的报文
+    for (int i = 0; i < 3; i++) {
+        sendto(peer, "q", 1, 0, (struct sockaddr*)&server_addr, sizeof(server_addr));
+    }
+    check(event_loop_run_once(loop, 1000) == 1, "socket readable");
+    check(reader.calls == 1 && reader.datagrams == 3, "callback drained the socket");
+    check(event_loop_run_once(loop, 10) == 0, "edge-triggered: no event after draining");
+
+    // 注册后未启用的定时器不触发
+    Ticker ticker = {loop, 0, 3, peer, server_addr};
+    int timer = event_timer_add(loop, on_tick, &ticker);
+    check(timer >= 0, "timer registered");
+    check(event_loop_run_once(loop, 30) == 0 && ticker.ticks == 0, "disabled timer does not fire");
+
+    // 定时器与 socket 在同一个循环里交替分发，第三次触发时停止循环
+    reader.calls = 0;
+    reader.datagrams = 0;
+    uint64_t start = event_now_ms();
+    event_timer_set(loop, timer, 20);
+    event_loop_run(loop);
+    uint64_t elapsed = event_now_ms() - start;
+    check(ticker.ticks == 3, "timer fired three times");
+    check(elapsed >= 55 && elapsed < 1000, "timer period respected");
+    // 最后一次触发发出的报文在循环停止后才分发
+    event_loop_run_once(loop, 100);
+    check(reader.datagrams == 3 && reader.calls >= 1, "datagrams sent from the timer were read");
+
+    // 停用后不再触发（停用前已到期的通知仍可能分发一次，但不会调用回调）
+    event_timer_set(loop, timer, 0);
+    event_loop_run_once(loop, 50);
+    check(ticker.ticks == 3, "stopped timer does not fire");
+
+    event_loop_destroy(loop);
+    close(server);
+    close(peer);
+    if (failures == 0) {
+        printf("All event loop tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+gcc -I src src/hashindex.c src/record.c src/names.c src/epoch.c test/test_hashindex.c -o test/test_hashindex -lpthread
+*/
+
+#include "../src/hashindex.h"
+#include "../src/names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMES 5000
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static RecordArena arena;
+static RecordSlab slab;
+static NameTable* names;
+
+// 记录持有所有者名的一个引用
+static RecordRef make_record(const char* domain, uint8_t type, uint32_t ipv4) {
+    uint8_t ipv6[16] = {0};
+    memcpy(ipv6, &ipv4, 4);
+    DNSRecord value;
+    DNSRecord_init(&value, domain, 0, type, type == RR_AAAA ? (const void*)ipv6 : (const void*)&ipv4);
+    return record_pack(&arena, &slab, &value, name_intern(names, domain), NAME_NIL);
+}
+
+static CacheRecord* at(RecordRef ref) {
+    return record_at(&arena, ref);
+}
+
+static void release(RecordRef ref) {
+    name_release(names, at(ref)->name);
+    record_free(&arena, &slab, ref);
+}
+
+static NameId id(const char* domain) {
+    return name_find(names, domain);
+}
+
+static int retired;
+
+static void count_retired(void* table, void* arg) {
+    (void)arg;
+    retired++;
+    free(table);
+}
+
+static int chain_length(RecordRef p) {
+    int n = 0;
+    for (; p != RECORD_NIL; p = at(p)->next) {
+        n++;
+    }
+    return n;
+}
+
+int main() {
+    HashIndex index;
+    names = name_table_create((size_t)NAMES * 64 * 4);
+    record_arena_init(&arena, (size_t)NAMES * 64 * 4);
+    check(hash_index_init(&index, 0, &arena) == 0, "init");
+    check(index.capacity == HASH_INDEX_MIN_CAPACITY, "minimum capacity");
+
+    // 同名同类型的记录挂在同一个键下，不同类型分开
+    RecordRef a1 = make_record("www.example.com", RR_A, 1);
+    RecordRef a2 = make_record("www.example.com", RR_A, 2);
+    RecordRef a3 = make_record("www.example.com", RR_A, 3);
+    RecordRef aaaa = make_record("www.example.com", RR_AAAA, 4);
+    hash_index_insert(&index, a1);
+    hash_index_insert(&index, a2);
+    hash_index_insert(&index, a3);
+    hash_index_insert(&index, aaaa);
+    check(index.size == 2, "two keys");
+    RecordRef found = hash_index_find(&index, id("www.example.com"), RR_A);
+    check(found == a1 && chain_length(found) == 3, "A chain in insertion order");
+    check(hash_index_find(&index, id("WWW.Example.COM"), RR_A) == a1, "case-insensitive");
+    check(hash_index_find(&index, id("www.example.com"), RR_AAAA) == aaaa, "AAAA key");
+    check(hash_index_find(&index, id("www.example.com"), RR_CNAME) == RECORD_NIL, "missing type");
+    check(id("www.example.co") == NAME_NIL, "prefix is not a match");
+    check(hash_index_hash(id("www.example.com"), RR_A) != hash_index_hash(id("www.example.com"), RR_AAAA),
+          "type mixed into the hash");
+
+    // 从中间、尾部、头部摘下
+    hash_index_delete(&index, a2);
+    found = hash_index_find(&index, id("www.example.com"), RR_A);
+    check(found == a1 && at(a1)->next == a3 && at(a3)->prev == a1, "unlink middle");
+    hash_index_delete(&index, a3);
+    check(at(a1)->next == RECORD_NIL, "unlink tail");
+    hash_index_insert(&index, a2);
+    hash_index_delete(&index, a1);
+    check(hash_index_find(&index, id("www.example.com"), RR_A) == a2, "unlink head");
+    // 原位替换：新记录占据旧记录在链表中的位置，旧记录仍指向原来的后继，正在遍历的读者可以继续
+    RecordRef b1 = make_record("www.example.com", RR_A, 5);
+    RecordRef b2 = make_record("www.example.com", RR_A, 6);
+    hash_index_insert(&index, a1);
+    hash_index_insert(&index, a3);
+    hash_index_replace(&index, a1, b1);
+    hash_index_replace(&index, a2, b2);
+    found = hash_index_find(&index, id("www.example.com"), RR_A);
+    check(found == b2 && at(b2)->next == b1 && at(b1)->next == a3 && at(a3)->prev == b1, "replace in place");
+    check(at(a1)->next == a3, "replaced record keeps its successor");
+    hash_index_replace(&index, a3, a1);
+    hash_index_insert(&index, a2);
+    check(at(a1)->next == a2 && at(a2)->prev == a1, "replaced tail");
+    hash_index_delete(&index, b2);
+    hash_index_delete(&index, b1);
+    hash_index_delete(&index, a1);
+    check(hash_index_find(&index, id("www.example.com"), RR_A) == a2 && index.size == 2, "only the last record left");
+    release(b1);
+    release(b2);
+    hash_index_delete(&index, a2);
+    check(hash_index_find(&index, id("www.example.com"), RR_A) == RECORD_NIL && index.size == 1, "key removed when empty");
+    hash_index_delete(&index, aaaa);
+    check(index.size == 0, "index empty");
+    release(a1);
+    release(a2);
+    release(a3);
+    release(aaaa);
+
+    // 扩容后全部仍可找到，替换下来的旧表交给 retire
+    index.retire = count_retired;
+    static RecordRef records[NAMES];
+    char name[64];
+    for (int i = 0; i < NAMES; i++) {
+        snprintf(name, sizeof(name), "host-%d.zone%d.example", i, i % 7);
+        records[i] = make_record(name, RR_A, (uint32_t)i);
+        check(hash_index_insert(&index, records[i]) == 1, "insert");
+    }
+    check(index.size == NAMES && index.rehashes > 0, "grew");
+    check(retired == (int)index.rehashes, "old tables handed to retire");
+    check(index.size * 8 <= index.capacity * 7, "load factor");
+    int all_found = 1;
+    for (int i = 0; i < NAMES; i++) {
+        all_found &= hash_index_find(&index, at(records[i])->name, RR_A) == records[i];
+    }
+    check(all_found, "all found after growth");
+    check(hash_index_find(&index, id("host-1.zone1.example"), RR_AAAA) == RECORD_NIL, "type is part of the key");
+
+    // 反复删除再插入，已删除标记不会让表无限变大
+    size_t capacity = index.capacity;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < NAMES; i += 2) {
+            hash_index_delete(&index, records[i]);
+            release(records[i]);
+        }
+        for (int i = 0; i < NAMES; i += 2) {
+            snprintf(name, sizeof(name), "churn-%d-%d.example", round, i);
+            records[i] = make_record(name, RR_A, (uint32_t)i);
+            hash_index_insert(&index, records[i]);
+        }
+    }
+    check(index.capacity == capacity, "churn does not grow the table");
+    all_found = 1;
+    for (int i = 0; i < NAMES; i++) {
+        all_found &= hash_index_find(&index, at(records[i])->name, RR_A) == records[i];
+    }
+    check(all_found, "all found after churn");
+    check(id("host-0.zone0.example") == NAME_NIL, "deleted name gone");
+
+    for (int i = 0; i < NAMES; i++) {
+        hash_index_delete(&index, records[i]);
+        release(records[i]);
+    }
+    check(index.size == 0, "empty after deleting all");
+    check(slab.bytes == 0, "records returned to the slab");
+    check(name_count(names) == 0, "names released with the records");
+    hash_index_free(&index);
+    record_arena_destroy(&arena);
+    name_table_destroy(names);
+
+    if (failures == 0) {
+        printf("All hash index tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
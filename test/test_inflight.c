@@ -0,0 +1,133 @@
+/*
+gcc -I src src/timer.c src/inflight.c test/test_inflight.c -o test/test_inflight
+*/
+
+#include "../src/inflight.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures;
+static int deadlines_fired;
+
+static void on_deadline(InflightEntry* entry, void* arg) {
+    (void)arg;
+    if (entry->used) {
+        deadlines_fired++;
+    }
+}
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    static InflightTable table;
+    static InflightEntry* entries[INFLIGHT_CAPACITY];
+    uint64_t now_ms = 1000;
+
+    check(inflight_init(&table) == 0, "init");
+
+    // 填满整张表，容量远超 65536
+    for (int i = 0; i < INFLIGHT_CAPACITY; i++) {
+        entries[i] = inflight_alloc(&table, now_ms, NULL, 1, 1, false);
+        if (entries[i] == NULL) {
+            check(0, "alloc until capacity");
+            return 1;
+        }
+        entries[i]->orig_id = (uint16_t)i;
+    }
+    check(table.count == INFLIGHT_CAPACITY, "count at capacity");
+    check(inflight_alloc(&table, now_ms, NULL, 1, 1, false) == NULL, "alloc beyond capacity fails");
+    check(table.rejected == 1, "rejected counted");
+
+    // 每个 (上游 socket, 事务 ID) 都能找回自己的条目
+    for (int i = 0; i < INFLIGHT_CAPACITY; i++) {
+        InflightEntry* e = inflight_lookup(&table, entries[i]->upstream, entries[i]->txid);
+        if (e != entries[i]) {
+            check(0, "lookup returns the allocated entry");
+            break;
+        }
+    }
+
+    // 释放一半后查找失败，且能重新分配
+    for (int i = 0; i < INFLIGHT_CAPACITY; i += 2) {
+        int upstream = entries[i]->upstream;
+        uint16_t txid = entries[i]->txid;
+        inflight_release(&table, entries[i]);
+        if (inflight_lookup(&table, upstream, txid) != NULL) {
+            check(0, "released entry not found");
+            break;
+        }
+    }
+    check(table.count == INFLIGHT_CAPACITY / 2, "count after release");
+    check(inflight_alloc(&table, now_ms, NULL, 1, 1, false) != NULL, "alloc after release");
+
+    // 剩余条目全部超时回收
+    int expired = inflight_expire(&table, now_ms + QUERY_TIMEOUT_SEC * 1000 + TIMER_WHEEL_TICK_MS, NULL, NULL);
+    check(expired == INFLIGHT_CAPACITY / 2 + 1, "all outstanding entries expire");
+    check(table.count == 0, "table empty after expiry");
+    check(table.timed_out == (uint64_t)expired, "timeouts counted");
+
+    // 相同问题合并为一个在途条目
+    struct sockaddr_in a = {0}, b = {0};
+    a.sin_port = htons(1000);
+    b.sin_port = htons(2000);
+    InflightEntry* first = inflight_alloc(&table, now_ms, "www.example.com", 1, 1, false);
+    first->orig_id = 7;
+    first->cli = a;
+    check(inflight_find(&table, "www.example.com", 1, 1) == first, "find same question");
+    check(inflight_find(&table, "www.example.com", 28, 1) == NULL, "different qtype not coalesced");
+    check(inflight_find(&table, "WWW.example.com", 1, 1) == NULL, "different case not coalesced");
+    check(inflight_add_waiter(&table, first, 7, &a) == 1, "retransmission ignored");
+    check(inflight_add_waiter(&table, first, 9, &b) == 0, "waiter added");
+    check(first->waiter_count == 1 && inflight_waiter(&table, first->waiters)->orig_id == 9, "waiter recorded");
+    inflight_release(&table, first);
+    check(inflight_find(&table, "www.example.com", 1, 1) == NULL, "released question not found");
+
+    // 应答期限先于超时到期，条目仍在途；释放的条目不再触发
+    InflightEntry* slow = inflight_alloc(&table, now_ms, "slow.example.com", 1, 1, false);
+    InflightEntry* fast = inflight_alloc(&table, now_ms, "fast.example.com", 1, 1, false);
+    inflight_set_deadline(&table, slow, now_ms, 1800);
+    inflight_set_deadline(&table, fast, now_ms, 1800);
+    inflight_release(&table, fast);
+    check(inflight_expire(&table, now_ms + 1000, on_deadline, NULL) == 0 && deadlines_fired == 0, "deadline not early");
+    check(inflight_expire(&table, now_ms + 2000, on_deadline, NULL) == 0, "deadline does not free entry");
+    check(deadlines_fired == 1 && slow->used && table.count == 1, "deadline fired once");
+    inflight_release(&table, slow);
+
+    // 预取没有应答期限；有过期数据的客户端挂上来后补上期限，到期时条目带着这个等待者
+    InflightEntry* refresh = inflight_alloc(&table, now_ms, "hot.example.com", 1, 1, true);
+    check(!timer_node_pending(&refresh->deadline), "prefetch has no deadline");
+    check(inflight_add_waiter(&table, refresh, 11, &a) == 0, "waiter joins prefetch");
+    inflight_set_deadline(&table, refresh, now_ms + 2000, 1800);
+    check(inflight_expire(&table, now_ms + 4000, on_deadline, NULL) == 0, "prefetch deadline does not free entry");
+    check(deadlines_fired == 2 && refresh->prefetch && refresh->waiter_count == 1 &&
+          inflight_waiter(&table, refresh->waiters)->orig_id == 11, "prefetch deadline reaches its waiter");
+    inflight_release(&table, refresh);
+
+    // -pfmax：在途的预取达到上限后不再发起，有预取完成后恢复；相同问题在途时不重复预取
+    InflightEntry* prefetches[2];
+    check(!inflight_can_prefetch(&table, 0, "a.example.com", 1, 1), "prefetch disabled with max 0");
+    prefetches[0] = inflight_alloc(&table, now_ms, "a.example.com", 1, 1, true);
+    check(inflight_can_prefetch(&table, 2, "b.example.com", 1, 1), "prefetch below the cap");
+    check(!inflight_can_prefetch(&table, 2, "a.example.com", 1, 1), "same question already prefetching");
+    prefetches[1] = inflight_alloc(&table, now_ms, "b.example.com", 1, 1, true);
+    InflightEntry* plain = inflight_alloc(&table, now_ms, "c.example.com", 1, 1, false);
+    check(table.prefetch_count == 2, "client queries not counted as prefetches");
+    check(!inflight_can_prefetch(&table, 2, "d.example.com", 1, 1), "prefetch cap reached");
+    check(!inflight_can_prefetch(&table, 3, "c.example.com", 1, 1), "question in flight for a client");
+    inflight_release(&table, prefetches[0]);
+    check(table.prefetch_count == 1 && inflight_can_prefetch(&table, 2, "d.example.com", 1, 1),
+          "released prefetch frees the cap");
+    inflight_release(&table, prefetches[1]);
+    inflight_release(&table, plain);
+
+    inflight_destroy(&table);
+    if (failures == 0) {
+        printf("All in-flight table tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+/*
+gcc -I src -pthread src/log.c test/test_log.c -o test/test_log
+*/
+
+#include "../src/log.h"
+#include "../src/thread.h"
+
+#define LOG_PATH "test_log.tmp"
+#define BURST_THREADS 4
+#define BURST_RECORDS 20000
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void* burst(void* arg) {
+    long id = (long)arg;
+    for (int i = 0; i < BURST_RECORDS; i++) {
+        LOG_DEBUG("burst %ld %d\n", id, i);
+    }
+    return NULL;
+}
+
+int main() {
+    remove(LOG_PATH);
+    log_level = LOG_LEVEL_DEBUG;
+    log_init(LOG_PATH);
+
+    LOG_INFO("mixed %s %d %llu %zu %.1f [%5s] [%-3d] %x %%\n", "name", -7, 123ULL, (size_t)9, 2.5, "ab", 4, 255);
+    // 字符串在写入时复制，之后修改不影响日志内容
+    char name[16] = "before";
+    LOG_DEBUG("copied %s\n", name);
+    strcpy(name, "after");
+    // 不支持的 * 宽度在此截断
+    LOG_WARNING("width %*d\n", 3, 4);
+    log_level = LOG_LEVEL_INFO;
+    LOG_DEBUG("disabled level\n");
+    log_level = LOG_LEVEL_DEBUG;
+
+    thread_t threads[BURST_THREADS];
+    for (long i = 0; i < BURST_THREADS; i++) {
+        thread_create(&threads[i], burst, (void*)i);
+    }
+    for (int i = 0; i < BURST_THREADS; i++) {
+        thread_join(threads[i]);
+    }
+    log_close();
+
+    FILE* fp = fopen(LOG_PATH, "r");
+    check(fp != NULL, "log file written");
+    char line[512];
+    int mixed = 0, copied = 0, width = 0, disabled = 0, bursts = 0;
+    while (fp && fgets(line, sizeof(line), fp)) {
+        check(line[0] == '[' && line[20] == ']', "timestamp prefix");
+        mixed += strstr(line, "] INFO : mixed name -7 123 9 2.5 [   ab] [4  ] ff %\n") != NULL;
+        copied += strstr(line, "] DEBUG: copied before\n") != NULL;
+        width += strstr(line, "] WARN : width ...\n") != NULL;
+        disabled += strstr(line, "disabled level") != NULL;
+        bursts += strstr(line, "] DEBUG: burst ") != NULL;
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    check(mixed == 1, "format conversions");
+    check(copied == 1, "string arguments copied");
+    check(width == 1, "unsupported conversion truncated");
+    check(disabled == 0, "disabled level not written");
+    // 队列满时丢弃并计数，写出的与丢弃的合计等于写入的
+    check(bursts + (int)log_dropped() == BURST_THREADS * BURST_RECORDS, "every record written or counted as dropped");
+    remove(LOG_PATH);
+
+    if (failures == 0) {
+        printf("All logger tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
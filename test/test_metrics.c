@@ -0,0 +1,74 @@
+/*
+gcc -I src src/metrics.c test/test_metrics.c -o test/test_metrics -lrt
+*/
+
+#include "../src/metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+#define METRICS_TEST_NAME "/dnsrelay-stats-test"
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    // 桶连续且覆盖全部取值，每个值落在 [下界, 下一桶下界) 内
+    int previous = -1;
+    int monotonic = 1, bounded = 1;
+    for (uint64_t v = 0; v < 100000; v++) {
+        int b = histogram_bucket(v);
+        monotonic &= b == previous || b == previous + 1;
+        bounded &= histogram_bucket_low(b) <= v && (b + 1 >= HISTOGRAM_BUCKETS || v < histogram_bucket_low(b + 1));
+        previous = b;
+    }
+    check(monotonic, "buckets are contiguous");
+    check(bounded, "values fall inside their bucket");
+    check(histogram_bucket(UINT32_MAX) == HISTOGRAM_BUCKETS - 1, "largest value in the last bucket");
+    check(histogram_bucket(UINT64_MAX) == HISTOGRAM_BUCKETS - 1, "overflow clamped");
+    // 相对误差不超过 1/8
+    uint64_t low = histogram_bucket_low(histogram_bucket(1000000));
+    check(low <= 1000000 && 1000000 - low <= 1000000 / HISTOGRAM_SUB_BUCKETS, "relative error");
+
+    static Histogram h, merged;
+    for (uint64_t v = 1; v <= 1000; v++) {
+        histogram_record(&h, v);
+    }
+    check(h.count == 1000 && h.sum == 500500 && h.max == 1000, "count, sum, max");
+    uint64_t p50 = histogram_percentile(&h, 50);
+    uint64_t p99 = histogram_percentile(&h, 99);
+    check(p50 >= 500 && p50 <= 500 + 500 / HISTOGRAM_SUB_BUCKETS, "p50");
+    check(p99 >= 990 && p99 <= 1000, "p99 capped at max");
+    histogram_merge(&merged, &h);
+    histogram_merge(&merged, &h);
+    check(merged.count == 2000 && histogram_percentile(&merged, 50) == p50, "merge");
+
+    // 共享内存：写入方的计数对只读映射可见
+    MetricsShared* metrics = metrics_open(METRICS_TEST_NAME, 2);
+    check(metrics != NULL && metrics->worker_count == 2, "open shared");
+    const MetricsShared* reader = metrics_attach(METRICS_TEST_NAME);
+    check(reader != NULL, "attach");
+    if (metrics && reader) {
+        metrics->workers[1].queries += 42;
+        histogram_record(&metrics->workers[1].upstream_rtt[2], 1500);
+        check(reader->workers[1].queries == 42 && reader->workers[1].upstream_rtt[2].count == 1, "reader sees counters");
+    }
+    check(((uintptr_t)&metrics->workers[1] % 64) == 0, "workers on separate cache lines");
+    metrics_close(metrics, METRICS_TEST_NAME);
+    check(metrics_attach(METRICS_TEST_NAME) == NULL, "removed on close");
+
+    // 不导出时使用私有内存
+    metrics = metrics_open(NULL, 1);
+    check(metrics != NULL, "private fallback");
+    metrics_close(metrics, NULL);
+
+    if (failures == 0) {
+        printf("All metrics tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/*
+gcc -I src src/names.c src/record.c src/epoch.c test/test_names.c -o test/test_names -lpthread
+*/
+
+#include "../src/names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMES 5000
+#define READERS 4
+#define STRESS_NAMES 512
+#define STRESS_ROUNDS 200000
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static NameTable* table;
+static int stop;
+static int inconsistent;
+
+// 一半的名字长期存在，另一半被写者反复加入、删除
+static void stress_name(char* out, size_t size, uint32_t n) {
+    snprintf(out, size, "n%u.Stress.Example", n);
+}
+
+// 读者不加锁查找：找到的名字必须与查询一致，常驻的名字必须找得到
+static void* reader(void* arg) {
+    (void)arg;
+    char name[64];
+    char lower[64];
+    for (uint32_t i = 0; !__atomic_load_n(&stop, __ATOMIC_ACQUIRE); i++) {
+        uint32_t n = (i * 2654435761u) % STRESS_NAMES;
+        stress_name(name, sizeof(name), n);
+        snprintf(lower, sizeof(lower), "n%u.stress.example", n);
+        epoch_enter();
+        NameId id = name_find(table, name);
+        if ((id != NAME_NIL && strcmp(name_string(table, id), lower) != 0) || (n % 2 == 0 && id == NAME_NIL)) {
+            __atomic_fetch_add(&inconsistent, 1, __ATOMIC_RELAXED);
+        }
+        epoch_exit();
+    }
+    return NULL;
+}
+
+int main() {
+    table = name_table_create((size_t)64 << 20);
+    check(table != NULL, "create");
+
+    // 不同大小写驻留为同一个名字，保存规范形式，引用计数
+    NameId a = name_intern(table, "WWW.Example.com");
+    NameId b = name_intern(table, "www.example.COM");
+    check(a != NAME_NIL && a == b, "same id regardless of case");
+    check(strcmp(name_string(table, a), "www.example.com") == 0, "canonical lowercase");
+    check(name_entry(table, a)->refs == 2 && name_count(table) == 1, "references counted");
+    check(name_find(table, "www.EXAMPLE.com") == a, "find is case-insensitive");
+    check(name_find(table, "www.example.co") == NAME_NIL, "prefix not found");
+    check(name_hash("WWW.Example.com", 15) == name_entry(table, a)->hash, "hash ignores case");
+    NameId c = name_intern(table, "mail.example.com");
+    check(c != a && name_count(table) == 2, "different name, different id");
+    name_release(table, b);
+    check(name_find(table, "www.example.com") == a, "kept while referenced");
+    name_release(table, a);
+    check(name_find(table, "www.example.com") == NAME_NIL && name_count(table) == 1, "deleted with the last reference");
+    name_release(table, c);
+
+    // 最长的名字放得下，更长的拒绝
+    char name[DOMAIN_MAX_LEN + 1];
+    memset(name, 'a', DOMAIN_MAX_LEN - 1);
+    name[DOMAIN_MAX_LEN - 1] = '\0';
+    NameId longest = name_intern(table, name);
+    check(longest != NAME_NIL && name_entry(table, longest)->len == DOMAIN_MAX_LEN - 1, "longest name");
+    name_release(table, longest);
+    name[DOMAIN_MAX_LEN - 1] = 'a';
+    name[DOMAIN_MAX_LEN] = '\0';
+    check(name_intern(table, name) == NAME_NIL, "too long");
+
+    // 扩容后全部仍可找到，NameId 不变
+    static NameId ids[NAMES];
+    for (int i = 0; i < NAMES; i++) {
+        snprintf(name, sizeof(name), "host-%d.zone%d.example", i, i % 7);
+        ids[i] = name_intern(table, name);
+    }
+    int all_found = 1;
+    for (int i = 0; i < NAMES; i++) {
+        snprintf(name, sizeof(name), "HOST-%d.zone%d.example", i, i % 7);
+        all_found &= name_find(table, name) == ids[i];
+    }
+    check(all_found && name_count(table) == NAMES, "all found after growth");
+    size_t capacity = 0;
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        capacity += table->stripes[i].table->capacity;
+    }
+    check(capacity > NAME_STRIPES * NAME_TABLE_MIN_CAPACITY, "stripes grew");
+
+    // 反复删除再加入：表不会无限变大，删除的名字宽限期后被复用
+    size_t bytes = name_bytes(table);
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < NAMES; i += 2) {
+            name_release(table, ids[i]);
+        }
+        epoch_synchronize();
+        for (int i = 0; i < NAMES; i += 2) {
+            snprintf(name, sizeof(name), "churn-%d-%d.example", round, i);
+            ids[i] = name_intern(table, name);
+        }
+    }
+    size_t churned = 0;
+    for (int i = 0; i < NAME_STRIPES; i++) {
+        churned += table->stripes[i].table->capacity;
+    }
+    check(churned <= capacity * 2, "churn does not keep growing the tables");
+    check(name_bytes(table) < bytes * 2, "deleted names reused");
+    for (int i = 0; i < NAMES; i++) {
+        name_release(table, ids[i]);
+    }
+    check(name_count(table) == 0, "empty after releasing all");
+
+    // 读者不加锁查找，同时写者反复加入、删除名字（触发删除标记与重建）
+    for (uint32_t n = 0; n < STRESS_NAMES; n += 2) {
+        stress_name(name, sizeof(name), n);
+        name_intern(table, name);
+    }
+    thread_t threads[READERS];
+    for (int i = 0; i < READERS; i++) {
+        thread_create(&threads[i], reader, NULL);
+    }
+    for (uint32_t i = 0; i < STRESS_ROUNDS; i++) {
+        uint32_t n = (i * 7 % STRESS_NAMES) | 1;
+        stress_name(name, sizeof(name), n);
+        NameId id = name_intern(table, name);
+        if (i % 3 != 0) {
+            name_release(table, id);
+        }
+        if (i % 5 == 0) {
+            name_release(table, name_find(table, name));
+        }
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < READERS; i++) {
+        thread_join(threads[i]);
+    }
+    check(inconsistent == 0, "readers saw consistent names");
+    name_table_destroy(table);
+
+    if (failures == 0) {
+        printf("All name table tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
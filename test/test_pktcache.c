@@ -0,0 +1,99 @@
+/*
+gcc -I src src/pktcache.c test/test_pktcache.c -o test/test_pktcache
+*/
+
+#include "../src/pktcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// www.example.com 的 A 查询（RD=1）
+static int build_query(char* buf, uint16_t id, uint16_t flags) {
+    static const unsigned char question[] = {3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+                                             0, 1, 0, 1};
+    unsigned char header[12] = {id >> 8, id & 0xFF, flags >> 8, flags & 0xFF, 0, 1, 0, 0, 0, 0, 0, 0};
+    memcpy(buf, header, 12);
+    memcpy(buf + 12, question, sizeof(question));
+    return 12 + (int)sizeof(question);
+}
+
+// 在查询后追加一条 A 记录，TTL 为 ttl
+static int build_response(char* buf, uint16_t id, uint32_t ttl) {
+    int len = build_query(buf, id, 0x8180);
+    unsigned char rr[] = {0xC0, 0x0C, 0, 1, 0, 1, ttl >> 24, (ttl >> 16) & 0xFF, (ttl >> 8) & 0xFF, ttl & 0xFF, 0, 4,
+                          1, 2, 3, 4};
+    buf[7] = 1;
+    memcpy(buf + len, rr, sizeof(rr));
+    return len + (int)sizeof(rr);
+}
+
+static uint32_t answer_ttl(const char* buf, int len) {
+    const unsigned char* p = (const unsigned char*)buf + len - 10;
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+int main() {
+    PacketCache cache;
+    char buf[BUFFER_SIZE];
+    char response[BUFFER_SIZE];
+    time_t now = 1700000000;
+
+    check(packet_cache_init(&cache, 100) == 0, "init");
+
+    int query_len = build_query(buf, 0x1111, 0x0100);
+    check(packet_cache_answer(&cache, buf, query_len, now) == 0 && cache.misses == 1, "miss before insert");
+
+    int response_len = build_response(response, 0x1111, 300);
+    packet_cache_insert(&cache, 0x0100, response, response_len, now, now + 1000);
+    check(cache.inserts == 1, "inserted");
+
+    // 换一个事务 ID 查询，10 秒后 TTL 扣减 10
+    query_len = build_query(buf, 0xABCD, 0x0100);
+    int len = packet_cache_answer(&cache, buf, query_len, now + 10);
+    check(len == response_len, "hit returns the cached response");
+    check((unsigned char)buf[0] == 0xAB && (unsigned char)buf[1] == 0xCD, "transaction ID rewritten");
+    check(answer_ttl(buf, len) == 290, "TTL adjusted");
+    check(memcmp(buf + 2, response + 2, len - 12) == 0, "rest of the response unchanged");
+
+    // RD 不同的查询不命中
+    query_len = build_query(buf, 0x2222, 0x0000);
+    check(packet_cache_answer(&cache, buf, query_len, now + 10) == 0, "different RD misses");
+
+    // 不晚于最小 TTL 失效
+    query_len = build_query(buf, 0x3333, 0x0100);
+    check(packet_cache_answer(&cache, buf, query_len, now + 300) == 0, "expired at TTL");
+
+    // 截止时间早于 TTL 时按截止时间失效
+    packet_cache_insert(&cache, 0x0100, response, response_len, now, now + 60);
+    query_len = build_query(buf, 0x4444, 0x0100);
+    check(packet_cache_answer(&cache, buf, query_len, now + 59) > 0, "hit before deadline");
+    query_len = build_query(buf, 0x4444, 0x0100);
+    check(packet_cache_answer(&cache, buf, query_len, now + 60) == 0, "expired at deadline");
+
+    // 截断的应答不缓存
+    uint64_t inserts = cache.inserts;
+    packet_cache_insert(&cache, 0x0100, response, response_len - 3, now, now + 60);
+    check(cache.inserts == inserts, "truncated response rejected");
+
+    packet_cache_destroy(&cache);
+
+    // 容量为 0 时关闭
+    check(packet_cache_init(&cache, 0) == 0, "init disabled");
+    packet_cache_insert(&cache, 0x0100, response, response_len, now, now + 60);
+    check(packet_cache_answer(&cache, buf, query_len, now) == 0, "disabled cache never hits");
+    packet_cache_destroy(&cache);
+
+    if (failures == 0) {
+        printf("All packet cache tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/*
+gcc -I src src/qlog.c test/test_qlog.c -o test/test_qlog
+*/
+
+#include "../src/qlog.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define QLOG_TEST_DIR "qlog_test.tmp"
+#define SEGMENT_SIZE 8192
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// www.example.com AAAA 的 NXDOMAIN 应答（只有头部和问题）
+static int build_response(char* buf) {
+    static const unsigned char packet[] = {0x12, 0x34, 0x81, 0x83, 0, 1, 0, 0, 0, 0, 0, 0,
+                                           3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+                                           0, 28, 0, 1};
+    memcpy(buf, packet, sizeof(packet));
+    return (int)sizeof(packet);
+}
+
+static int count_segments(void) {
+    DIR* dir = opendir(QLOG_TEST_DIR);
+    int count = 0;
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        count += strncmp(entry->d_name, "qlog-", 5) == 0;
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    return count;
+}
+
+static void remove_segments(void) {
+    DIR* dir = opendir(QLOG_TEST_DIR);
+    struct dirent* entry;
+    char path[512];
+    while (dir && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", QLOG_TEST_DIR, entry->d_name);
+            unlink(path);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    rmdir(QLOG_TEST_DIR);
+}
+
+int main() {
+    QueryLog log;
+    char packet[512];
+    int len = build_response(packet);
+    struct sockaddr_in client;
+    memset(&client, 0, sizeof(client));
+    client.sin_family = AF_INET;
+    client.sin_addr.s_addr = inet_addr("192.0.2.7");
+    client.sin_port = htons(5353);
+
+    remove_segments();
+    check(qlog_open(&log, QLOG_TEST_DIR, 3, SEGMENT_SIZE, 2) == 0 && qlog_enabled(&log), "open");
+
+    // 每条记录 24 + 17 字节，对齐到 48；写满几个段后只保留最近 2 个
+    uint64_t start = qlog_now_us();
+    for (int i = 0; i < 1000; i++) {
+        qlog_write(&log, &client, packet, len, QLOG_SRC_NEGATIVE, (uint32_t)i);
+    }
+    check(log.records == 1000 && log.errors == 0, "all records written");
+    check(log.rotations > 2, "segments rotated");
+    check(count_segments() == 2, "old segments removed");
+
+    // 当前段仍在映射中，读者按头部的 used 读取
+    const uint8_t* data = log.base;
+    size_t used = qlog_segment_used(data, SEGMENT_SIZE);
+    check(used == log.used, "header tracks used bytes");
+    size_t offset = 0;
+    const QlogRecord* record;
+    const QlogRecord* last = NULL;
+    int count = 0;
+    while ((record = qlog_next(data, used, &offset)) != NULL) {
+        last = record;
+        count++;
+    }
+    check(count > 0 && last != NULL && last->latency_us == 999, "records read back in order");
+    char name[256];
+    check(last && qlog_name(last, name, sizeof(name)) == 15 && strcmp(name, "www.example.com") == 0, "qname");
+    check(last && last->qtype == 28 && last->rcode == 3 && last->source == QLOG_SRC_NEGATIVE, "qtype, rcode, source");
+    check(last && last->client_addr == client.sin_addr.s_addr && last->client_port == client.sin_port, "client");
+    check(last && last->time_us >= start, "timestamp");
+
+    // 关闭后段文件截断到实际长度
+    uint32_t sequence = log.sequence;
+    size_t final_used = log.used;
+    qlog_close(&log);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/qlog-w3-%s-%06u.bin", QLOG_TEST_DIR, log.stamp, sequence);
+    FILE* fp = fopen(path, "rb");
+    check(fp != NULL, "segment file exists");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        check((size_t)ftell(fp) == final_used, "segment truncated on close");
+        fclose(fp);
+    }
+
+    // 缺少问题部分的报文只记录头部字段
+    check(qlog_open(&log, QLOG_TEST_DIR, 4, SEGMENT_SIZE, 0) == 0, "reopen");
+    packet[5] = 0;
+    qlog_write(&log, &client, packet, 12, QLOG_SRC_UPSTREAM, 0);
+    offset = 0;
+    record = qlog_next(log.base, log.used, &offset);
+    check(record && record->name_len == 0 && qlog_name(record, name, sizeof(name)) == -1, "no question");
+
+    // 超过 255 字节的问题名不记录名字，后面的记录照常读出
+    char long_packet[400];
+    packet[5] = 1;
+    memcpy(long_packet, packet, 12);
+    int pos = 12;
+    for (int i = 0; i < 5; i++) {
+        long_packet[pos++] = 63;
+        memset(long_packet + pos, 'a', 63);
+        pos += 63;
+    }
+    long_packet[pos++] = 0;
+    long_packet[pos++] = 0;
+    long_packet[pos++] = 1;
+    qlog_write(&log, &client, long_packet, pos, QLOG_SRC_UPSTREAM, 1);
+    qlog_write(&log, &client, packet, len, QLOG_SRC_UPSTREAM, 2);
+    record = qlog_next(log.base, log.used, &offset);
+    check(record && record->name_len == 0 && record->qtype == 1 && record->latency_us == 1, "long qname not stored");
+    record = qlog_next(log.base, log.used, &offset);
+    check(record && record->latency_us == 2 && record->qtype == 28 && qlog_name(record, name, sizeof(name)) == 15,
+          "record after long qname");
+    qlog_close(&log);
+
+    remove_segments();
+    if (failures == 0) {
+        printf("All query log tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/*
+gcc -I src src/record.c src/names.c src/epoch.c test/test_record.c -o test/test_record -lpthread
+*/
+
+#include "../src/record.h"
+#include "../src/names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static NameTable* names;
+
+// 按 value 驻留所有者名与 CNAME 目标后打包，记录持有两者的引用
+static RecordRef pack(RecordArena* arena, RecordSlab* slab, const DNSRecord* value) {
+    NameId name = name_intern(names, value->domain);
+    NameId target = value->type == RR_CNAME ? name_intern(names, value->value.cname) : NAME_NIL;
+    return record_pack(arena, slab, value, name, target);
+}
+
+static void release(RecordArena* arena, RecordSlab* slab, RecordRef ref) {
+    const CacheRecord* record = record_at(arena, ref);
+    name_release(names, record->name);
+    if (record->type == RR_CNAME) {
+        name_release(names, record_cname(record));
+    }
+    record_free(arena, slab, ref);
+}
+
+// 打包后再解码，内容与原记录一致
+static int round_trip(RecordArena* arena, RecordSlab* slab, const DNSRecord* value) {
+    RecordRef ref = pack(arena, slab, value);
+    if (ref == RECORD_NIL) {
+        return 0;
+    }
+    const CacheRecord* record = record_at(arena, ref);
+    DNSRecord out;
+    memset(&out, 0, sizeof(out));
+    record_unpack(record, names, &out);
+    NameId target = value->type == RR_CNAME ? name_find(names, value->value.cname) : NAME_NIL;
+    int ok = DNSRecord_compare(&out, value) && record_equal(record, value, name_find(names, value->domain), target) &&
+             out.expire_time == value->expire_time && out.ttl == value->ttl && out.flags == value->flags;
+    if (value->type == RR_NEGATIVE) {
+        const NegativeAnswer* a = &value->value.negative;
+        const NegativeAnswer* b = &out.value.negative;
+        ok &= a->rcode == b->rcode && a->owner_len == b->owner_len && a->rdata_len == b->rdata_len &&
+              memcmp(a->soa, b->soa, a->owner_len + a->rdata_len) == 0;
+    }
+    release(arena, slab, ref);
+    return ok;
+}
+
+int main() {
+    RecordArena arena;
+    RecordSlab slab;
+    memset(&slab, 0, sizeof(slab));
+    names = name_table_create((size_t)4 << 20);
+    check(record_arena_init(&arena, 1) == 0, "init");
+    check(arena.size == (2 << 20) && ((uintptr_t)arena.base & ((2 << 20) - 1)) == 0, "aligned to a huge page");
+
+    // 各类型打包后都能原样解码
+    DNSRecord value;
+    uint32_t ip = 0x01020304;
+    DNSRecord_init(&value, "www.example.com", 1000, RR_A, &ip);
+    value.ttl = 300;
+    value.flags = RECORD_STATIC;
+    check(round_trip(&arena, &slab, &value), "A round trip");
+    uint8_t ipv6[16] = {0x20, 0x01, 0x0d, 0xb8, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    DNSRecord_init(&value, "v6.example.com", 1000, RR_AAAA, ipv6);
+    check(round_trip(&arena, &slab, &value), "AAAA round trip");
+    DNSRecord_init(&value, "www.example.com", 1000, RR_CNAME, "edge.cdn.example.net");
+    check(round_trip(&arena, &slab, &value), "CNAME round trip");
+    NegativeAnswer negative;
+    memset(&negative, 0, sizeof(negative));
+    negative.qtype = RR_AAAA;
+    negative.owner_len = 9;
+    negative.rdata_len = 40;
+    for (int i = 0; i < 49; i++) {
+        negative.soa[i] = (uint8_t)(i * 7);
+    }
+    DNSRecord_init(&value, "gone.example.com", 1000, RR_NEGATIVE, &negative);
+    check(round_trip(&arena, &slab, &value), "negative round trip");
+    RecordRef ref = pack(&arena, &slab, &value);
+    check(record_negative_qtype(record_at(&arena, ref)) == RR_AAAA, "negative qtype");
+    release(&arena, &slab, ref);
+
+    // 名字以规范的小写形式解码
+    DNSRecord out;
+    DNSRecord_init(&value, "WWW.Example.com", 1000, RR_CNAME, "Edge.CDN.example.net");
+    ref = pack(&arena, &slab, &value);
+    record_unpack(record_at(&arena, ref), names, &out);
+    check(strcmp(out.domain, "www.example.com") == 0 && strcmp(out.value.cname, "edge.cdn.example.net") == 0,
+          "canonical names");
+    release(&arena, &slab, ref);
+
+    // 最长的域名加最长的 CNAME 目标放得下
+    char long_name[DOMAIN_MAX_LEN];
+    memset(long_name, 'a', DOMAIN_MAX_LEN - 1);
+    long_name[DOMAIN_MAX_LEN - 1] = '\0';
+    DNSRecord_init(&value, long_name, 1000, RR_CNAME, long_name);
+    check(round_trip(&arena, &slab, &value), "longest names");
+
+    // 紧凑：常见的 A 记录 48 字节，名字不论多长都只占一个 NameId
+    DNSRecord_init(&value, "www.example.com", 1000, RR_A, &ip);
+    check(record_packed_size(&value) <= 48 && sizeof(DNSRecord) >= 8 * 64, "compact A record");
+    check(slab_class(32) == 0 && slab_class(33) == 1 && slab_class(320) == RECORD_CLASSES - 1 &&
+          slab_class(321) == -1, "size classes");
+    RecordRef a = pack(&arena, &slab, &value);
+    NameId www = name_find(names, "www.example.com");
+    check(a != RECORD_NIL, "allocated");
+    check(slab.bytes == 48, "A record in the 48-byte class");
+    check(record_ref(&arena, record_at(&arena, a)) == a, "ref and address");
+    check(record_at(&arena, a)->name == www && strcmp(name_string(names, www), "www.example.com") == 0,
+          "name stored by id");
+    DNSRecord other = value;
+    other.value.ipv4 = ip + 1;
+    check(!record_equal(record_at(&arena, a), &other, www, NAME_NIL), "different address");
+    other.value.ipv4 = ip;
+    check(!record_equal(record_at(&arena, a), &other, name_intern(names, "v6.example.com"), NAME_NIL),
+          "different name");
+    name_release(names, name_find(names, "v6.example.com"));
+    check(record_equal(record_at(&arena, a), &other, name_find(names, "WWW.example.com"), NAME_NIL),
+          "names compared by id, case-insensitively");
+
+    // 释放的记录被同一大小类复用
+    release(&arena, &slab, a);
+    check(slab.bytes == 0, "bytes released");
+    check(pack(&arena, &slab, &value) == a, "free list reused");
+    DNSRecord_init(&value, "v6.example.com", 1000, RR_AAAA, ipv6);
+    RecordRef b = pack(&arena, &slab, &value);
+    check(b != a && b != RECORD_NIL, "other class carved separately");
+
+    // 用尽保留的地址空间后分配失败，不会越界；RECORD_NIL 从不被分配
+    DNSRecord_init(&value, "www.example.com", 1000, RR_A, &ip);
+    int count = 0, out_of_range = 0;
+    NameId name = name_intern(names, value.domain);
+    for (;;) {
+        ref = record_pack(&arena, &slab, &value, name, NAME_NIL);
+        if (ref == RECORD_NIL) {
+            break;
+        }
+        out_of_range |= (size_t)ref * RECORD_UNIT >= arena.size;
+        count++;
+    }
+    check(!out_of_range && count > (int)(arena.size / 48) * 9 / 10, "arena filled");
+    check(slab.bytes <= arena.size, "bytes within the arena");
+
+    // 多个分片共用一个 arena，各自切块
+    RecordSlab second;
+    memset(&second, 0, sizeof(second));
+    check(record_pack(&arena, &second, &value, name, NAME_NIL) == RECORD_NIL, "exhausted for every shard");
+    record_arena_destroy(&arena);
+    check(record_arena_init(&arena, (size_t)4 << 20) == 0, "reinit");
+    memset(&slab, 0, sizeof(slab));
+    memset(&second, 0, sizeof(second));
+    RecordRef x = record_pack(&arena, &slab, &value, name, NAME_NIL);
+    RecordRef y = record_pack(&arena, &second, &value, name, NAME_NIL);
+    check(x != RECORD_NIL && y != RECORD_NIL && (x > y ? x - y : y - x) * RECORD_UNIT >= 64 << 10,
+          "shards carve separate chunks");
+    record_arena_destroy(&arena);
+    name_table_destroy(names);
+
+    if (failures == 0) {
+        printf("All record layout tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/*
+gcc -I src src/sketch.c test/test_sketch.c -o test/test_sketch -lpthread
+*/
+
+#include "../src/sketch.h"
+#include "../src/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS 1000
+#define THREADS 4
+#define THREAD_ROUNDS 200000
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// 与名字哈希一样分布均匀的键
+static uint64_t key_hash(uint64_t key) {
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+static FrequencySketch shared;
+
+// 各线程不加锁地增加同一批键
+static void* increment(void* arg) {
+    (void)arg;
+    for (int i = 0; i < THREAD_ROUNDS; i++) {
+        sketch_increment(&shared, key_hash((uint64_t)(i % 64)));
+    }
+    return NULL;
+}
+
+int main() {
+    FrequencySketch sketch;
+    check(sketch_init(&sketch, KEYS) == 0, "init");
+    check(((sketch.mask + 1) & sketch.mask) == 0 && (sketch.mask + 1) * 4 >= KEYS, "groups cover the capacity");
+    check(sketch.sample == KEYS * SKETCH_SAMPLE_FACTOR, "sample size");
+    check(sketch_estimate(&sketch, key_hash(1)) == 0, "unseen key");
+
+    // 计数到上限为止
+    for (int i = 0; i < 20; i++) {
+        sketch_increment(&sketch, key_hash(1));
+    }
+    check(sketch_estimate(&sketch, key_hash(1)) == SKETCH_MAX, "saturates");
+
+    // 键 k 增加 k % 8 次：估计从不低于实际次数，容量以内几乎没有高估
+    for (uint64_t k = 2; k < KEYS; k++) {
+        for (uint64_t n = 0; n < k % 8; n++) {
+            sketch_increment(&sketch, key_hash(k));
+        }
+    }
+    int under = 0, exact = 0;
+    for (uint64_t k = 2; k < KEYS; k++) {
+        int estimate = sketch_estimate(&sketch, key_hash(k));
+        under += estimate < (int)(k % 8);
+        exact += estimate == (int)(k % 8);
+    }
+    check(under == 0, "never underestimates");
+    check(exact > (KEYS - 2) * 95 / 100, "few overestimates");
+
+    // 累计增加达到 sample 才老化，老化后计数减半
+    check(sketch_age(&sketch) == 0, "no aging before the sample");
+    for (uint64_t k = KEYS; sketch.additions < sketch.sample; k++) {
+        sketch_increment(&sketch, key_hash(k));
+    }
+    int before = sketch_estimate(&sketch, key_hash(7));
+    uint32_t additions = sketch.additions;
+    check(sketch_age(&sketch) == 1, "aged after the sample");
+    check(sketch_estimate(&sketch, key_hash(7)) == before / 2 && sketch_estimate(&sketch, key_hash(1)) == SKETCH_MAX / 2,
+          "counters halved");
+    check(sketch.additions == additions / 2, "additions halved");
+    sketch_free(&sketch);
+    check(sketch.table == NULL, "freed");
+
+    // 多个线程并发增加：可能丢掉个别增加，热门的键仍计到上限
+    check(sketch_init(&shared, 64) == 0, "init shared");
+    thread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        thread_create(&threads[i], increment, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        thread_join(threads[i]);
+    }
+    int saturated = 1;
+    for (uint64_t k = 0; k < 64; k++) {
+        saturated &= sketch_estimate(&shared, key_hash(k)) == SKETCH_MAX;
+    }
+    check(saturated, "concurrent increments");
+    sketch_free(&shared);
+
+    if (failures == 0) {
+        printf("All frequency sketch tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/*
+gcc -I src src/timer.c test/test_timer.c -o test/test_timer
+*/
+
+#include "../src/timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 1000
+
+typedef struct Item {
+    TimerNode node;
+    uint64_t due_ms;    // 期望的到期时间
+    uint64_t fired_ms;  // 实际到期时间，0 表示未到期
+} Item;
+
+static Item items[N];
+static uint64_t now_ms;
+static int failures;
+
+static void on_expire(TimerNode* node, void* arg) {
+    Item* item = (Item*)node;
+    (void)arg;
+    item->fired_ms = now_ms;
+}
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    TimerWheel wheel = {0};
+    now_ms = 1700000000000ULL;  // 时间轮不要求从 0 开始
+    srand(1);
+
+    // 跨越多个层级的随机超时
+    for (int i = 0; i < N; i++) {
+        uint64_t timeout = (uint64_t)(rand() % 600000) + 1;
+        items[i].due_ms = now_ms + timeout;
+        timer_wheel_add(&wheel, &items[i].node, now_ms, timeout);
+    }
+    check(wheel.count == N, "count after add");
+
+    // 取消一半
+    for (int i = 0; i < N; i += 2) {
+        timer_wheel_cancel(&wheel, &items[i].node);
+        check(!timer_node_pending(&items[i].node), "cancelled node not pending");
+    }
+    check(wheel.count == N / 2, "count after cancel");
+
+    // 以不规则步长推进 11 分钟
+    uint64_t end = now_ms + 660000;
+    while (now_ms < end) {
+        now_ms += (uint64_t)(rand() % 700) + 1;
+        timer_wheel_advance(&wheel, now_ms, on_expire, NULL);
+    }
+    check(wheel.count == 0, "all timers expired");
+
+    for (int i = 0; i < N; i++) {
+        if (i % 2 == 0) {
+            check(items[i].fired_ms == 0, "cancelled timer fired");
+        } else {
+            check(items[i].fired_ms >= items[i].due_ms, "timer fired early");
+            check(items[i].fired_ms < items[i].due_ms + TIMER_WHEEL_TICK_MS + 700, "timer fired late");
+        }
+    }
+
+    // 重新添加已挂在轮上的节点等同于改期
+    timer_wheel_add(&wheel, &items[0].node, now_ms, 5000);
+    timer_wheel_add(&wheel, &items[0].node, now_ms, 100);
+    check(wheel.count == 1, "re-add replaces");
+    items[0].fired_ms = 0;
+    now_ms += 1000;
+    check(timer_wheel_advance(&wheel, now_ms, on_expire, NULL) == 1, "rescheduled timer expired");
+
+    if (failures == 0) {
+        printf("All timer wheel tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/*
+gcc -I src src/trie.c src/record.c test/test_trie_art.c -o test/test_trie_art
+*/
+
+#include "../src/trie.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMES 3000
+
+static int failures;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static RecordArena arena;
+static RecordSlab slab;
+static char names[NAMES][64];
+static RecordRef records[NAMES];
+static int present[NAMES];
+
+// a 是否为 b 本身或 b 的子域（不区分大小写）
+static int within(const char* a, const char* b) {
+    size_t la = strlen(a), lb = strlen(b);
+    if (la < lb || strcasecmp(a + la - lb, b) != 0) {
+        return 0;
+    }
+    return la == lb || a[la - lb - 1] == '.';
+}
+
+// 每个名字都能找到，且节点的 sum 等于它自身加上仍在树中的子域数
+static int consistent(TrieNode* root) {
+    int ok = 1, total = 0;
+    for (int i = 0; i < NAMES; i++) {
+        TrieNode* node = trie_search(root, names[i]);
+        if (!present[i]) {
+            ok &= node == NULL || node->head != records[i];
+            continue;
+        }
+        total++;
+        int expected = 0;
+        for (int j = 0; j < NAMES; j++) {
+            expected += present[j] && within(names[j], names[i]);
+        }
+        ok &= node != NULL && node->isEnd && node->sum == expected;
+    }
+    return ok && root->sum == total;
+}
+
+// 在 arena 中建一条 A 记录；Trie 的键由调用方给出，这里不需要驻留名字
+static RecordRef make_record(const char* domain, uint32_t ip) {
+    DNSRecord value;
+    DNSRecord_init(&value, domain, 0, RR_A, &ip);
+    return record_pack(&arena, &slab, &value, NAME_NIL, NAME_NIL);
+}
+
+static uint32_t seed = 12345;
+
+static uint32_t rnd(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+int main() {
+    TrieNode* root = trie_create();
+    record_arena_init(&arena, (size_t)NAMES * 64 * 2);
+
+    // 基本语义：大小写、重复、非法字符、同名多条记录
+    RecordRef a = make_record("www.example.com", 1);
+    RecordRef b = make_record("www.example.com", 2);
+    RecordRef c = make_record("example.com", 2);
+    RecordRef bad = make_record("bad_name.com", 2);
+    check(trie_insert(root, "www.example.com", &arena, a) == 1, "insert");
+    check(trie_insert(root, "www.example.com", &arena, a) == 0, "duplicate");
+    check(trie_insert(root, "www.example.com", &arena, b) == 1, "second record");
+    check(trie_search(root, "WWW.Example.Com") != NULL, "case-insensitive");
+    check(trie_search(root, "example.com") == NULL, "suffix is not a name");
+    check(trie_search(root, "ww.example.com") == NULL, "partial label");
+    check(trie_insert(root, "bad_name.com", &arena, bad) == -1, "invalid character");
+    check(trie_insert(root, "example.com", &arena, c) == 1, "insert parent");
+    TrieNode* node = trie_search(root, "example.com");
+    check(node != NULL && node->sum == 2 && node->head == c, "parent sum");
+    check(root->sum == 2, "root sum");
+    trie_delete(root, "www.example.com", &arena, a);
+    node = trie_search(root, "www.example.com");
+    check(node != NULL && node->head == b && node->tail == b && record_at(&arena, b)->prev == RECORD_NIL,
+          "unlink one record");
+    check(root->sum == 2, "name kept while records remain");
+    // 原位替换，树的结构不变
+    trie_replace(root, "www.example.com", &arena, b, a);
+    node = trie_search(root, "www.example.com");
+    check(node != NULL && node->head == a && node->tail == a && root->sum == 2, "replace");
+    trie_delete(root, "www.example.com", &arena, a);
+    check(trie_search(root, "www.example.com") == NULL && root->sum == 1, "name removed");
+    trie_delete(root, "example.com", &arena, c);
+    size_t nodes = 0;
+    trie_memory(root, &nodes);
+    check(root->sum == 0 && root->count == 0 && nodes == 1, "tree empty");
+    record_free(&arena, &slab, a);
+    record_free(&arena, &slab, b);
+    record_free(&arena, &slab, c);
+    record_free(&arena, &slab, bad);
+
+    // 随机名字（大量共享后缀与子域关系）反复增删，与暴力计算的结果比对
+    static const char* zones[] = {"com", "net", "example.com", "a.example.com", "cn", "edu.cn", "x.edu.cn"};
+    for (int i = 0; i < NAMES; i++) {
+        int kind = rnd() % 4;
+        if (kind == 0) {
+            snprintf(names[i], sizeof(names[i]), "%s", zones[rnd() % 7]);
+        } else if (kind == 1) {
+            snprintf(names[i], sizeof(names[i]), "h%u.%s", rnd() % 200, zones[rnd() % 7]);
+        } else {
+            snprintf(names[i], sizeof(names[i]), "%c%u.s%u.%s", 'a' + rnd() % 26, rnd() % 50, rnd() % 40,
+                     zones[rnd() % 7]);
+        }
+        int duplicate = 0;
+        for (int j = 0; j < i; j++) {
+            duplicate |= strcmp(names[j], names[i]) == 0;
+        }
+        if (duplicate) {    // sum 按名字计数，每个名字只用一次
+            i--;
+            continue;
+        }
+        records[i] = make_record(names[i], (uint32_t)i);
+    }
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < NAMES; i++) {
+            if (!present[i] && rnd() % 2) {
+                present[i] = trie_insert(root, names[i], &arena, records[i]) == 1;
+            }
+        }
+        check(consistent(root), "consistent after inserts");
+        for (int i = 0; i < NAMES; i++) {
+            if (present[i] && rnd() % 3 == 0) {
+                trie_delete(root, names[i], &arena, records[i]);
+                present[i] = 0;
+            }
+        }
+        check(consistent(root), "consistent after deletes");
+    }
+
+    // 每个名字只占少量内存
+    nodes = 0;
+    size_t bytes = trie_memory(root, &nodes);
+    check(bytes / (size_t)root->sum < 300, "compact nodes");
+
+    for (int i = 0; i < NAMES; i++) {
+        if (present[i]) {
+            trie_delete(root, names[i], &arena, records[i]);
+        }
+        record_free(&arena, &slab, records[i]);
+    }
+    nodes = 0;
+    trie_memory(root, &nodes);
+    check(root->sum == 0 && nodes == 1, "all nodes released");
+    trie_free(root);
+    check(slab.bytes == 0, "records returned to the slab");
+    record_arena_destroy(&arena);
+
+    if (failures == 0) {
+        printf("All trie tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+/*
+gcc -I src -fcommon src/uring.c src/batch.c src/event.c src/log.c test/test_uring.c -o test/test_uring -lpthread -Wl,--wrap=syscall
+用假的 receiveClient/receiveServer 代替 server.c：客户端 socket 上以 'e' 开头的数据报原样回送，其余只计数；
+工作线程由事件循环的定时器停止，收包出问题时测试也不会卡住
+*/
+
+#include "../src/server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define BULK 1500   // 超过一个缓冲区环（1024 个缓冲区），收完必须在 -ENOBUFS 之后重新挂载 multishot recvmsg
+#define UPSTREAM_DATAGRAMS 3
+
+static int failures;
+static int fail_syscall = -1;  // 让这个系统调用以 ENOSYS 失败，模拟不支持 io_uring 的内核
+static int bulk_received;
+static int upstream_received[UPSTREAM_SOCKETS];
+static int ticks;
+static int stop_requested;
+
+long __real_syscall(long number, ...);
+
+long __wrap_syscall(long number, ...) {
+    va_list ap;
+    va_start(ap, number);
+    long a = va_arg(ap, long), b = va_arg(ap, long), c = va_arg(ap, long);
+    long d = va_arg(ap, long), e = va_arg(ap, long), f = va_arg(ap, long);
+    va_end(ap);
+    if (number == fail_syscall) {
+        errno = ENOSYS;
+        return -1;
+    }
+    return __real_syscall(number, a, b, c, d, e, f);
+}
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+void receiveClient(DNSWorker* w, char* buf, int recv_len, const struct sockaddr_in* cli) {
+    if (buf[0] == 'e') {
+        batch_queue(w->client_tx, buf, recv_len, cli);
+    } else {
+        __atomic_fetch_add(&bulk_received, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void receiveServer(Upstream* up, char* buf, int recv_len) {
+    (void)buf;
+    (void)recv_len;
+    __atomic_fetch_add(&upstream_received[up->index], 1, __ATOMIC_RELAXED);
+}
+
+void worker_flush(DNSWorker* w) {
+    batch_flush(w->client_tx);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        batch_flush(w->upstreams[i].tx);
+    }
+}
+
+static void on_tick(void* arg) {
+    DNSWorker* w = (DNSWorker*)arg;
+    __atomic_fetch_add(&ticks, 1, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&stop_requested, __ATOMIC_RELAXED)) {
+        event_loop_stop(w->loop);
+    }
+}
+
+static int udp_socket(struct sockaddr_in* addr, int nonblocking) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+        getsockname(fd, (struct sockaddr*)addr, &len) < 0) {
+        return -1;
+    }
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (nonblocking) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+static int worker_result = -2;
+
+static void* run_worker(void* arg) {
+    worker_result = uring_worker_run((DNSWorker*)arg);
+    return NULL;
+}
+
+static int wait_for(int* counter, int target) {
+    for (int i = 0; i < 200 && __atomic_load_n(counter, __ATOMIC_RELAXED) < target; i++) {
+        usleep(10000);
+    }
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+int main() {
+    static DNSWorker worker;
+    DNSWorker* w = &worker;
+    struct sockaddr_in client_addr, upstream_addr[UPSTREAM_SOCKETS], peer_addr;
+    w->client_socket = udp_socket(&client_addr, 1);
+    int peer = udp_socket(&peer_addr, 0);
+    w->client_rx = batch_create(w->client_socket, batch_size);
+    w->client_tx = batch_create(w->client_socket, batch_size);
+    for (int i = 0; i < UPSTREAM_SOCKETS; i++) {
+        w->upstreams[i].w = w;
+        w->upstreams[i].index = i;
+        w->upstreams[i].sock = udp_socket(&upstream_addr[i], 1);
+        w->upstreams[i].rx = batch_create(w->upstreams[i].sock, batch_size);
+        w->upstreams[i].tx = batch_create(w->upstreams[i].sock, batch_size);
+    }
+    w->loop = event_loop_create();
+    if (w->client_socket < 0 || peer < 0 || w->loop == NULL) {
+        printf("FAIL: could not set up the worker\n");
+        return 1;
+    }
+    struct timeval timeout = {2, 0};
+    setsockopt(peer, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // 内核不支持 io_uring 或缓冲区环：返回 -1，发送批次仍走 sendmmsg，由调用方退回 epoll
+    fail_syscall = __NR_io_uring_setup;
+    check(uring_worker_run(w) == -1, "io_uring_setup failure falls back");
+    fail_syscall = __NR_io_uring_register;
+    check(uring_worker_run(w) == -1, "buffer ring registration failure falls back");
+    fail_syscall = -1;
+    check(w->client_tx->flush_hook == NULL && w->upstreams[0].tx->flush_hook == NULL, "send hooks left unset");
+    char data[BUFFER_SIZE];
+    batch_queue(w->client_tx, "fallback", 8, &peer_addr);
+    check(batch_flush(w->client_tx) == 1, "fallback batch sent without io_uring");
+    check(recv(peer, data, sizeof(data), 0) == 8 && memcmp(data, "fallback", 8) == 0, "fallback datagram arrives");
+
+    // 内核或容器不允许 io_uring 时只测退回路径
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int probe = (int)__real_syscall(__NR_io_uring_setup, 1, &params);
+    if (probe < 0) {
+        printf("io_uring unavailable (errno %d), skipping loopback tests\n", errno);
+        if (failures == 0) {
+            printf("All io_uring tests passed\n");
+        }
+        return failures ? 1 : 0;
+    }
+    close(probe);
+
+    // 工作线程启动前就排好超过缓冲区环容量的数据报
+    memset(data, 'b', sizeof(data));
+    for (int i = 0; i < BULK; i++) {
+        sendto(peer, data, 64, 0, (struct sockaddr*)&client_addr, sizeof(client_addr));
+    }
+    for (int i = 0; i < UPSTREAM_DATAGRAMS; i++) {
+        sendto(peer, "u", 1, 0, (struct sockaddr*)&upstream_addr[2], sizeof(upstream_addr[2]));
+    }
+    int timer = event_timer_add(w->loop, on_tick, w);
+    event_timer_set(w->loop, timer, 10);
+
+    thread_t thread;
+    if (thread_create(&thread, run_worker, w) != 0) {
+        printf("FAIL: could not start the worker thread\n");
+        return 1;
+    }
+
+    // 回送经由 io_uring 的 sendmsg 发出，来源是客户端 socket
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    sendto(peer, "echo 1", 6, 0, (struct sockaddr*)&client_addr, sizeof(client_addr));
+    int n = recvfrom(peer, data, sizeof(data), 0, (struct sockaddr*)&from, &from_len);
+    check(n == 6 && memcmp(data, "echo 1", 6) == 0, "loopback echo through io_uring");
+    check(from.sin_port == client_addr.sin_port, "echo sent from the client socket");
+
+    check(wait_for(&bulk_received, BULK) == BULK, "every datagram received after the buffer ring ran dry");
+    check(wait_for(&upstream_received[2], UPSTREAM_DATAGRAMS) == UPSTREAM_DATAGRAMS &&
+          upstream_received[0] == 0 && upstream_received[1] == 0, "upstream datagrams routed by socket");
+    check(wait_for(&ticks, 3) >= 3, "event loop timers fire under io_uring");
+
+    // 缓冲区重新挂载之后的数据报同样能回送
+    sendto(peer, "echo 2", 6, 0, (struct sockaddr*)&client_addr, sizeof(client_addr));
+    n = recv(peer, data, sizeof(data), 0);
+    check(n == 6 && memcmp(data, "echo 2", 6) == 0, "echo after re-arm");
+
+    __atomic_store_n(&stop_requested, 1, __ATOMIC_RELAXED);
+    thread_join(thread);
+    check(worker_result == 0, "worker stops cleanly");
+    check(w->client_rx->stats.packets == BULK + 2 && w->client_tx->flush_hook == NULL, "stats kept, hooks restored");
+
+    event_loop_destroy(w->loop);
+    if (failures == 0) {
+        printf("All io_uring tests passed\n");
+    }
+    return failures ? 1 : 0;
+}
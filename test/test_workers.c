@@ -0,0 +1,232 @@
+/*
+gcc -I src -fcommon src/server.c src/cache.c src/sketch.c src/hashindex.c src/trie.c src/record.c src/names.c src/epoch.c src/arena.c src/log.c src/dnsStruct.c src/response.c src/blacklist.c src/host.c src/event.c src/batch.c src/uring.c src/inflight.c src/timer.c src/pktcache.c src/qlog.c src/metrics.c test/test_workers.c -o test/test_workers -lpthread -lrt
+多个工作线程的冒烟测试：中继运行在回环地址的高位端口上，上游是 127.0.0.2 上的假 DNS 服务器；
+多个客户端线程各用几个 socket（源端口不同，由 SO_REUSEPORT 分到不同工作线程）并发查询同一批名字，
+记录缓存被各工作线程同时读写，检查每个应答都正确，且共享缓存确实在工作线程之间生效
+*/
+
+#include "../src/server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WORKERS 4
+#define CLIENTS 4           // 客户端线程数
+#define CLIENT_SOCKETS 4    // 每个客户端线程的 socket 数
+#define ROUNDS 150          // 每个 socket 的查询数
+#define NAMES 32            // nK.smoke.test，TTL 1 秒，测试期间反复过期、重新插入
+#define SHARED_NAME "shared.smoke.test"  // TTL 60 秒，只应向上游查询一次
+
+DNSCache *dns_cache;
+
+static int failures;
+static int port;
+static int upstream_queries;
+static int client_answers;
+
+static void check(int cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// 名字对应的地址：nK 为 10.0.K/256.K%256，其余为 10.1.0.1
+static uint32_t name_ip(const char* label, int label_len) {
+    if (label_len > 1 && label[0] == 'n') {
+        int k = atoi(label + 1);
+        return htonl(0x0A000000u | (uint32_t)k);
+    }
+    return htonl(0x0A010001u);
+}
+
+// 假上游：原样带回问题，附一条 A 记录
+static void* run_upstream(void* arg) {
+    int sock = *(int*)arg;
+    char buf[BUFFER_SIZE];
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr*)&from, &from_len);
+        if (len <= 12 || len + 16 > (int)sizeof(buf)) {
+            continue;
+        }
+        __atomic_fetch_add(&upstream_queries, 1, __ATOMIC_RELAXED);
+        const char* label = buf + 13;
+        int label_len = (uint8_t)buf[12];
+        uint32_t ttl = label[0] == 'n' ? 1 : 60;
+        uint32_t ip = name_ip(label, label_len);
+
+        buf[2] = (char)0x81;  // QR RD RA，RCODE 0
+        buf[3] = (char)0x80;
+        buf[7] = 1;           // ANCOUNT
+        uint8_t answer[16] = {0xC0, 0x0C, 0, RR_A, 0, 1,
+                              ttl >> 24, ttl >> 16, ttl >> 8, ttl, 0, 4};
+        memcpy(answer + 12, &ip, 4);
+        memcpy(buf + len, answer, sizeof(answer));
+        sendto(sock, buf, len + sizeof(answer), 0, (struct sockaddr*)&from, from_len);
+    }
+    return NULL;
+}
+
+static void* run_relay(void* arg) {
+    (void)arg;
+    dns_poll();
+    return NULL;
+}
+
+// 发一个 A 查询并等应答，检查事务 ID、RCODE 和最后一条记录的地址
+static int ask(int sock, uint16_t txid, const char* name) {
+    char query[BUFFER_SIZE];
+    memset(query, 0, 12);
+    query[0] = txid >> 8;
+    query[1] = txid & 0xFF;
+    query[2] = 0x01;  // RD
+    query[5] = 1;     // QDCOUNT
+    int len = 12;
+    const char* label = name;
+    while (*label) {
+        const char* dot = strchr(label, '.');
+        int n = dot ? (int)(dot - label) : (int)strlen(label);
+        query[len++] = n;
+        memcpy(query + len, label, n);
+        len += n;
+        label += dot ? n + 1 : n;
+    }
+    query[len++] = 0;
+    query[len++] = 0;
+    query[len++] = RR_A;
+    query[len++] = 0;
+    query[len++] = 1;
+
+    struct sockaddr_in relay;
+    memset(&relay, 0, sizeof(relay));
+    relay.sin_family = AF_INET;
+    relay.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    relay.sin_port = htons(port);
+    sendto(sock, query, len, 0, (struct sockaddr*)&relay, sizeof(relay));
+
+    uint8_t reply[BUFFER_SIZE];
+    int n = recv(sock, reply, sizeof(reply), 0);
+    if (n < 12 + 16 || reply[0] != query[0] || reply[1] != (uint8_t)query[1] || (reply[3] & 0x0F) != 0 ||
+        reply[7] == 0) {
+        return 0;
+    }
+    uint32_t ip = name_ip(name, (int)strcspn(name, "."));
+    return memcmp(reply + n - 4, &ip, 4) == 0;
+}
+
+static int client_socket(void) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static void* run_client(void* arg) {
+    int id = (int)(intptr_t)arg;
+    int socks[CLIENT_SOCKETS];
+    for (int i = 0; i < CLIENT_SOCKETS; i++) {
+        socks[i] = client_socket();
+    }
+    char name[64];
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < CLIENT_SOCKETS; i++) {
+            int k = (round * 7 + id * CLIENT_SOCKETS + i) % NAMES;
+            snprintf(name, sizeof(name), "n%d.smoke.test", k);
+            if (ask(socks[i], (uint16_t)(id << 12 | round), name)) {
+                __atomic_fetch_add(&client_answers, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    for (int i = 0; i < CLIENT_SOCKETS; i++) {
+        close(socks[i]);
+    }
+    return NULL;
+}
+
+static uint64_t sum_workers(size_t offset) {
+    uint64_t sum = 0;
+    for (int i = 0; i < worker_count; i++) {
+        sum += *(volatile uint64_t*)((char*)&metrics->workers[i] + offset);
+    }
+    return sum;
+}
+
+int main() {
+    port = 20000 + getpid() % 20000;
+    worker_count = WORKERS;
+    metrics_name = NULL;
+    remote_dns = "127.0.0.2";
+
+    // 上游与中继用同一个端口号，上游绑定具体地址，优先于中继绑定的 INADDR_ANY
+    int upstream = socket(AF_INET, SOCK_DGRAM, 0);
+    const int REUSE = 1;
+    setsockopt(upstream, SOL_SOCKET, SO_REUSEADDR, &REUSE, sizeof(REUSE));
+    struct sockaddr_in upstream_addr;
+    memset(&upstream_addr, 0, sizeof(upstream_addr));
+    upstream_addr.sin_family = AF_INET;
+    upstream_addr.sin_addr.s_addr = inet_addr(remote_dns);
+    upstream_addr.sin_port = htons(port);
+    if (upstream < 0 || bind(upstream, (struct sockaddr*)&upstream_addr, sizeof(upstream_addr)) < 0) {
+        printf("FAIL: could not bind the fake upstream on %s:%d\n", remote_dns, port);
+        return 1;
+    }
+
+    init_socket(port);
+    init_DNS();
+    init_metrics();
+    check(worker_count == WORKERS, "all workers started");
+
+    thread_t upstream_thread, relay_thread;
+    if (thread_create(&upstream_thread, run_upstream, &upstream) != 0 ||
+        thread_create(&relay_thread, run_relay, NULL) != 0) {
+        printf("FAIL: could not start the relay\n");
+        return 1;
+    }
+
+    // 一个工作线程查到的记录，其他工作线程直接从共享缓存应答
+    int first = client_socket();
+    check(ask(first, 1, SHARED_NAME), "first query answered through the upstream");
+    check(__atomic_load_n(&upstream_queries, __ATOMIC_RELAXED) == 1, "first query forwarded once");
+    int shared_ok = 1;
+    for (int i = 0; i < 16; i++) {
+        int sock = client_socket();
+        shared_ok &= ask(sock, (uint16_t)(100 + i), SHARED_NAME);
+        close(sock);
+    }
+    close(first);
+    check(shared_ok, "shared name answered from every source port");
+    check(__atomic_load_n(&upstream_queries, __ATOMIC_RELAXED) == 1, "other workers hit the shared cache");
+    int busy = 0;
+    for (int i = 0; i < worker_count; i++) {
+        busy += metrics->workers[i].queries > 0;
+    }
+    check(busy >= 2, "queries spread over more than one worker");
+
+    // 各工作线程同时插入、读取、过期同一批名字
+    thread_t clients[CLIENTS];
+    for (int i = 0; i < CLIENTS; i++) {
+        thread_create(&clients[i], run_client, (void*)(intptr_t)i);
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        thread_join(clients[i]);
+    }
+    int total = CLIENTS * CLIENT_SOCKETS * ROUNDS;
+    check(client_answers == total, "every concurrent query answered correctly");
+    check(__atomic_load_n(&upstream_queries, __ATOMIC_RELAXED) < total / 2, "most concurrent queries hit the cache");
+    check(sum_workers(offsetof(WorkerMetrics, queries)) == (uint64_t)total + 17, "every query counted once");
+
+    // 预取等收尾的上游查询完成后，各工作线程的在途表应清空
+    usleep(300000);
+    check(sum_workers(offsetof(WorkerMetrics, inflight_used)) == 0, "in-flight tables drained");
+    check(sum_workers(offsetof(WorkerMetrics, inflight_rejected)) == 0, "no query rejected for a full table");
+    check(sum_workers(offsetof(WorkerMetrics, upstream_unmatched)) == 0, "every upstream response matched");
+
+    if (failures == 0) {
+        printf("All multi-worker tests passed\n");
+    }
+    // 工作线程不会退出，直接结束进程
+    exit(failures ? 1 : 0);
+}
@@ -0,0 +1,183 @@
+/*
+指标查看工具：只读映射 dnsrelay 导出的共享内存，汇总各工作线程的计数与直方图
+用法：dnsrelay-stats [-n NAME] [-w] [-s] [-i SEC]
+    -n NAME  共享内存名（默认 /dnsrelay-stats，与中继的 -metrics 一致）
+    -w       另外列出每个工作线程
+    -s       另外列出记录缓存的每个分片
+    -i SEC   每隔 SEC 秒刷新一次，速率按两次读取之间的差值计算
+*/
+
+#include "../src/metrics.h"
+#include "../src/qlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+static void sum_workers(const MetricsShared* metrics, WorkerMetrics* total) {
+    memset(total, 0, sizeof(*total));
+    for (uint32_t i = 0; i < metrics->worker_count && i < METRICS_MAX_WORKERS; i++) {
+        const WorkerMetrics* w = &metrics->workers[i];
+        total->queries += w->queries;
+        for (int s = 0; s < METRICS_SOURCES; s++) {
+            total->answers[s] += w->answers[s];
+        }
+        total->forwarded += w->forwarded;
+        total->upstream_responses += w->upstream_responses;
+        total->upstream_unmatched += w->upstream_unmatched;
+        total->upstream_malformed += w->upstream_malformed;
+        total->upstream_failures += w->upstream_failures;
+        total->inflight_used += w->inflight_used;
+        total->inflight_capacity += w->inflight_capacity;
+        total->inflight_timed_out += w->inflight_timed_out;
+        total->inflight_rejected += w->inflight_rejected;
+        total->inflight_coalesced += w->inflight_coalesced;
+        total->tx_dropped += w->tx_dropped;
+        if (w->rx_max_batch > total->rx_max_batch) {
+            total->rx_max_batch = w->rx_max_batch;
+        }
+        histogram_merge(&total->answer_latency, &w->answer_latency);
+        for (int u = 0; u < UPSTREAM_SOCKETS; u++) {
+            histogram_merge(&total->upstream_rtt[u], &w->upstream_rtt[u]);
+        }
+    }
+}
+
+static void print_histogram(const char* name, const Histogram* h) {
+    if (h->count == 0) {
+        printf("  %-18s no samples\n", name);
+        return;
+    }
+    printf("  %-18s n=%llu mean=%lluus p50=%lluus p90=%lluus p99=%lluus max=%lluus\n", name,
+           (unsigned long long)h->count, (unsigned long long)(h->sum / h->count),
+           (unsigned long long)histogram_percentile(h, 50), (unsigned long long)histogram_percentile(h, 90),
+           (unsigned long long)histogram_percentile(h, 99), (unsigned long long)h->max);
+}
+
+static void print_worker(const char* title, const WorkerMetrics* w, double seconds, uint64_t queries_before) {
+    uint64_t answered = 0;
+    for (int s = 0; s < METRICS_SOURCES; s++) {
+        answered += w->answers[s];
+    }
+    uint64_t hits = w->answers[QLOG_SRC_PACKET_CACHE] + w->answers[QLOG_SRC_CACHE] + w->answers[QLOG_SRC_NEGATIVE];
+
+    printf("%s\n", title);
+    printf("  queries            %llu (%.1f/s)\n", (unsigned long long)w->queries,
+           seconds > 0 ? (w->queries - queries_before) / seconds : 0.0);
+    printf("  answers            %llu, hit ratio %.1f%%\n", (unsigned long long)answered,
+           answered ? 100.0 * hits / answered : 0.0);
+    for (int s = 1; s < METRICS_SOURCES; s++) {
+        printf("    %-16s %llu\n", qlog_source_name((uint8_t)s), (unsigned long long)w->answers[s]);
+    }
+    printf("  forwarded          %llu, responses %llu, unmatched %llu, malformed %llu, SERVFAIL/REFUSED %llu\n",
+           (unsigned long long)w->forwarded, (unsigned long long)w->upstream_responses,
+           (unsigned long long)w->upstream_unmatched, (unsigned long long)w->upstream_malformed,
+           (unsigned long long)w->upstream_failures);
+    printf("  in-flight          %llu / %llu, timed out %llu, coalesced %llu\n", (unsigned long long)w->inflight_used,
+           (unsigned long long)w->inflight_capacity, (unsigned long long)w->inflight_timed_out,
+           (unsigned long long)w->inflight_coalesced);
+    printf("  drops              tx %llu, in-flight table full %llu\n", (unsigned long long)w->tx_dropped,
+           (unsigned long long)w->inflight_rejected);
+    printf("  largest rx batch   %llu\n", (unsigned long long)w->rx_max_batch);
+    print_histogram("answer latency", &w->answer_latency);
+    for (int u = 0; u < UPSTREAM_SOCKETS; u++) {
+        char name[32];
+        snprintf(name, sizeof(name), "upstream %d rtt", u);
+        print_histogram(name, &w->upstream_rtt[u]);
+    }
+}
+
+static void print_shards(const MetricsShared* metrics) {
+    printf("cache shards\n");
+    for (uint64_t i = 0; i < metrics->cache_shards && i < METRICS_MAX_SHARDS; i++) {
+        const CacheShardMetrics* s = &metrics->shards[i];
+        uint64_t lookups = s->hits + s->misses;
+        printf("  shard %-3llu %6llu / %-6llu %6llu KB, hits %llu (%.1f%%), misses %llu, inserts %llu, evictions %llu, "
+               "rejected %llu, expired %llu\n",
+               (unsigned long long)i, (unsigned long long)s->size, (unsigned long long)s->capacity,
+               (unsigned long long)(s->bytes / 1024), (unsigned long long)s->hits,
+               lookups ? 100.0 * s->hits / lookups : 0.0, (unsigned long long)s->misses,
+               (unsigned long long)s->inserts, (unsigned long long)s->evictions,
+               (unsigned long long)s->rejected, (unsigned long long)s->expired);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* name = METRICS_DEFAULT_NAME;
+    int per_worker = 0;
+    int per_shard = 0;
+    int interval = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            name = argv[++i];
+        } else if (!strcmp(argv[i], "-w")) {
+            per_worker = 1;
+        } else if (!strcmp(argv[i], "-s")) {
+            per_shard = 1;
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            interval = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n NAME] [-w] [-s] [-i SEC]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const MetricsShared* metrics = metrics_attach(name);
+    if (metrics == NULL) {
+        fprintf(stderr, "No dnsrelay metrics found at %s\n", name);
+        return 1;
+    }
+
+    static WorkerMetrics total;
+    uint64_t queries_before = 0;
+    uint64_t worker_before[METRICS_MAX_WORKERS] = {0};
+    for (;;) {
+        struct timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        uint64_t now_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        double uptime = (now_us - metrics->started_us) / 1e6;
+        double seconds = interval > 0 && queries_before > 0 ? interval : uptime;
+
+        sum_workers(metrics, &total);
+        printf("dnsrelay pid %u, %u workers, up %.0fs\n", metrics->pid, metrics->worker_count, uptime);
+        printf("  cache              %llu / %llu records (%llu KB) in %llu shards, prefetch issued %llu used %llu, "
+               "stale answers %llu\n",
+               (unsigned long long)metrics->cache_size, (unsigned long long)metrics->cache_capacity,
+               (unsigned long long)(metrics->cache_bytes / 1024), (unsigned long long)metrics->cache_shards,
+               (unsigned long long)metrics->prefetch_issued, (unsigned long long)metrics->prefetch_used,
+               (unsigned long long)metrics->stale_served);
+        printf("  names              %llu (%llu KB)\n", (unsigned long long)metrics->names,
+               (unsigned long long)(metrics->name_bytes / 1024));
+        printf("  log records dropped %llu\n", (unsigned long long)metrics->log_dropped);
+        print_worker("total", &total, seconds, interval > 0 ? queries_before : 0);
+        queries_before = total.queries;
+        if (per_shard) {
+            print_shards(metrics);
+        }
+        if (per_worker) {
+            for (uint32_t i = 0; i < metrics->worker_count && i < METRICS_MAX_WORKERS; i++) {
+                char title[32];
+                snprintf(title, sizeof(title), "worker %u", i);
+                print_worker(title, &metrics->workers[i], seconds, interval > 0 ? worker_before[i] : 0);
+                worker_before[i] = metrics->workers[i].queries;
+            }
+        }
+        if (interval <= 0) {
+            break;
+        }
+        printf("\n");
+        fflush(stdout);
+#ifdef _WIN32
+        Sleep(interval * 1000);
+#else
+        sleep(interval);
+#endif
+    }
+    return 0;
+}
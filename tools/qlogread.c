@@ -0,0 +1,127 @@
+/*
+查询日志读取工具：把 dnsrelay -qlog 写出的段文件转换为文本或 CSV
+用法：qlogread [-csv] segment...
+*/
+
+#include "../src/qlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+#endif
+
+static const char* type_name(uint16_t qtype, char* buf, size_t size) {
+    switch (qtype) {
+    case 1: return "A";
+    case 5: return "CNAME";
+    case 6: return "SOA";
+    case 28: return "AAAA";
+    default:
+        snprintf(buf, size, "TYPE%u", qtype);
+        return buf;
+    }
+}
+
+static const char* rcode_name(uint8_t rcode, char* buf, size_t size) {
+    static const char* names[] = {"NOERROR", "FORMERR", "SERVFAIL", "NXDOMAIN", "NOTIMP", "REFUSED"};
+    if (rcode < sizeof(names) / sizeof(names[0])) {
+        return names[rcode];
+    }
+    snprintf(buf, size, "RCODE%u", rcode);
+    return buf;
+}
+
+// 整个段文件读入内存
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? (uint8_t*)malloc(length) : NULL;
+    if (data == NULL || fread(data, 1, length, fp) != (size_t)length) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+static void print_record(const QlogRecord* record, int csv) {
+    char name[256];
+    char type_buf[16];
+    char rcode_buf[16];
+    if (qlog_name(record, name, sizeof(name)) < 0) {
+        strcpy(name, "-");
+    }
+    struct in_addr addr;
+    addr.s_addr = record->client_addr;
+    const char* client = inet_ntoa(addr);
+    unsigned port = ntohs(record->client_port);
+    const char* qtype = type_name(record->qtype, type_buf, sizeof(type_buf));
+    const char* rcode = rcode_name(record->rcode, rcode_buf, sizeof(rcode_buf));
+
+    if (csv) {
+        printf("%llu,%s,%u,%s,%s,%s,%s,%u\n", (unsigned long long)record->time_us, client, port, name, qtype, rcode,
+               qlog_source_name(record->source), record->latency_us);
+        return;
+    }
+    time_t seconds = (time_t)(record->time_us / 1000000);
+    struct tm tm_time;
+#ifdef _WIN32
+    localtime_s(&tm_time, &seconds);
+#else
+    localtime_r(&seconds, &tm_time);
+#endif
+    char time_string[20];
+    strftime(time_string, sizeof(time_string), "%Y-%m-%d %H:%M:%S", &tm_time);
+    printf("%s.%06u %s:%u %s %s %s %s %uus\n", time_string, (unsigned)(record->time_us % 1000000), client, port, name,
+           qtype, rcode, qlog_source_name(record->source), record->latency_us);
+}
+
+int main(int argc, char* argv[]) {
+    int csv = 0;
+    int first = 1;
+    if (argc > 1 && !strcmp(argv[1], "-csv")) {
+        csv = 1;
+        first = 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-csv] segment...\n", argv[0]);
+        return 2;
+    }
+    if (csv) {
+        printf("time_us,client,port,qname,qtype,rcode,source,latency_us\n");
+    }
+
+    int status = 0;
+    for (int i = first; i < argc; i++) {
+        size_t size = 0;
+        uint8_t* data = read_file(argv[i], &size);
+        if (data == NULL) {
+            status = 1;
+            continue;
+        }
+        size_t used = qlog_segment_used(data, size);
+        if (used == 0) {
+            fprintf(stderr, "%s: not a query log segment\n", argv[i]);
+            status = 1;
+        }
+        size_t offset = 0;
+        const QlogRecord* record;
+        while (used > 0 && (record = qlog_next(data, used, &offset)) != NULL) {
+            print_record(record, csv);
+        }
+        free(data);
+    }
+    return status;
+}